@@ -7,9 +7,21 @@ mkdir -p isodir/boot
 mkdir -p isodir/boot/grub
 
 cp sysroot/boot/jkos.kernel isodir/boot/jkos.kernel
+
+# Every user program next to the kernel becomes a module, the kernel starts
+# one process per module.
+MODULES=""
+for PROGRAM in sysroot/boot/*; do
+  NAME=$(basename "$PROGRAM")
+  [ "$NAME" = jkos.kernel ] && continue
+  cp "$PROGRAM" isodir/boot/"$NAME"
+  MODULES="$MODULES	module /boot/$NAME $NAME
+"
+done
+
 cat > isodir/boot/grub/grub.cfg << EOF
 menuentry "jkos" {
 	multiboot /boot/jkos.kernel
-}
+$MODULES}
 EOF
 grub2-mkrescue -o jkos.iso isodir
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <kernel/cpu.h>
+#include <kernel/init.h>
+#include <kernel/tty.h>
+
+// CPUID leaf 1 EDX
+#define CPUID_EDX_FPU (0x01 << 0)
+#define CPUID_EDX_PSE (0x01 << 3)
+#define CPUID_EDX_TSC (0x01 << 4)
+#define CPUID_EDX_MSR (0x01 << 5)
+#define CPUID_EDX_APIC (0x01 << 9)
+#define CPUID_EDX_SEP (0x01 << 11)
+#define CPUID_EDX_PGE (0x01 << 13)
+#define CPUID_EDX_PAT (0x01 << 16)
+#define CPUID_EDX_MMX (0x01 << 23)
+#define CPUID_EDX_FXSR (0x01 << 24)
+#define CPUID_EDX_SSE (0x01 << 25)
+#define CPUID_EDX_SSE2 (0x01 << 26)
+
+// CPUID leaf 1 ECX
+#define CPUID_ECX_SSE3 (0x01 << 0)
+#define CPUID_ECX_MONITOR (0x01 << 3)
+
+static uint32_t cpu_feature_bits;
+static char cpu_vendor_string[13];
+
+/**************************************************************************//**
+ * @brief Identifies the CPU through CPUID and records its features.
+ * 
+ * CPUID itself is assumed, every CPU able to run the rest of the kernel
+ * (i.e. one with RDTSC) supports it.
+ *              
+ ******************************************************************************/
+__init void cpu_init() {
+    uint32_t regs[4];
+    uint32_t max_leaf;
+
+    cpu_cpuid(0, 0, regs);
+    max_leaf = regs[0];
+    memcpy(&cpu_vendor_string[0], &regs[1], 4);
+    memcpy(&cpu_vendor_string[4], &regs[3], 4);
+    memcpy(&cpu_vendor_string[8], &regs[2], 4);
+    cpu_vendor_string[12] = '\0';
+
+    cpu_feature_bits = 0;
+    if (max_leaf < 1)
+        return;
+
+    cpu_cpuid(1, 0, regs);
+
+    static const struct { uint32_t cpuid; uint32_t feature; } edx_map[] = {
+        { CPUID_EDX_FPU, CPU_FEATURE_FPU },
+        { CPUID_EDX_PSE, CPU_FEATURE_PSE },
+        { CPUID_EDX_TSC, CPU_FEATURE_TSC },
+        { CPUID_EDX_MSR, CPU_FEATURE_MSR },
+        { CPUID_EDX_APIC, CPU_FEATURE_APIC },
+        { CPUID_EDX_SEP, CPU_FEATURE_SEP },
+        { CPUID_EDX_PGE, CPU_FEATURE_PGE },
+        { CPUID_EDX_PAT, CPU_FEATURE_PAT },
+        { CPUID_EDX_MMX, CPU_FEATURE_MMX },
+        { CPUID_EDX_FXSR, CPU_FEATURE_FXSR },
+        { CPUID_EDX_SSE, CPU_FEATURE_SSE },
+        { CPUID_EDX_SSE2, CPU_FEATURE_SSE2 },
+    };
+
+    for (size_t i = 0; i < sizeof(edx_map) / sizeof(edx_map[0]); i++)
+        if (regs[3] & edx_map[i].cpuid)
+            cpu_feature_bits |= edx_map[i].feature;
+
+    if (regs[2] & CPUID_ECX_SSE3)
+        cpu_feature_bits |= CPU_FEATURE_SSE3;
+    if (regs[2] & CPUID_ECX_MONITOR)
+        cpu_feature_bits |= CPU_FEATURE_MONITOR;
+
+    term_writestring("\nCPU identified.");
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the CPU_FEATURE_* bits found by cpu_init().
+ * 
+ * @return Feature bitmask.
+ * 
+ ******************************************************************************/
+uint32_t cpu_features() {
+    return cpu_feature_bits;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the CPUID vendor string, e.g. "GenuineIntel".
+ * 
+ * @return NUL terminated vendor string.
+ * 
+ ******************************************************************************/
+const char* cpu_vendor() {
+    return cpu_vendor_string;
+}
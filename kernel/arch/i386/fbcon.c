@@ -0,0 +1,482 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/fbcon.h>
+#include <kernel/fpu.h>
+#include <kernel/init.h>
+#include <kernel/multiboot.h>
+#include <kernel/tsc.h>
+
+#include "font8x8.h"
+
+#define FBCON_GLYPH_WIDTH 8
+#define FBCON_GLYPH_HEIGHT 16 // font8x8 rows are doubled
+#define FBCON_GLYPH_PIXELS (FBCON_GLYPH_WIDTH * FBCON_GLYPH_HEIGHT)
+
+// Back buffer is statically sized, larger modes only use the top-left part
+#define FBCON_MAX_WIDTH 1024
+#define FBCON_MAX_HEIGHT 768
+
+// Glyph cache: one slot per fg/bg color pair, least recently used is evicted
+#define FBCON_CACHE_SLOTS 8
+#define FBCON_CACHE_GLYPHS 128
+
+// Dirty rectangles collected between flushes, merged when the list fills up
+#define FBCON_DIRTY_MAX 16
+
+#define FBCON_PALETTE_SIZE 16
+
+typedef struct FbconGlyphSlot {
+    uint32_t pixels[FBCON_CACHE_GLYPHS][FBCON_GLYPH_PIXELS];
+    uint32_t rendered[FBCON_CACHE_GLYPHS / 32]; // bitmap of valid glyphs
+    uint32_t last_used;
+    uint8_t color;
+    bool in_use;
+} FbconGlyphSlot;
+
+typedef struct FbconRect {
+    uint16_t x0, y0; // first cell
+    uint16_t x1, y1; // one past the last cell
+} FbconRect;
+
+typedef struct FbconStats {
+    uint64_t start_tsc;
+    uint32_t frames;
+    uint32_t chars;
+    uint32_t glyph_renders;
+    uint32_t scrolls;
+    uint64_t bytes_flushed;
+    uint64_t flush_cycles;
+} FbconStats;
+
+// VGA text mode palette, as 0xRRGGBB
+static const uint32_t fbcon_vga_rgb[FBCON_PALETTE_SIZE] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+// state var
+static bool fbcon_enabled;
+static uint8_t* fbcon_front;
+static uint32_t fbcon_pitch; // bytes per framebuffer scanline
+static bool fbcon_front_aligned; // scanlines start 16-byte aligned
+static uint32_t fbcon_width; // pixels, always a whole number of glyphs
+static uint32_t fbcon_height;
+static size_t fbcon_cols;
+static size_t fbcon_lines;
+static uint32_t fbcon_palette[FBCON_PALETTE_SIZE];
+
+static uint32_t fbcon_back[FBCON_MAX_WIDTH * FBCON_MAX_HEIGHT] __attribute__((aligned(64)));
+
+static FbconGlyphSlot fbcon_cache[FBCON_CACHE_SLOTS] __attribute__((aligned(64)));
+static FbconGlyphSlot* fbcon_cache_mru;
+static uint32_t fbcon_cache_clock;
+
+static FbconRect fbcon_dirty[FBCON_DIRTY_MAX];
+static size_t fbcon_dirty_count;
+static bool fbcon_dirty_all;
+
+static FbconStats fbcon_stats;
+
+/**************************************************************************//**
+ * @brief Local function. Packs an 0xRRGGBB color into the framebuffer format.
+ * 
+ ******************************************************************************/
+static __init uint32_t fbcon_pack_color(const multiboot_info_t* mbi, uint32_t rgb) {
+    uint32_t r = (rgb >> 16) & 0xFF, g = (rgb >> 8) & 0xFF, b = rgb & 0xFF;
+
+    return ((r >> (8 - mbi->framebuffer_red_mask_size)) << mbi->framebuffer_red_field_position)
+        | ((g >> (8 - mbi->framebuffer_green_mask_size)) << mbi->framebuffer_green_field_position)
+        | ((b >> (8 - mbi->framebuffer_blue_mask_size)) << mbi->framebuffer_blue_field_position);
+}
+
+/**************************************************************************//**
+ * @brief Initializes the framebuffer console.
+ * 
+ * The console is only enabled if the bootloader set up a 32-bit direct color
+ * linear framebuffer, otherwise tty.c keeps using VGA text mode.
+ * 
+ * @param mbi Multiboot information structure passed by the bootloader.
+ * @return true if the framebuffer console is in use.
+ *              
+ ******************************************************************************/
+__init bool fbcon_init(const multiboot_info_t* mbi) {
+    fbcon_enabled = false;
+
+    if (!(mbi->flags & MULTIBOOT_INFO_FRAMEBUFFER_INFO))
+        return false;
+    if (mbi->framebuffer_type != MULTIBOOT_FRAMEBUFFER_TYPE_RGB || mbi->framebuffer_bpp != 32)
+        return false;
+    if (mbi->framebuffer_addr > UINT32_MAX)
+        return false;
+
+    fbcon_front = (uint8_t*) (uintptr_t) mbi->framebuffer_addr;
+    fbcon_pitch = mbi->framebuffer_pitch;
+    fbcon_front_aligned = ((uintptr_t) fbcon_front % 16) == 0 && (fbcon_pitch % 16) == 0;
+    fbcon_width = mbi->framebuffer_width < FBCON_MAX_WIDTH ? mbi->framebuffer_width : FBCON_MAX_WIDTH;
+    fbcon_height = mbi->framebuffer_height < FBCON_MAX_HEIGHT ? mbi->framebuffer_height : FBCON_MAX_HEIGHT;
+    fbcon_cols = fbcon_width / FBCON_GLYPH_WIDTH;
+    fbcon_lines = fbcon_height / FBCON_GLYPH_HEIGHT;
+    fbcon_width = fbcon_cols * FBCON_GLYPH_WIDTH;
+    fbcon_height = fbcon_lines * FBCON_GLYPH_HEIGHT;
+
+    for (size_t i = 0; i < FBCON_PALETTE_SIZE; i++)
+        fbcon_palette[i] = fbcon_pack_color(mbi, fbcon_vga_rgb[i]);
+
+    for (size_t i = 0; i < FBCON_CACHE_SLOTS; i++)
+        fbcon_cache[i].in_use = false;
+    fbcon_cache_mru = NULL;
+    fbcon_cache_clock = 0;
+
+    fbcon_dirty_count = 0;
+    fbcon_dirty_all = false;
+
+    memset(&fbcon_stats, 0, sizeof(fbcon_stats));
+    fbcon_stats.start_tsc = tsc_read();
+
+    fbcon_enabled = true;
+    return true;
+}
+
+/**************************************************************************//**
+ * @brief Checks whether the framebuffer console is in use.
+ * 
+ * @return true if fbcon_init() found a usable framebuffer.
+ * 
+ ******************************************************************************/
+bool fbcon_active() {
+    return fbcon_enabled;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the console width.
+ * 
+ * @return Number of character columns.
+ * 
+ ******************************************************************************/
+size_t fbcon_columns() {
+    return fbcon_cols;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the console height.
+ * 
+ * @return Number of character rows.
+ * 
+ ******************************************************************************/
+size_t fbcon_rows() {
+    return fbcon_lines;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Marks the whole screen for the next flush.
+ * 
+ ******************************************************************************/
+static void fbcon_mark_all() {
+    fbcon_dirty_all = true;
+    fbcon_dirty_count = 0;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Marks a single cell for the next flush.
+ * 
+ * Consecutive cells on a line, the common case when printing, extend the
+ * last rectangle. Once the list is full everything collapses into a single
+ * bounding rectangle.
+ * 
+ * @param x Column of the cell.
+ * @param y Row of the cell.
+ * 
+ ******************************************************************************/
+static void fbcon_mark_cell(uint16_t x, uint16_t y) {
+    if (fbcon_dirty_all)
+        return;
+
+    if (fbcon_dirty_count) {
+        FbconRect* last = &fbcon_dirty[fbcon_dirty_count - 1];
+        if (last->y0 == y && last->y1 == y + 1 && x >= last->x0 && x <= last->x1) {
+            if (x == last->x1)
+                last->x1++;
+            return;
+        }
+    }
+
+    if (fbcon_dirty_count == FBCON_DIRTY_MAX) {
+        FbconRect bound = fbcon_dirty[0];
+        for (size_t i = 1; i < FBCON_DIRTY_MAX; i++) {
+            FbconRect* r = &fbcon_dirty[i];
+            if (r->x0 < bound.x0) bound.x0 = r->x0;
+            if (r->y0 < bound.y0) bound.y0 = r->y0;
+            if (r->x1 > bound.x1) bound.x1 = r->x1;
+            if (r->y1 > bound.y1) bound.y1 = r->y1;
+        }
+        if (x < bound.x0) bound.x0 = x;
+        if (y < bound.y0) bound.y0 = y;
+        if (x + 1 > bound.x1) bound.x1 = x + 1;
+        if (y + 1 > bound.y1) bound.y1 = y + 1;
+        fbcon_dirty[0] = bound;
+        fbcon_dirty_count = 1;
+        return;
+    }
+
+    fbcon_dirty[fbcon_dirty_count].x0 = x;
+    fbcon_dirty[fbcon_dirty_count].y0 = y;
+    fbcon_dirty[fbcon_dirty_count].x1 = x + 1;
+    fbcon_dirty[fbcon_dirty_count].y1 = y + 1;
+    fbcon_dirty_count++;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Finds the glyph cache slot for a color pair.
+ * 
+ * @param color VGA style color attribute, foreground in the low nibble.
+ * @return Slot holding glyphs pre-rendered in that color pair.
+ * 
+ ******************************************************************************/
+static FbconGlyphSlot* fbcon_cache_slot(uint8_t color) {
+    FbconGlyphSlot* victim = &fbcon_cache[0];
+
+    if (fbcon_cache_mru && fbcon_cache_mru->color == color)
+        return fbcon_cache_mru;
+
+    for (size_t i = 0; i < FBCON_CACHE_SLOTS; i++) {
+        FbconGlyphSlot* slot = &fbcon_cache[i];
+        if (slot->in_use && slot->color == color) {
+            victim = slot;
+            goto found;
+        }
+        if (!slot->in_use || (victim->in_use && slot->last_used < victim->last_used))
+            victim = slot;
+    }
+
+    victim->color = color;
+    victim->in_use = true;
+    memset(victim->rendered, 0, sizeof(victim->rendered));
+
+found:
+    victim->last_used = ++fbcon_cache_clock;
+    fbcon_cache_mru = victim;
+    return victim;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Returns a glyph pre-rendered in the given colors.
+ * 
+ * @param c Character. Anything outside the font is drawn as a blank cell.
+ * @param color VGA style color attribute.
+ * @return FBCON_GLYPH_PIXELS pixels, row-major.
+ * 
+ ******************************************************************************/
+static const uint32_t* fbcon_glyph(unsigned char c, uint8_t color) {
+    FbconGlyphSlot* slot = fbcon_cache_slot(color);
+
+    if (c < FONT8X8_FIRST || c > FONT8X8_LAST)
+        c = ' ';
+
+    uint32_t* pixels = slot->pixels[c];
+    if (slot->rendered[c / 32] & (1u << (c % 32)))
+        return pixels;
+
+    uint32_t fg = fbcon_palette[color & 0x0F];
+    uint32_t bg = fbcon_palette[(color >> 4) & 0x07];
+    const uint8_t* bitmap = font8x8[c - FONT8X8_FIRST];
+
+    for (size_t y = 0; y < FBCON_GLYPH_HEIGHT; y++) {
+        uint8_t bits = bitmap[y * FONT8X8_HEIGHT / FBCON_GLYPH_HEIGHT];
+        for (size_t x = 0; x < FBCON_GLYPH_WIDTH; x++)
+            *pixels++ = (bits & (1 << x)) ? fg : bg;
+    }
+
+    slot->rendered[c / 32] |= 1u << (c % 32);
+    fbcon_stats.glyph_renders++;
+    return slot->pixels[c];
+}
+
+/**************************************************************************//**
+ * @brief Fills the back buffer with a background color.
+ * 
+ * @param color VGA style color attribute, only the background is used.
+ * 
+ ******************************************************************************/
+void fbcon_clear(uint8_t color) {
+    uint32_t bg = fbcon_palette[(color >> 4) & 0x07];
+
+    for (size_t i = 0; i < fbcon_width * fbcon_height; i++)
+        fbcon_back[i] = bg;
+
+    fbcon_mark_all();
+}
+
+/**************************************************************************//**
+ * @brief Draws a character cell into the back buffer.
+ * 
+ * @param c Character to write.
+ * @param color VGA style color attribute.
+ * @param x Column. Index starts at 0.
+ * @param y Row. Index starts at 0.
+ * 
+ ******************************************************************************/
+void fbcon_putcell(unsigned char c, uint8_t color, size_t x, size_t y) {
+    const uint32_t* glyph = fbcon_glyph(c, color);
+    uint32_t* dst = &fbcon_back[y * FBCON_GLYPH_HEIGHT * fbcon_width + x * FBCON_GLYPH_WIDTH];
+
+    for (size_t row = 0; row < FBCON_GLYPH_HEIGHT; row++) {
+        memcpy(dst, glyph, FBCON_GLYPH_WIDTH * sizeof(uint32_t));
+        glyph += FBCON_GLYPH_WIDTH;
+        dst += fbcon_width;
+    }
+
+    fbcon_stats.chars++;
+    fbcon_mark_cell((uint16_t) x, (uint16_t) y);
+}
+
+/**************************************************************************//**
+ * @brief Scrolls the console up by one row.
+ * 
+ * The back buffer is moved as a whole rather than re-rendering every cell,
+ * and the freed bottom row is filled with the background color.
+ * 
+ * @param color VGA style color attribute, only the background is used.
+ * 
+ ******************************************************************************/
+void fbcon_scroll(uint8_t color) {
+    size_t row_pixels = FBCON_GLYPH_HEIGHT * fbcon_width;
+    size_t keep = (fbcon_lines - 1) * row_pixels;
+    uint32_t bg = fbcon_palette[(color >> 4) & 0x07];
+
+    memmove(fbcon_back, fbcon_back + row_pixels, keep * sizeof(uint32_t));
+    for (size_t i = 0; i < row_pixels; i++)
+        fbcon_back[keep + i] = bg;
+
+    fbcon_stats.scrolls++;
+    fbcon_mark_all();
+}
+
+/**************************************************************************//**
+ * @brief Local function. Copies one span with 16-byte SSE stores.
+ * 
+ * Non-temporal stores are used since the framebuffer is never read back.
+ * Must be called between kernel_fpu_begin() and kernel_fpu_end(). The kernel
+ * is built without -msse, so xmm0/xmm1 need no clobbers.
+ * 
+ * @param dst 16-byte aligned destination.
+ * @param src 16-byte aligned source.
+ * @param bytes Number of bytes, a non-zero multiple of 32.
+ * 
+ ******************************************************************************/
+static inline void fbcon_copy_sse(void* dst, const void* src, size_t bytes) {
+    asm volatile("1:\n\t"
+        "MOVAPS (%1), %%xmm0\n\t"
+        "MOVAPS 16(%1), %%xmm1\n\t"
+        "MOVNTPS %%xmm0, (%0)\n\t"
+        "MOVNTPS %%xmm1, 16(%0)\n\t"
+        "ADD $32, %1\n\t"
+        "ADD $32, %0\n\t"
+        "SUB $32, %2\n\t"
+        "JNZ 1b\n\t"
+        : "+r" (dst), "+r" (src), "+r" (bytes)
+        :
+        : "memory", "cc"
+        );
+}
+
+/**************************************************************************//**
+ * @brief Local function. Copies a rectangle from back to front buffer.
+ * 
+ * Rectangles are whole glyph cells, so each span is a multiple of 32 bytes
+ * and starts 32-byte aligned in the back buffer. Spans are moved with SSE
+ * stores when the framebuffer is aligned too, or string stores otherwise.
+ * 
+ * @param px Left edge in pixels.
+ * @param py Top edge in pixels.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @param sse Use fbcon_copy_sse(), the caller holds kernel_fpu_begin().
+ * 
+ ******************************************************************************/
+static void fbcon_blit(size_t px, size_t py, size_t width, size_t height, bool sse) {
+    const uint32_t* src = &fbcon_back[py * fbcon_width + px];
+    uint8_t* dst = fbcon_front + py * fbcon_pitch + px * sizeof(uint32_t);
+
+    for (size_t y = 0; y < height; y++) {
+        const void* s = src;
+        void* d = dst;
+        size_t count = width;
+
+        if (sse)
+            fbcon_copy_sse(d, s, count * sizeof(uint32_t));
+        else
+            asm volatile("REP MOVSL\n\t"
+                : "+S" (s), "+D" (d), "+c" (count)
+                :
+                : "memory"
+                );
+
+        src += fbcon_width;
+        dst += fbcon_pitch;
+    }
+
+    fbcon_stats.bytes_flushed += (uint64_t) width * height * sizeof(uint32_t);
+}
+
+/**************************************************************************//**
+ * @brief Pushes all dirty rectangles to the framebuffer, i.e. ends a frame.
+ * 
+ ******************************************************************************/
+void fbcon_flush() {
+    uint64_t start;
+    bool sse;
+
+    if (!fbcon_dirty_all && !fbcon_dirty_count)
+        return;
+
+    start = tsc_read();
+    sse = fbcon_front_aligned && fpu_has_sse();
+    if (sse)
+        kernel_fpu_begin();
+
+    if (fbcon_dirty_all) {
+        fbcon_blit(0, 0, fbcon_width, fbcon_height, sse);
+    } else {
+        for (size_t i = 0; i < fbcon_dirty_count; i++) {
+            FbconRect* r = &fbcon_dirty[i];
+            fbcon_blit(r->x0 * FBCON_GLYPH_WIDTH, r->y0 * FBCON_GLYPH_HEIGHT,
+                (r->x1 - r->x0) * FBCON_GLYPH_WIDTH, (r->y1 - r->y0) * FBCON_GLYPH_HEIGHT, sse);
+        }
+    }
+
+    if (sse) {
+        asm volatile("SFENCE\n\t" : : : "memory"); // order the non-temporal stores
+        kernel_fpu_end();
+    }
+
+    fbcon_dirty_all = false;
+    fbcon_dirty_count = 0;
+    fbcon_stats.frames++;
+    fbcon_stats.flush_cycles += tsc_read() - start;
+}
+
+/**************************************************************************//**
+ * @brief Prints frame and character throughput since fbcon_init().
+ * 
+ ******************************************************************************/
+void fbcon_report() {
+    if (!fbcon_enabled)
+        return;
+
+    uint64_t elapsed_us = tsc_cycles_to_us(tsc_read() - fbcon_stats.start_tsc);
+    uint64_t flush_us = tsc_cycles_to_us(fbcon_stats.flush_cycles);
+    if (elapsed_us == 0)
+        elapsed_us = 1;
+
+    printf("\nfbcon: %ux%u, %u frames, %u chars, %u scrolls, %u glyph renders in %llu us",
+        fbcon_width, fbcon_height, fbcon_stats.frames, fbcon_stats.chars,
+        fbcon_stats.scrolls, fbcon_stats.glyph_renders, elapsed_us);
+    printf("\nfbcon: %llu frames/s, %llu chars/s, %llu KiB flushed in %llu us",
+        (uint64_t) fbcon_stats.frames * 1000000 / elapsed_us,
+        (uint64_t) fbcon_stats.chars * 1000000 / elapsed_us,
+        fbcon_stats.bytes_flushed / 1024, flush_us);
+}
@@ -0,0 +1,246 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <kernel/cpu.h>
+#include <kernel/fpu.h>
+#include <kernel/idt.h>
+#include <kernel/init.h>
+#include <kernel/thread.h>
+#include <kernel/tty.h>
+
+#define FPU_MXCSR_DEFAULT 0x1F80 // all SIMD exceptions masked, round to nearest
+
+typedef struct FpuStats {
+    uint32_t traps;    // #NM exceptions taken
+    uint32_t saves;    // thread states written back to memory
+    uint32_t restores; // thread states loaded into the FPU
+    uint32_t kernel_sections;
+} FpuStats;
+
+static bool fpu_present;
+static bool fpu_fxsr;
+static bool fpu_sse;
+static bool fpu_ts_set;
+static Thread* fpu_owner; // thread whose state is live in the FPU registers
+static uint32_t fpu_kernel_flags;
+static uint8_t fpu_initial_state[THREAD_FPU_STATE_SIZE] __attribute__((aligned(16)));
+static FpuStats fpu_stats;
+
+/**************************************************************************//**
+ * @brief Local function. Clears CR0.TS, allowing FPU/SSE instructions.
+ * 
+ ******************************************************************************/
+static inline void fpu_clts() {
+    if (fpu_ts_set) {
+        asm volatile("CLTS\n\t" : : : "memory");
+        fpu_ts_set = false;
+    }
+}
+
+/**************************************************************************//**
+ * @brief Local function. Sets CR0.TS, so the next FPU/SSE instruction traps.
+ * 
+ ******************************************************************************/
+static inline void fpu_stts() {
+    if (!fpu_ts_set) {
+        cpu_write_cr0(cpu_read_cr0() | CPU_CR0_TS);
+        fpu_ts_set = true;
+    }
+}
+
+/**************************************************************************//**
+ * @brief Local function. Writes the FPU register state to memory.
+ * 
+ * @param area 16-byte aligned save area of THREAD_FPU_STATE_SIZE bytes.
+ * 
+ ******************************************************************************/
+static inline void fpu_save(uint8_t* area) {
+    if (fpu_fxsr)
+        asm volatile("FXSAVE %0\n\t" : "=m" (*(uint8_t (*)[THREAD_FPU_STATE_SIZE]) area));
+    else
+        asm volatile("FNSAVE %0\n\t" : "=m" (*(uint8_t (*)[THREAD_FPU_STATE_SIZE]) area));
+}
+
+/**************************************************************************//**
+ * @brief Local function. Loads the FPU register state from memory.
+ * 
+ * @param area Save area previously filled by fpu_save().
+ * 
+ ******************************************************************************/
+static inline void fpu_restore(const uint8_t* area) {
+    if (fpu_fxsr)
+        asm volatile("FXRSTOR %0\n\t" : : "m" (*(const uint8_t (*)[THREAD_FPU_STATE_SIZE]) area));
+    else
+        asm volatile("FRSTOR %0\n\t" : : "m" (*(const uint8_t (*)[THREAD_FPU_STATE_SIZE]) area));
+}
+
+/**************************************************************************//**
+ * @brief Local function. Device Not Available(#NM) exception handler.
+ * 
+ * Raised by the first FPU/SSE instruction after a context switch to a thread
+ * that does not own the FPU. The previous owner's state is saved and the
+ * running thread's state, or a clean one on first use, is restored.
+ * 
+ ******************************************************************************/
+static void fpu_device_not_available(InterruptFrame* frame) {
+    Thread* current = thread_current();
+
+    (void) frame;
+
+    fpu_clts();
+    fpu_stats.traps++;
+
+    if (!current || fpu_owner == current)
+        return;
+
+    if (fpu_owner) {
+        fpu_save(fpu_owner->fpu_state);
+        fpu_stats.saves++;
+    }
+
+    fpu_restore(current->fpu_used ? current->fpu_state : fpu_initial_state);
+    fpu_stats.restores++;
+
+    current->fpu_used = true;
+    fpu_owner = current;
+}
+
+/**************************************************************************//**
+ * @brief Initializes the x87 FPU and, when available, SSE.
+ * 
+ * CR0.EM is cleared and CR0.MP/NE set, CR4.OSFXSR and CR4.OSXMMEXCPT enable
+ * FXSAVE/FXRSTOR and SSE. A clean register image is kept for threads using
+ * the FPU for the first time. CR0.TS is left set, so no thread pays for the
+ * FPU until it executes an FPU/SSE instruction. Must run after cpu_init()
+ * and idt_init().
+ *              
+ ******************************************************************************/
+__init void fpu_init() {
+    uint32_t cr0, cr4;
+
+    fpu_present = cpu_has(CPU_FEATURE_FPU);
+    fpu_fxsr = cpu_has(CPU_FEATURE_FXSR);
+    fpu_sse = fpu_fxsr && cpu_has(CPU_FEATURE_SSE);
+    fpu_owner = NULL;
+
+    if (!fpu_present) {
+        term_writestring("\nNo FPU present.");
+        return;
+    }
+
+    cr0 = cpu_read_cr0();
+    cr0 &= ~(CPU_CR0_EM | CPU_CR0_TS);
+    cr0 |= CPU_CR0_MP | CPU_CR0_NE;
+    cpu_write_cr0(cr0);
+    fpu_ts_set = false;
+
+    if (fpu_fxsr) {
+        cr4 = cpu_read_cr4() | CPU_CR4_OSFXSR;
+        if (fpu_sse)
+            cr4 |= CPU_CR4_OSXMMEXCPT;
+        cpu_write_cr4(cr4);
+    }
+
+    asm volatile("FNINIT\n\t");
+    if (fpu_sse) {
+        uint32_t mxcsr = FPU_MXCSR_DEFAULT;
+        asm volatile("LDMXCSR %0\n\t" : : "m" (mxcsr));
+    }
+    fpu_save(fpu_initial_state);
+
+    idt_register_handler(IDT_VECTOR_DEVICE_NOT_AVAILABLE, fpu_device_not_available);
+    fpu_stts();
+
+    term_writestring(fpu_sse ? "\nFPU/SSE initialized." : "\nFPU initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Checks whether SSE may be used inside kernel_fpu_begin/end().
+ * 
+ * @return true if SSE was enabled by fpu_init().
+ * 
+ ******************************************************************************/
+bool fpu_has_sse() {
+    return fpu_sse;
+}
+
+/**************************************************************************//**
+ * @brief Arms the lazy FPU switch, called by the scheduler on every switch.
+ * 
+ * Nothing is saved here. CR0.TS is set unless the incoming thread still
+ * owns the FPU registers, in which case it can keep using them for free.
+ * 
+ * @param prev Thread being switched out.
+ * @param next Thread being switched in.
+ * 
+ ******************************************************************************/
+void fpu_switch(Thread* prev, Thread* next) {
+    (void) prev;
+
+    if (!fpu_present)
+        return;
+
+    if (next == fpu_owner)
+        fpu_clts();
+    else
+        fpu_stts();
+}
+
+/**************************************************************************//**
+ * @brief Drops FPU ownership of an exiting thread, its state is discarded.
+ * 
+ * @param thread Exiting thread.
+ * 
+ ******************************************************************************/
+void fpu_thread_exit(Thread* thread) {
+    if (fpu_owner == thread)
+        fpu_owner = NULL;
+    thread->fpu_used = false;
+}
+
+/**************************************************************************//**
+ * @brief Starts a section of kernel code using FPU/SSE registers.
+ * 
+ * The owning thread's registers are saved first, so the section may clobber
+ * any FPU/SSE register. Interrupts are disabled until kernel_fpu_end(), so
+ * sections must be short and cannot nest or sleep.
+ *              
+ ******************************************************************************/
+void kernel_fpu_begin() {
+    fpu_kernel_flags = cpu_irq_save();
+
+    if (!fpu_present)
+        return;
+
+    fpu_clts();
+    if (fpu_owner) {
+        fpu_save(fpu_owner->fpu_state);
+        fpu_stats.saves++;
+        fpu_owner = NULL;
+    }
+    fpu_stats.kernel_sections++;
+}
+
+/**************************************************************************//**
+ * @brief Ends a section started by kernel_fpu_begin().
+ * 
+ * CR0.TS is set again, the next thread to use the FPU reloads its own state.
+ *              
+ ******************************************************************************/
+void kernel_fpu_end() {
+    if (fpu_present)
+        fpu_stts();
+
+    cpu_irq_restore(fpu_kernel_flags);
+}
+
+/**************************************************************************//**
+ * @brief Prints lazy FPU switching counters.
+ *              
+ ******************************************************************************/
+void fpu_report() {
+    printf("\nfpu: %u #NM traps, %u saves, %u restores, %u kernel sections",
+        fpu_stats.traps, fpu_stats.saves, fpu_stats.restores, fpu_stats.kernel_sections);
+}
@@ -1,9 +1,11 @@
 #include <stdint.h>
 
 #include <kernel/gdt.h>
+#include <kernel/init.h>
 #include <kernel/tty.h>
 
 #define GDT_MAX_ENTRIES 6 // for now?
+#define GDT_ENTRY_TSS 5
 
 // Segment Descriptor Flags
 #define GDT_FLAG_LONG_MODE (0x01 << 1)
@@ -41,18 +43,41 @@ typedef struct GDTSegmentDescriptor {
     uint8_t access_attr; // Accessed [0], Read/Writable [1], DC(Direct/Conforming) [2], Executable [3], Descriptor Type [4], DPL [5:6], Present [7]
     uint8_t limit_upper_and_flags; // upper limit [0:3], flags [4:7]
     uint8_t base_upper;
-} GDTDesc __attribute__((packed));
+} __attribute__((packed)) GDTDesc;
 
 typedef struct GDTDescriptor {
     uint16_t limit;
     uint32_t base_addr;
-} GDTPtr __attribute__((packed));
+} __attribute__((packed)) GDTPtr;
+
+/*
+ * 32-bit Task State Segment. Only ss0/esp0, the stack loaded on a switch to
+ * ring 0, are used. Hardware task switching is not.
+ */
+typedef struct TaskStateSegment {
+    uint32_t prev_tss;
+    uint32_t esp0;
+    uint32_t ss0;
+    uint32_t esp1;
+    uint32_t ss1;
+    uint32_t esp2;
+    uint32_t ss2;
+    uint32_t cr3;
+    uint32_t eip;
+    uint32_t eflags;
+    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t es, cs, ss, ds, fs, gs;
+    uint32_t ldt;
+    uint16_t trap;
+    uint16_t iomap_base;
+} __attribute__((packed)) TSS;
 
 #define GDT_SIZEOF_DESC_BYTES sizeof(GDTDesc)
 
 static GDTDesc gdt_gdt[GDT_MAX_ENTRIES]; 
 static GDTPtr gdt_desc_ptr;
 static uint8_t gdt_entry_count;
+static TSS gdt_tss __attribute__((aligned(64)));
 
 /**************************************************************************//**
  * @brief Adds a descriptor entry to the Global Descriptor Table(GDT).
@@ -71,7 +96,7 @@ void gdt_add_descriptor(uint8_t entry, uint32_t base, uint32_t limit, uint8_t ac
     gdt_gdt[entry].base_upper = (base & (0xFF << 24)) >> 24;
     gdt_gdt[entry].limit_low = limit & 0xFFFF;
     gdt_gdt[entry].limit_upper_and_flags = (limit & (0xF << 16)) >> 16;
-    gdt_gdt[entry].limit_upper_and_flags = gdt_gdt[entry].limit_upper_and_flags | flags;
+    gdt_gdt[entry].limit_upper_and_flags = gdt_gdt[entry].limit_upper_and_flags | (flags << 4);
     gdt_gdt[entry].access_attr = access;
     gdt_entry_count++;
 }
@@ -90,6 +115,8 @@ void gdt_add_descriptor(uint8_t entry, uint32_t base, uint32_t limit, uint8_t ac
  * User Mode Code Segment
  * 
  * User Mode Data Segment
+ * 
+ * Task State Segment
  *              
  ******************************************************************************/
 void gdt_init_descriptors() {
@@ -108,6 +135,11 @@ void gdt_init_descriptors() {
     // User Mode Data Segment
     gdt_add_descriptor(4, 0, 0XFFFFF, GDT_ACC_PRESENT|GDT_ACC_DPL_PRIVILEGE_3|GDT_ACC_CODE_DATA_SEG|GDT_ACC_READ_WRITE_ALLOW,
         GDT_FLAG_DB_SIZE_32|GDT_FLAG_GRANULARITY_PAGE);
+    // Task State Segment, no I/O permission bitmap (iomap_base past the limit)
+    gdt_tss.ss0 = GDT_SEGMENT_KERN_DATA;
+    gdt_tss.iomap_base = sizeof(gdt_tss);
+    gdt_add_descriptor(GDT_ENTRY_TSS, (uint32_t) &gdt_tss, sizeof(gdt_tss) - 1, GDT_ACC_PRESENT|GDT_ACC_DPL_PRIVILEGE_0|GDT_ACC_TYPE_32_TSS_AVAIL,
+        GDT_FLAG_GRANULARITY_BYTE);
 
 }
 
@@ -115,10 +147,13 @@ void gdt_init_descriptors() {
  * @brief Initializes the Global Descriptor Table(GDT).
  * 
  * Initializes the GDT, and adds the default descriptor entries via
- * gdt_init_descriptors().
+ * gdt_init_descriptors(). The segment registers still hold the bootloader's
+ * selectors afterwards, so they are reloaded with the kernel segments, and
+ * the TSS is loaded into the task register. Interrupts stay disabled until
+ * pic_init().
  *              
  ******************************************************************************/
-void gdt_init() {
+__init void gdt_init() {
 
     gdt_entry_count = 0;
 
@@ -133,13 +168,46 @@ void gdt_init() {
     gdt_init_descriptors();
 
     asm("LGDT %0\n\t"
-        "STI   \n\t"
+        "LJMP %1, $1f\n\t"
+        "1:\n\t"
+        "MOV %2, %%ax\n\t"
+        "MOV %%ax, %%ds\n\t"
+        "MOV %%ax, %%es\n\t"
+        "MOV %%ax, %%fs\n\t"
+        "MOV %%ax, %%gs\n\t"
+        "MOV %%ax, %%ss\n\t"
+        "MOV %3, %%ax\n\t"
+        "LTR %%ax\n\t"
         :
-        : "m" (gdt_desc_ptr)
+        : "m" (gdt_desc_ptr), "i" (GDT_SEGMENT_KERN_CODE), "i" (GDT_SEGMENT_KERN_DATA), "i" (GDT_SEGMENT_TSS)
+        : "eax", "memory"
         );
 
     term_writestring("\nGDT initialized.");
 
 }
 
-// TODO: Add TSS Descriptor
+/**************************************************************************//**
+ * @brief Sets the stack the CPU switches to when entering ring 0.
+ * 
+ * Called on every thread switch, so interrupts and system calls from ring 3
+ * land on the running thread's kernel stack.
+ * 
+ * @param esp0 Top of the kernel stack.
+ *              
+ ******************************************************************************/
+void gdt_set_kernel_stack(uint32_t esp0) {
+    gdt_tss.esp0 = esp0;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the address of the TSS.
+ * 
+ * The SYSENTER entry point finds esp0 through it, see usermode.S.
+ * 
+ * @return Linear address of the TSS.
+ *              
+ ******************************************************************************/
+uint32_t gdt_tss_address() {
+    return (uint32_t) &gdt_tss;
+}
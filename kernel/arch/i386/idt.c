@@ -0,0 +1,180 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <kernel/gdt.h>
+#include <kernel/idt.h>
+#include <kernel/init.h>
+#include <kernel/lapic.h>
+#include <kernel/pic.h>
+#include <kernel/process.h>
+#include <kernel/softirq.h>
+#include <kernel/tty.h>
+
+#define IDT_STUB_COUNT 80 // exceptions, legacy IRQs and MSIs, see isr.S
+#define IDT_EXCEPTION_COUNT 32
+
+// Gate type and attribute flags
+#define IDT_GATE_INTERRUPT_32 0x0E
+#define IDT_GATE_TRAP_32 0x0F
+#define IDT_GATE_DPL_PRIVILEGE_0 (0x00 << 5)
+#define IDT_GATE_DPL_PRIVILEGE_3 (0x03 << 5)
+#define IDT_GATE_PRESENT (0x01 << 7)
+
+typedef struct IDTGateDescriptor {
+    uint16_t offset_low;
+    uint16_t selector;
+    uint8_t zero;
+    uint8_t type_attr; // Gate Type [0:3], zero [4], DPL [5:6], Present [7]
+    uint16_t offset_high;
+} __attribute__((packed)) IDTGate;
+
+typedef struct IDTDescriptor {
+    uint16_t limit;
+    uint32_t base_addr;
+} __attribute__((packed)) IDTPtr;
+
+static const char* const idt_exception_names[] = {
+    "Divide Error", "Debug", "NMI", "Breakpoint", "Overflow", "Bound Range Exceeded",
+    "Invalid Opcode", "Device Not Available", "Double Fault", "Coprocessor Segment Overrun",
+    "Invalid TSS", "Segment Not Present", "Stack-Segment Fault", "General Protection",
+    "Page Fault", "Reserved", "x87 FPU Error", "Alignment Check", "Machine Check",
+    "SIMD Floating-Point",
+};
+
+extern const uint32_t isr_stub_table[IDT_STUB_COUNT];
+extern void isr_stub_128();
+
+static IDTGate idt_idt[IDT_MAX_ENTRIES];
+static IDTPtr idt_desc_ptr;
+static idt_handler_t idt_handlers[IDT_MAX_ENTRIES];
+
+/**************************************************************************//**
+ * @brief Local function. Fills in a gate of the Interrupt Descriptor Table.
+ * 
+ * @param vector Interrupt vector.
+ * @param offset Address of the entry stub.
+ * @param type_attr Gate type, DPL and present bit.
+ *              
+ ******************************************************************************/
+static void idt_set_gate(uint8_t vector, uint32_t offset, uint8_t type_attr) {
+    idt_idt[vector].offset_low = offset & 0xFFFF;
+    idt_idt[vector].offset_high = (offset >> 16) & 0xFFFF;
+    idt_idt[vector].selector = GDT_SEGMENT_KERN_CODE;
+    idt_idt[vector].zero = 0;
+    idt_idt[vector].type_attr = type_attr;
+}
+
+/**************************************************************************//**
+ * @brief Initializes the Interrupt Descriptor Table(IDT).
+ * 
+ * Installs interrupt gates for the CPU exceptions, the 16 PIC lines and the
+ * MSI vectors, and a ring 3 trap gate for INT 0x80 system calls. Must run
+ * after gdt_init() and before interrupts are enabled by pic_init().
+ *              
+ ******************************************************************************/
+__init void idt_init() {
+
+    for (size_t i = 0; i < IDT_STUB_COUNT; i++)
+        idt_set_gate(i, isr_stub_table[i], IDT_GATE_PRESENT|IDT_GATE_DPL_PRIVILEGE_0|IDT_GATE_INTERRUPT_32);
+
+    // Trap gate, system calls run with interrupts enabled
+    idt_set_gate(IDT_VECTOR_SYSCALL, (uint32_t) isr_stub_128, IDT_GATE_PRESENT|IDT_GATE_DPL_PRIVILEGE_3|IDT_GATE_TRAP_32);
+
+    idt_desc_ptr.limit = sizeof(idt_idt) - 1;
+    idt_desc_ptr.base_addr = (uint32_t) &idt_idt;
+
+    asm("LIDT %0\n\t"
+        :
+        : "m" (idt_desc_ptr)
+        );
+
+    term_writestring("\nIDT initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Registers a C handler for an interrupt vector.
+ * 
+ * @param vector Interrupt vector. Replaces any handler already registered.
+ * @param handler Function called with the saved register state.
+ *              
+ ******************************************************************************/
+void idt_register_handler(uint8_t vector, idt_handler_t handler) {
+    idt_handlers[vector] = handler;
+}
+
+/**************************************************************************//**
+ * @brief Registers a C handler for a PIC interrupt line.
+ * 
+ * EOI is sent by idt_dispatch() once the handler returns. The line still
+ * has to be unmasked with pic_clearInterruptMask().
+ * 
+ * @param irq Interrupt line, 0-15.
+ * @param handler Function called with the saved register state.
+ *              
+ ******************************************************************************/
+void idt_register_irq_handler(uint8_t irq, idt_handler_t handler) {
+    idt_register_handler(IDT_VECTOR_IRQ_BASE + irq, handler);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Reports an unhandled exception and halts.
+ * 
+ * Exceptions raised in ring 3 only kill the offending process.
+ * 
+ ******************************************************************************/
+static void idt_unhandled_exception(InterruptFrame* frame) {
+    const char* name = "Reserved";
+
+    if (frame->vector < sizeof(idt_exception_names) / sizeof(idt_exception_names[0]))
+        name = idt_exception_names[frame->vector];
+    if (frame->cs & GDT_RPL_USER)
+        process_fault(frame, name);
+
+    printf("\nUnhandled exception %u (%s) at %x:%x, error code %x",
+        frame->vector, name, frame->cs, frame->eip, frame->error_code);
+    printf("\neax=%08x ebx=%08x ecx=%08x edx=%08x esi=%08x edi=%08x ebp=%08x",
+        frame->eax, frame->ebx, frame->ecx, frame->edx, frame->esi, frame->edi, frame->ebp);
+    abort();
+}
+
+/**************************************************************************//**
+ * @brief Common interrupt handler, called by every stub in isr.S.
+ * 
+ * Hardware interrupts are acknowledged as soon as their handler returns,
+ * deferred work they raised runs afterwards, see softirq_irq_exit().
+ * 
+ * @param frame Register state saved on entry.
+ *              
+ ******************************************************************************/
+void idt_dispatch(InterruptFrame* frame) {
+    idt_handler_t handler = idt_handlers[frame->vector];
+
+    if (frame->vector >= IDT_VECTOR_IRQ_BASE && frame->vector < IDT_VECTOR_IRQ_BASE + IDT_IRQ_COUNT) {
+        softirq_irq_enter();
+        if (handler)
+            handler(frame);
+        pic_sendEndOfInterrupt(frame->vector - IDT_VECTOR_IRQ_BASE);
+        softirq_irq_exit();
+        return;
+    }
+
+    // Message signaled interrupts arrive through the local APIC
+    if (frame->vector >= IDT_VECTOR_MSI_BASE && frame->vector < IDT_VECTOR_MSI_BASE + IDT_MSI_COUNT) {
+        softirq_irq_enter();
+        if (handler)
+            handler(frame);
+        lapic_eoi();
+        softirq_irq_exit();
+        return;
+    }
+
+    // Spurious local APIC interrupts must not be acknowledged
+    if (frame->vector == IDT_VECTOR_SPURIOUS)
+        return;
+
+    if (handler)
+        handler(frame);
+    else if (frame->vector < IDT_EXCEPTION_COUNT)
+        idt_unhandled_exception(frame);
+}
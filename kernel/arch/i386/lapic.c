@@ -0,0 +1,83 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <kernel/cpu.h>
+#include <kernel/idt.h>
+#include <kernel/init.h>
+#include <kernel/lapic.h>
+#include <kernel/paging.h>
+#include <kernel/tty.h>
+
+static volatile uint32_t* lapic_regs; // NULL while the local APIC is not in use
+
+/**************************************************************************//**
+ * @brief Local function. Reads a local APIC register.
+ * 
+ ******************************************************************************/
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic_regs[reg / sizeof(uint32_t)];
+}
+
+/**************************************************************************//**
+ * @brief Local function. Writes a local APIC register.
+ * 
+ ******************************************************************************/
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    lapic_regs[reg / sizeof(uint32_t)] = value;
+}
+
+/**************************************************************************//**
+ * @brief Enables the local APIC of the boot CPU, so it accepts MSIs.
+ * 
+ * The 8259 keeps delivering the legacy IRQs through LINT0 (virtual wire
+ * mode), which is set up explicitly since firmware does not always do it.
+ * The registers are reached through the MMIO identity map. Must run after
+ * cpu_init() and paging_init(), with interrupts disabled.
+ * 
+ ******************************************************************************/
+__init void lapic_init() {
+    lapic_regs = NULL;
+    if (!cpu_has(CPU_FEATURE_APIC | CPU_FEATURE_MSR)) {
+        term_writestring("\nLocal APIC: not present, MSIs unavailable.");
+        return;
+    }
+
+    uint64_t base = cpu_rdmsr(LAPIC_MSR_BASE);
+    if ((base >> 32) || (base & LAPIC_BASE_MASK) < MMIO_SPACE_START) {
+        term_writestring("\nLocal APIC: registers outside the MMIO map, MSIs unavailable.");
+        return;
+    }
+    cpu_wrmsr(LAPIC_MSR_BASE, base | LAPIC_BASE_ENABLE);
+
+    lapic_regs = (volatile uint32_t*) (uint32_t) (base & LAPIC_BASE_MASK);
+    lapic_write(LAPIC_REG_LVT_LINT0, LAPIC_LVT_EXTINT);
+    lapic_write(LAPIC_REG_LVT_LINT1, LAPIC_LVT_NMI);
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | IDT_VECTOR_SPURIOUS);
+
+    term_writestring("\nLocal APIC initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Checks whether lapic_init() enabled the local APIC.
+ * 
+ ******************************************************************************/
+bool lapic_enabled() {
+    return lapic_regs != NULL;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the APIC ID of the running CPU, the MSI destination.
+ * 
+ ******************************************************************************/
+uint32_t lapic_id() {
+    return lapic_read(LAPIC_REG_ID) >> 24;
+}
+
+/**************************************************************************//**
+ * @brief Acknowledges the interrupt being handled, see idt_dispatch().
+ * 
+ ******************************************************************************/
+void lapic_eoi() {
+    lapic_write(LAPIC_REG_EOI, 0);
+}
@@ -0,0 +1,277 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <kernel/cpu.h>
+#include <kernel/frame.h>
+#include <kernel/idt.h>
+#include <kernel/init.h>
+#include <kernel/paging.h>
+#include <kernel/process.h>
+#include <kernel/tty.h>
+#include <kernel/vm.h>
+
+#define PAGING_ENTRIES 1024
+#define PAGING_LARGE_PAGE_SIZE 0x400000
+#define PAGING_KERNEL_PDE_END (KERNEL_SPACE_END / PAGING_LARGE_PAGE_SIZE)
+#define PAGING_USER_PDE_START (USER_SPACE_START / PAGING_LARGE_PAGE_SIZE)
+#define PAGING_USER_PDE_END (USER_SPACE_END / PAGING_LARGE_PAGE_SIZE)
+
+// Page fault error code bits
+#define PAGING_FAULT_PRESENT 0x01
+#define PAGING_FAULT_WRITE 0x02
+#define PAGING_FAULT_USER 0x04
+
+#define PAGING_PDE_INDEX(address) ((address) >> 22)
+#define PAGING_PTE_INDEX(address) (((address) >> 12) & (PAGING_ENTRIES - 1))
+
+extern uint8_t __user_start[];
+extern uint8_t __user_end[];
+
+/*
+ * Kernel page directory, used by kernel threads and copied into every new
+ * address space. The first 4 MiB go through paging_low_table, so page 0
+ * can stay unmapped to catch NULL pointers and the .user section can be
+ * opened to ring 3. Everything else is mapped with 4 MiB pages.
+ */
+static uint32_t paging_directory[PAGING_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+static uint32_t paging_low_table[PAGING_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+static uint32_t paging_active;
+
+/**************************************************************************//**
+ * @brief Local function. Page fault handler.
+ * 
+ * Faults in user space are resolved by the running process's address space.
+ * Anything it cannot resolve kills the process if it came from ring 3 or
+ * hit user space, and halts the kernel otherwise.
+ * 
+ ******************************************************************************/
+static void paging_page_fault(InterruptFrame* frame) {
+    uint32_t address = cpu_read_cr2();
+    Process* process = process_current();
+
+    if (process && vm_handle_fault(process->space, address, frame->error_code & PAGING_FAULT_WRITE))
+        return;
+
+    if ((frame->error_code & PAGING_FAULT_USER) || (address >= USER_SPACE_START && address < USER_SPACE_END)) {
+        printf("\nPage fault at %x (%s, %s)", address,
+            frame->error_code & PAGING_FAULT_WRITE ? "write" : "read",
+            frame->error_code & PAGING_FAULT_PRESENT ? "protection" : "not present");
+        process_fault(frame, "Page Fault");
+    }
+
+    printf("\nKernel page fault at %x, eip %x, error code %x", address, frame->eip, frame->error_code);
+    abort();
+}
+
+/**************************************************************************//**
+ * @brief Initializes paging with the kernel page directory.
+ * 
+ * Identity maps RAM below KERNEL_SPACE_END for the kernel and the MMIO
+ * range at the top, as global pages when the CPU supports PGE so switching
+ * address spaces leaves them in the TLB. The MMIO mappings leave caching to
+ * the MTRRs, which the firmware sets to uncached for the PCI hole. CR0.WP is
+ * set so kernel writes to copy-on-write pages fault as well. Must run after
+ * frame_init() and idt_init().
+ * 
+ ******************************************************************************/
+__init void paging_init() {
+    uint32_t global = 0;
+
+    if (!cpu_has(CPU_FEATURE_PSE)) {
+        printf("\nPaging: CPU lacks 4 MiB pages");
+        abort();
+    }
+    if (cpu_has(CPU_FEATURE_PGE))
+        global = PAGE_GLOBAL;
+
+    paging_low_table[0] = 0;
+    for (uint32_t i = 1; i < PAGING_ENTRIES; i++) {
+        uint32_t address = i * PAGE_SIZE;
+
+        if (address >= (uint32_t) __user_start && address < (uint32_t) __user_end)
+            paging_low_table[i] = address | PAGE_PRESENT | PAGE_WRITE | PAGE_USER | global;
+        else
+            paging_low_table[i] = address | PAGE_PRESENT | PAGE_WRITE | global;
+    }
+
+    memset(paging_directory, 0, sizeof(paging_directory));
+    paging_directory[0] = (uint32_t) paging_low_table | PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
+    for (uint32_t i = 1; i < PAGING_KERNEL_PDE_END; i++)
+        paging_directory[i] = (i * PAGING_LARGE_PAGE_SIZE) | PAGE_PRESENT | PAGE_WRITE | PAGE_LARGE | global;
+    for (uint32_t i = PAGING_USER_PDE_END; i < PAGING_ENTRIES; i++)
+        paging_directory[i] = (i * PAGING_LARGE_PAGE_SIZE) | PAGE_PRESENT | PAGE_WRITE | PAGE_LARGE | global;
+
+    idt_register_handler(IDT_VECTOR_PAGE_FAULT, paging_page_fault);
+
+    cpu_write_cr4(cpu_read_cr4() | CPU_CR4_PSE | (global ? CPU_CR4_PGE : 0));
+    paging_active = (uint32_t) paging_directory;
+    cpu_write_cr3(paging_active);
+    cpu_write_cr0(cpu_read_cr0() | CPU_CR0_PG | CPU_CR0_WP);
+
+    term_writestring("\nPaging initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the kernel page directory.
+ * 
+ * @return Physical address of the page directory kernel threads run on.
+ * 
+ ******************************************************************************/
+uint32_t paging_kernel_directory() {
+    return (uint32_t) paging_directory;
+}
+
+/**************************************************************************//**
+ * @brief Creates a page directory with the kernel mappings and an empty user space.
+ * 
+ * @return Physical address of the page directory, 0 if out of memory.
+ * 
+ ******************************************************************************/
+uint32_t paging_create_directory() {
+    uint32_t directory = frame_alloc_zeroed();
+
+    if (!directory)
+        return 0;
+
+    uint32_t* entries = (uint32_t*) directory;
+    memcpy(entries, paging_directory, PAGING_KERNEL_PDE_END * sizeof(uint32_t));
+    memcpy(entries + PAGING_USER_PDE_END, paging_directory + PAGING_USER_PDE_END,
+        (PAGING_ENTRIES - PAGING_USER_PDE_END) * sizeof(uint32_t));
+    return directory;
+}
+
+/**************************************************************************//**
+ * @brief Frees a page directory, its page tables and its user mappings.
+ * 
+ * Each mapped frame loses one reference. The directory must not be active.
+ * 
+ * @param directory Physical address of the page directory.
+ * 
+ ******************************************************************************/
+void paging_destroy_directory(uint32_t directory) {
+    uint32_t* entries = (uint32_t*) directory;
+
+    for (uint32_t i = PAGING_USER_PDE_START; i < PAGING_USER_PDE_END; i++) {
+        if (!(entries[i] & PAGE_PRESENT))
+            continue;
+
+        uint32_t* table = (uint32_t*) (entries[i] & PAGE_MASK);
+        for (uint32_t j = 0; j < PAGING_ENTRIES; j++) {
+            if (table[j] & PAGE_PRESENT)
+                frame_unref(table[j] & PAGE_MASK);
+        }
+        frame_unref((uint32_t) table);
+    }
+    frame_unref(directory);
+}
+
+/**************************************************************************//**
+ * @brief Copies the user mappings of one page directory into another.
+ * 
+ * Frames are shared, not copied: writable pages become read-only and marked
+ * PAGE_COW in both directories, and every shared frame gains a reference.
+ * The first write from either side faults and gets a private copy, see
+ * vm_handle_fault().
+ * 
+ * @param parent Physical address of the page directory to copy.
+ * @param child Physical address of a directory from paging_create_directory().
+ * @return False if out of memory. The child then holds a partial copy and
+ * has to be destroyed.
+ * 
+ ******************************************************************************/
+bool paging_clone_directory(uint32_t parent, uint32_t child) {
+    uint32_t* parent_entries = (uint32_t*) parent;
+    uint32_t* child_entries = (uint32_t*) child;
+    bool complete = true;
+
+    for (uint32_t i = PAGING_USER_PDE_START; i < PAGING_USER_PDE_END && complete; i++) {
+        if (!(parent_entries[i] & PAGE_PRESENT))
+            continue;
+
+        uint32_t child_table = frame_alloc();
+        if (!child_table) {
+            complete = false;
+            break;
+        }
+
+        uint32_t* parent_ptes = (uint32_t*) (parent_entries[i] & PAGE_MASK);
+        uint32_t* child_ptes = (uint32_t*) child_table;
+        for (uint32_t j = 0; j < PAGING_ENTRIES; j++) {
+            uint32_t pte = parent_ptes[j];
+
+            if (pte & PAGE_PRESENT) {
+                if (pte & PAGE_WRITE) {
+                    pte = (pte & ~PAGE_WRITE) | PAGE_COW;
+                    parent_ptes[j] = pte;
+                }
+                frame_ref(pte & PAGE_MASK);
+            }
+            child_ptes[j] = pte;
+        }
+        child_entries[i] = child_table | (parent_entries[i] & ~PAGE_MASK);
+    }
+
+    // The parent lost write access, drop its stale TLB entries
+    if (parent == paging_active)
+        cpu_write_cr3(parent);
+    return complete;
+}
+
+/**************************************************************************//**
+ * @brief Looks up the page table entry for a user space address.
+ * 
+ * @param directory Physical address of the page directory.
+ * @param address Virtual address in user space.
+ * @param create Allocate a missing page table.
+ * @return Pointer to the entry, NULL if there is no page table (or it could
+ * not be allocated) or the address is outside user space.
+ * 
+ ******************************************************************************/
+uint32_t* paging_get_entry(uint32_t directory, uint32_t address, bool create) {
+    uint32_t* entries = (uint32_t*) directory;
+    uint32_t* pde = &entries[PAGING_PDE_INDEX(address)];
+
+    if (address < USER_SPACE_START || address >= USER_SPACE_END)
+        return NULL;
+
+    if (!(*pde & PAGE_PRESENT)) {
+        if (!create)
+            return NULL;
+
+        uint32_t table = frame_alloc_zeroed();
+        if (!table)
+            return NULL;
+        *pde = table | PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
+    }
+
+    return &((uint32_t*) (*pde & PAGE_MASK))[PAGING_PTE_INDEX(address)];
+}
+
+/**************************************************************************//**
+ * @brief Loads a page directory, unless it is already active.
+ * 
+ * Kernel mappings are global, so only user space TLB entries are flushed.
+ * 
+ * @param directory Physical address of the page directory.
+ * 
+ ******************************************************************************/
+void paging_activate(uint32_t directory) {
+    if (directory != paging_active) {
+        paging_active = directory;
+        cpu_write_cr3(directory);
+    }
+}
+
+/**************************************************************************//**
+ * @brief Drops the TLB entry of a page in the active address space.
+ * 
+ * @param address Virtual address within the page.
+ * 
+ ******************************************************************************/
+void paging_invalidate(uint32_t address) {
+    cpu_invlpg(address);
+}
@@ -0,0 +1,676 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <kernel/cpu.h>
+#include <kernel/idt.h>
+#include <kernel/init.h>
+#include <kernel/lapic.h>
+#include <kernel/paging.h>
+#include <kernel/pci.h>
+#include <kernel/pio.h>
+#include <kernel/tsc.h>
+#include <kernel/tty.h>
+
+#define PCI_SLOT_MAX 32
+#define PCI_FUNCTION_MAX 8
+#define PCI_CAPABILITY_MAX 48 // bounds walks of a broken capability list
+
+static const char* const pci_class_names[] = {
+    "unclassified", "storage", "network", "display", "multimedia", "memory",
+    "bridge", "communication", "system", "input", "docking", "processor",
+    "serial bus", "wireless", "intelligent", "satellite", "crypto", "signal processing",
+};
+
+static PciDevice pci_devices[PCI_DEVICE_MAX];
+static uint32_t pci_device_count;
+static const PciDriver* pci_drivers[PCI_DRIVER_MAX];
+static uint32_t pci_driver_count;
+static uint32_t pci_msi_used; // bit per vector from IDT_VECTOR_MSI_BASE
+static uint32_t pci_bus_count;
+static uint32_t pci_config_reads;
+static uint64_t pci_enum_cycles;
+
+/**************************************************************************//**
+ * @brief Local function. Reads a configuration dword by bus address.
+ * 
+ * Mechanism #1 needs the address and data ports written back to back, so
+ * interrupts are held off in between.
+ * 
+ ******************************************************************************/
+static uint32_t pci_config_read(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset) {
+    uint32_t flags = cpu_irq_save();
+    uint32_t value;
+
+    outl(PCI_CONFIG_ENABLE | (bus << 16) | (slot << 11) | (function << 8) | (offset & 0xFC),
+        PCI_CONFIG_ADDRESS);
+    value = inl(PCI_CONFIG_DATA);
+    pci_config_reads++;
+
+    cpu_irq_restore(flags);
+    return value;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Writes a configuration dword by bus address.
+ * 
+ ******************************************************************************/
+static void pci_config_write(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint32_t value) {
+    uint32_t flags = cpu_irq_save();
+
+    outl(PCI_CONFIG_ENABLE | (bus << 16) | (slot << 11) | (function << 8) | (offset & 0xFC),
+        PCI_CONFIG_ADDRESS);
+    outl(value, PCI_CONFIG_DATA);
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Sizes the BARs of a function.
+ * 
+ * Each BAR is written with all ones and read back, the bits that stay zero
+ * give its size. Decoding is switched off meanwhile, so the device does not
+ * claim accesses at the bogus address.
+ * 
+ ******************************************************************************/
+static __init void pci_size_bars(PciDevice* device, uint32_t count) {
+    uint16_t command = pci_read16(device, PCI_COMMAND);
+
+    pci_write16(device, PCI_COMMAND, command & ~(PCI_COMMAND_IO | PCI_COMMAND_MEMORY));
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t offset = PCI_BAR0 + i * sizeof(uint32_t);
+        uint32_t original = pci_read32(device, offset);
+        PciBar* bar = &device->bars[i];
+        uint32_t mask;
+
+        pci_write32(device, offset, 0xFFFFFFFF);
+        mask = pci_read32(device, offset);
+        pci_write32(device, offset, original);
+
+        if (original & 0x01) {
+            bar->flags = PCI_BAR_IO;
+            bar->base = original & 0xFFFFFFFC;
+            mask &= 0xFFFC;
+            // I/O space is 64 KiB, the upper half of the mask may read as 0
+            bar->size = mask ? (~mask + 1) & 0xFFFF : 0;
+        } else {
+            bar->flags = (original & 0x08) ? PCI_BAR_PREFETCH : 0;
+            bar->base = original & 0xFFFFFFF0;
+            mask &= 0xFFFFFFF0;
+            bar->size = mask ? ~mask + 1 : 0;
+        }
+
+        // The upper half of a 64-bit BAR takes the next slot
+        if (!(original & 0x01) && (original & 0x06) == 0x04 && i + 1 < count) {
+            uint32_t high = pci_read32(device, offset + sizeof(uint32_t));
+
+            bar->flags |= PCI_BAR_64;
+            if (high) {
+                bar->base = 0; // not reachable with 32-bit addressing
+                bar->size = 0;
+            }
+            i++;
+        }
+    }
+
+    pci_write16(device, PCI_COMMAND, command);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Checks a device against a driver's ID table.
+ * 
+ ******************************************************************************/
+static bool pci_match(const PciDriver* driver, const PciDevice* device) {
+    uint32_t class_code = (device->class_code << 16) | (device->subclass << 8) | device->prog_if;
+
+    for (const PciId* id = driver->ids; id->vendor || id->class_mask; id++) {
+        if (id->vendor != PCI_ANY_ID && id->vendor != device->vendor)
+            continue;
+        if (id->device != PCI_ANY_ID && id->device != device->device)
+            continue;
+        if ((class_code & id->class_mask) == (id->class_code & id->class_mask))
+            return true;
+    }
+    return false;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Offers an unbound device to a driver.
+ * 
+ ******************************************************************************/
+static void pci_bind(const PciDriver* driver, PciDevice* device) {
+    if (device->driver || !pci_match(driver, device))
+        return;
+    if (driver->probe(device) == 0)
+        device->driver = driver;
+}
+
+static __init void pci_scan_bus(uint8_t bus);
+
+/**************************************************************************//**
+ * @brief Local function. Adds a function to the device table.
+ * 
+ * Bridges to another PCI bus are followed right away, so buses are only
+ * visited if something leads to them.
+ * 
+ * @return Header type byte, with the multi-function bit.
+ * 
+ ******************************************************************************/
+static __init uint8_t pci_scan_function(uint8_t bus, uint8_t slot, uint8_t function, uint32_t id) {
+    uint32_t class_revision = pci_config_read(bus, slot, function, PCI_CLASS_REVISION);
+    uint32_t header = pci_config_read(bus, slot, function, PCI_HEADER_TYPE & 0xFC);
+    uint32_t interrupt = pci_config_read(bus, slot, function, PCI_INTERRUPT_LINE);
+    uint8_t header_type = (header >> 16) & PCI_HEADER_TYPE_MASK;
+
+    if (pci_device_count < PCI_DEVICE_MAX) {
+        PciDevice* device = &pci_devices[pci_device_count++];
+
+        device->bus = bus;
+        device->slot = slot;
+        device->function = function;
+        device->header_type = header_type;
+        device->vendor = id & 0xFFFF;
+        device->device = id >> 16;
+        device->revision = class_revision & 0xFF;
+        device->prog_if = (class_revision >> 8) & 0xFF;
+        device->subclass = (class_revision >> 16) & 0xFF;
+        device->class_code = class_revision >> 24;
+        device->irq_line = interrupt & 0xFF;
+        device->irq_pin = (interrupt >> 8) & 0xFF;
+        device->msi_cap = pci_find_capability(device, PCI_CAP_MSI, 0);
+        device->msix_cap = pci_find_capability(device, PCI_CAP_MSIX, 0);
+        device->msi_vector = 0;
+        device->driver = NULL;
+        device->driver_data = NULL;
+
+        if (header_type == PCI_HEADER_TYPE_DEVICE)
+            pci_size_bars(device, PCI_BAR_COUNT);
+        else if (header_type == PCI_HEADER_TYPE_BRIDGE)
+            pci_size_bars(device, 2);
+    }
+
+    if (header_type == PCI_HEADER_TYPE_BRIDGE && (class_revision >> 24) == PCI_CLASS_BRIDGE
+        && ((class_revision >> 16) & 0xFF) == PCI_SUBCLASS_BRIDGE_PCI) {
+        uint8_t secondary = (pci_config_read(bus, slot, function, PCI_SECONDARY_BUS & 0xFC) >> 8) & 0xFF;
+
+        if (secondary > bus)
+            pci_scan_bus(secondary);
+    }
+    return (header >> 16) & 0xFF;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Enumerates the functions on one bus.
+ * 
+ * Functions 1-7 are only probed on multi-function devices, which saves 7
+ * of every 8 configuration reads on a typical bus.
+ * 
+ ******************************************************************************/
+static __init void pci_scan_bus(uint8_t bus) {
+    pci_bus_count++;
+
+    for (uint8_t slot = 0; slot < PCI_SLOT_MAX; slot++) {
+        uint32_t id = pci_config_read(bus, slot, 0, PCI_VENDOR_ID);
+
+        if ((id & 0xFFFF) == 0xFFFF)
+            continue;
+        if (!(pci_scan_function(bus, slot, 0, id) & PCI_HEADER_MULTIFUNCTION))
+            continue;
+
+        for (uint8_t function = 1; function < PCI_FUNCTION_MAX; function++) {
+            id = pci_config_read(bus, slot, function, PCI_VENDOR_ID);
+            if ((id & 0xFFFF) != 0xFFFF)
+                pci_scan_function(bus, slot, function, id);
+        }
+    }
+}
+
+/**************************************************************************//**
+ * @brief Enumerates the PCI buses into the device table.
+ * 
+ * Buses are found by following bridges from bus 0. A multi-function host
+ * bridge at 00:00 means one host controller, and root bus, per function.
+ * Drivers registered so far are matched afterwards. Must run after
+ * lapic_init() for MSIs to be available.
+ * 
+ ******************************************************************************/
+__init void pci_init() {
+    uint64_t start = tsc_read();
+
+    pci_device_count = 0;
+    pci_bus_count = 0;
+    pci_config_reads = 0;
+    pci_msi_used = 0;
+
+    uint32_t header = pci_config_read(0, 0, 0, PCI_HEADER_TYPE & 0xFC);
+    if ((header >> 16) & PCI_HEADER_MULTIFUNCTION) {
+        for (uint8_t function = 0; function < PCI_FUNCTION_MAX; function++) {
+            if ((pci_config_read(0, 0, function, PCI_VENDOR_ID) & 0xFFFF) != 0xFFFF)
+                pci_scan_bus(function);
+        }
+    } else {
+        pci_scan_bus(0);
+    }
+
+    pci_enum_cycles = tsc_read() - start;
+
+    for (uint32_t i = 0; i < pci_driver_count; i++) {
+        for (uint32_t j = 0; j < pci_device_count; j++)
+            pci_bind(pci_drivers[i], &pci_devices[j]);
+    }
+
+    term_writestring("\nPCI initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Reads a configuration space dword.
+ * 
+ * @param device Device from the table.
+ * @param offset Register offset, rounded down to a multiple of 4.
+ * @return Register value.
+ * 
+ ******************************************************************************/
+uint32_t pci_read32(const PciDevice* device, uint8_t offset) {
+    return pci_config_read(device->bus, device->slot, device->function, offset);
+}
+
+/**************************************************************************//**
+ * @brief Reads a configuration space word.
+ * 
+ * @param device Device from the table.
+ * @param offset Register offset, rounded down to a multiple of 2.
+ * @return Register value.
+ * 
+ ******************************************************************************/
+uint16_t pci_read16(const PciDevice* device, uint8_t offset) {
+    return (pci_read32(device, offset) >> ((offset & 0x02) * 8)) & 0xFFFF;
+}
+
+/**************************************************************************//**
+ * @brief Reads a configuration space byte.
+ * 
+ * @param device Device from the table.
+ * @param offset Register offset.
+ * @return Register value.
+ * 
+ ******************************************************************************/
+uint8_t pci_read8(const PciDevice* device, uint8_t offset) {
+    return (pci_read32(device, offset) >> ((offset & 0x03) * 8)) & 0xFF;
+}
+
+/**************************************************************************//**
+ * @brief Writes a configuration space dword.
+ * 
+ * @param device Device from the table.
+ * @param offset Register offset, rounded down to a multiple of 4.
+ * @param value Value to write.
+ * 
+ ******************************************************************************/
+void pci_write32(const PciDevice* device, uint8_t offset, uint32_t value) {
+    pci_config_write(device->bus, device->slot, device->function, offset, value);
+}
+
+/**************************************************************************//**
+ * @brief Writes a configuration space word.
+ * 
+ * Mechanism #1 only transfers dwords, so the rest of the dword is read and
+ * written back. Avoid on registers with write-one-to-clear bits next to it.
+ * 
+ * @param device Device from the table.
+ * @param offset Register offset, rounded down to a multiple of 2.
+ * @param value Value to write.
+ * 
+ ******************************************************************************/
+void pci_write16(const PciDevice* device, uint8_t offset, uint16_t value) {
+    uint32_t shift = (offset & 0x02) * 8;
+    uint32_t dword = pci_read32(device, offset);
+
+    dword = (dword & ~(0xFFFF << shift)) | ((uint32_t) value << shift);
+    pci_write32(device, offset, dword);
+}
+
+/**************************************************************************//**
+ * @brief Writes a configuration space byte, see pci_write16().
+ * 
+ * @param device Device from the table.
+ * @param offset Register offset.
+ * @param value Value to write.
+ * 
+ ******************************************************************************/
+void pci_write8(const PciDevice* device, uint8_t offset, uint8_t value) {
+    uint32_t shift = (offset & 0x03) * 8;
+    uint32_t dword = pci_read32(device, offset);
+
+    dword = (dword & ~(0xFF << shift)) | ((uint32_t) value << shift);
+    pci_write32(device, offset, dword);
+}
+
+/**************************************************************************//**
+ * @brief Looks up a device by vendor and device ID in the cached table.
+ * 
+ * @param vendor Vendor ID, or PCI_ANY_ID.
+ * @param device Device ID, or PCI_ANY_ID.
+ * @param from Previous match to continue after, NULL to start over.
+ * @return Next matching device, NULL if there is none.
+ * 
+ ******************************************************************************/
+PciDevice* pci_find_device(uint16_t vendor, uint16_t device, PciDevice* from) {
+    for (uint32_t i = from ? (uint32_t) (from - pci_devices) + 1 : 0; i < pci_device_count; i++) {
+        PciDevice* candidate = &pci_devices[i];
+
+        if ((vendor == PCI_ANY_ID || candidate->vendor == vendor)
+            && (device == PCI_ANY_ID || candidate->device == device))
+            return candidate;
+    }
+    return NULL;
+}
+
+/**************************************************************************//**
+ * @brief Looks up a device by class in the cached table.
+ * 
+ * @param class_code Base class.
+ * @param subclass Subclass, or 0xFF for any.
+ * @param from Previous match to continue after, NULL to start over.
+ * @return Next matching device, NULL if there is none.
+ * 
+ ******************************************************************************/
+PciDevice* pci_find_class(uint8_t class_code, uint8_t subclass, PciDevice* from) {
+    for (uint32_t i = from ? (uint32_t) (from - pci_devices) + 1 : 0; i < pci_device_count; i++) {
+        PciDevice* candidate = &pci_devices[i];
+
+        if (candidate->class_code == class_code && (subclass == 0xFF || candidate->subclass == subclass))
+            return candidate;
+    }
+    return NULL;
+}
+
+/**************************************************************************//**
+ * @brief Walks the capability list of a device.
+ * 
+ * @param device Device from the table.
+ * @param id Capability ID, PCI_CAP_*.
+ * @param from Offset of a previous match to continue after, 0 to start over.
+ * @return Configuration space offset of the capability, 0 if not found.
+ * 
+ ******************************************************************************/
+uint8_t pci_find_capability(const PciDevice* device, uint8_t id, uint8_t from) {
+    uint8_t offset;
+
+    if (from) {
+        offset = pci_read8(device, from + 1);
+    } else {
+        if (!(pci_read16(device, PCI_STATUS) & PCI_STATUS_CAPABILITIES))
+            return 0;
+        offset = pci_read8(device, PCI_CAPABILITY_LIST);
+    }
+
+    for (uint32_t i = 0; i < PCI_CAPABILITY_MAX && offset >= 0x40; i++) {
+        uint16_t header = pci_read16(device, offset & 0xFC);
+
+        if ((header & 0xFF) == id)
+            return offset & 0xFC;
+        offset = header >> 8;
+    }
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Turns on decoding of the device's BARs and bus mastering (DMA).
+ * 
+ * @param device Device from the table.
+ * 
+ ******************************************************************************/
+void pci_enable(PciDevice* device) {
+    uint16_t command = pci_read16(device, PCI_COMMAND);
+
+    command |= PCI_COMMAND_MASTER;
+    for (uint32_t i = 0; i < PCI_BAR_COUNT; i++) {
+        if (device->bars[i].size)
+            command |= (device->bars[i].flags & PCI_BAR_IO) ? PCI_COMMAND_IO : PCI_COMMAND_MEMORY;
+    }
+    pci_write16(device, PCI_COMMAND, command);
+}
+
+/**************************************************************************//**
+ * @brief Retrieves a pointer to a memory BAR.
+ * 
+ * BARs are used where the firmware put them. The MMIO range is identity
+ * mapped with caching left to the MTRRs, see paging_init(), so nothing has
+ * to be mapped here.
+ * 
+ * @param device Device from the table.
+ * @param bar BAR index.
+ * @return Virtual address of the BAR, NULL for I/O BARs and BARs that are
+ * unassigned or outside the MMIO range.
+ * 
+ ******************************************************************************/
+void* pci_map_bar(PciDevice* device, uint32_t bar) {
+    if (bar >= PCI_BAR_COUNT)
+        return NULL;
+
+    PciBar* entry = &device->bars[bar];
+    if (!entry->size || (entry->flags & PCI_BAR_IO))
+        return NULL;
+    if (entry->base < MMIO_SPACE_START || entry->base + entry->size - 1 < entry->base)
+        return NULL;
+    return (void*) entry->base;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Takes a free MSI vector and installs its handler.
+ * 
+ * @return Vector, -EBUSY if all are taken.
+ * 
+ ******************************************************************************/
+static int pci_alloc_vector(idt_handler_t handler) {
+    uint32_t flags = cpu_irq_save();
+    uint32_t free = ~pci_msi_used & ((1U << IDT_MSI_COUNT) - 1);
+
+    if (!free) {
+        cpu_irq_restore(flags);
+        return -EBUSY;
+    }
+    uint32_t index = __builtin_ctz(free);
+    pci_msi_used |= 1U << index;
+    cpu_irq_restore(flags);
+
+    idt_register_handler(IDT_VECTOR_MSI_BASE + index, handler);
+    return IDT_VECTOR_MSI_BASE + index;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Removes the handler of an MSI vector and frees it.
+ * 
+ ******************************************************************************/
+static void pci_free_vector(uint8_t vector) {
+    idt_register_handler(vector, NULL);
+
+    uint32_t flags = cpu_irq_save();
+    pci_msi_used &= ~(1U << (vector - IDT_VECTOR_MSI_BASE));
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Switches a device from its legacy interrupt line to a single MSI.
+ * 
+ * The message targets the local APIC of the boot CPU with a vector of its
+ * own, so the interrupt is never shared and needs no 8259 round trips.
+ * 
+ * @param device Device from the table.
+ * @param handler Called in hard interrupt context, the EOI is sent by
+ * idt_dispatch().
+ * @return Interrupt vector, -ENODEV if the device or CPU lacks MSI support,
+ * -EBUSY if all MSI vectors are taken.
+ * 
+ ******************************************************************************/
+int pci_enable_msi(PciDevice* device, idt_handler_t handler) {
+    uint8_t cap = device->msi_cap;
+
+    if (!cap || !lapic_enabled())
+        return -ENODEV;
+    if (device->msi_vector)
+        return device->msi_vector;
+
+    int vector = pci_alloc_vector(handler);
+    if (vector < 0)
+        return vector;
+
+    uint16_t control = pci_read16(device, cap + PCI_MSI_CONTROL);
+    pci_write32(device, cap + PCI_MSI_ADDRESS, LAPIC_MSI_ADDRESS | (lapic_id() << LAPIC_MSI_DEST_SHIFT));
+    if (control & PCI_MSI_CONTROL_64BIT) {
+        pci_write32(device, cap + PCI_MSI_ADDRESS_HIGH, 0);
+        pci_write16(device, cap + PCI_MSI_DATA_64, vector);
+        if (control & PCI_MSI_CONTROL_MASKABLE)
+            pci_write32(device, cap + PCI_MSI_MASK_64, 0);
+    } else {
+        pci_write16(device, cap + PCI_MSI_DATA_32, vector);
+        if (control & PCI_MSI_CONTROL_MASKABLE)
+            pci_write32(device, cap + PCI_MSI_MASK_32, 0);
+    }
+    control = (control & ~PCI_MSI_CONTROL_MME_MASK) | PCI_MSI_CONTROL_ENABLE;
+    pci_write16(device, cap + PCI_MSI_CONTROL, control);
+
+    pci_write16(device, PCI_COMMAND, pci_read16(device, PCI_COMMAND) | PCI_COMMAND_INTX_DISABLE);
+    device->msi_vector = vector;
+    return vector;
+}
+
+/**************************************************************************//**
+ * @brief Switches a device to MSI-X, with one table entry in use.
+ * 
+ * The other entries keep their reset state, masked. Devices that only
+ * implement MSI-X, like the virtio ones QEMU emulates, need this rather
+ * than pci_enable_msi(). Only one MSI-X entry per device is supported.
+ * 
+ * @param device Device from the table.
+ * @param entry Table entry the device raises, device specific.
+ * @param handler Called in hard interrupt context, the EOI is sent by
+ * idt_dispatch().
+ * @return Interrupt vector, -ENODEV if the device or CPU lacks MSI-X
+ * support or its table is not reachable, -EINVAL for an entry past the
+ * table, -EBUSY if all MSI vectors are taken.
+ * 
+ ******************************************************************************/
+int pci_enable_msix(PciDevice* device, uint32_t entry, idt_handler_t handler) {
+    uint8_t cap = device->msix_cap;
+
+    if (!cap || !lapic_enabled())
+        return -ENODEV;
+    if (device->msi_vector)
+        return device->msi_vector;
+
+    uint16_t control = pci_read16(device, cap + PCI_MSIX_CONTROL);
+    uint32_t table = pci_read32(device, cap + PCI_MSIX_TABLE);
+    volatile uint8_t* base = pci_map_bar(device, table & 0x07);
+
+    if (entry > (control & PCI_MSIX_CONTROL_SIZE_MASK))
+        return -EINVAL;
+    if (!base)
+        return -ENODEV;
+
+    int vector = pci_alloc_vector(handler);
+    if (vector < 0)
+        return vector;
+
+    // Enabled with all entries masked while the one in use is written
+    pci_enable(device);
+    pci_write16(device, cap + PCI_MSIX_CONTROL, control | PCI_MSIX_CONTROL_ENABLE | PCI_MSIX_CONTROL_MASK_ALL);
+
+    volatile uint32_t* slot = (volatile uint32_t*) (base + (table & ~0x07) + entry * PCI_MSIX_ENTRY_SIZE);
+    slot[PCI_MSIX_ENTRY_ADDRESS / 4] = LAPIC_MSI_ADDRESS | (lapic_id() << LAPIC_MSI_DEST_SHIFT);
+    slot[PCI_MSIX_ENTRY_ADDRESS_HIGH / 4] = 0;
+    slot[PCI_MSIX_ENTRY_DATA / 4] = vector;
+    slot[PCI_MSIX_ENTRY_CONTROL / 4] &= ~PCI_MSIX_ENTRY_MASKED;
+
+    pci_write16(device, cap + PCI_MSIX_CONTROL, (control | PCI_MSIX_CONTROL_ENABLE) & ~PCI_MSIX_CONTROL_MASK_ALL);
+    pci_write16(device, PCI_COMMAND, pci_read16(device, PCI_COMMAND) | PCI_COMMAND_INTX_DISABLE);
+    device->msi_vector = vector;
+    device->msix = true;
+    return vector;
+}
+
+/**************************************************************************//**
+ * @brief Switches a device back from MSI or MSI-X to its legacy line.
+ * 
+ * Undoes pci_enable_msi() or pci_enable_msix(), for drivers that give up
+ * on a device after enabling them. The line itself is left to the driver.
+ * 
+ * @param device Device from the table, nothing happens if neither is on.
+ * 
+ ******************************************************************************/
+void pci_disable_msi(PciDevice* device) {
+    if (!device->msi_vector)
+        return;
+
+    if (device->msix) {
+        uint8_t cap = device->msix_cap;
+        pci_write16(device, cap + PCI_MSIX_CONTROL, pci_read16(device, cap + PCI_MSIX_CONTROL) & ~PCI_MSIX_CONTROL_ENABLE);
+    } else {
+        uint8_t cap = device->msi_cap;
+        pci_write16(device, cap + PCI_MSI_CONTROL, pci_read16(device, cap + PCI_MSI_CONTROL) & ~PCI_MSI_CONTROL_ENABLE);
+    }
+    pci_write16(device, PCI_COMMAND, pci_read16(device, PCI_COMMAND) & ~PCI_COMMAND_INTX_DISABLE);
+
+    pci_free_vector(device->msi_vector);
+    device->msi_vector = 0;
+    device->msix = false;
+}
+
+/**************************************************************************//**
+ * @brief Adds a driver and offers it every unbound matching device.
+ * 
+ * Drivers registered before pci_init() are matched once enumeration is done.
+ * 
+ * @param driver Driver, must stay valid.
+ * @return Number of devices bound, -ENOMEM if the registry is full.
+ * 
+ ******************************************************************************/
+int pci_register_driver(const PciDriver* driver) {
+    int bound = 0;
+
+    if (pci_driver_count == PCI_DRIVER_MAX)
+        return -ENOMEM;
+    pci_drivers[pci_driver_count++] = driver;
+
+    for (uint32_t i = 0; i < pci_device_count; i++) {
+        pci_bind(driver, &pci_devices[i]);
+        if (pci_devices[i].driver == driver)
+            bound++;
+    }
+    return bound;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves a readable name for a base class.
+ * 
+ ******************************************************************************/
+const char* pci_class_name(uint8_t class_code) {
+    if (class_code < sizeof(pci_class_names) / sizeof(pci_class_names[0]))
+        return pci_class_names[class_code];
+    return "other";
+}
+
+/**************************************************************************//**
+ * @brief Prints the device table and the cost of enumerating it.
+ * 
+ ******************************************************************************/
+void pci_report() {
+    for (uint32_t i = 0; i < pci_device_count; i++) {
+        PciDevice* device = &pci_devices[i];
+
+        printf("\npci: %02x:%02x.%u %04x:%04x %s (%02x.%02x.%02x)", device->bus, device->slot,
+            device->function, device->vendor, device->device, pci_class_name(device->class_code),
+            device->class_code, device->subclass, device->prog_if);
+        if (device->msi_vector)
+            printf(" %s %u", device->msix ? "msi-x" : "msi", device->msi_vector);
+        else if (device->irq_pin)
+            printf(" irq %u", device->irq_line);
+        if (device->driver)
+            printf(" [%s]", device->driver->name);
+    }
+    printf("\npci: %u functions on %u buses, %u config reads, enumerated in %llu us",
+        pci_device_count, pci_bus_count, pci_config_reads, tsc_cycles_to_us(pci_enum_cycles));
+}
@@ -1,5 +1,6 @@
 #include <stdint.h>
 
+#include <kernel/init.h>
 #include <kernel/pic.h>
 #include <kernel/pio.h>
 #include <kernel/tty.h>
@@ -84,7 +85,7 @@ static uint8_t pic_master_data, pic_slave_data;
  * offset values, through pic_initOffset(uint8_t,uint8_t).
  *              
  ******************************************************************************/
-void pic_init() {
+__init void pic_init() {
     pic_initOffset(PIC_MASTER_x86_IRQ_OFFSET, PIC_SLAVE_x86_IRQ_OFFSET);
 }
 
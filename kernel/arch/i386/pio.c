@@ -41,6 +41,24 @@ void outw(uint16_t value, unsigned short int port) {
         );
 }
 
+/**************************************************************************//**
+ * @brief Writes a 32-bit value to the specified port.
+ *
+ * This function writes a 32-bit doubleword to a hardware port, through
+ * a specified 16-bit address.
+ *
+ * @param value Value to be written.
+ * @param port Port to be written to.
+ *              
+ ******************************************************************************/
+void outl(uint32_t value, unsigned short int port) {
+
+    asm volatile("outl %0, %1\n\t"
+        :
+        : "a" (value), "d" (port)
+        );
+}
+
 /**************************************************************************//**
  * @brief Reads an 8-bit value from a specified port.
  *
@@ -77,4 +95,25 @@ uint16_t inw(unsigned short int port) {
         );
 
     return in_word;
-}
\ No newline at end of file
+}
+
+/**************************************************************************//**
+ * @brief Reads a 32-bit value from a specified port.
+ *
+ * This function reads a 32-bit doubleword from a port, specified by its
+ * address.
+ * 
+ * @param port Port to be read from.
+ * @return Value read from port.
+ *              
+ ******************************************************************************/
+uint32_t inl(unsigned short int port) {
+    uint32_t in_long;
+
+    asm volatile("inl %1, %0\n\t"
+        : "=a" (in_long)
+        : "d" (port)
+        );
+
+    return in_long;
+}
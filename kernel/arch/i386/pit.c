@@ -0,0 +1,125 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <kernel/cpu.h>
+#include <kernel/idt.h>
+#include <kernel/init.h>
+#include <kernel/pic.h>
+#include <kernel/pio.h>
+#include <kernel/pit.h>
+#include <kernel/tty.h>
+
+#define PIT_MAX_COUNT 0xFFFF
+
+static pit_handler_t pit_handler;
+static bool pit_periodic;
+static uint32_t pit_periodic_count;
+static uint32_t pit_reprograms;
+
+/**************************************************************************//**
+ * @brief Local function. IRQ0 handler, forwards to the registered handler.
+ * 
+ ******************************************************************************/
+static void pit_interrupt(InterruptFrame* frame) {
+    (void) frame;
+    if (pit_handler)
+        pit_handler();
+}
+
+/**************************************************************************//**
+ * @brief Local function. Loads a mode and reload value into channel 0.
+ * 
+ ******************************************************************************/
+static void pit_load(uint8_t command, uint16_t count) {
+    uint32_t flags = cpu_irq_save();
+
+    outb(command, PIT_CMD);
+    outb(count & 0xFF, PIT_CHANNEL0_DATA);
+    outb(count >> 8, PIT_CHANNEL0_DATA);
+    pit_reprograms++;
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Initializes PIT channel 0 as the clock event device.
+ * 
+ * The channel stays silent until pit_set_periodic() or pit_set_oneshot().
+ * 
+ * @param handler Called from IRQ0, in hard interrupt context.
+ *              
+ ******************************************************************************/
+__init void pit_init(pit_handler_t handler) {
+    pit_handler = handler;
+    pit_periodic = false;
+    pit_periodic_count = 0;
+    pit_reprograms = 0;
+
+    // Mode 0 with no count written yet does not fire
+    outb(PIT_CMD_CHANNEL0_ONESHOT, PIT_CMD);
+
+    idt_register_irq_handler(PIT_IRQ, pit_interrupt);
+    pic_clearInterruptMask(PIT_IRQ);
+
+    term_writestring("\nPIT initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Makes channel 0 interrupt at a fixed rate.
+ * 
+ * Does not touch the hardware if that rate is already running.
+ * 
+ * @param hz Interrupt frequency, at least 19 Hz.
+ *              
+ ******************************************************************************/
+void pit_set_periodic(uint32_t hz) {
+    uint32_t count = (PIT_FREQUENCY_HZ + hz / 2) / hz;
+
+    if (count > PIT_MAX_COUNT)
+        count = PIT_MAX_COUNT;
+    if (pit_periodic && pit_periodic_count == count)
+        return;
+
+    pit_load(PIT_CMD_CHANNEL0_PERIODIC, (uint16_t) count);
+    pit_periodic = true;
+    pit_periodic_count = count;
+}
+
+/**************************************************************************//**
+ * @brief Makes channel 0 interrupt once after a delay.
+ * 
+ * Replaces a periodic rate or a pending one-shot interrupt.
+ * 
+ * @param us Delay in microseconds, rounded up to the PIT resolution and
+ * limited to about 55 ms.
+ * @return Delay actually programmed, in microseconds.
+ *              
+ ******************************************************************************/
+uint32_t pit_set_oneshot(uint32_t us) {
+    uint64_t count = ((uint64_t) us * PIT_FREQUENCY_HZ + 999999) / 1000000;
+
+    if (count > PIT_MAX_COUNT)
+        count = PIT_MAX_COUNT;
+    if (count == 0)
+        count = 1;
+
+    pit_load(PIT_CMD_CHANNEL0_ONESHOT, (uint16_t) count);
+    pit_periodic = false;
+    return (uint32_t) ((count * 1000000) / PIT_FREQUENCY_HZ);
+}
+
+/**************************************************************************//**
+ * @brief Checks whether channel 0 runs at a fixed rate.
+ * 
+ ******************************************************************************/
+bool pit_is_periodic() {
+    return pit_periodic;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves how often channel 0 was reprogrammed.
+ * 
+ ******************************************************************************/
+uint32_t pit_reprogram_count() {
+    return pit_reprograms;
+}
@@ -0,0 +1,830 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <kernel/cpu.h>
+#include <kernel/futex.h>
+#include <kernel/gdt.h>
+#include <kernel/idt.h>
+#include <kernel/init.h>
+#include <kernel/paging.h>
+#include <kernel/pipe.h>
+#include <kernel/process.h>
+#include <kernel/syscall.h>
+#include <kernel/thread.h>
+#include <kernel/tmpfs.h>
+#include <kernel/tty.h>
+#include <kernel/usermode.h>
+#include <kernel/vdso.h>
+#include <kernel/vm.h>
+
+// SYSENTER model specific registers
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+#define SYSCALL_BENCH_ITERATIONS 100000
+#define SYSCALL_BENCH_WARMUP 1000
+#define SYSCALL_BENCH_STACK_SIZE 1024
+
+typedef int32_t (*syscall_handler_t)(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4);
+
+// cdecl callers pop the arguments, so handlers may declare fewer than four
+#define SYSCALL_HANDLER(fn) ((syscall_handler_t) (void (*)(void)) (fn))
+
+typedef struct SyscallBenchResult {
+    uint64_t int80_cycles;
+    uint64_t sysenter_cycles;
+    bool use_sysenter;
+    bool done;
+} SyscallBenchResult;
+
+extern void sysenter_entry();
+
+static bool syscall_sysenter_enabled;
+
+static USER_DATA SyscallBenchResult syscall_bench_result;
+static USER_DATA uint8_t syscall_bench_stack[SYSCALL_BENCH_STACK_SIZE] __attribute__((aligned(16)));
+
+/**************************************************************************//**
+ * @brief SYSCALL_EXIT: Terminates the calling process with all of its
+ * threads, see process_exit().
+ * 
+ ******************************************************************************/
+static int32_t syscall_exit(uint32_t status) {
+    process_exit((int32_t) status);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_THREAD_EXIT: Terminates only the calling thread, see
+ * process_thread_exit().
+ * 
+ ******************************************************************************/
+static int32_t syscall_thread_exit() {
+    process_thread_exit();
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_NULL: Does nothing, used to measure entry/exit overhead.
+ * 
+ * @return 0.
+ * 
+ ******************************************************************************/
+static int32_t syscall_null() {
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_FORK: Duplicates the calling process, see process_fork().
+ * 
+ * @return Child process id in the parent, 0 in the child.
+ * 
+ ******************************************************************************/
+static int32_t syscall_fork() {
+    return process_fork(thread_current()->syscall_frame);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_GETPID: Retrieves the id of the calling process.
+ * 
+ * @return Process id, -EINVAL from a thread without a process.
+ * 
+ ******************************************************************************/
+static int32_t syscall_getpid() {
+    Process* process = process_current();
+
+    return process ? (int32_t) process->id : -EINVAL;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Checks that a buffer lies in user space.
+ * 
+ ******************************************************************************/
+static inline bool syscall_user_buffer(uint32_t buffer, uint32_t count) {
+    return buffer >= USER_SPACE_START && buffer <= USER_SPACE_END && count <= USER_SPACE_END - buffer
+        && count <= INT32_MAX;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Copies a NUL terminated path from user space.
+ * 
+ * @param address User address of the path.
+ * @param path Receives the path, TMPFS_PATH_MAX bytes.
+ * @return 0 on success, -EFAULT if the path runs out of user space,
+ * -ENAMETOOLONG if it does not fit.
+ * 
+ ******************************************************************************/
+static int syscall_user_path(uint32_t address, char* path) {
+    for (uint32_t i = 0; i < TMPFS_PATH_MAX; i++) {
+        if (address + i < USER_SPACE_START || address + i >= USER_SPACE_END)
+            return -EFAULT;
+        path[i] = ((const char*) address)[i];
+        if (!path[i])
+            return 0;
+    }
+    return -ENAMETOOLONG;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_WRITE: Writes a user buffer to a file descriptor.
+ * 
+ * Standard output and standard error print to the console, other
+ * descriptors are files or pipes, see tmpfs_write() and pipe_write(). Either
+ * way the buffer is read in place, pages it spans are faulted in as the
+ * copy reaches them.
+ * 
+ * @return Bytes written, -EBADF for a descriptor not open for writing,
+ * -EFAULT if the buffer is not in user space, or an error from
+ * tmpfs_write() or pipe_write().
+ * 
+ ******************************************************************************/
+static int32_t syscall_write(uint32_t fd, uint32_t buffer, uint32_t count) {
+    ProcessFile* file;
+    int32_t written;
+
+    if (!syscall_user_buffer(buffer, count))
+        return -EFAULT;
+    if (fd == SYSCALL_FD_STDOUT || fd == SYSCALL_FD_STDERR) {
+        term_write((const char*) buffer, count);
+        return (int32_t) count;
+    }
+
+    file = process_file(fd);
+    if (!file || (file->flags & SYSCALL_O_ACCMODE) == SYSCALL_O_RDONLY)
+        return -EBADF;
+    if (file->pipe)
+        return pipe_write(file->pipe, (const uint8_t*) buffer, count);
+    if (file->flags & SYSCALL_O_APPEND)
+        file->offset = file->inode->size;
+
+    written = tmpfs_write(file->inode, file->offset, (const uint8_t*) buffer, count);
+    if (written > 0)
+        file->offset += (uint32_t) written;
+    return written;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_READ: Reads from a file or pipe into a user buffer.
+ * 
+ * Data is copied straight from the page cache or the pipe buffer, see
+ * tmpfs_read() and pipe_read(). The console cannot be read yet.
+ * 
+ * @return Bytes read, 0 at the end of the file, -EBADF for a descriptor not
+ * open for reading, -EFAULT if the buffer is not in user space, -EISDIR for
+ * a directory.
+ * 
+ ******************************************************************************/
+static int32_t syscall_read(uint32_t fd, uint32_t buffer, uint32_t count) {
+    ProcessFile* file = process_file(fd);
+    int32_t read;
+
+    if (!file || (file->flags & SYSCALL_O_ACCMODE) == SYSCALL_O_WRONLY)
+        return -EBADF;
+    if (!syscall_user_buffer(buffer, count))
+        return -EFAULT;
+    if (file->pipe)
+        return pipe_read(file->pipe, (uint8_t*) buffer, count);
+
+    read = tmpfs_read(file->inode, file->offset, (uint8_t*) buffer, count);
+    if (read > 0)
+        file->offset += (uint32_t) read;
+    return read;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_OPEN: Opens a file or directory in the RAM file system.
+ * 
+ * @param path User address of an absolute path.
+ * @param flags SYSCALL_O_* flags.
+ * @return New descriptor, -EINVAL for unknown flags, -EISDIR to open a
+ * directory for writing, -EMFILE if no descriptor is left, or an error from
+ * copying the path or tmpfs_open().
+ * 
+ ******************************************************************************/
+static int32_t syscall_open(uint32_t path, uint32_t flags) {
+    char name[TMPFS_PATH_MAX];
+    uint32_t open_flags = 0;
+    TmpfsInode* inode;
+    int32_t result;
+
+    if ((flags & ~(SYSCALL_O_ACCMODE | SYSCALL_O_CREAT | SYSCALL_O_EXCL | SYSCALL_O_TRUNC | SYSCALL_O_APPEND))
+        || (flags & SYSCALL_O_ACCMODE) == SYSCALL_O_ACCMODE)
+        return -EINVAL;
+    result = syscall_user_path(path, name);
+    if (result)
+        return result;
+
+    if (flags & SYSCALL_O_CREAT)
+        open_flags |= TMPFS_OPEN_CREATE;
+    if (flags & SYSCALL_O_EXCL)
+        open_flags |= TMPFS_OPEN_EXCLUSIVE;
+    if (flags & SYSCALL_O_TRUNC)
+        open_flags |= TMPFS_OPEN_TRUNCATE;
+
+    result = tmpfs_open(name, open_flags, &inode);
+    if (result)
+        return result;
+    if (inode->type == TMPFS_DIR && (flags & SYSCALL_O_ACCMODE) != SYSCALL_O_RDONLY) {
+        tmpfs_put(inode);
+        return -EISDIR;
+    }
+
+    result = process_file_open(inode, flags & (SYSCALL_O_ACCMODE | SYSCALL_O_APPEND));
+    if (result < 0)
+        tmpfs_put(inode);
+    return result;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_CLOSE: Closes a file descriptor, see process_file_close().
+ * 
+ * @return 0 on success, -EBADF for a descriptor that is not open.
+ * 
+ ******************************************************************************/
+static int32_t syscall_close(uint32_t fd) {
+    return process_file_close(fd);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_LSEEK: Moves the offset of an open file.
+ * 
+ * Moving past the end is allowed, a write there leaves a hole.
+ * 
+ * @param offset Signed distance from the origin.
+ * @param whence SYSCALL_SEEK_*.
+ * @return New offset, -EBADF for a descriptor that is not open, -ESPIPE for
+ * a pipe, -EINVAL for an unknown origin or a negative result, -EOVERFLOW
+ * past INT32_MAX.
+ * 
+ ******************************************************************************/
+static int32_t syscall_lseek(uint32_t fd, uint32_t offset, uint32_t whence) {
+    ProcessFile* file = process_file(fd);
+    int64_t position;
+
+    if (!file)
+        return -EBADF;
+    if (file->pipe)
+        return -ESPIPE;
+
+    if (whence == SYSCALL_SEEK_SET)
+        position = 0;
+    else if (whence == SYSCALL_SEEK_CUR)
+        position = file->offset;
+    else if (whence == SYSCALL_SEEK_END)
+        position = file->inode->size;
+    else
+        return -EINVAL;
+
+    position += (int32_t) offset;
+    if (position < 0)
+        return -EINVAL;
+    if (position > INT32_MAX)
+        return -EOVERFLOW;
+    file->offset = (uint32_t) position;
+    return (int32_t) position;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_FTRUNCATE: Sets the size of an open file.
+ * 
+ * @return 0 on success, -EBADF for a descriptor not open for writing,
+ * -EINVAL for a pipe, -EISDIR for a directory.
+ * 
+ ******************************************************************************/
+static int32_t syscall_ftruncate(uint32_t fd, uint32_t size) {
+    ProcessFile* file = process_file(fd);
+
+    if (!file || (file->flags & SYSCALL_O_ACCMODE) == SYSCALL_O_RDONLY)
+        return -EBADF;
+    if (file->pipe)
+        return -EINVAL;
+    return tmpfs_truncate(file->inode, size);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_MKDIR: Creates a directory, see tmpfs_mkdir().
+ * 
+ * @return 0 on success, negated errno value otherwise.
+ * 
+ ******************************************************************************/
+static int32_t syscall_mkdir(uint32_t path) {
+    char name[TMPFS_PATH_MAX];
+    int error = syscall_user_path(path, name);
+
+    return error ? error : tmpfs_mkdir(name);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_UNLINK: Removes the name of a file, see tmpfs_unlink().
+ * 
+ * @return 0 on success, negated errno value otherwise.
+ * 
+ ******************************************************************************/
+static int32_t syscall_unlink(uint32_t path) {
+    char name[TMPFS_PATH_MAX];
+    int error = syscall_user_path(path, name);
+
+    return error ? error : tmpfs_unlink(name);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_RMDIR: Removes an empty directory, see tmpfs_rmdir().
+ * 
+ * @return 0 on success, negated errno value otherwise.
+ * 
+ ******************************************************************************/
+static int32_t syscall_rmdir(uint32_t path) {
+    char name[TMPFS_PATH_MAX];
+    int error = syscall_user_path(path, name);
+
+    return error ? error : tmpfs_rmdir(name);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_STAT: Retrieves the attributes of a file or directory.
+ * 
+ * @param path User address of an absolute path.
+ * @param stat User address of a SyscallStat to fill in.
+ * @return 0 on success, -EFAULT if stat is not in user space, or an error
+ * from copying the path or tmpfs_stat().
+ * 
+ ******************************************************************************/
+static int32_t syscall_stat(uint32_t path, uint32_t stat) {
+    char name[TMPFS_PATH_MAX];
+    SyscallStat* user_stat = (SyscallStat*) stat;
+    TmpfsStat result;
+    int error;
+
+    if (!syscall_user_buffer(stat, sizeof(SyscallStat)))
+        return -EFAULT;
+    error = syscall_user_path(path, name);
+    if (!error)
+        error = tmpfs_stat(name, &result);
+    if (error)
+        return error;
+
+    user_stat->id = result.id;
+    user_stat->type = result.type == TMPFS_DIR ? SYSCALL_STAT_DIR : SYSCALL_STAT_FILE;
+    user_stat->links = result.links;
+    user_stat->size = result.size;
+    user_stat->pages = result.pages;
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_PIPE: Creates a pipe, see pipe_create().
+ * 
+ * @param fds User address of two ints, receiving the read end and the write
+ * end.
+ * @return 0 on success, -EFAULT if fds is not in user space, -EMFILE if two
+ * descriptors are not left, -ENFILE if out of pipes or memory.
+ * 
+ ******************************************************************************/
+static int32_t syscall_pipe(uint32_t fds) {
+    int32_t* user_fds = (int32_t*) fds;
+    int32_t read_fd, write_fd;
+    Pipe* pipe;
+
+    if (!syscall_user_buffer(fds, 2 * sizeof(int32_t)))
+        return -EFAULT;
+    pipe = pipe_create();
+    if (!pipe)
+        return -ENFILE;
+
+    read_fd = process_pipe_open(pipe, false);
+    if (read_fd < 0) {
+        pipe_put(pipe, false);
+        pipe_put(pipe, true);
+        return read_fd;
+    }
+    write_fd = process_pipe_open(pipe, true);
+    if (write_fd < 0) {
+        process_file_close((uint32_t) read_fd);
+        pipe_put(pipe, true);
+        return write_fd;
+    }
+
+    user_fds[0] = read_fd;
+    user_fds[1] = write_fd;
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_PIPE_GRANT: Moves pages into a pipe, see pipe_grant().
+ * 
+ * @param fd Write end of a pipe.
+ * @param address Start of private anonymous memory, page aligned.
+ * @param size Bytes, whole pages.
+ * @return 0 on success, -EBADF for a descriptor that is not the write end
+ * of a pipe, or an error from pipe_grant().
+ * 
+ ******************************************************************************/
+static int32_t syscall_pipe_grant(uint32_t fd, uint32_t address, uint32_t size) {
+    ProcessFile* file = process_file(fd);
+
+    if (!file || !file->pipe || file->flags != SYSCALL_O_WRONLY)
+        return -EBADF;
+    return pipe_grant(file->pipe, process_current()->space, address, size);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_PIPE_ACCEPT: Maps the pages of a grant, see pipe_accept().
+ * 
+ * The kernel picks the address like for SYSCALL_MMAP, the pages are
+ * unmapped with SYSCALL_MUNMAP.
+ * 
+ * @param fd Read end of a pipe.
+ * @param size User address of a uint32_t receiving the size of the
+ * mapping.
+ * @return Start of the mapping, 0 at the end of the pipe, -EBADF for a
+ * descriptor that is not the read end of a pipe, -EFAULT if size is not in
+ * user space, or an error from pipe_accept().
+ * 
+ ******************************************************************************/
+static int32_t syscall_pipe_accept(uint32_t fd, uint32_t size) {
+    ProcessFile* file = process_file(fd);
+    uint32_t mapped;
+    int32_t address;
+
+    if (!file || !file->pipe || file->flags != SYSCALL_O_RDONLY)
+        return -EBADF;
+    if (!syscall_user_buffer(size, sizeof(uint32_t)))
+        return -EFAULT;
+
+    address = pipe_accept(file->pipe, process_current()->space, PROCESS_MMAP_TOP, &mapped);
+    *(uint32_t*) size = mapped;
+    return address;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_BRK: Moves the end of the heap, see process_brk().
+ * 
+ * @return New break, or the current one for address 0.
+ * 
+ ******************************************************************************/
+static int32_t syscall_brk(uint32_t address) {
+    return process_brk(address);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_MMAP: Maps private demand-zero memory or part of a file.
+ * 
+ * The kernel picks the address, searching down from PROCESS_MMAP_TOP, and
+ * each mapping takes a region of the address space until it is unmapped.
+ * Files map their page cache pages, see vm_map_inode(): with
+ * SYSCALL_MAP_SHARED writes go to the file, otherwise to private copies.
+ * Either end of a pipe maps the pipe's shared memory, see pipe_ring(),
+ * which has to be SYSCALL_MAP_SHARED.
+ * 
+ * @param size Size in bytes, rounded up to whole pages.
+ * @param prot SYSCALL_PROT_* flags, plus SYSCALL_MAP_SHARED for files.
+ * @param fd Open file or pipe to map, -1 for anonymous memory.
+ * @param offset Page aligned file offset.
+ * @return Start of the mapping, -EINVAL for a bad size, flags or offset,
+ * -EBADF for a descriptor that is not open, -EACCES if the descriptor does
+ * not allow the access, -ENODEV for a directory, -ENOMEM if there is no room.
+ * 
+ ******************************************************************************/
+static int32_t syscall_mmap(uint32_t size, uint32_t prot, uint32_t fd, uint32_t offset) {
+    Process* process = process_current();
+    ProcessFile* file = NULL;
+    TmpfsInode* inode = NULL;
+    uint32_t flags = 0;
+    uint32_t address;
+    int error;
+
+    if (!process || !size || size > USER_SPACE_END - USER_SPACE_START
+        || (prot & ~(SYSCALL_PROT_READ | SYSCALL_PROT_WRITE | SYSCALL_PROT_EXEC | SYSCALL_MAP_SHARED)))
+        return -EINVAL;
+
+    if (prot & SYSCALL_PROT_READ)
+        flags |= VM_READ;
+    if (prot & SYSCALL_PROT_WRITE)
+        flags |= VM_WRITE;
+    if (prot & SYSCALL_PROT_EXEC)
+        flags |= VM_EXEC;
+
+    if (fd == (uint32_t) -1) {
+        if (prot & SYSCALL_MAP_SHARED)
+            return -EINVAL;
+    } else {
+        file = process_file(fd);
+        if (!file)
+            return -EBADF;
+        if (offset & ~PAGE_MASK)
+            return -EINVAL;
+        if (file->pipe) {
+            if (!(prot & SYSCALL_MAP_SHARED))
+                return -EINVAL;
+            inode = pipe_ring(file->pipe);
+            if (!inode)
+                return -ENOMEM;
+        } else {
+            if (file->inode->type != TMPFS_FILE)
+                return -ENODEV;
+            if ((file->flags & SYSCALL_O_ACCMODE) == SYSCALL_O_WRONLY
+                || ((prot & SYSCALL_MAP_SHARED) && (prot & SYSCALL_PROT_WRITE)
+                    && (file->flags & SYSCALL_O_ACCMODE) != SYSCALL_O_RDWR))
+                return -EACCES;
+            inode = file->inode;
+        }
+        if (prot & SYSCALL_MAP_SHARED)
+            flags |= VM_SHARED;
+    }
+
+    address = vm_find_free(process->space, size, PROCESS_MMAP_TOP);
+    if (!address)
+        return -ENOMEM;
+    if (inode)
+        error = vm_map_inode(process->space, address, size, inode, offset, flags);
+    else
+        error = vm_map_anonymous(process->space, address, size, flags);
+    return error ? -ENOMEM : (int32_t) address;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_MUNMAP: Unmaps a range and frees its pages, see vm_unmap().
+ * 
+ * @return 0 on success, negated errno value otherwise.
+ * 
+ ******************************************************************************/
+static int32_t syscall_munmap(uint32_t address, uint32_t size) {
+    Process* process = process_current();
+
+    return process ? vm_unmap(process->space, address, size) : -EINVAL;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_MADVISE: Acts on advice about a range of memory.
+ * 
+ * Only SYSCALL_MADV_DONTNEED is supported, which frees the pages right
+ * away, see vm_discard().
+ * 
+ * @return 0 on success, negated errno value otherwise.
+ * 
+ ******************************************************************************/
+static int32_t syscall_madvise(uint32_t address, uint32_t size, uint32_t advice) {
+    Process* process = process_current();
+
+    if (!process || advice != SYSCALL_MADV_DONTNEED)
+        return -EINVAL;
+    return vm_discard(process->space, address, size);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_CLOCK_GETTIME: Reads a clock into a user timespec.
+ * 
+ * The same clock user space reads from the shared data page without a
+ * system call, see vdso_clock_ns(). There is no real-time clock yet, so
+ * both clocks count from boot.
+ * 
+ * @param clock SYSCALL_CLOCK_*.
+ * @param time Receives seconds and nanoseconds as two 32-bit values.
+ * @return 0 on success, -EINVAL for an unknown clock, -EFAULT if time is
+ * not in user space.
+ * 
+ ******************************************************************************/
+static int32_t syscall_clock_gettime(uint32_t clock, uint32_t time) {
+    uint64_t ns = vdso_monotonic_ns();
+    uint32_t* user_time = (uint32_t*) time;
+
+    if (clock != SYSCALL_CLOCK_REALTIME && clock != SYSCALL_CLOCK_MONOTONIC)
+        return -EINVAL;
+    if (time < USER_SPACE_START || time > USER_SPACE_END - 2 * sizeof(uint32_t))
+        return -EFAULT;
+
+    user_time[0] = (uint32_t) (ns / 1000000000);
+    user_time[1] = (uint32_t) (ns % 1000000000);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_FUTEX_WAIT: Sleeps while a user word holds a value.
+ * 
+ * See futex_wait(). User space calls this only after it found the word
+ * contended, the uncontended paths never enter the kernel.
+ * 
+ * @return 0 once woken, -EAGAIN if the word changed, -EINVAL or -EFAULT
+ * for a bad address.
+ * 
+ ******************************************************************************/
+static int32_t syscall_futex_wait(uint32_t address, uint32_t expected) {
+    Process* process = process_current();
+
+    return process ? futex_wait(process->space, address, expected) : -EINVAL;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_FUTEX_WAKE: Wakes threads sleeping on a user word.
+ * 
+ * @return Number of threads woken, -EINVAL or -EFAULT for a bad address.
+ * 
+ ******************************************************************************/
+static int32_t syscall_futex_wake(uint32_t address, uint32_t count) {
+    Process* process = process_current();
+
+    return process ? futex_wake(process->space, address, count) : -EINVAL;
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_THREAD_CREATE: Starts a thread in the calling process.
+ * 
+ * See process_thread_create().
+ * 
+ * @return Thread id, negated errno value otherwise.
+ * 
+ ******************************************************************************/
+static int32_t syscall_thread_create(uint32_t entry, uint32_t stack, uint32_t exit_word) {
+    return process_thread_create(entry, stack, exit_word);
+}
+
+/**************************************************************************//**
+ * @brief SYSCALL_YIELD: Lets other runnable threads go first.
+ * 
+ * Threads are not preempted, so user threads that poll for each other
+ * need this to make progress.
+ * 
+ * @return 0.
+ * 
+ ******************************************************************************/
+static int32_t syscall_yield() {
+    thread_yield();
+    return 0;
+}
+
+static const syscall_handler_t syscall_table[SYSCALL_MAX] = {
+    [SYSCALL_EXIT] = SYSCALL_HANDLER(syscall_exit),
+    [SYSCALL_NULL] = SYSCALL_HANDLER(syscall_null),
+    [SYSCALL_FORK] = SYSCALL_HANDLER(syscall_fork),
+    [SYSCALL_GETPID] = SYSCALL_HANDLER(syscall_getpid),
+    [SYSCALL_WRITE] = SYSCALL_HANDLER(syscall_write),
+    [SYSCALL_BRK] = SYSCALL_HANDLER(syscall_brk),
+    [SYSCALL_MMAP] = SYSCALL_HANDLER(syscall_mmap),
+    [SYSCALL_MUNMAP] = SYSCALL_HANDLER(syscall_munmap),
+    [SYSCALL_MADVISE] = SYSCALL_HANDLER(syscall_madvise),
+    [SYSCALL_CLOCK_GETTIME] = SYSCALL_HANDLER(syscall_clock_gettime),
+    [SYSCALL_FUTEX_WAIT] = SYSCALL_HANDLER(syscall_futex_wait),
+    [SYSCALL_FUTEX_WAKE] = SYSCALL_HANDLER(syscall_futex_wake),
+    [SYSCALL_THREAD_CREATE] = SYSCALL_HANDLER(syscall_thread_create),
+    [SYSCALL_YIELD] = SYSCALL_HANDLER(syscall_yield),
+    [SYSCALL_OPEN] = SYSCALL_HANDLER(syscall_open),
+    [SYSCALL_CLOSE] = SYSCALL_HANDLER(syscall_close),
+    [SYSCALL_READ] = SYSCALL_HANDLER(syscall_read),
+    [SYSCALL_LSEEK] = SYSCALL_HANDLER(syscall_lseek),
+    [SYSCALL_FTRUNCATE] = SYSCALL_HANDLER(syscall_ftruncate),
+    [SYSCALL_MKDIR] = SYSCALL_HANDLER(syscall_mkdir),
+    [SYSCALL_UNLINK] = SYSCALL_HANDLER(syscall_unlink),
+    [SYSCALL_RMDIR] = SYSCALL_HANDLER(syscall_rmdir),
+    [SYSCALL_STAT] = SYSCALL_HANDLER(syscall_stat),
+    [SYSCALL_PIPE] = SYSCALL_HANDLER(syscall_pipe),
+    [SYSCALL_PIPE_GRANT] = SYSCALL_HANDLER(syscall_pipe_grant),
+    [SYSCALL_PIPE_ACCEPT] = SYSCALL_HANDLER(syscall_pipe_accept),
+    [SYSCALL_THREAD_EXIT] = SYSCALL_HANDLER(syscall_thread_exit),
+};
+
+/**************************************************************************//**
+ * @brief Common system call handler for INT 0x80 and SYSENTER.
+ * 
+ * A thread killed while in the call, because another thread of its process
+ * exited, ends here instead of returning to user mode.
+ * 
+ * @param frame Register state of the calling thread. The result is returned
+ * to user mode through frame->eax.
+ *              
+ ******************************************************************************/
+void syscall_dispatch(InterruptFrame* frame) {
+    uint32_t number = frame->eax;
+    Thread* thread = thread_current();
+
+    if (number >= SYSCALL_MAX || !syscall_table[number]) {
+        frame->eax = (uint32_t) -ENOSYS;
+        return;
+    }
+
+    thread->syscall_frame = frame;
+    frame->eax = (uint32_t) syscall_table[number](frame->ebx, frame->esi, frame->edi, frame->ebp);
+    if (thread->killed)
+        process_thread_exit();
+}
+
+/**************************************************************************//**
+ * @brief Initializes both system call entry paths.
+ * 
+ * INT 0x80 always works. When CPUID reports SEP, the SYSENTER MSRs are set
+ * up as well: kernel CS (SS follows as CS + 8, the user segments as CS + 16
+ * and CS + 24, which matches the GDT layout), the TSS as entry stack, and
+ * sysenter_entry as entry point. Must run after gdt_init() and cpu_init().
+ *              
+ ******************************************************************************/
+__init void syscall_init() {
+    idt_register_handler(IDT_VECTOR_SYSCALL, syscall_dispatch);
+
+    syscall_sysenter_enabled = cpu_has(CPU_FEATURE_SEP | CPU_FEATURE_MSR);
+    if (syscall_sysenter_enabled) {
+        cpu_wrmsr(MSR_SYSENTER_CS, GDT_SEGMENT_KERN_CODE);
+        cpu_wrmsr(MSR_SYSENTER_ESP, gdt_tss_address());
+        cpu_wrmsr(MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+    }
+
+    term_writestring(syscall_sysenter_enabled ? "\nSystem calls initialized (SYSENTER)."
+        : "\nSystem calls initialized (INT 0x80).");
+}
+
+/**************************************************************************//**
+ * @brief Local function. Reads the TSC from ring 3.
+ * 
+ ******************************************************************************/
+static inline __attribute__((always_inline, no_instrument_function)) uint64_t syscall_bench_rdtsc() {
+    uint32_t low, high;
+    asm volatile("RDTSC\n\t" : "=a" (low), "=d" (high));
+    return ((uint64_t) high << 32) | low;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Ring 3 half of syscall_benchmark().
+ * 
+ * Times SYSCALL_NULL round trips through INT 0x80 and, if enabled, SYSENTER,
+ * then exits through SYSCALL_EXIT.
+ * 
+ ******************************************************************************/
+static USER_TEXT void syscall_bench_user() {
+    uint64_t start;
+    uint32_t number;
+
+    for (uint32_t i = 0; i < SYSCALL_BENCH_WARMUP; i++) {
+        number = SYSCALL_NULL;
+        asm volatile("INT $0x80\n\t" : "+a" (number) : : "memory");
+    }
+    start = syscall_bench_rdtsc();
+    for (uint32_t i = 0; i < SYSCALL_BENCH_ITERATIONS; i++) {
+        number = SYSCALL_NULL;
+        asm volatile("INT $0x80\n\t" : "+a" (number) : : "memory");
+    }
+    syscall_bench_result.int80_cycles = syscall_bench_rdtsc() - start;
+
+    if (syscall_bench_result.use_sysenter) {
+        for (uint32_t i = 0; i < SYSCALL_BENCH_WARMUP; i++) {
+            number = SYSCALL_NULL;
+            asm volatile("MOV %%esp, %%ecx\n\t"
+                "MOVL $1f, %%edx\n\t"
+                "SYSENTER\n\t"
+                "1:\n\t"
+                : "+a" (number) : : "ecx", "edx", "memory");
+        }
+        start = syscall_bench_rdtsc();
+        for (uint32_t i = 0; i < SYSCALL_BENCH_ITERATIONS; i++) {
+            number = SYSCALL_NULL;
+            asm volatile("MOV %%esp, %%ecx\n\t"
+                "MOVL $1f, %%edx\n\t"
+                "SYSENTER\n\t"
+                "1:\n\t"
+                : "+a" (number) : : "ecx", "edx", "memory");
+        }
+        syscall_bench_result.sysenter_cycles = syscall_bench_rdtsc() - start;
+    }
+
+    syscall_bench_result.done = true;
+
+    number = SYSCALL_EXIT;
+    asm volatile("INT $0x80\n\t" : "+a" (number) : "b" (0) : "memory");
+    for (;;)
+        ;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Kernel thread dropping into syscall_bench_user().
+ * 
+ ******************************************************************************/
+static void syscall_bench_thread(void* arg) {
+    (void) arg;
+    usermode_enter((uint32_t) syscall_bench_user,
+        (uint32_t) (syscall_bench_stack + SYSCALL_BENCH_STACK_SIZE));
+}
+
+/**************************************************************************//**
+ * @brief Compares null system call round trips through both entry paths.
+ * 
+ * A ring 3 thread issues SYSCALL_NULL in a loop, the cycles per round trip
+ * are printed once it exits.
+ *              
+ ******************************************************************************/
+void syscall_benchmark() {
+    syscall_bench_result.done = false;
+    syscall_bench_result.use_sysenter = syscall_sysenter_enabled;
+
+    if (!thread_create("syscall-bench", syscall_bench_thread, NULL)) {
+        printf("\nsyscall: benchmark thread could not be created");
+        return;
+    }
+
+    while (!syscall_bench_result.done)
+        thread_yield();
+
+    printf("\nsyscall: null round trip, int 0x80 %llu cycles",
+        syscall_bench_result.int80_cycles / SYSCALL_BENCH_ITERATIONS);
+    if (syscall_bench_result.use_sysenter)
+        printf(", sysenter %llu cycles", syscall_bench_result.sysenter_cycles / SYSCALL_BENCH_ITERATIONS);
+    printf(" (%u iterations)", SYSCALL_BENCH_ITERATIONS);
+}
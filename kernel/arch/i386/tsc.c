@@ -0,0 +1,63 @@
+#include <stdint.h>
+
+#include <kernel/init.h>
+#include <kernel/pio.h>
+#include <kernel/pit.h>
+#include <kernel/tsc.h>
+#include <kernel/tty.h>
+
+#define TSC_CALIBRATE_MS 10
+
+static uint32_t tsc_cycles_per_ms = 1;
+
+/**************************************************************************//**
+ * @brief Calibrates the Time Stamp Counter(TSC) against the PIT.
+ * 
+ * Channel 2 is used since it can be polled through its output bit, so no
+ * interrupts are needed. The speaker stays disconnected throughout.
+ *              
+ ******************************************************************************/
+__init void tsc_init() {
+    uint16_t count = (PIT_FREQUENCY_HZ * TSC_CALIBRATE_MS) / 1000;
+    uint64_t start, end;
+
+    outb((inb(PIT_GATE_PORT) & ~PIT_GATE_SPEAKER) | PIT_GATE_CHANNEL2, PIT_GATE_PORT);
+
+    outb(PIT_CMD_CHANNEL2_ONESHOT, PIT_CMD);
+    outb(count & 0xFF, PIT_CHANNEL2_DATA);
+    outb(count >> 8, PIT_CHANNEL2_DATA);
+
+    start = tsc_read();
+    while (!(inb(PIT_GATE_PORT) & PIT_GATE_CHANNEL2_OUT))
+        ;
+    end = tsc_read();
+
+    outb(inb(PIT_GATE_PORT) & ~PIT_GATE_CHANNEL2, PIT_GATE_PORT);
+
+    tsc_cycles_per_ms = (uint32_t) ((end - start) / TSC_CALIBRATE_MS);
+    if (tsc_cycles_per_ms == 0)
+        tsc_cycles_per_ms = 1;
+
+    term_writestring("\nTSC calibrated.");
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the calibrated TSC frequency.
+ * 
+ * @return TSC frequency in kHz, i.e. cycles per millisecond.
+ * 
+ ******************************************************************************/
+uint32_t tsc_khz() {
+    return tsc_cycles_per_ms;
+}
+
+/**************************************************************************//**
+ * @brief Converts a TSC cycle count to microseconds.
+ * 
+ * @param cycles Number of cycles, usually the difference of two tsc_read().
+ * @return Elapsed time in microseconds.
+ * 
+ ******************************************************************************/
+uint64_t tsc_cycles_to_us(uint64_t cycles) {
+    return (cycles * 1000) / tsc_cycles_per_ms;
+}
@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <kernel/fbcon.h>
+#include <kernel/init.h>
 #include <kernel/tty.h>
 #include <kernel/pio.h>
 
@@ -14,20 +16,36 @@ static size_t terminal_column;
 static uint8_t terminal_color;
 static uint16_t* terminal_buffer;
 static uint8_t terminal_blink;
+static size_t terminal_width;
+static size_t terminal_height;
+static bool terminal_fb;
 
 /**************************************************************************//**
  * @brief Initializes terminal functionality.
  *
  * This function set up default state variables, and writes white space to
- * the VGA text mode address.
+ * the VGA text mode address. If fbcon_init() found a linear framebuffer, the
+ * framebuffer console is used as the backend instead.
  *              
  ******************************************************************************/
-void term_init(void) {
+__init void term_init(void) {
 	terminal_row = 0;
 	terminal_column = 0;
 	terminal_color = vga_entry_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
 	terminal_buffer = VGA_MEMORY;
     terminal_blink = 0;
+    terminal_fb = fbcon_active();
+
+    if (terminal_fb) {
+        terminal_width = fbcon_columns();
+        terminal_height = fbcon_rows();
+        fbcon_clear(terminal_color);
+        fbcon_flush();
+        return;
+    }
+
+    terminal_width = VGA_WIDTH;
+    terminal_height = VGA_HEIGHT;
 	for (size_t y = 0; y < VGA_HEIGHT; y++) {
 		for (size_t x = 0; x < VGA_WIDTH; x++) {
 			const size_t index = y * VGA_WIDTH + x;
@@ -80,6 +98,10 @@ void term_setbgcolor(uint8_t color) {
  * 
  ******************************************************************************/
 void term_putentryat(unsigned char c, uint8_t color, size_t x, size_t y) {
+    if (terminal_fb) {
+        fbcon_putcell(c, color, x, y);
+        return;
+    }
 	const size_t index = y * VGA_WIDTH + x;
 	terminal_buffer[index] = vga_entry(c, color, false);
 }
@@ -91,14 +113,23 @@ void term_putentryat(unsigned char c, uint8_t color, size_t x, size_t y) {
 void term_scroll() {
     terminal_row--;
 
+    if (terminal_fb) {
+        fbcon_scroll(terminal_color);
+        return;
+    }
+
     // Move everything up 1
-    for(size_t y = 0; y < VGA_HEIGHT; y++) {
+    for(size_t y = 0; y < VGA_HEIGHT - 1; y++) {
         for(size_t x = 0; x < VGA_WIDTH; x++) {
 			const size_t upper_index = y * VGA_WIDTH + x;
             const size_t lower_index = (y+1) * VGA_WIDTH + x;
             terminal_buffer[upper_index] = terminal_buffer[lower_index];
         }
     }
+
+    // Blank the freed bottom line
+    for(size_t x = 0; x < VGA_WIDTH; x++)
+        terminal_buffer[(VGA_HEIGHT - 1) * VGA_WIDTH + x] = vga_entry(' ', terminal_color, false);
 }
 
 /**************************************************************************//**
@@ -112,13 +143,13 @@ void term_putchar(char c) {
 
     if (uc == 10) { // Handle newlines
     terminal_column = 0;
-    if (++terminal_row == VGA_HEIGHT)
+    if (++terminal_row == terminal_height)
         term_scroll();
     } else {
         term_putentryat(uc, terminal_color, terminal_column, terminal_row);
-        if (++terminal_column == VGA_WIDTH) {
+        if (++terminal_column == terminal_width) {
             terminal_column = 0;
-            if (++terminal_row == VGA_HEIGHT)
+            if (++terminal_row == terminal_height)
                 term_scroll();
         }
     }
@@ -127,6 +158,9 @@ void term_putchar(char c) {
 /**************************************************************************//**
  * @brief Writes characters to terminal, up to specified size.
  * 
+ * With the framebuffer console, each call is one frame: cells are drawn to
+ * the back buffer and the dirty region is flushed once at the end.
+ * 
  * @param data Character array. Restricted to VGA text mode characters.
  * @param size Number of characters to write.
  * 
@@ -134,6 +168,10 @@ void term_putchar(char c) {
 void term_write(const char* data, size_t size) {
 	for (size_t i = 0; i < size; i++)
 		term_putchar(data[i]);
+
+    if (terminal_fb)
+        fbcon_flush();
+    else
         term_setcursorpos(terminal_row, terminal_column);
 }
 
@@ -158,7 +196,9 @@ void term_writestring(const char* data) {
  ******************************************************************************/
 void term_enablecursor(uint8_t min, uint8_t max) { 
     
-    if(max <= min)
+    if(terminal_fb) // hardware cursor only exists in text mode
+        return;
+    else if(max <= min)
         return;
     else if(max > MAX_SCANLINES)
         max = MAX_SCANLINES;
@@ -185,6 +225,8 @@ void term_enablecursordefault() {
  * 
  ******************************************************************************/
 void term_disablecursor() {
+    if (terminal_fb)
+        return;
     outb(0x0A, VGA_INDEX_PORT);
 	outb(0x20, VGA_DATA_PORT);
 }
@@ -198,7 +240,10 @@ void term_disablecursor() {
  ******************************************************************************/
 void term_setcursorpos(uint8_t x, uint8_t y) {
 
-	uint16_t pos = y * 80 + x;
+	if (terminal_fb)
+		return;
+
+	uint16_t pos = y * VGA_WIDTH + x;
 
 	outb(0x0F, VGA_INDEX_PORT);
 	outb((uint8_t) (pos & 0xFF), VGA_DATA_PORT);
@@ -0,0 +1,214 @@
+#ifndef _KERNEL_CPU_H_
+#define _KERNEL_CPU_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Feature bits collected by cpu_init(), see cpu_has()
+#define CPU_FEATURE_FPU (0x01 << 0)
+#define CPU_FEATURE_PSE (0x01 << 1)
+#define CPU_FEATURE_TSC (0x01 << 2)
+#define CPU_FEATURE_MSR (0x01 << 3)
+#define CPU_FEATURE_APIC (0x01 << 4)
+#define CPU_FEATURE_SEP (0x01 << 5)
+#define CPU_FEATURE_PGE (0x01 << 6)
+#define CPU_FEATURE_PAT (0x01 << 7)
+#define CPU_FEATURE_MMX (0x01 << 8)
+#define CPU_FEATURE_FXSR (0x01 << 9)
+#define CPU_FEATURE_SSE (0x01 << 10)
+#define CPU_FEATURE_SSE2 (0x01 << 11)
+#define CPU_FEATURE_SSE3 (0x01 << 12)
+#define CPU_FEATURE_MONITOR (0x01 << 13)
+
+// Control register bits
+#define CPU_CR0_MP (0x01 << 1)
+#define CPU_CR0_EM (0x01 << 2)
+#define CPU_CR0_TS (0x01 << 3)
+#define CPU_CR0_NE (0x01 << 5)
+#define CPU_CR0_WP (0x01 << 16)
+#define CPU_CR0_PG (0x01 << 31)
+
+#define CPU_CR4_PSE (0x01 << 4)
+#define CPU_CR4_PGE (0x01 << 7)
+#define CPU_CR4_OSFXSR (0x01 << 9)
+#define CPU_CR4_OSXMMEXCPT (0x01 << 10)
+
+#define CPU_EFLAGS_IF (0x01 << 9)
+
+#define CPU_MAX 1 // per-CPU data is sized for this, only the boot CPU is brought up
+
+void cpu_init();
+uint32_t cpu_features();
+const char* cpu_vendor();
+
+/**************************************************************************//**
+ * @brief Checks for CPU features detected by cpu_init().
+ * 
+ * @param features One or more CPU_FEATURE_* bits.
+ * @return true if all requested features are present.
+ * 
+ ******************************************************************************/
+static inline bool cpu_has(uint32_t features) {
+    return (cpu_features() & features) == features;
+}
+
+static inline void cpu_cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+    asm volatile("CPUID\n\t"
+        : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+        : "a" (leaf), "c" (subleaf)
+        );
+}
+
+static inline uint32_t cpu_read_cr0() {
+    uint32_t value;
+    asm volatile("MOV %%cr0, %0\n\t" : "=r" (value));
+    return value;
+}
+
+static inline void cpu_write_cr0(uint32_t value) {
+    asm volatile("MOV %0, %%cr0\n\t" : : "r" (value) : "memory");
+}
+
+static inline uint32_t cpu_read_cr2() {
+    uint32_t value;
+    asm volatile("MOV %%cr2, %0\n\t" : "=r" (value));
+    return value;
+}
+
+static inline uint32_t cpu_read_cr3() {
+    uint32_t value;
+    asm volatile("MOV %%cr3, %0\n\t" : "=r" (value));
+    return value;
+}
+
+static inline void cpu_write_cr3(uint32_t value) {
+    asm volatile("MOV %0, %%cr3\n\t" : : "r" (value) : "memory");
+}
+
+static inline void cpu_invlpg(uint32_t address) {
+    asm volatile("INVLPG (%0)\n\t" : : "r" (address) : "memory");
+}
+
+static inline uint32_t cpu_read_cr4() {
+    uint32_t value;
+    asm volatile("MOV %%cr4, %0\n\t" : "=r" (value));
+    return value;
+}
+
+static inline void cpu_write_cr4(uint32_t value) {
+    asm volatile("MOV %0, %%cr4\n\t" : : "r" (value) : "memory");
+}
+
+static inline uint64_t cpu_rdmsr(uint32_t msr) {
+    uint32_t low, high;
+    asm volatile("RDMSR\n\t" : "=a" (low), "=d" (high) : "c" (msr));
+    return ((uint64_t) high << 32) | low;
+}
+
+static inline void cpu_wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile("WRMSR\n\t"
+        :
+        : "c" (msr), "a" ((uint32_t) value), "d" ((uint32_t) (value >> 32))
+        );
+}
+
+/**************************************************************************//**
+ * @brief Disables interrupts, returning the previous EFLAGS.
+ * 
+ * @return EFLAGS value to hand to cpu_irq_restore().
+ * 
+ ******************************************************************************/
+static inline uint32_t cpu_irq_save() {
+    uint32_t flags;
+    asm volatile("PUSHF\n\t"
+        "POP %0\n\t"
+        "CLI\n\t"
+        : "=r" (flags)
+        :
+        : "memory"
+        );
+    return flags;
+}
+
+/**************************************************************************//**
+ * @brief Re-enables interrupts if they were enabled at cpu_irq_save().
+ * 
+ ******************************************************************************/
+static inline void cpu_irq_restore(uint32_t flags) {
+    if (flags & CPU_EFLAGS_IF)
+        asm volatile("STI\n\t" : : : "memory");
+}
+
+/**************************************************************************//**
+ * @brief Enables interrupts.
+ * 
+ ******************************************************************************/
+static inline void cpu_irq_enable() {
+    asm volatile("STI\n\t" : : : "memory");
+}
+
+/**************************************************************************//**
+ * @brief Disables interrupts.
+ * 
+ ******************************************************************************/
+static inline void cpu_irq_disable() {
+    asm volatile("CLI\n\t" : : : "memory");
+}
+
+/**************************************************************************//**
+ * @brief Enables interrupts and halts until the next one.
+ * 
+ * STI only takes effect after the following instruction, so an interrupt
+ * that became pending while disabled still ends the HLT.
+ * 
+ ******************************************************************************/
+static inline void cpu_halt() {
+    asm volatile("STI\n\t"
+        "HLT\n\t"
+        : : : "memory");
+}
+
+/**************************************************************************//**
+ * @brief Arms address monitoring for cpu_mwait().
+ * 
+ * @param address Any byte in the cache line to watch.
+ * 
+ ******************************************************************************/
+static inline void cpu_monitor(const volatile void* address) {
+    asm volatile("MONITOR\n\t" : : "a" (address), "c" (0), "d" (0) : "memory");
+}
+
+/**************************************************************************//**
+ * @brief Enables interrupts and waits for a write to the monitored line.
+ * 
+ * An interrupt also ends the wait, the STI shadow covers the MWAIT as it
+ * does for cpu_halt().
+ * 
+ * @param hint Target C-state, bits 7:4 state and 3:0 sub-state.
+ * 
+ ******************************************************************************/
+static inline void cpu_mwait(uint32_t hint) {
+    asm volatile("STI\n\t"
+        "MWAIT\n\t"
+        : : "a" (hint), "c" (0) : "memory");
+}
+
+/**************************************************************************//**
+ * @brief Spin-loop hint.
+ * 
+ ******************************************************************************/
+static inline void cpu_pause() {
+    asm volatile("PAUSE\n\t" : : : "memory");
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the index of the running CPU, for per-CPU data.
+ * 
+ * @return 0 to CPU_MAX - 1.
+ * 
+ ******************************************************************************/
+static inline uint32_t cpu_id() {
+    return 0;
+}
+
+#endif // _KERNEL_CPU_H_
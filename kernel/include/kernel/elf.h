@@ -0,0 +1,55 @@
+#ifndef _KERNEL_ELF_H_
+#define _KERNEL_ELF_H_
+
+#include <stdint.h>
+
+#include <kernel/vm.h>
+
+#define ELF_IDENT_SIZE 16
+
+// e_ident
+#define ELF_MAGIC 0x464C457F // "\x7FELF", little endian
+#define ELF_CLASS_32 1
+#define ELF_DATA_LSB 1
+
+// e_type, e_machine
+#define ELF_TYPE_EXEC 2
+#define ELF_MACHINE_386 3
+
+// p_type, p_flags
+#define ELF_PT_LOAD 1
+#define ELF_PF_X 0x1
+#define ELF_PF_W 0x2
+#define ELF_PF_R 0x4
+
+typedef struct Elf32Header {
+    uint8_t e_ident[ELF_IDENT_SIZE];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint32_t e_entry;
+    uint32_t e_phoff;
+    uint32_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+} __attribute__((packed)) Elf32_Ehdr;
+
+typedef struct Elf32ProgramHeader {
+    uint32_t p_type;
+    uint32_t p_offset;
+    uint32_t p_vaddr;
+    uint32_t p_paddr;
+    uint32_t p_filesz;
+    uint32_t p_memsz;
+    uint32_t p_flags;
+    uint32_t p_align;
+} __attribute__((packed)) Elf32_Phdr;
+
+int elf_load(AddressSpace* space, const uint8_t* image, uint32_t size, uint32_t* entry);
+
+#endif // _KERNEL_ELF_H_
@@ -0,0 +1,20 @@
+#ifndef _KERNEL_FBCON_H_
+#define _KERNEL_FBCON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <kernel/multiboot.h>
+
+bool fbcon_init(const multiboot_info_t* mbi);
+bool fbcon_active();
+size_t fbcon_columns();
+size_t fbcon_rows();
+void fbcon_clear(uint8_t color);
+void fbcon_putcell(unsigned char c, uint8_t color, size_t x, size_t y);
+void fbcon_scroll(uint8_t color);
+void fbcon_flush();
+void fbcon_report();
+
+#endif // _KERNEL_FBCON_H_
@@ -0,0 +1,18 @@
+#ifndef _KERNEL_FPU_H_
+#define _KERNEL_FPU_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct Thread;
+
+void fpu_init();
+bool fpu_has_sse();
+void fpu_switch(struct Thread* prev, struct Thread* next);
+void fpu_thread_exit(struct Thread* thread);
+void fpu_report();
+
+void kernel_fpu_begin();
+void kernel_fpu_end();
+
+#endif // _KERNEL_FPU_H_
@@ -0,0 +1,22 @@
+#ifndef _KERNEL_FRAME_H_
+#define _KERNEL_FRAME_H_
+
+#include <stdint.h>
+
+#include <kernel/multiboot.h>
+
+#define FRAME_SIZE 4096
+#define FRAME_MAX_MEMORY 0x40000000 // RAM above this is ignored, see paging.h
+
+void frame_init(const multiboot_info_t* mbi);
+void frame_free_init();
+uint32_t frame_alloc();
+uint32_t frame_alloc_zeroed();
+void frame_ref(uint32_t frame);
+void frame_unref(uint32_t frame);
+void frame_pin(uint32_t start, uint32_t end);
+uint16_t frame_refcount(uint32_t frame);
+uint32_t frame_free_count();
+uint32_t frame_total_count();
+
+#endif // _KERNEL_FRAME_H_
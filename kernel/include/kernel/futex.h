@@ -0,0 +1,15 @@
+#ifndef _KERNEL_FUTEX_H_
+#define _KERNEL_FUTEX_H_
+
+#include <stdint.h>
+
+#include <kernel/vm.h>
+
+#define FUTEX_HASH_BITS 6
+#define FUTEX_BUCKETS (1 << FUTEX_HASH_BITS)
+
+int32_t futex_wait(AddressSpace* space, uint32_t address, uint32_t expected);
+int32_t futex_wake(AddressSpace* space, uint32_t address, uint32_t count);
+int32_t futex_store_wake(AddressSpace* space, uint32_t address, uint32_t value, uint32_t count);
+
+#endif // _KERNEL_FUTEX_H_
@@ -1,12 +1,20 @@
 #ifndef _KERNEL_GDT_H_
 #define _KERNEL_GDT_H_
 
+#include <stdint.h>
+
 #define GDT_SEGMENT_KERN_CODE 0x08
 #define GDT_SEGMENT_KERN_DATA 0x10
 #define GDT_SEGMENT_USER_CODE 0x18
 #define GDT_SEGMENT_USER_DATA 0x20
+#define GDT_SEGMENT_TSS 0x28
+
+// Requested Privilege Level, OR'd into selectors loaded from ring 3
+#define GDT_RPL_USER 0x03
 
 void gdt_add_descriptor(uint8_t entry, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags);
 void gdt_init();
+void gdt_set_kernel_stack(uint32_t esp0);
+uint32_t gdt_tss_address();
 
-#endif // _KERNEL_GDT_H_
\ No newline at end of file
+#endif // _KERNEL_GDT_H_
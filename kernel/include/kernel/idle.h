@@ -0,0 +1,21 @@
+#ifndef _KERNEL_IDLE_H_
+#define _KERNEL_IDLE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Idle states, from shallowest to deepest
+#define IDLE_POLL 0
+#define IDLE_MWAIT_C1 1
+#define IDLE_HLT 2
+#define IDLE_MWAIT_C2 3
+
+#define IDLE_STATE_COUNT 4
+
+void idle_init();
+void idle_enter();
+void idle_kick();
+__attribute__((__noreturn__)) void idle_loop();
+void idle_report();
+
+#endif // _KERNEL_IDLE_H_
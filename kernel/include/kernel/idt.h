@@ -0,0 +1,54 @@
+#ifndef _KERNEL_IDT_H_
+#define _KERNEL_IDT_H_
+
+#include <stdint.h>
+
+#define IDT_MAX_ENTRIES 256
+
+// CPU exception vectors
+#define IDT_VECTOR_DIVIDE_ERROR 0x00
+#define IDT_VECTOR_DEBUG 0x01
+#define IDT_VECTOR_NMI 0x02
+#define IDT_VECTOR_BREAKPOINT 0x03
+#define IDT_VECTOR_INVALID_OPCODE 0x06
+#define IDT_VECTOR_DEVICE_NOT_AVAILABLE 0x07
+#define IDT_VECTOR_DOUBLE_FAULT 0x08
+#define IDT_VECTOR_GENERAL_PROTECTION 0x0D
+#define IDT_VECTOR_PAGE_FAULT 0x0E
+#define IDT_VECTOR_FPU_ERROR 0x10
+#define IDT_VECTOR_SIMD_ERROR 0x13
+
+// Hardware interrupts, remapped there by pic_init()
+#define IDT_VECTOR_IRQ_BASE 0x20
+#define IDT_IRQ_COUNT 16
+
+// Message signaled interrupts, handed out by pci_enable_msi()
+#define IDT_VECTOR_MSI_BASE 0x30
+#define IDT_MSI_COUNT 31
+
+// Local APIC spurious interrupt, low nibble all ones as older CPUs require
+#define IDT_VECTOR_SPURIOUS 0x4F
+
+// Software interrupt for system calls, callable from ring 3
+#define IDT_VECTOR_SYSCALL 0x80
+
+/*
+ * Register state pushed by the interrupt stubs in isr.S, lowest address first.
+ * user_esp and user_ss are only valid when the interrupt came from ring 3.
+ */
+typedef struct InterruptFrame {
+    uint32_t gs, fs, es, ds;
+    uint32_t edi, esi, ebp, esp_dummy, ebx, edx, ecx, eax; // PUSHA order
+    uint32_t vector;
+    uint32_t error_code;
+    uint32_t eip, cs, eflags; // pushed by the CPU
+    uint32_t user_esp, user_ss;
+} InterruptFrame;
+
+typedef void (*idt_handler_t)(InterruptFrame* frame);
+
+void idt_init();
+void idt_register_handler(uint8_t vector, idt_handler_t handler);
+void idt_register_irq_handler(uint8_t irq, idt_handler_t handler);
+
+#endif // _KERNEL_IDT_H_
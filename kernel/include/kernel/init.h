@@ -0,0 +1,13 @@
+#ifndef _KERNEL_INIT_H_
+#define _KERNEL_INIT_H_
+
+/*
+ * Code and data only used while booting. linker.ld gathers it between
+ * __init_start and __init_end, and frame_free_init() hands those frames to
+ * the allocator once kernel_main() is done with it. Nothing may call into
+ * __init code, or keep pointers to __initdata, after that.
+ */
+#define __init __attribute__((section(".init.text")))
+#define __initdata __attribute__((section(".init.data")))
+
+#endif // _KERNEL_INIT_H_
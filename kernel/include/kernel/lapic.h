@@ -0,0 +1,32 @@
+#ifndef _KERNEL_LAPIC_H_
+#define _KERNEL_LAPIC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LAPIC_MSR_BASE 0x1B
+#define LAPIC_BASE_ENABLE (0x01 << 11)
+#define LAPIC_BASE_MASK 0xFFFFF000
+
+// Register offsets
+#define LAPIC_REG_ID 0x020
+#define LAPIC_REG_TPR 0x080
+#define LAPIC_REG_EOI 0x0B0
+#define LAPIC_REG_SVR 0x0F0
+#define LAPIC_REG_LVT_LINT0 0x350
+#define LAPIC_REG_LVT_LINT1 0x360
+
+#define LAPIC_SVR_ENABLE (0x01 << 8)
+#define LAPIC_LVT_EXTINT (0x07 << 8)
+#define LAPIC_LVT_NMI (0x04 << 8)
+
+// MSI address/data, see pci_enable_msi()
+#define LAPIC_MSI_ADDRESS 0xFEE00000
+#define LAPIC_MSI_DEST_SHIFT 12
+
+void lapic_init();
+bool lapic_enabled();
+uint32_t lapic_id();
+void lapic_eoi();
+
+#endif // _KERNEL_LAPIC_H_
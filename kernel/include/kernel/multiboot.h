@@ -0,0 +1,84 @@
+#ifndef _KERNEL_MULTIBOOT_H_
+#define _KERNEL_MULTIBOOT_H_
+
+#include <stdint.h>
+
+// Value of EAX when a Multiboot compliant bootloader hands over control
+#define MULTIBOOT_BOOTLOADER_MAGIC 0x2BADB002
+
+// multiboot_info_t flags, each marks the matching fields as valid
+#define MULTIBOOT_INFO_MEMORY (0x01 << 0)
+#define MULTIBOOT_INFO_BOOTDEV (0x01 << 1)
+#define MULTIBOOT_INFO_CMDLINE (0x01 << 2)
+#define MULTIBOOT_INFO_MODS (0x01 << 3)
+#define MULTIBOOT_INFO_MEM_MAP (0x01 << 6)
+#define MULTIBOOT_INFO_BOOT_LOADER_NAME (0x01 << 9)
+#define MULTIBOOT_INFO_VBE_INFO (0x01 << 11)
+#define MULTIBOOT_INFO_FRAMEBUFFER_INFO (0x01 << 12)
+
+#define MULTIBOOT_FRAMEBUFFER_TYPE_INDEXED 0
+#define MULTIBOOT_FRAMEBUFFER_TYPE_RGB 1
+#define MULTIBOOT_FRAMEBUFFER_TYPE_EGA_TEXT 2
+
+#define MULTIBOOT_MEMORY_AVAILABLE 1
+
+typedef struct MultibootInfo {
+    uint32_t flags;
+
+    uint32_t mem_lower;
+    uint32_t mem_upper;
+
+    uint32_t boot_device;
+    uint32_t cmdline;
+
+    uint32_t mods_count;
+    uint32_t mods_addr;
+
+    uint32_t syms[4];
+
+    uint32_t mmap_length;
+    uint32_t mmap_addr;
+
+    uint32_t drives_length;
+    uint32_t drives_addr;
+
+    uint32_t config_table;
+    uint32_t boot_loader_name;
+    uint32_t apm_table;
+
+    uint32_t vbe_control_info;
+    uint32_t vbe_mode_info;
+    uint16_t vbe_mode;
+    uint16_t vbe_interface_seg;
+    uint16_t vbe_interface_off;
+    uint16_t vbe_interface_len;
+
+    uint64_t framebuffer_addr;
+    uint32_t framebuffer_pitch;
+    uint32_t framebuffer_width;
+    uint32_t framebuffer_height;
+    uint8_t framebuffer_bpp;
+    uint8_t framebuffer_type;
+    uint8_t framebuffer_red_field_position;
+    uint8_t framebuffer_red_mask_size;
+    uint8_t framebuffer_green_field_position;
+    uint8_t framebuffer_green_mask_size;
+    uint8_t framebuffer_blue_field_position;
+    uint8_t framebuffer_blue_mask_size;
+} __attribute__((packed)) multiboot_info_t;
+
+typedef struct MultibootMmapEntry {
+    uint32_t size; // Size of the entry, not counting this field
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+typedef struct MultibootModule {
+    uint32_t mod_start;
+    uint32_t mod_end;
+    uint32_t cmdline;
+    uint32_t pad;
+} __attribute__((packed)) multiboot_module_t;
+
+#endif // _KERNEL_MULTIBOOT_H_
@@ -0,0 +1,43 @@
+#ifndef _KERNEL_PAGING_H_
+#define _KERNEL_PAGING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PAGE_SIZE 4096
+#define PAGE_MASK (~(PAGE_SIZE - 1))
+
+// Page directory and page table entry flags
+#define PAGE_PRESENT 0x001
+#define PAGE_WRITE 0x002
+#define PAGE_USER 0x004
+#define PAGE_WRITE_THROUGH 0x008
+#define PAGE_CACHE_DISABLE 0x010
+#define PAGE_ACCESSED 0x020
+#define PAGE_DIRTY 0x040
+#define PAGE_LARGE 0x080 // 4 MiB page, page directory entries only
+#define PAGE_GLOBAL 0x100
+#define PAGE_COW 0x200   // available to software: read-only copy of a writable page
+
+/*
+ * Virtual memory layout, shared by every address space:
+ *
+ * 0x00000000 - 0x3FFFFFFF  kernel, identity mapped RAM, supervisor only
+ * 0x40000000 - 0xBFFFFFFF  user space, private to each address space
+ * 0xC0000000 - 0xFFFFFFFF  identity mapped MMIO (framebuffer, PCI BARs), uncached
+ */
+#define KERNEL_SPACE_END 0x40000000
+#define USER_SPACE_START 0x40000000
+#define USER_SPACE_END 0xC0000000
+#define MMIO_SPACE_START 0xC0000000
+
+void paging_init();
+uint32_t paging_kernel_directory();
+uint32_t paging_create_directory();
+void paging_destroy_directory(uint32_t directory);
+bool paging_clone_directory(uint32_t parent, uint32_t child);
+uint32_t* paging_get_entry(uint32_t directory, uint32_t address, bool create);
+void paging_activate(uint32_t directory);
+void paging_invalidate(uint32_t address);
+
+#endif // _KERNEL_PAGING_H_
@@ -0,0 +1,159 @@
+#ifndef _KERNEL_PCI_H_
+#define _KERNEL_PCI_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <kernel/idt.h>
+
+#define PCI_DEVICE_MAX 64
+#define PCI_DRIVER_MAX 16
+#define PCI_BAR_COUNT 6
+#define PCI_ANY_ID 0xFFFF
+
+// Configuration mechanism #1 ports
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA 0xCFC
+#define PCI_CONFIG_ENABLE (0x01 << 31)
+
+// Configuration space header offsets
+#define PCI_VENDOR_ID 0x00
+#define PCI_DEVICE_ID 0x02
+#define PCI_COMMAND 0x04
+#define PCI_STATUS 0x06
+#define PCI_CLASS_REVISION 0x08 // revision, prog IF, subclass, class from low to high
+#define PCI_HEADER_TYPE 0x0E
+#define PCI_BAR0 0x10
+#define PCI_SECONDARY_BUS 0x19 // PCI-to-PCI bridges only
+#define PCI_CAPABILITY_LIST 0x34
+#define PCI_INTERRUPT_LINE 0x3C
+#define PCI_INTERRUPT_PIN 0x3D
+
+#define PCI_COMMAND_IO (0x01 << 0)
+#define PCI_COMMAND_MEMORY (0x01 << 1)
+#define PCI_COMMAND_MASTER (0x01 << 2)
+#define PCI_COMMAND_INTX_DISABLE (0x01 << 10)
+
+#define PCI_STATUS_CAPABILITIES (0x01 << 4)
+
+#define PCI_HEADER_TYPE_MASK 0x7F
+#define PCI_HEADER_TYPE_DEVICE 0x00
+#define PCI_HEADER_TYPE_BRIDGE 0x01
+#define PCI_HEADER_MULTIFUNCTION 0x80
+
+#define PCI_CLASS_BRIDGE 0x06
+#define PCI_SUBCLASS_BRIDGE_PCI 0x04
+
+// Capability IDs
+#define PCI_CAP_MSI 0x05
+#define PCI_CAP_VENDOR 0x09
+#define PCI_CAP_MSIX 0x11
+
+// MSI capability layout, offsets from the capability
+#define PCI_MSI_CONTROL 0x02
+#define PCI_MSI_ADDRESS 0x04
+#define PCI_MSI_DATA_32 0x08
+#define PCI_MSI_MASK_32 0x0C
+#define PCI_MSI_ADDRESS_HIGH 0x08
+#define PCI_MSI_DATA_64 0x0C
+#define PCI_MSI_MASK_64 0x10
+
+#define PCI_MSI_CONTROL_ENABLE (0x01 << 0)
+#define PCI_MSI_CONTROL_MME_MASK (0x07 << 4) // vectors enabled, log2
+#define PCI_MSI_CONTROL_64BIT (0x01 << 7)
+#define PCI_MSI_CONTROL_MASKABLE (0x01 << 8)
+
+// MSI-X capability layout, offsets from the capability
+#define PCI_MSIX_CONTROL 0x02
+#define PCI_MSIX_TABLE 0x04 // BAR index in bits 2:0, offset above
+
+#define PCI_MSIX_CONTROL_SIZE_MASK 0x07FF // table entries - 1
+#define PCI_MSIX_CONTROL_MASK_ALL (0x01 << 14)
+#define PCI_MSIX_CONTROL_ENABLE (0x01 << 15)
+
+// MSI-X table entry, 16 bytes each
+#define PCI_MSIX_ENTRY_SIZE 16
+#define PCI_MSIX_ENTRY_ADDRESS 0x00
+#define PCI_MSIX_ENTRY_ADDRESS_HIGH 0x04
+#define PCI_MSIX_ENTRY_DATA 0x08
+#define PCI_MSIX_ENTRY_CONTROL 0x0C
+#define PCI_MSIX_ENTRY_MASKED 0x01
+
+// PciBar flags
+#define PCI_BAR_IO 0x01
+#define PCI_BAR_64 0x02
+#define PCI_BAR_PREFETCH 0x04
+
+typedef struct PciBar {
+    uint32_t base; // port number for I/O BARs, physical address otherwise
+    uint32_t size; // 0 if unimplemented
+    uint32_t flags;
+} PciBar;
+
+/*
+ * Cached copy of a function's configuration header, filled in once by
+ * pci_init(). Live registers are read with pci_read*().
+ */
+typedef struct PciDevice {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t function;
+    uint8_t header_type;
+    uint16_t vendor;
+    uint16_t device;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+    uint8_t revision;
+    uint8_t irq_line; // legacy 8259 line, 0xFF if none
+    uint8_t irq_pin;  // INTA# to INTD#, 0 if none
+    uint8_t msi_cap;  // offset of the MSI capability, 0 if none
+    uint8_t msix_cap; // offset of the MSI-X capability, 0 if none
+    uint8_t msi_vector; // 0 while neither MSI nor MSI-X is enabled
+    bool msix;          // msi_vector was set up through MSI-X
+    PciBar bars[PCI_BAR_COUNT];
+    const struct PciDriver* driver; // NULL while unbound
+    void* driver_data;
+} PciDevice;
+
+/*
+ * Device match for drivers. vendor and device may be PCI_ANY_ID. class_code
+ * holds class, subclass and prog IF as 0xCCSSPP and is compared under
+ * class_mask, so a zero mask matches any class.
+ */
+typedef struct PciId {
+    uint16_t vendor;
+    uint16_t device;
+    uint32_t class_code;
+    uint32_t class_mask;
+} PciId;
+
+#define PCI_ID_DEVICE(vendor, device) { (vendor), (device), 0, 0 }
+#define PCI_ID_CLASS(class_code, class_mask) { PCI_ANY_ID, PCI_ANY_ID, (class_code), (class_mask) }
+
+typedef struct PciDriver {
+    const char* name;
+    const PciId* ids; // ends with an all zero entry
+    int (*probe)(PciDevice* device); // 0 to bind, negated errno value otherwise
+} PciDriver;
+
+void pci_init();
+uint32_t pci_read32(const PciDevice* device, uint8_t offset);
+uint16_t pci_read16(const PciDevice* device, uint8_t offset);
+uint8_t pci_read8(const PciDevice* device, uint8_t offset);
+void pci_write32(const PciDevice* device, uint8_t offset, uint32_t value);
+void pci_write16(const PciDevice* device, uint8_t offset, uint16_t value);
+void pci_write8(const PciDevice* device, uint8_t offset, uint8_t value);
+PciDevice* pci_find_device(uint16_t vendor, uint16_t device, PciDevice* from);
+PciDevice* pci_find_class(uint8_t class_code, uint8_t subclass, PciDevice* from);
+uint8_t pci_find_capability(const PciDevice* device, uint8_t id, uint8_t from);
+void pci_enable(PciDevice* device);
+void* pci_map_bar(PciDevice* device, uint32_t bar);
+int pci_enable_msi(PciDevice* device, idt_handler_t handler);
+int pci_enable_msix(PciDevice* device, uint32_t entry, idt_handler_t handler);
+void pci_disable_msi(PciDevice* device);
+int pci_register_driver(const PciDriver* driver);
+const char* pci_class_name(uint8_t class_code);
+void pci_report();
+
+#endif // _KERNEL_PCI_H_
@@ -12,8 +12,10 @@
 
 void outb(uint8_t value, unsigned short int port);
 void outw(uint16_t value, unsigned short int port);
+void outl(uint32_t value, unsigned short int port);
 
 uint8_t inb(unsigned short int port);
 uint16_t inw(unsigned short int port);
+uint32_t inl(unsigned short int port);
 
 #endif // _KERNEL_IO_H_
@@ -0,0 +1,67 @@
+#ifndef _KERNEL_PIPE_H_
+#define _KERNEL_PIPE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <kernel/frame.h>
+#include <kernel/syscall.h>
+#include <kernel/vm.h>
+
+#define PIPE_MAX 16
+#define PIPE_BUFFER_PAGES 16 // bytes written and not read yet, 64 KiB
+#define PIPE_BUFFER_SIZE (PIPE_BUFFER_PAGES * FRAME_SIZE)
+#define PIPE_GRANT_MAX 8     // page grants queued and not accepted yet
+#define PIPE_GRANT_PAGES_MAX (FRAME_SIZE / sizeof(uint32_t)) // 4 MiB, one frame of frame addresses
+#define PIPE_RING_SIZE SYSCALL_PIPE_RING_SIZE
+
+struct PipeWaiter;
+struct TmpfsInode;
+
+/*
+ * Pages given away by pipe_grant(), waiting for pipe_accept(). The grant
+ * holds a reference to each frame, 0 stands for a page that was never
+ * touched and is demand-zero on the other side.
+ */
+typedef struct PipeGrant {
+    uint32_t* frames; // a frame of its own
+    uint32_t pages;
+} PipeGrant;
+
+/*
+ * A one-way channel between a read end and a write end, each a descriptor
+ * that may be inherited by any number of processes. It offers three ways to
+ * move data:
+ *
+ * - read() and write() copy bytes through a kernel buffer, like any pipe.
+ * - pipe_grant() moves whole pages out of the writer's address space and
+ *   pipe_accept() maps the same frames into the reader's, so a buffer of
+ *   any size crosses without a copy.
+ * - Either end can be mapped, giving both sides the same PIPE_RING_SIZE of
+ *   shared memory for a ring that needs no system call per message.
+ */
+typedef struct Pipe {
+    uint32_t buffer[PIPE_BUFFER_PAGES]; // frames, allocated with the pipe
+    uint32_t head;                      // offset of the first unread byte
+    uint32_t count;                     // unread bytes
+    PipeGrant grants[PIPE_GRANT_MAX];   // queue starting at first_grant
+    uint32_t first_grant;
+    uint32_t grant_count;
+    struct TmpfsInode* ring;            // shared memory, created on first map
+    uint32_t readers;                   // open read ends
+    uint32_t writers;                   // open write ends
+    struct PipeWaiter* read_waiters;    // sleeping until there is data
+    struct PipeWaiter* write_waiters;   // sleeping until there is room
+    bool in_use;
+} Pipe;
+
+Pipe* pipe_create();
+void pipe_get(Pipe* pipe, bool writer);
+void pipe_put(Pipe* pipe, bool writer);
+int32_t pipe_read(Pipe* pipe, uint8_t* buffer, uint32_t count);
+int32_t pipe_write(Pipe* pipe, const uint8_t* buffer, uint32_t count);
+int32_t pipe_grant(Pipe* pipe, AddressSpace* space, uint32_t address, uint32_t size);
+int32_t pipe_accept(Pipe* pipe, AddressSpace* space, uint32_t limit, uint32_t* size);
+struct TmpfsInode* pipe_ring(Pipe* pipe);
+
+#endif // _KERNEL_PIPE_H_
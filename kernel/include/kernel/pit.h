@@ -0,0 +1,34 @@
+#ifndef _KERNEL_PIT_H_
+#define _KERNEL_PIT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PIT_FREQUENCY_HZ 1193182
+#define PIT_IRQ 0
+
+// I/O ports
+#define PIT_CHANNEL0_DATA 0x40
+#define PIT_CHANNEL2_DATA 0x42
+#define PIT_CMD 0x43
+
+// Mode/command bytes, lobyte/hibyte access, binary counting
+#define PIT_CMD_CHANNEL0_ONESHOT 0x30  // mode 0, interrupt on terminal count
+#define PIT_CMD_CHANNEL0_PERIODIC 0x34 // mode 2, rate generator
+#define PIT_CMD_CHANNEL2_ONESHOT 0xB0
+
+// Port 0x61 bits: channel 2 gate, speaker enable and channel 2 output state
+#define PIT_GATE_PORT 0x61
+#define PIT_GATE_CHANNEL2 0x01
+#define PIT_GATE_SPEAKER 0x02
+#define PIT_GATE_CHANNEL2_OUT 0x20
+
+typedef void (*pit_handler_t)();
+
+void pit_init(pit_handler_t handler);
+void pit_set_periodic(uint32_t hz);
+uint32_t pit_set_oneshot(uint32_t us);
+bool pit_is_periodic();
+uint32_t pit_reprogram_count();
+
+#endif // _KERNEL_PIT_H_
@@ -0,0 +1,64 @@
+#ifndef _KERNEL_PROCESS_H_
+#define _KERNEL_PROCESS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <kernel/idt.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/vdso.h>
+#include <kernel/vm.h>
+
+#define PROCESS_MAX 16
+#define PROCESS_NAME_MAX 32
+#define PROCESS_FILE_MAX 16 // descriptors, 0 to 2 are the console
+#define PROCESS_STACK_TOP USER_SPACE_END
+#define PROCESS_STACK_SIZE 0x100000 // demand-zero, only touched pages cost memory
+#define PROCESS_MMAP_TOP VDSO_DATA_ADDRESS // below the shared data page and the stack's guard page
+
+struct Pipe;
+struct TmpfsInode;
+
+/*
+ * An open descriptor refers to either a file or directory, or to one end of
+ * a pipe: the read end is SYSCALL_O_RDONLY, the write end SYSCALL_O_WRONLY.
+ */
+typedef struct ProcessFile {
+    struct TmpfsInode* inode; // holds a reference, NULL for a pipe end
+    struct Pipe* pipe;        // holds an end, NULL for a file
+    uint32_t offset;
+    uint32_t flags;           // SYSCALL_O_* access mode and SYSCALL_O_APPEND
+} ProcessFile;
+
+typedef struct Process {
+    uint32_t id;
+    char name[PROCESS_NAME_MAX];
+    AddressSpace* space;
+    uint32_t entry;            // ELF entry point
+    uint32_t heap_start;       // page after the ELF image
+    uint32_t brk;              // end of the heap, see process_brk()
+    uint32_t threads;          // live threads, the process ends with the last one
+    bool exiting;              // process_exit() was called, the other threads are killed
+    int32_t exit_status;       // from the first process_exit(), 0 if there was none
+    InterruptFrame fork_frame; // user state a process_fork() child starts from
+    ProcessFile files[PROCESS_FILE_MAX];
+    bool in_use;
+} Process;
+
+Process* process_spawn(const char* name, const uint8_t* image, uint32_t size);
+void process_spawn_modules(const multiboot_info_t* mbi);
+int32_t process_fork(const InterruptFrame* frame);
+int32_t process_thread_create(uint32_t entry, uint32_t stack, uint32_t exit_word);
+int32_t process_brk(uint32_t address);
+int32_t process_file_open(struct TmpfsInode* inode, uint32_t flags);
+int32_t process_pipe_open(struct Pipe* pipe, bool writer);
+ProcessFile* process_file(uint32_t fd);
+int process_file_close(uint32_t fd);
+Process* process_current();
+void process_wait_all();
+__attribute__((__noreturn__)) void process_exit(int32_t status);
+__attribute__((__noreturn__)) void process_thread_exit();
+__attribute__((__noreturn__)) void process_fault(const InterruptFrame* frame, const char* description);
+
+#endif // _KERNEL_PROCESS_H_
@@ -0,0 +1,9 @@
+#ifndef _KERNEL_PROFILE_H_
+#define _KERNEL_PROFILE_H_
+
+#define PROFILE_PORT 0xE9 // QEMU/Bochs debug console, see layout.sh
+
+void profile_start();
+void profile_report();
+
+#endif // _KERNEL_PROFILE_H_
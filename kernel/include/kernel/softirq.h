@@ -0,0 +1,44 @@
+#ifndef _KERNEL_SOFTIRQ_H_
+#define _KERNEL_SOFTIRQ_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Softirq classes, run in this order
+#define SOFTIRQ_HI_TASKLET 0
+#define SOFTIRQ_TIMER 1
+#define SOFTIRQ_BLOCK 2
+#define SOFTIRQ_TASKLET 3
+
+#define SOFTIRQ_COUNT 4
+
+// Tasklet state bits
+#define TASKLET_SCHEDULED 0x01
+#define TASKLET_RUNNING 0x02
+
+typedef void (*softirq_handler_t)();
+typedef void (*tasklet_func_t)(void* data);
+
+/*
+ * Deferred function for interrupt handlers, embedded in its owner. A
+ * tasklet is queued at most once and never runs concurrently with itself.
+ */
+typedef struct Tasklet {
+    struct Tasklet* next;
+    tasklet_func_t func;
+    void* data;
+    volatile uint32_t state;
+} Tasklet;
+
+void softirq_init();
+void softirq_register(uint32_t nr, softirq_handler_t handler);
+void softirq_raise(uint32_t nr);
+void softirq_irq_enter();
+void softirq_irq_exit();
+void softirq_report();
+
+void tasklet_init(Tasklet* tasklet, tasklet_func_t func, void* data);
+void tasklet_schedule(Tasklet* tasklet);
+void tasklet_hi_schedule(Tasklet* tasklet);
+
+#endif // _KERNEL_SOFTIRQ_H_
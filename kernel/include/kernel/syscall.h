@@ -0,0 +1,100 @@
+#ifndef _KERNEL_SYSCALL_H_
+#define _KERNEL_SYSCALL_H_
+
+#include <stdint.h>
+
+/*
+ * System call numbers, shared with user space.
+ *
+ * Calling convention for both entry paths: number in EAX, arguments in EBX,
+ * ESI, EDI and EBP, result (or a negated errno value) in EAX. Results from
+ * -SYSCALL_ERRNO_MAX to -1 are errors, addresses above 2 GiB are not. INT 0x80
+ * preserves all other registers. SYSENTER expects the return address in EDX
+ * and the user stack pointer in ECX, both are clobbered.
+ */
+#define SYSCALL_EXIT 0
+#define SYSCALL_NULL 1
+#define SYSCALL_FORK 2
+#define SYSCALL_GETPID 3
+#define SYSCALL_WRITE 4
+#define SYSCALL_BRK 5
+#define SYSCALL_MMAP 6
+#define SYSCALL_MUNMAP 7
+#define SYSCALL_MADVISE 8
+#define SYSCALL_CLOCK_GETTIME 9
+#define SYSCALL_FUTEX_WAIT 10
+#define SYSCALL_FUTEX_WAKE 11
+#define SYSCALL_THREAD_CREATE 12
+#define SYSCALL_YIELD 13
+#define SYSCALL_OPEN 14
+#define SYSCALL_CLOSE 15
+#define SYSCALL_READ 16
+#define SYSCALL_LSEEK 17
+#define SYSCALL_FTRUNCATE 18
+#define SYSCALL_MKDIR 19
+#define SYSCALL_UNLINK 20
+#define SYSCALL_RMDIR 21
+#define SYSCALL_STAT 22
+#define SYSCALL_PIPE 23
+#define SYSCALL_PIPE_GRANT 24
+#define SYSCALL_PIPE_ACCEPT 25
+#define SYSCALL_THREAD_EXIT 26
+
+#define SYSCALL_MAX 27
+
+#define SYSCALL_ERRNO_MAX 4095
+
+// File descriptors every process starts with, all on the console
+#define SYSCALL_FD_STDIN 0
+#define SYSCALL_FD_STDOUT 1
+#define SYSCALL_FD_STDERR 2
+
+// SYSCALL_MMAP protection flags, SYSCALL_MAP_SHARED may be or'd in for files and pipes
+#define SYSCALL_PROT_READ 0x01
+#define SYSCALL_PROT_WRITE 0x02
+#define SYSCALL_PROT_EXEC 0x04
+#define SYSCALL_MAP_SHARED 0x100
+
+// SYSCALL_OPEN flags
+#define SYSCALL_O_RDONLY 0x0000
+#define SYSCALL_O_WRONLY 0x0001
+#define SYSCALL_O_RDWR 0x0002
+#define SYSCALL_O_ACCMODE 0x0003
+#define SYSCALL_O_CREAT 0x0040
+#define SYSCALL_O_EXCL 0x0080
+#define SYSCALL_O_TRUNC 0x0200
+#define SYSCALL_O_APPEND 0x0400
+
+// SYSCALL_LSEEK origins
+#define SYSCALL_SEEK_SET 0
+#define SYSCALL_SEEK_CUR 1
+#define SYSCALL_SEEK_END 2
+
+// SYSCALL_STAT result
+#define SYSCALL_STAT_FILE 1
+#define SYSCALL_STAT_DIR 2
+
+typedef struct SyscallStat {
+    uint32_t id;
+    uint32_t type;  // SYSCALL_STAT_*
+    uint32_t links;
+    uint32_t size;
+    uint32_t pages; // page cache pages, holes have none
+} SyscallStat;
+
+// Bytes of shared memory a pipe descriptor maps, see SYSCALL_MMAP
+#define SYSCALL_PIPE_RING_SIZE 0x10000
+
+// SYSCALL_MADVISE advice
+#define SYSCALL_MADV_DONTNEED 4
+
+// SYSCALL_CLOCK_GETTIME clocks, both count from boot
+#define SYSCALL_CLOCK_REALTIME 0
+#define SYSCALL_CLOCK_MONOTONIC 1
+
+#ifdef __is_kernel
+void syscall_init();
+void syscall_benchmark();
+#endif
+
+#endif // _KERNEL_SYSCALL_H_
@@ -0,0 +1,47 @@
+#ifndef _KERNEL_THREAD_H_
+#define _KERNEL_THREAD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define THREAD_MAX 16
+#define THREAD_STACK_SIZE 8192
+#define THREAD_FPU_STATE_SIZE 512 // FXSAVE image, FNSAVE uses the first 108 bytes
+
+typedef enum ThreadState {
+    THREAD_UNUSED = 0,
+    THREAD_RUNNABLE,
+    THREAD_RUNNING,
+    THREAD_BLOCKED,
+    THREAD_DEAD,
+} ThreadState;
+
+typedef struct Thread {
+    uint8_t fpu_state[THREAD_FPU_STATE_SIZE] __attribute__((aligned(16))); // only valid if fpu_used
+    uint32_t esp; // saved kernel stack pointer while switched out
+    uint32_t id;
+    ThreadState state;
+    bool fpu_used; // thread has touched the FPU/SSE at least once
+    const char* name;
+    uint8_t* stack;
+    struct Process* process; // NULL for kernel threads
+    struct InterruptFrame* syscall_frame; // user state of the system call in progress
+    uint32_t user_entry; // ring 3 start of a thread from process_thread_create()
+    uint32_t user_stack;
+    uint32_t exit_word;  // user address cleared and futex-woken on exit, 0 for none
+    bool killed;         // its process is exiting, see thread_kill()
+    struct Thread* next; // run queue link
+} Thread;
+
+typedef void (*thread_entry_t)(void* arg);
+
+void thread_init();
+Thread* thread_create(const char* name, thread_entry_t entry, void* arg);
+Thread* thread_current();
+void thread_yield();
+void thread_block();
+void thread_wake(Thread* thread);
+void thread_kill(struct Process* process);
+__attribute__((__noreturn__)) void thread_exit();
+
+#endif // _KERNEL_THREAD_H_
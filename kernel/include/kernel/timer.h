@@ -0,0 +1,35 @@
+#ifndef _KERNEL_TIMER_H_
+#define _KERNEL_TIMER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMER_HZ 1000 // jiffies per second
+
+typedef void (*timer_callback_t)(void* arg);
+
+/*
+ * Kernel timer, embedded in its owner. Callbacks run with interrupts
+ * enabled but outside of any thread, so they must not block or yield.
+ */
+typedef struct Timer {
+    struct Timer* next;
+    struct Timer** pprev; // NULL while not pending
+    uint64_t expires;     // jiffies
+    timer_callback_t callback;
+    void* arg;
+    uint16_t bucket;
+} Timer;
+
+void timer_init();
+void timer_setup(Timer* timer, timer_callback_t callback, void* arg);
+void timer_add(Timer* timer, uint64_t expires);
+bool timer_cancel(Timer* timer);
+bool timer_pending(const Timer* timer);
+uint64_t timer_jiffies();
+uint64_t timer_next_event();
+uint64_t timer_next_event_tsc();
+uint64_t timer_last_interrupt_tsc();
+void timer_benchmark();
+
+#endif // _KERNEL_TIMER_H_
@@ -0,0 +1,75 @@
+#ifndef _KERNEL_TMPFS_H_
+#define _KERNEL_TMPFS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TMPFS_INODE_MAX 512
+#define TMPFS_DENTRY_MAX 512
+#define TMPFS_HASH_BITS 7
+#define TMPFS_NAME_MAX 27
+#define TMPFS_PATH_MAX 256
+
+/*
+ * Radix tree nodes are a frame of TMPFS_RADIX_SLOTS pointers, like a page
+ * table, so two levels index every page of a 4 GiB file.
+ */
+#define TMPFS_RADIX_BITS 10
+#define TMPFS_RADIX_SLOTS (1 << TMPFS_RADIX_BITS)
+#define TMPFS_RADIX_HEIGHT_MAX 2
+
+// Inode types
+#define TMPFS_FILE 1
+#define TMPFS_DIR 2
+
+// tmpfs_open() flags
+#define TMPFS_OPEN_CREATE 0x01
+#define TMPFS_OPEN_EXCLUSIVE 0x02
+#define TMPFS_OPEN_TRUNCATE 0x04
+
+/*
+ * A file or directory. File data lives in a radix tree of page frames
+ * indexed by page number: a tree of height 0 is the page at index 0 or
+ * nothing, every level above multiplies its reach by TMPFS_RADIX_SLOTS.
+ * Pages are only allocated when written or mapped, so holes cost nothing.
+ * An inode goes away once no name refers to it and it is neither open nor
+ * mapped.
+ */
+typedef struct TmpfsInode {
+    uint32_t id;
+    uint32_t type;             // TMPFS_FILE or TMPFS_DIR
+    uint32_t size;             // bytes, files only
+    uint32_t links;            // names referring to it
+    uint32_t refs;             // open files and mappings, see tmpfs_get()
+    uint32_t entries;          // names in a directory
+    uint32_t pages;            // pages in the cache
+    void* root;                // radix tree, see above
+    uint32_t height;
+    struct TmpfsInode* parent; // directory a directory is in, for ".."
+    struct TmpfsInode* next_free;
+    bool in_use;
+} TmpfsInode;
+
+typedef struct TmpfsStat {
+    uint32_t id;
+    uint32_t type;
+    uint32_t links;
+    uint32_t size;
+    uint32_t pages;
+} TmpfsStat;
+
+void tmpfs_init();
+int tmpfs_open(const char* path, uint32_t flags, TmpfsInode** inode);
+TmpfsInode* tmpfs_anonymous(uint32_t size);
+void tmpfs_get(TmpfsInode* inode);
+void tmpfs_put(TmpfsInode* inode);
+int tmpfs_mkdir(const char* path);
+int tmpfs_unlink(const char* path);
+int tmpfs_rmdir(const char* path);
+int tmpfs_stat(const char* path, TmpfsStat* stat);
+int32_t tmpfs_read(TmpfsInode* inode, uint32_t offset, uint8_t* buffer, uint32_t count);
+int32_t tmpfs_write(TmpfsInode* inode, uint32_t offset, const uint8_t* buffer, uint32_t count);
+int tmpfs_truncate(TmpfsInode* inode, uint32_t size);
+uint32_t tmpfs_page(TmpfsInode* inode, uint32_t index);
+
+#endif // _KERNEL_TMPFS_H_
@@ -0,0 +1,26 @@
+#ifndef _KERNEL_TSC_H_
+#define _KERNEL_TSC_H_
+
+#include <stdint.h>
+
+void tsc_init();
+uint32_t tsc_khz();
+uint64_t tsc_cycles_to_us(uint64_t cycles);
+
+/**************************************************************************//**
+ * @brief Reads the Time Stamp Counter(TSC).
+ * 
+ * @return Cycles since reset.
+ * 
+ ******************************************************************************/
+static inline uint64_t tsc_read() {
+    uint32_t low, high;
+
+    asm volatile("RDTSC\n\t"
+        : "=a" (low), "=d" (high)
+        );
+
+    return ((uint64_t) high << 32) | low;
+}
+
+#endif // _KERNEL_TSC_H_
@@ -0,0 +1,21 @@
+#ifndef _KERNEL_USERMODE_H_
+#define _KERNEL_USERMODE_H_
+
+#include <stdint.h>
+
+/*
+ * Code and data in the kernel image that runs in ring 3, e.g. benchmarks.
+ * linker.ld keeps it on separate pages, between __user_start and __user_end,
+ * so it can be mapped user accessible. Such code must not call into the rest
+ * of the kernel other than through system calls, which includes the
+ * profiling hooks of KERNEL_PROFILE builds.
+ */
+#define USER_TEXT __attribute__((section(".user.text"), noinline, no_instrument_function))
+#define USER_DATA __attribute__((section(".user.data")))
+
+struct InterruptFrame;
+
+__attribute__((__noreturn__)) void usermode_enter(uint32_t eip, uint32_t esp);
+__attribute__((__noreturn__)) void usermode_resume(struct InterruptFrame* frame);
+
+#endif // _KERNEL_USERMODE_H_
@@ -0,0 +1,76 @@
+#ifndef _KERNEL_VDSO_H_
+#define _KERNEL_VDSO_H_
+
+#include <stdint.h>
+
+/*
+ * Kernel data page, shared with user space.
+ *
+ * Every process sees the same page read-only at VDSO_DATA_ADDRESS, below
+ * the guard page of its stack. It holds a clock snapshot that user space
+ * extends with the TSC, so reading the time needs no system call, and
+ * static facts about the CPUs.
+ */
+#define VDSO_DATA_ADDRESS 0xBFEFE000
+
+/*
+ * The clock fields are updated under a sequence counter: the kernel makes
+ * sequence odd, changes the snapshot and makes it even again. Readers
+ * retry until they saw the same even value before and after reading.
+ * Nanoseconds since boot are
+ *
+ *     monotonic_base + (((TSC - tsc_base) * multiplier) >> shift)
+ *
+ * and the kernel refreshes the base often enough for the product to stay
+ * within 64 bits.
+ */
+typedef struct VdsoData {
+    volatile uint32_t sequence;
+    uint32_t shift;
+    uint64_t tsc_base;
+    uint64_t monotonic_base; // ns since boot at tsc_base
+    uint32_t multiplier;
+    uint32_t tsc_khz;
+    uint32_t cpu_count;
+    uint32_t cpu_features;   // CPU_FEATURE_* bits, see kernel/cpu.h
+    char cpu_vendor[16];     // CPUID vendor string, NUL terminated
+} VdsoData;
+
+/**************************************************************************//**
+ * @brief Reads the monotonic clock from a data page.
+ * 
+ * Safe against concurrent updates, see VdsoData. Works in the kernel and
+ * in user space alike.
+ * 
+ * @param data The kernel's data page.
+ * @return Nanoseconds since boot.
+ * 
+ ******************************************************************************/
+static inline uint64_t vdso_clock_ns(const volatile VdsoData* data) {
+    uint32_t sequence;
+    uint64_t ns;
+
+    do {
+        uint32_t low, high;
+
+        while ((sequence = data->sequence) & 1)
+            asm volatile("PAUSE\n\t" : : : "memory");
+        asm volatile("RDTSC\n\t" : "=a" (low), "=d" (high) : : "memory");
+
+        uint64_t cycles = (((uint64_t) high << 32) | low) - data->tsc_base;
+        ns = data->monotonic_base + ((cycles * data->multiplier) >> data->shift);
+        asm volatile("" : : : "memory");
+    } while (data->sequence != sequence);
+
+    return ns;
+}
+
+#ifdef __is_kernel
+#include <kernel/vm.h>
+
+void vdso_init();
+int vdso_map(AddressSpace* space);
+uint64_t vdso_monotonic_ns();
+#endif
+
+#endif // _KERNEL_VDSO_H_
@@ -0,0 +1,143 @@
+#ifndef _KERNEL_VIRTIO_H_
+#define _KERNEL_VIRTIO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <kernel/idt.h>
+#include <kernel/pci.h>
+
+#define VIRTIO_PCI_VENDOR 0x1AF4
+#define VIRTIO_PCI_LEGACY_BASE 0x1000 // transitional devices, 0x1000 + ID - 1
+#define VIRTIO_PCI_MODERN_BASE 0x1040 // virtio 1.0 only devices, 0x1040 + ID
+
+#define VIRTIO_QUEUE_MAX_SIZE 256
+#define VIRTIO_QUEUE_MAX 4         // rings in the static pool, one per queue in use
+#define VIRTIO_QUEUE_ALIGN 4096    // legacy used ring alignment
+#define VIRTIO_NO_VECTOR 0xFFFF
+
+// Device status
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER 0x02
+#define VIRTIO_STATUS_DRIVER_OK 0x04
+#define VIRTIO_STATUS_FEATURES_OK 0x08
+#define VIRTIO_STATUS_FAILED 0x80
+
+// Transport feature bits, device specific ones are below 24
+#define VIRTIO_F_RING_INDIRECT_DESC 28
+#define VIRTIO_F_RING_EVENT_IDX 29
+#define VIRTIO_F_VERSION_1 32
+
+#define VIRTIO_ISR_QUEUE 0x01
+#define VIRTIO_ISR_CONFIG 0x02
+
+// Split virtqueue flags
+#define VIRTQ_DESC_F_NEXT 0x01
+#define VIRTQ_DESC_F_WRITE 0x02    // device writes the buffer
+#define VIRTQ_AVAIL_F_NO_INTERRUPT 0x01
+#define VIRTQ_USED_F_NO_NOTIFY 0x01
+
+typedef struct VirtqDesc {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} VirtqDesc;
+
+// Followed by used_event when VIRTIO_F_RING_EVENT_IDX is negotiated
+typedef struct VirtqAvail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} VirtqAvail;
+
+typedef struct VirtqUsedElem {
+    uint32_t id;  // head of the descriptor chain
+    uint32_t len; // bytes written by the device
+} VirtqUsedElem;
+
+// Followed by avail_event when VIRTIO_F_RING_EVENT_IDX is negotiated
+typedef struct VirtqUsed {
+    uint16_t flags;
+    uint16_t idx;
+    VirtqUsedElem ring[];
+} VirtqUsed;
+
+/*
+ * One piece of a scatter-gather list. Buffers are handed to the device as
+ * they are, so they must be kernel memory, which is identity mapped and
+ * thus physically contiguous.
+ */
+typedef struct VirtqBuffer {
+    void* data;
+    uint32_t length;
+} VirtqBuffer;
+
+/*
+ * Virtio device behind a PCI function, either through the legacy I/O port
+ * registers or the virtio 1.0 capabilities.
+ */
+typedef struct VirtioDevice {
+    PciDevice* pci;
+    bool modern;
+    bool msix;
+    uint16_t io_base;               // legacy only
+    volatile uint8_t* common;       // modern only, from here on
+    volatile uint8_t* notify;
+    uint32_t notify_multiplier;
+    volatile uint8_t* isr;
+    volatile uint8_t* config;
+    uint64_t features;              // negotiated
+} VirtioDevice;
+
+typedef struct VirtqStats {
+    uint32_t added;           // descriptor chains
+    uint32_t kicks;           // doorbell writes
+    uint32_t kicks_suppressed;
+    uint32_t completed;
+} VirtqStats;
+
+/*
+ * Split virtqueue. New chains are only made visible to the device by
+ * virtq_kick(), so a batch of virtq_add() calls costs one index update and
+ * at most one doorbell write.
+ */
+typedef struct Virtqueue {
+    VirtioDevice* device;
+    uint16_t index;
+    uint16_t size;
+    volatile VirtqDesc* desc;
+    volatile VirtqAvail* avail;
+    volatile VirtqUsed* used;
+    volatile uint16_t* used_event;  // in the avail ring
+    volatile uint16_t* avail_event; // in the used ring
+    volatile uint16_t* doorbell;    // modern only
+    uint16_t free_head;
+    uint16_t free_count;
+    uint16_t avail_idx;  // next avail ring slot, published by virtq_kick()
+    uint16_t kicked_idx; // avail index as of the last virtq_kick()
+    uint16_t last_used;  // next used ring slot to consume
+    bool event_idx;
+    void* tokens[VIRTIO_QUEUE_MAX_SIZE];
+    VirtqStats stats;
+} Virtqueue;
+
+int virtio_pci_init(VirtioDevice* device, PciDevice* pci);
+int virtio_enable_msix(VirtioDevice* device, idt_handler_t handler);
+int virtio_negotiate(VirtioDevice* device, uint64_t wanted);
+bool virtio_has_feature(const VirtioDevice* device, uint32_t bit);
+uint32_t virtio_config_read32(VirtioDevice* device, uint32_t offset);
+uint64_t virtio_config_read64(VirtioDevice* device, uint32_t offset);
+uint8_t virtio_isr_read(VirtioDevice* device);
+void virtio_driver_ok(VirtioDevice* device);
+void virtio_fail(VirtioDevice* device);
+
+int virtq_setup(Virtqueue* queue, VirtioDevice* device, uint16_t index);
+int virtq_add(Virtqueue* queue, const VirtqBuffer* buffers, uint32_t out, uint32_t in, void* token);
+bool virtq_kick(Virtqueue* queue);
+void* virtq_get(Virtqueue* queue, uint32_t* length);
+void virtq_disable_cb(Virtqueue* queue);
+bool virtq_enable_cb(Virtqueue* queue, uint16_t batch);
+uint32_t virtq_free_count(const Virtqueue* queue);
+
+#endif // _KERNEL_VIRTIO_H_
@@ -0,0 +1,74 @@
+#ifndef _KERNEL_VIRTIO_BLK_H_
+#define _KERNEL_VIRTIO_BLK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <kernel/virtio.h>
+
+#define VIRTIO_BLK_MAX 4
+#define VIRTIO_BLK_ID 2
+#define VIRTIO_BLK_SECTOR_SIZE 512
+#define VIRTIO_BLK_SEGMENT_MAX 16 // caller buffers per request
+
+// Request types
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+#define VIRTIO_BLK_T_FLUSH 4
+
+// Request status written by the device
+#define VIRTIO_BLK_S_OK 0
+#define VIRTIO_BLK_S_IOERR 1
+#define VIRTIO_BLK_S_UNSUPP 2
+
+// Feature bits
+#define VIRTIO_BLK_F_SIZE_MAX 1
+#define VIRTIO_BLK_F_SEG_MAX 2
+#define VIRTIO_BLK_F_RO 5
+#define VIRTIO_BLK_F_BLK_SIZE 6
+#define VIRTIO_BLK_F_FLUSH 9
+
+// Device configuration offsets
+#define VIRTIO_BLK_CONFIG_CAPACITY 0x00 // 512 byte sectors
+#define VIRTIO_BLK_CONFIG_SIZE_MAX 0x08
+#define VIRTIO_BLK_CONFIG_SEG_MAX 0x0C
+#define VIRTIO_BLK_CONFIG_BLK_SIZE 0x14
+
+typedef struct VirtioBlk VirtioBlk;
+typedef struct VirtioBlkRequest VirtioBlkRequest;
+typedef void (*virtio_blk_callback_t)(VirtioBlkRequest* request);
+
+typedef struct VirtioBlkHeader {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} VirtioBlkHeader;
+
+/*
+ * Block request, owned by the caller until its callback runs. The header
+ * and status are handed to the device in place and the segments point at
+ * the caller's buffers, which must be kernel memory. Callbacks run in the
+ * block softirq and may submit further requests, which are kicked together
+ * once the completion batch is done.
+ */
+struct VirtioBlkRequest {
+    VirtioBlkHeader header;     // type and sector filled in by the caller
+    volatile uint8_t status;    // VIRTIO_BLK_S_*, written by the device
+    VirtqBuffer segments[VIRTIO_BLK_SEGMENT_MAX];
+    uint32_t segment_count;
+    virtio_blk_callback_t callback;
+    void* arg;
+    int result;                 // 0 or a negated errno value on completion
+};
+
+void virtio_blk_init();
+VirtioBlk* virtio_blk_get(uint32_t index);
+uint64_t virtio_blk_capacity(const VirtioBlk* disk);
+int virtio_blk_submit(VirtioBlk* disk, VirtioBlkRequest* request);
+void virtio_blk_kick(VirtioBlk* disk);
+int virtio_blk_read(VirtioBlk* disk, uint64_t sector, void* buffer, uint32_t bytes);
+int virtio_blk_write(VirtioBlk* disk, uint64_t sector, const void* buffer, uint32_t bytes);
+void virtio_blk_report();
+void virtio_blk_benchmark();
+
+#endif // _KERNEL_VIRTIO_BLK_H_
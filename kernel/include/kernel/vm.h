@@ -0,0 +1,71 @@
+#ifndef _KERNEL_VM_H_
+#define _KERNEL_VM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VM_SPACE_MAX 16
+#define VM_REGION_MAX 64 // ELF segments, stack, heap and one per mmap() mapping
+
+// Region access flags
+#define VM_READ 0x01
+#define VM_WRITE 0x02
+#define VM_EXEC 0x04
+#define VM_SHARED 0x08 // writes reach the page cache of the backing inode
+
+struct TmpfsInode;
+
+/*
+ * A range of user space with common access rights. Nothing is mapped up
+ * front, pages are filled in by vm_handle_fault() on first touch: from the
+ * backing file where it has data, with zeros elsewhere (e.g. .bss). Regions
+ * backed by an inode map its page cache pages instead, see vm_map_inode().
+ */
+typedef struct VmRegion {
+    uint32_t start;       // page aligned
+    uint32_t end;         // page aligned, exclusive
+    uint32_t flags;
+    const uint8_t* file;  // data backing the region, NULL for anonymous memory
+    uint32_t file_start;  // virtual address of file[0]
+    uint32_t file_size;   // bytes of file data, the rest of the region is zero
+    struct TmpfsInode* inode; // page cache backing the region, holds a reference
+    uint32_t inode_offset;    // file offset of start
+    bool in_use;
+} VmRegion;
+
+typedef struct VmStats {
+    uint32_t faults;          // resolved faults of all kinds
+    uint32_t file_faults;     // pages filled from a file
+    uint32_t file_shared;     // of those, mapped straight onto the file's frames
+    uint32_t zero_faults;     // demand-zero pages
+    uint32_t cow_faults;      // writes to copy-on-write pages
+    uint32_t cow_copies;      // of those, pages that had to be copied
+    uint32_t released;        // pages unmapped or discarded while the space was alive
+    uint64_t fault_cycles;    // total time spent resolving faults
+    uint64_t fault_cycles_max;
+} VmStats;
+
+typedef struct AddressSpace {
+    uint32_t directory; // physical address of the page directory
+    VmRegion regions[VM_REGION_MAX];
+    VmStats stats;
+    bool in_use;
+} AddressSpace;
+
+AddressSpace* vm_space_create();
+AddressSpace* vm_space_clone(AddressSpace* parent);
+void vm_space_destroy(AddressSpace* space);
+void vm_space_activate(AddressSpace* space);
+int vm_map_anonymous(AddressSpace* space, uint32_t start, uint32_t size, uint32_t flags);
+int vm_map_file(AddressSpace* space, uint32_t start, uint32_t size, const uint8_t* file, uint32_t file_size, uint32_t flags);
+int vm_map_inode(AddressSpace* space, uint32_t start, uint32_t size, struct TmpfsInode* inode, uint32_t offset, uint32_t flags);
+int vm_map_pages(AddressSpace* space, uint32_t start, const uint32_t* frames, uint32_t count, uint32_t flags);
+int vm_take_pages(AddressSpace* space, uint32_t start, uint32_t size, uint32_t* frames);
+int vm_unmap(AddressSpace* space, uint32_t start, uint32_t size);
+int vm_discard(AddressSpace* space, uint32_t start, uint32_t size);
+void vm_unmap_inode(struct TmpfsInode* inode, uint32_t first);
+int vm_resize(AddressSpace* space, uint32_t start, uint32_t end);
+uint32_t vm_find_free(AddressSpace* space, uint32_t size, uint32_t limit);
+bool vm_handle_fault(AddressSpace* space, uint32_t address, bool write);
+
+#endif // _KERNEL_VM_H_
@@ -0,0 +1,74 @@
+#include <errno.h>
+#include <stdint.h>
+
+#include <kernel/elf.h>
+#include <kernel/vm.h>
+
+/**************************************************************************//**
+ * @brief Local function. Checks that an image is an i386 ELF32 executable.
+ * 
+ ******************************************************************************/
+static int elf_check_header(const uint8_t* image, uint32_t size) {
+    const Elf32_Ehdr* header = (const Elf32_Ehdr*) image;
+
+    if (size < sizeof(Elf32_Ehdr) || *(const uint32_t*) header->e_ident != ELF_MAGIC)
+        return -ENOEXEC;
+    if (header->e_ident[4] != ELF_CLASS_32 || header->e_ident[5] != ELF_DATA_LSB)
+        return -ENOEXEC;
+    if (header->e_type != ELF_TYPE_EXEC || header->e_machine != ELF_MACHINE_386)
+        return -ENOEXEC;
+    if (header->e_phentsize != sizeof(Elf32_Phdr) || header->e_phoff > size
+        || header->e_phnum > (size - header->e_phoff) / sizeof(Elf32_Phdr))
+        return -ENOEXEC;
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Maps an ELF32 executable into an address space.
+ * 
+ * Each PT_LOAD segment becomes a region backed by the image, nothing is
+ * read or copied until the program touches its pages, see vm_handle_fault().
+ * The bytes between p_filesz and p_memsz (.bss) are demand-zero. Read-only
+ * segments that GRUB loaded page aligned share the image's frames outright.
+ * 
+ * @param space Address space with an empty user space.
+ * @param image Executable in memory. Must outlive the address space.
+ * @param size Size of the image in bytes.
+ * @param entry Receives the entry point.
+ * @return 0 on success, -ENOEXEC for an invalid image, or the error of
+ * vm_map_file().
+ * 
+ ******************************************************************************/
+int elf_load(AddressSpace* space, const uint8_t* image, uint32_t size, uint32_t* entry) {
+    const Elf32_Ehdr* header = (const Elf32_Ehdr*) image;
+    int error = elf_check_header(image, size);
+
+    if (error)
+        return error;
+
+    const Elf32_Phdr* segments = (const Elf32_Phdr*) (image + header->e_phoff);
+    for (uint16_t i = 0; i < header->e_phnum; i++) {
+        const Elf32_Phdr* segment = &segments[i];
+        uint32_t flags = 0;
+
+        if (segment->p_type != ELF_PT_LOAD || !segment->p_memsz)
+            continue;
+        if (segment->p_offset > size || segment->p_filesz > size - segment->p_offset)
+            return -ENOEXEC;
+
+        if (segment->p_flags & ELF_PF_R)
+            flags |= VM_READ;
+        if (segment->p_flags & ELF_PF_W)
+            flags |= VM_WRITE;
+        if (segment->p_flags & ELF_PF_X)
+            flags |= VM_EXEC;
+
+        error = vm_map_file(space, segment->p_vaddr, segment->p_memsz, image + segment->p_offset,
+            segment->p_filesz, flags);
+        if (error)
+            return error;
+    }
+
+    *entry = header->e_entry;
+    return 0;
+}
@@ -0,0 +1,298 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <kernel/cpu.h>
+#include <kernel/frame.h>
+#include <kernel/init.h>
+#include <kernel/multiboot.h>
+#include <kernel/tty.h>
+
+#define FRAME_COUNT (FRAME_MAX_MEMORY / FRAME_SIZE)
+#define FRAME_LOW_MEMORY 0x100000 // BIOS data, VGA memory and option ROMs live below
+#define FRAME_PINNED 0xFFFF       // refcount of frames that are never freed
+#define FRAME_RESERVED_MAX 4 // kernel, info structure, memory map and module list
+
+typedef struct FrameRange {
+    uint32_t start;
+    uint32_t end;
+} FrameRange;
+
+extern uint8_t __kernel_end[];
+extern uint8_t __init_start[];
+extern uint8_t __init_end[];
+
+/*
+ * Free frames form a singly linked list through their first word, so
+ * allocation and freeing are O(1) and need no memory besides the refcounts.
+ * All frames lie below FRAME_MAX_MEMORY, which is identity mapped.
+ */
+static uint16_t frame_refs[FRAME_COUNT];
+static uint32_t frame_free_head; // 0 if empty, frame 0 is never handed out
+static uint32_t frame_free_frames;
+static uint32_t frame_total_frames;
+static FrameRange frame_reserved[FRAME_RESERVED_MAX];
+static size_t frame_reserved_count;
+static const multiboot_module_t* frame_modules; // checked in place, any number of them
+static uint32_t frame_module_count;
+
+/**************************************************************************//**
+ * @brief Local function. Excludes a physical range from the free list.
+ * 
+ ******************************************************************************/
+static __init void frame_reserve(uint32_t start, uint32_t end) {
+    if (frame_reserved_count == FRAME_RESERVED_MAX) {
+        printf("\nFrame allocator: too many reserved ranges");
+        abort();
+    }
+    frame_reserved[frame_reserved_count].start = start & ~(FRAME_SIZE - 1);
+    frame_reserved[frame_reserved_count].end = (end + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+    frame_reserved_count++;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Checks whether a frame overlaps a byte range.
+ * 
+ ******************************************************************************/
+static inline bool frame_in_range(uint32_t frame, uint32_t start, uint32_t end) {
+    return end > start && frame < end && frame + FRAME_SIZE > start;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Checks a frame against the reserved ranges, the
+ * modules and their command lines.
+ * 
+ ******************************************************************************/
+static __init bool frame_is_reserved(uint32_t frame) {
+    for (size_t i = 0; i < frame_reserved_count; i++) {
+        if (frame >= frame_reserved[i].start && frame < frame_reserved[i].end)
+            return true;
+    }
+    for (uint32_t i = 0; i < frame_module_count; i++) {
+        const multiboot_module_t* module = &frame_modules[i];
+        const char* cmdline = (const char*) module->cmdline;
+
+        if (frame_in_range(frame, module->mod_start, module->mod_end))
+            return true;
+        if (cmdline && frame_in_range(frame, module->cmdline, module->cmdline + strlen(cmdline) + 1))
+            return true;
+    }
+    return false;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Pushes a frame onto the free list.
+ * 
+ ******************************************************************************/
+static inline void frame_push(uint32_t frame) {
+    *(uint32_t*) frame = frame_free_head;
+    frame_free_head = frame;
+    frame_refs[frame / FRAME_SIZE] = 0;
+    frame_free_frames++;
+}
+
+/**************************************************************************//**
+ * @brief Initializes the physical frame allocator.
+ * 
+ * Every available frame of the multiboot memory map between 1 MiB and
+ * FRAME_MAX_MEMORY goes onto the free list, except for the kernel image and
+ * what GRUB left in memory: the info structure, memory map, module list and
+ * the modules themselves. Module frames are pinned instead, so program
+ * images can be mapped into address spaces without copying. Must run before
+ * paging_init(), while physical memory is still directly addressable.
+ * 
+ * @param mbi Multiboot information from the bootloader, may be NULL.
+ * 
+ ******************************************************************************/
+__init void frame_init(const multiboot_info_t* mbi) {
+    memset(frame_refs, 0xFF, sizeof(frame_refs));
+    frame_free_head = 0;
+    frame_free_frames = 0;
+    frame_reserved_count = 0;
+    frame_modules = NULL;
+    frame_module_count = 0;
+
+    if (!mbi || !(mbi->flags & MULTIBOOT_INFO_MEM_MAP)) {
+        term_writestring("\nFrame allocator: no memory map.");
+        return;
+    }
+
+    frame_reserve(FRAME_LOW_MEMORY, (uint32_t) __kernel_end);
+    frame_reserve((uint32_t) mbi, (uint32_t) mbi + sizeof(*mbi));
+    frame_reserve(mbi->mmap_addr, mbi->mmap_addr + mbi->mmap_length);
+    if (mbi->flags & MULTIBOOT_INFO_MODS) {
+        frame_reserve(mbi->mods_addr, mbi->mods_addr + mbi->mods_count * sizeof(multiboot_module_t));
+        frame_modules = (const multiboot_module_t*) mbi->mods_addr;
+        frame_module_count = mbi->mods_count;
+    }
+
+    uint32_t entry = mbi->mmap_addr;
+    while (entry < mbi->mmap_addr + mbi->mmap_length) {
+        const multiboot_mmap_entry_t* region = (const multiboot_mmap_entry_t*) entry;
+        uint64_t start = region->addr;
+        uint64_t end = region->addr + region->len;
+
+        entry += region->size + sizeof(region->size);
+        if (region->type != MULTIBOOT_MEMORY_AVAILABLE)
+            continue;
+
+        if (start < FRAME_LOW_MEMORY)
+            start = FRAME_LOW_MEMORY;
+        if (end > FRAME_MAX_MEMORY)
+            end = FRAME_MAX_MEMORY;
+        start = (start + FRAME_SIZE - 1) & ~(uint64_t) (FRAME_SIZE - 1);
+
+        // Pushed top down, so allocations come out in ascending order
+        for (uint64_t frame = (end & ~(uint64_t) (FRAME_SIZE - 1)); frame > start; ) {
+            frame -= FRAME_SIZE;
+            if (!frame_is_reserved((uint32_t) frame))
+                frame_push((uint32_t) frame);
+        }
+    }
+
+    // Module frames are left out of the free list, see above
+    if (mbi->flags & MULTIBOOT_INFO_MODS) {
+        const multiboot_module_t* modules = (const multiboot_module_t*) mbi->mods_addr;
+
+        for (uint32_t i = 0; i < mbi->mods_count; i++)
+            frame_pin(modules[i].mod_start, modules[i].mod_end);
+    }
+
+    frame_total_frames = frame_free_frames;
+    term_writestring("\nFrame allocator initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Releases the frames of the kernel's __init code and data.
+ * 
+ * Called at the end of kernel_main(), once no __init function is running
+ * or will be called again.
+ * 
+ ******************************************************************************/
+void frame_free_init() {
+    uint32_t flags = cpu_irq_save();
+    uint32_t freed = 0;
+
+    for (uint32_t frame = (uint32_t) __init_start; frame < (uint32_t) __init_end; frame += FRAME_SIZE) {
+        frame_push(frame);
+        freed++;
+    }
+    frame_total_frames += freed;
+
+    cpu_irq_restore(flags);
+    printf("\nFreed %u KiB of init memory.", freed * FRAME_SIZE / 1024);
+}
+
+/**************************************************************************//**
+ * @brief Allocates a physical frame.
+ * 
+ * The contents are undefined.
+ * 
+ * @return Physical address of the frame with a refcount of 1, or 0 if out of
+ * memory.
+ * 
+ ******************************************************************************/
+uint32_t frame_alloc() {
+    uint32_t flags = cpu_irq_save();
+    uint32_t frame = frame_free_head;
+
+    if (frame) {
+        frame_free_head = *(uint32_t*) frame;
+        frame_refs[frame / FRAME_SIZE] = 1;
+        frame_free_frames--;
+    }
+
+    cpu_irq_restore(flags);
+    return frame;
+}
+
+/**************************************************************************//**
+ * @brief Allocates a zero-filled physical frame.
+ * 
+ * @return Physical address of the frame with a refcount of 1, or 0 if out of
+ * memory.
+ * 
+ ******************************************************************************/
+uint32_t frame_alloc_zeroed() {
+    uint32_t frame = frame_alloc();
+
+    if (frame)
+        memset((void*) frame, 0, FRAME_SIZE);
+    return frame;
+}
+
+/**************************************************************************//**
+ * @brief Adds a reference to an allocated frame, e.g. a copy-on-write mapping.
+ * 
+ * @param frame Physical address of the frame. Pinned frames are ignored.
+ * 
+ ******************************************************************************/
+void frame_ref(uint32_t frame) {
+    uint32_t flags = cpu_irq_save();
+    uint16_t* refs = &frame_refs[frame / FRAME_SIZE];
+
+    if (*refs != FRAME_PINNED)
+        (*refs)++;
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Drops a reference to a frame, freeing it with the last one.
+ * 
+ * @param frame Physical address of the frame. Pinned frames are ignored.
+ * 
+ ******************************************************************************/
+void frame_unref(uint32_t frame) {
+    uint32_t flags = cpu_irq_save();
+    uint16_t* refs = &frame_refs[frame / FRAME_SIZE];
+
+    if (*refs != FRAME_PINNED && *refs && --(*refs) == 0)
+        frame_push(frame);
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Marks a physical range as never freed.
+ * 
+ * Pinned frames can be mapped any number of times without refcounting.
+ * 
+ * @param start First byte of the range.
+ * @param end Byte past the range.
+ * 
+ ******************************************************************************/
+void frame_pin(uint32_t start, uint32_t end) {
+    for (uint32_t frame = start & ~(FRAME_SIZE - 1); frame < end && frame < FRAME_MAX_MEMORY; frame += FRAME_SIZE)
+        frame_refs[frame / FRAME_SIZE] = FRAME_PINNED;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the number of references to a frame.
+ * 
+ * @param frame Physical address of the frame.
+ * @return Reference count, 0xFFFF for pinned frames.
+ * 
+ ******************************************************************************/
+uint16_t frame_refcount(uint32_t frame) {
+    return frame_refs[frame / FRAME_SIZE];
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the number of free frames.
+ * 
+ ******************************************************************************/
+uint32_t frame_free_count() {
+    return frame_free_frames;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the number of frames managed by the allocator.
+ * 
+ ******************************************************************************/
+uint32_t frame_total_count() {
+    return frame_total_frames;
+}
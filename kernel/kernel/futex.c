@@ -0,0 +1,196 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <kernel/cpu.h>
+#include <kernel/futex.h>
+#include <kernel/paging.h>
+#include <kernel/thread.h>
+#include <kernel/vm.h>
+
+/*
+ * A thread sleeping in futex_wait(). Waiters live on their own kernel stack
+ * and are chained into the bucket their key hashes to, so the table itself
+ * is just list heads. The key is the physical address of the futex word:
+ * threads of one process and processes sharing a frame meet in the same
+ * queue whatever virtual address they use, and a private copy made for a
+ * copy-on-write fault no longer matches.
+ */
+typedef struct FutexWaiter {
+    uint32_t key;
+    Thread* thread;
+    bool woken;
+    struct FutexWaiter* next;
+} FutexWaiter;
+
+// Buckets are only touched with interrupts disabled, enough for CPU_MAX 1
+static FutexWaiter* futex_table[FUTEX_BUCKETS];
+
+/**************************************************************************//**
+ * @brief Local function. Hashes a key to its bucket.
+ * 
+ * Futex words are aligned, so the low two bits carry nothing. Multiplying
+ * by the golden ratio spreads neighbouring words over the table.
+ * 
+ ******************************************************************************/
+static inline FutexWaiter** futex_bucket(uint32_t key) {
+    return &futex_table[((key >> 2) * 0x9E3779B1u) >> (32 - FUTEX_HASH_BITS)];
+}
+
+/**************************************************************************//**
+ * @brief Local function. Finds the physical address behind a futex word.
+ * 
+ * The page has to be present and writable, so it is faulted in for writing
+ * first if need be. That also breaks copy-on-write sharing, which would
+ * otherwise leave a process keyed on a frame it is about to lose.
+ * 
+ * @param space Address space of the caller, must be active.
+ * @param address User address of the word.
+ * @param key Receives the physical address.
+ * @return 0 on success, -EINVAL if address is not 4-byte aligned, -EFAULT
+ * if it is not writable user memory.
+ * 
+ ******************************************************************************/
+static int futex_key(AddressSpace* space, uint32_t address, uint32_t* key) {
+    uint32_t* entry;
+
+    if (address & (sizeof(uint32_t) - 1))
+        return -EINVAL;
+    if (address < USER_SPACE_START || address >= USER_SPACE_END)
+        return -EFAULT;
+
+    entry = paging_get_entry(space->directory, address, false);
+    if (!entry || (*entry & (PAGE_PRESENT | PAGE_WRITE)) != (PAGE_PRESENT | PAGE_WRITE)) {
+        if (!vm_handle_fault(space, address, true))
+            return -EFAULT;
+        entry = paging_get_entry(space->directory, address, false);
+    }
+
+    *key = (*entry & PAGE_MASK) | (address & ~PAGE_MASK);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Sleeps until futex_wake() if a user word still holds a value.
+ * 
+ * The comparison and the queueing happen with interrupts disabled, so a
+ * waker that changes the word and then calls futex_wake() cannot slip in
+ * between and be missed. Waiters queue at the tail, so wake-ups go out in
+ * arrival order. The word is read through its physical address,
+ * which is identity mapped.
+ * 
+ * @param space Address space of the caller, must be active.
+ * @param address User address of the futex word.
+ * @param expected Value the word must hold for the thread to sleep.
+ * @return 0 once woken, -EAGAIN if the word held another value, -EINTR if
+ * the thread was killed, see thread_kill(), or an error from futex_key().
+ * 
+ ******************************************************************************/
+int32_t futex_wait(AddressSpace* space, uint32_t address, uint32_t expected) {
+    FutexWaiter waiter;
+    FutexWaiter** bucket;
+    uint32_t flags;
+    int error = futex_key(space, address, &waiter.key);
+
+    if (error)
+        return error;
+
+    waiter.thread = thread_current();
+    waiter.woken = false;
+    bucket = futex_bucket(waiter.key);
+
+    flags = cpu_irq_save();
+    if (*(volatile uint32_t*) waiter.key != expected) {
+        cpu_irq_restore(flags);
+        return -EAGAIN;
+    }
+
+    while (*bucket)
+        bucket = &(*bucket)->next;
+    waiter.next = NULL;
+    *bucket = &waiter;
+    while (!waiter.woken && !waiter.thread->killed)
+        thread_block();
+
+    if (!waiter.woken) {
+        for (bucket = futex_bucket(waiter.key); *bucket != &waiter; bucket = &(*bucket)->next)
+            ;
+        *bucket = waiter.next;
+        cpu_irq_restore(flags);
+        return -EINTR;
+    }
+    cpu_irq_restore(flags);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Wakes up to count waiters queued on a key.
+ * 
+ * Waiters are taken off the queue here, so each wake-up is counted once
+ * even if the woken thread has not run yet.
+ * 
+ ******************************************************************************/
+static int32_t futex_wake_key(uint32_t key, uint32_t count) {
+    uint32_t flags = cpu_irq_save();
+    FutexWaiter** link = futex_bucket(key);
+    int32_t woken = 0;
+
+    if (count > INT32_MAX)
+        count = INT32_MAX;
+
+    while (*link && (uint32_t) woken < count) {
+        FutexWaiter* waiter = *link;
+
+        if (waiter->key != key) {
+            link = &waiter->next;
+            continue;
+        }
+        *link = waiter->next;
+        waiter->woken = true;
+        thread_wake(waiter->thread);
+        woken++;
+    }
+    cpu_irq_restore(flags);
+    return woken;
+}
+
+/**************************************************************************//**
+ * @brief Wakes threads sleeping on a user word.
+ * 
+ * @param space Address space of the caller, must be active.
+ * @param address User address of the futex word.
+ * @param count Most threads to wake.
+ * @return Number of threads woken, or an error from futex_key().
+ * 
+ ******************************************************************************/
+int32_t futex_wake(AddressSpace* space, uint32_t address, uint32_t count) {
+    uint32_t key;
+    int error = futex_key(space, address, &key);
+
+    return error ? error : futex_wake_key(key, count);
+}
+
+/**************************************************************************//**
+ * @brief Stores a value into a user word and wakes its waiters.
+ * 
+ * Used for the exit word of a thread, see process_thread_exit(). Going
+ * through the key means a word the process unmapped is skipped rather than
+ * faulting in the kernel.
+ * 
+ * @param space Address space of the caller, must be active.
+ * @param address User address of the futex word.
+ * @param value Value to store.
+ * @param count Most threads to wake.
+ * @return Number of threads woken, or an error from futex_key().
+ * 
+ ******************************************************************************/
+int32_t futex_store_wake(AddressSpace* space, uint32_t address, uint32_t value, uint32_t count) {
+    uint32_t key;
+    int error = futex_key(space, address, &key);
+
+    if (error)
+        return error;
+    *(volatile uint32_t*) key = value;
+    return futex_wake_key(key, count);
+}
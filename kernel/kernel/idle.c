@@ -0,0 +1,323 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <kernel/cpu.h>
+#include <kernel/idle.h>
+#include <kernel/init.h>
+#include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <kernel/tsc.h>
+#include <kernel/tty.h>
+
+#define IDLE_CACHE_LINE 64     // MONITOR granularity assumed for the wake flag
+#define IDLE_HISTORY_SHIFT 3   // predictor keeps 7/8 of its old estimate
+
+// CPUID leaf 5, MONITOR/MWAIT
+#define CPUID_MWAIT_LEAF 5
+#define CPUID_MWAIT_ECX_EXTENSIONS 0x01
+#define CPUID_MWAIT_EDX_C2_SHIFT 8
+#define CPUID_MWAIT_EDX_C2_MASK 0x0F
+
+typedef struct IdleState {
+    const char* name;
+    uint32_t hint;                // MWAIT hint
+    uint32_t exit_latency_us;
+    uint32_t target_residency_us; // shortest sleep the state pays off for
+    bool available;
+} IdleState;
+
+typedef struct IdleStats {
+    uint32_t entries;
+    uint32_t kicked;          // ended by idle_kick() rather than an idle interrupt
+    uint32_t too_deep;        // woke before its target residency
+    uint32_t too_shallow;     // slept long enough for the next deeper state
+    uint64_t residency;       // cycles
+    uint32_t timer_wakeups;   // ended by a one-shot clock interrupt at its deadline
+    uint64_t exit_latency;    // cycles from that deadline into the interrupt handler
+    uint64_t exit_latency_max;
+    uint64_t kick_latency;    // cycles from idle_kick() until back in idle_enter()
+    uint64_t kick_latency_max;
+} IdleStats;
+
+/*
+ * The wake flag sits alone at the start of its cache line, since that line
+ * is what MWAIT monitors. Writing it is what ends an MWAIT, so a wake-up
+ * costs a store instead of an interrupt.
+ */
+typedef struct IdleCpu {
+    volatile uint32_t need_resched __attribute__((aligned(IDLE_CACHE_LINE)));
+    bool idling __attribute__((aligned(IDLE_CACHE_LINE)));
+    uint64_t kick_tsc;
+    uint64_t period_start;  // TSC when the CPU ran out of threads, 0 while busy
+    uint32_t predicted_us;  // running average of idle period lengths
+    uint32_t periods;
+    IdleStats stats[IDLE_STATE_COUNT];
+} IdleCpu;
+
+/*
+ * Ordered by target residency. Polling wakes instantly but keeps the core
+ * busy. MWAIT C1 sleeps until an interrupt or a write to the wake flag.
+ * HLT is the same C1 on bare metal, but under a hypervisor it hands the
+ * physical CPU back where MWAIT is usually unavailable or spins, so it is
+ * kept for waits long enough to be worth a VM exit. Deeper MWAIT states
+ * are only used when CPUID enumerates them.
+ */
+static IdleState idle_states[IDLE_STATE_COUNT] = {
+    [IDLE_POLL] = { "poll", 0, 0, 0, true },
+    [IDLE_MWAIT_C1] = { "mwait-c1", 0x00, 1, 2, false },
+    [IDLE_HLT] = { "hlt", 0, 2, 50, true },
+    [IDLE_MWAIT_C2] = { "mwait-c2", 0x10, 50, 200, false },
+};
+
+static IdleCpu idle_cpus[CPU_MAX];
+static uint32_t idle_monitor_line;
+
+/**************************************************************************//**
+ * @brief Local function. Predicts how long the CPU will stay idle.
+ * 
+ * The next clock interrupt is a hard upper bound. Below it, the history of
+ * past idle periods is trusted as long as the current period has not
+ * already outlasted it.
+ * 
+ * @return Expected sleep in microseconds.
+ * 
+ ******************************************************************************/
+static uint32_t idle_predict(IdleCpu* cpu, uint64_t now) {
+    uint64_t jiffies = timer_jiffies();
+    uint64_t next = timer_next_event();
+    uint64_t timer_us = next > jiffies ? (next - jiffies) * 1000000 / TIMER_HZ : 0;
+    uint64_t elapsed_us = tsc_cycles_to_us(now - cpu->period_start);
+
+    if (cpu->periods && cpu->predicted_us > elapsed_us && cpu->predicted_us - elapsed_us < timer_us)
+        return cpu->predicted_us - elapsed_us;
+    return timer_us > UINT32_MAX ? UINT32_MAX : (uint32_t) timer_us;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Picks the deepest state that pays off for a sleep.
+ * 
+ ******************************************************************************/
+static uint32_t idle_select(uint32_t predicted_us) {
+    uint32_t selected = IDLE_POLL;
+
+    for (uint32_t i = IDLE_POLL + 1; i < IDLE_STATE_COUNT; i++) {
+        if (idle_states[i].available && idle_states[i].target_residency_us <= predicted_us)
+            selected = i;
+    }
+    return selected;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Finds the next deeper available state.
+ * 
+ * @return State index, IDLE_STATE_COUNT if there is none.
+ * 
+ ******************************************************************************/
+static uint32_t idle_deeper(uint32_t state) {
+    while (++state < IDLE_STATE_COUNT && !idle_states[state].available)
+        ;
+    return state;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Sleeps in an idle state until an interrupt.
+ * 
+ * Interrupts are enabled for the sleep and disabled again on return. Polling
+ * gives up after the target residency of the next deeper state, so a wrong
+ * prediction is corrected on the next idle_enter().
+ * 
+ ******************************************************************************/
+static void idle_sleep(IdleCpu* cpu, uint32_t state) {
+    switch (state) {
+    case IDLE_POLL: {
+        uint32_t deeper = idle_deeper(IDLE_POLL);
+        uint64_t limit_us = deeper < IDLE_STATE_COUNT ? idle_states[deeper].target_residency_us : 1;
+        uint64_t deadline = tsc_read() + limit_us * tsc_khz() / 1000;
+
+        cpu_irq_enable();
+        while (!cpu->need_resched && tsc_read() < deadline)
+            cpu_pause();
+        break;
+    }
+    case IDLE_MWAIT_C1:
+    case IDLE_MWAIT_C2:
+        // Interrupts stay off between the check and MWAIT, so no kick is lost
+        cpu_monitor(&cpu->need_resched);
+        if (!cpu->need_resched)
+            cpu_mwait(idle_states[state].hint);
+        break;
+    default:
+        cpu_halt();
+        break;
+    }
+    cpu_irq_disable();
+}
+
+/**************************************************************************//**
+ * @brief Initializes the idle states from CPUID.
+ * 
+ * MWAIT C1 needs MONITOR/MWAIT, deeper MWAIT states also need leaf 5 to
+ * report sub-states for them. Must run after cpu_init() and tsc_init().
+ * 
+ ******************************************************************************/
+__init void idle_init() {
+    uint32_t regs[4];
+
+    idle_monitor_line = 0;
+    if (cpu_has(CPU_FEATURE_MONITOR)) {
+        idle_states[IDLE_MWAIT_C1].available = true;
+
+        cpu_cpuid(0, 0, regs);
+        if (regs[0] >= CPUID_MWAIT_LEAF) {
+            cpu_cpuid(CPUID_MWAIT_LEAF, 0, regs);
+            idle_monitor_line = regs[1] & 0xFFFF;
+            if ((regs[2] & CPUID_MWAIT_ECX_EXTENSIONS)
+                && ((regs[3] >> CPUID_MWAIT_EDX_C2_SHIFT) & CPUID_MWAIT_EDX_C2_MASK))
+                idle_states[IDLE_MWAIT_C2].available = true;
+        }
+    }
+
+    term_writestring("\nIdle states initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Sleeps until an interrupt, in the state the governor picks.
+ * 
+ * Called by the scheduler with interrupts disabled when no thread is
+ * runnable, and returns with interrupts disabled. Consecutive calls without
+ * a thread becoming runnable in between make up one idle period, whose
+ * length feeds the predictor once it ends.
+ * 
+ ******************************************************************************/
+void idle_enter() {
+    IdleCpu* cpu = &idle_cpus[cpu_id()];
+    uint64_t start = tsc_read();
+
+    if (!cpu->period_start)
+        cpu->period_start = start;
+    cpu->need_resched = 0;
+    cpu->idling = true;
+
+    uint32_t state = idle_select(idle_predict(cpu, start));
+    uint64_t expected = timer_next_event_tsc();
+    idle_sleep(cpu, state);
+
+    uint64_t end = tsc_read();
+    uint64_t fired = timer_last_interrupt_tsc();
+    uint64_t residency_us = tsc_cycles_to_us(end - start);
+    uint32_t deeper = idle_deeper(state);
+    IdleStats* stats = &cpu->stats[state];
+
+    cpu->idling = false;
+    stats->entries++;
+    stats->residency += end - start;
+    if (residency_us < idle_states[state].target_residency_us)
+        stats->too_deep++;
+    else if (deeper < IDLE_STATE_COUNT && residency_us >= idle_states[deeper].target_residency_us)
+        stats->too_shallow++;
+
+    /*
+     * A clock interrupt taken during the sleep and not before its deadline
+     * is what woke a halted CPU, so the time from the deadline into the
+     * handler is the state's exit latency plus interrupt entry. Polling
+     * never sleeps, and the periodic tick has no known deadline.
+     */
+    if (state != IDLE_POLL && expected > start && fired >= expected && fired <= end) {
+        uint64_t latency = fired - expected;
+
+        stats->timer_wakeups++;
+        stats->exit_latency += latency;
+        if (latency > stats->exit_latency_max)
+            stats->exit_latency_max = latency;
+    }
+
+    if (cpu->need_resched) {
+        uint64_t latency = end - cpu->kick_tsc;
+        uint64_t period_us = tsc_cycles_to_us(end - cpu->period_start);
+
+        stats->kicked++;
+        stats->kick_latency += latency;
+        if (latency > stats->kick_latency_max)
+            stats->kick_latency_max = latency;
+
+        if (period_us > INT32_MAX)
+            period_us = INT32_MAX;
+        if (cpu->periods++)
+            cpu->predicted_us += ((int32_t) period_us - (int32_t) cpu->predicted_us) >> IDLE_HISTORY_SHIFT;
+        else
+            cpu->predicted_us = period_us;
+        cpu->period_start = 0;
+    }
+}
+
+/**************************************************************************//**
+ * @brief Tells an idle CPU that a thread became runnable.
+ * 
+ * Called by the scheduler with interrupts disabled. The store to the wake
+ * flag ends MWAIT by itself, a CPU in HLT is already awake since only an
+ * interrupt handler can get here while it sleeps.
+ * 
+ ******************************************************************************/
+void idle_kick() {
+    IdleCpu* cpu = &idle_cpus[cpu_id()];
+
+    if (cpu->idling && !cpu->need_resched) {
+        cpu->kick_tsc = tsc_read();
+        cpu->need_resched = 1;
+    }
+}
+
+/**************************************************************************//**
+ * @brief Turns the calling thread into the idle loop, for good.
+ * 
+ * The boot thread ends up here once kernel_main() is done. It blocks and is
+ * never woken, so the scheduler idles whenever no other thread is runnable.
+ * 
+ ******************************************************************************/
+void idle_loop() {
+    cpu_irq_save();
+    for (;;)
+        thread_block();
+}
+
+/**************************************************************************//**
+ * @brief Prints residency and wake-up latency per idle state and CPU.
+ * 
+ * Exit latency is measured on clock interrupts only. Kick to resume is the
+ * time from idle_kick(), which runs in the handler of an interrupt that
+ * already woke the CPU, until idle_enter() regains control, so it says
+ * nothing about how deep the sleep was.
+ * 
+ ******************************************************************************/
+void idle_report() {
+    printf("\nidle: monitor line %u bytes, states", idle_monitor_line);
+    for (size_t i = 0; i < IDLE_STATE_COUNT; i++) {
+        if (idle_states[i].available)
+            printf(" %s (exit %u us)", idle_states[i].name, idle_states[i].exit_latency_us);
+    }
+
+    for (size_t i = 0; i < CPU_MAX; i++) {
+        IdleCpu* cpu = &idle_cpus[i];
+
+        for (size_t state = 0; state < IDLE_STATE_COUNT; state++) {
+            IdleStats* stats = &cpu->stats[state];
+
+            if (!stats->entries)
+                continue;
+            printf("\nidle: cpu %u %s: %u entries, %llu us resident, %u too deep, %u too shallow",
+                i, idle_states[state].name, stats->entries, tsc_cycles_to_us(stats->residency),
+                stats->too_deep, stats->too_shallow);
+            if (stats->timer_wakeups)
+                printf("\nidle: cpu %u %s: %u timer wake-ups, exit latency avg %llu max %llu cycles",
+                    i, idle_states[state].name, stats->timer_wakeups, stats->exit_latency / stats->timer_wakeups,
+                    stats->exit_latency_max);
+            if (stats->kicked)
+                printf("\nidle: cpu %u %s: %u kicks, kick to resume avg %llu max %llu cycles",
+                    i, idle_states[state].name, stats->kicked, stats->kick_latency / stats->kicked,
+                    stats->kick_latency_max);
+        }
+        printf("\nidle: cpu %u: %u periods, predicted %u us", i, cpu->periods, cpu->predicted_us);
+    }
+}
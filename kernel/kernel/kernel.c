@@ -1,13 +1,37 @@
+#include <stdint.h>
 #include <stdio.h>
 
+#include <kernel/cpu.h>
+#include <kernel/fbcon.h>
+#include <kernel/fpu.h>
+#include <kernel/frame.h>
+#include <kernel/idle.h>
+#include <kernel/idt.h>
+#include <kernel/lapic.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/pci.h>
+#include <kernel/process.h>
+#include <kernel/profile.h>
+#include <kernel/tsc.h>
 #include <kernel/tty.h>
 #include <kernel/pio.h>
 #include <kernel/gdt.h>
 #include <kernel/pic.h>
+#include <kernel/softirq.h>
+#include <kernel/syscall.h>
+#include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <kernel/tmpfs.h>
+#include <kernel/vdso.h>
+#include <kernel/virtio_blk.h>
 
-void kernel_main(void) {
+void kernel_main(uint32_t magic, multiboot_info_t* mbi) {
+	if (magic == MULTIBOOT_BOOTLOADER_MAGIC)
+		fbcon_init(mbi);
 	term_init();
 	term_enablecursordefault();
+	tsc_init();
     printf("Hello, kernel World!\nThis is the second line!\nThis is the third line!\nThis is the fourth line!");
     printf("\nHello, kernel World!\nThis is the second line!\nThis is the third line!\nThis is the fourth line!");
 	printf("\nHello, kernel World!\nThis is the second line!\nThis is the third line!\nThis is the fourth line!");
@@ -21,7 +45,36 @@ void kernel_main(void) {
 	printf("\nHello, kernel World!\nThis is the second line!\nThis is the third line!\nThis is the fourth line!");
 	printf("\nHello, kernel World!\nThis is the second line!\nThis is the third line!\nThis is the fourth line!");
 	gdt_init();
+	idt_init();
+	cpu_init();
+	frame_init(magic == MULTIBOOT_BOOTLOADER_MAGIC ? mbi : NULL);
+	paging_init();
+	fpu_init();
+	syscall_init();
+	thread_init();
+	softirq_init();
+	lapic_init();
 	pic_init();
-
+	timer_init();
+	vdso_init();
+	tmpfs_init();
+	idle_init();
+	pci_init();
+	virtio_blk_init();
+	profile_start();
+	fbcon_report();
+	pci_report();
+	virtio_blk_report();
+	fpu_report();
+	syscall_benchmark();
+	timer_benchmark();
+	virtio_blk_benchmark();
+	softirq_report();
+	idle_report();
+	process_spawn_modules(magic == MULTIBOOT_BOOTLOADER_MAGIC ? mbi : NULL);
+	frame_free_init();
+	process_wait_all();
+	profile_report();
+	idle_loop();
 
 }
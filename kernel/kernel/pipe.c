@@ -0,0 +1,406 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <kernel/cpu.h>
+#include <kernel/frame.h>
+#include <kernel/paging.h>
+#include <kernel/pipe.h>
+#include <kernel/thread.h>
+#include <kernel/tmpfs.h>
+#include <kernel/vm.h>
+
+/*
+ * A thread sleeping on one side of a pipe, on its own kernel stack. Any
+ * change on the other side wakes the whole queue and every sleeper checks
+ * again, which is cheap with the one or two threads a pipe usually has.
+ */
+typedef struct PipeWaiter {
+    Thread* thread;
+    bool woken;
+    struct PipeWaiter* next;
+} PipeWaiter;
+
+// Queues are only touched with interrupts disabled, enough for CPU_MAX 1
+static Pipe pipe_table[PIPE_MAX];
+
+/**************************************************************************//**
+ * @brief Local function. Sleeps on a queue until pipe_wake() empties it.
+ * 
+ * Interrupts must be disabled, so the condition the caller checked cannot
+ * change before the thread is queued.
+ * 
+ * @return 0 once woken, -EINTR if the thread was killed, see thread_kill().
+ * 
+ ******************************************************************************/
+static inline int pipe_sleep(PipeWaiter** queue) {
+    PipeWaiter waiter;
+
+    waiter.thread = thread_current();
+    waiter.woken = false;
+    waiter.next = *queue;
+    *queue = &waiter;
+    while (!waiter.woken && !waiter.thread->killed)
+        thread_block();
+
+    if (waiter.woken)
+        return 0;
+
+    // Killed, pipe_wake() has not taken the waiter off the queue
+    PipeWaiter** link = queue;
+    while (*link != &waiter)
+        link = &(*link)->next;
+    *link = waiter.next;
+    return -EINTR;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Wakes all threads sleeping on a queue.
+ * 
+ ******************************************************************************/
+static void pipe_wake(PipeWaiter** queue) {
+    uint32_t flags = cpu_irq_save();
+
+    while (*queue) {
+        PipeWaiter* waiter = *queue;
+
+        *queue = waiter->next;
+        waiter->woken = true;
+        thread_wake(waiter->thread);
+    }
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Drops the frames of a grant nobody accepted.
+ * 
+ ******************************************************************************/
+static void pipe_grant_free(PipeGrant* grant) {
+    for (uint32_t i = 0; i < grant->pages; i++) {
+        if (grant->frames[i])
+            frame_unref(grant->frames[i]);
+    }
+    frame_unref((uint32_t) grant->frames);
+    grant->frames = NULL;
+    grant->pages = 0;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Frees a pipe once both ends are closed.
+ * 
+ ******************************************************************************/
+static void pipe_release(Pipe* pipe) {
+    if (pipe->readers || pipe->writers)
+        return;
+
+    for (uint32_t i = 0; i < PIPE_BUFFER_PAGES; i++) {
+        if (pipe->buffer[i])
+            frame_unref(pipe->buffer[i]);
+        pipe->buffer[i] = 0;
+    }
+    while (pipe->grant_count) {
+        pipe_grant_free(&pipe->grants[pipe->first_grant]);
+        pipe->first_grant = (pipe->first_grant + 1) % PIPE_GRANT_MAX;
+        pipe->grant_count--;
+    }
+    if (pipe->ring)
+        tmpfs_put(pipe->ring);
+    pipe->ring = NULL;
+    pipe->in_use = false;
+}
+
+/**************************************************************************//**
+ * @brief Creates a pipe and its buffer.
+ * 
+ * @return Pipe with one read end and one write end open, NULL if out of
+ * pipes or memory.
+ * 
+ ******************************************************************************/
+Pipe* pipe_create() {
+    uint32_t flags = cpu_irq_save();
+    Pipe* pipe = NULL;
+
+    for (size_t i = 0; i < PIPE_MAX; i++) {
+        if (!pipe_table[i].in_use) {
+            pipe = &pipe_table[i];
+            pipe->in_use = true;
+            break;
+        }
+    }
+    cpu_irq_restore(flags);
+
+    if (!pipe)
+        return NULL;
+
+    memset(pipe->buffer, 0, sizeof(pipe->buffer));
+    pipe->head = 0;
+    pipe->count = 0;
+    pipe->first_grant = 0;
+    pipe->grant_count = 0;
+    pipe->ring = NULL;
+    pipe->read_waiters = NULL;
+    pipe->write_waiters = NULL;
+    pipe->readers = 0;
+    pipe->writers = 0;
+
+    for (uint32_t i = 0; i < PIPE_BUFFER_PAGES; i++) {
+        pipe->buffer[i] = frame_alloc();
+        if (!pipe->buffer[i]) {
+            pipe_release(pipe);
+            return NULL;
+        }
+    }
+    pipe->readers = 1;
+    pipe->writers = 1;
+    return pipe;
+}
+
+/**************************************************************************//**
+ * @brief Opens another read or write end, e.g. for a forked descriptor.
+ * 
+ ******************************************************************************/
+void pipe_get(Pipe* pipe, bool writer) {
+    if (writer)
+        pipe->writers++;
+    else
+        pipe->readers++;
+}
+
+/**************************************************************************//**
+ * @brief Closes a read or write end, freeing the pipe with the last one.
+ * 
+ * Closing the last write end wakes readers to see the end of the data,
+ * closing the last read end wakes writers to fail with -EPIPE.
+ * 
+ ******************************************************************************/
+void pipe_put(Pipe* pipe, bool writer) {
+    if (writer) {
+        if (!--pipe->writers)
+            pipe_wake(&pipe->read_waiters);
+    } else {
+        if (!--pipe->readers)
+            pipe_wake(&pipe->write_waiters);
+    }
+    pipe_release(pipe);
+}
+
+/**************************************************************************//**
+ * @brief Reads buffered bytes from a pipe.
+ * 
+ * Sleeps while the buffer is empty and a write end is open. Bytes are
+ * copied straight into the destination, which may be user memory of the
+ * calling process.
+ * 
+ * @param pipe Pipe to read from.
+ * @param buffer Destination.
+ * @param count Most bytes to read.
+ * @return Bytes read, 0 once the buffer is empty and all write ends are
+ * closed, -EINTR if the thread was killed while waiting for data.
+ * 
+ ******************************************************************************/
+int32_t pipe_read(Pipe* pipe, uint8_t* buffer, uint32_t count) {
+    uint32_t done = 0;
+    uint32_t flags;
+
+    if (!count)
+        return 0;
+
+    flags = cpu_irq_save();
+    while (!pipe->count && pipe->writers) {
+        if (pipe_sleep(&pipe->read_waiters)) {
+            cpu_irq_restore(flags);
+            return -EINTR;
+        }
+    }
+    cpu_irq_restore(flags);
+
+    while (done < count && pipe->count) {
+        uint32_t page_offset = pipe->head % FRAME_SIZE;
+        uint32_t chunk = FRAME_SIZE - page_offset;
+
+        if (chunk > pipe->count)
+            chunk = pipe->count;
+        if (chunk > count - done)
+            chunk = count - done;
+        memcpy(buffer + done, (const uint8_t*) pipe->buffer[pipe->head / FRAME_SIZE] + page_offset, chunk);
+        pipe->head = (pipe->head + chunk) % PIPE_BUFFER_SIZE;
+        pipe->count -= chunk;
+        done += chunk;
+    }
+
+    if (done)
+        pipe_wake(&pipe->write_waiters);
+    return (int32_t) done;
+}
+
+/**************************************************************************//**
+ * @brief Writes bytes into a pipe.
+ * 
+ * Sleeps whenever the buffer is full, until all bytes are written or the
+ * last read end is closed.
+ * 
+ * @param pipe Pipe to write to.
+ * @param buffer Source, may be user memory of the calling process.
+ * @param count Bytes to write.
+ * @return Bytes written, -EPIPE if no read end is open before any were,
+ * -EINTR if the thread was killed before any were.
+ * 
+ ******************************************************************************/
+int32_t pipe_write(Pipe* pipe, const uint8_t* buffer, uint32_t count) {
+    uint32_t done = 0;
+
+    while (done < count) {
+        uint32_t flags = cpu_irq_save();
+
+        while (pipe->count == PIPE_BUFFER_SIZE && pipe->readers) {
+            if (pipe_sleep(&pipe->write_waiters)) {
+                cpu_irq_restore(flags);
+                return done ? (int32_t) done : -EINTR;
+            }
+        }
+        cpu_irq_restore(flags);
+
+        if (!pipe->readers)
+            return done ? (int32_t) done : -EPIPE;
+
+        while (done < count && pipe->count < PIPE_BUFFER_SIZE) {
+            uint32_t tail = (pipe->head + pipe->count) % PIPE_BUFFER_SIZE;
+            uint32_t page_offset = tail % FRAME_SIZE;
+            uint32_t chunk = FRAME_SIZE - page_offset;
+
+            if (chunk > PIPE_BUFFER_SIZE - pipe->count)
+                chunk = PIPE_BUFFER_SIZE - pipe->count;
+            if (chunk > count - done)
+                chunk = count - done;
+            memcpy((uint8_t*) pipe->buffer[tail / FRAME_SIZE] + page_offset, buffer + done, chunk);
+            pipe->count += chunk;
+            done += chunk;
+        }
+        pipe_wake(&pipe->read_waiters);
+    }
+    return (int32_t) done;
+}
+
+/**************************************************************************//**
+ * @brief Moves pages from an address space into a pipe.
+ * 
+ * The range is unmapped from the writer, see vm_take_pages(), and its
+ * frames wait in the pipe for pipe_accept(). Sleeps while PIPE_GRANT_MAX
+ * grants are queued. Grants are a stream of their own, read() never sees
+ * them.
+ * 
+ * @param pipe Pipe to write to.
+ * @param space Address space of the caller.
+ * @param address Start of the range, page aligned.
+ * @param size Size of the range, whole pages, at most PIPE_GRANT_PAGES_MAX.
+ * @return 0 on success, -EINVAL for a bad range, -EPIPE if no read end is
+ * open, -ENOMEM if out of memory, -EINTR if the thread was killed while
+ * waiting for room.
+ * 
+ ******************************************************************************/
+int32_t pipe_grant(Pipe* pipe, AddressSpace* space, uint32_t address, uint32_t size) {
+    uint32_t pages = size / PAGE_SIZE;
+    uint32_t flags;
+    uint32_t* frames;
+    PipeGrant* grant;
+    int error;
+
+    if (!pages || ((address | size) & ~PAGE_MASK) || pages > PIPE_GRANT_PAGES_MAX)
+        return -EINVAL;
+
+    flags = cpu_irq_save();
+    while (pipe->grant_count == PIPE_GRANT_MAX && pipe->readers) {
+        if (pipe_sleep(&pipe->write_waiters)) {
+            cpu_irq_restore(flags);
+            return -EINTR;
+        }
+    }
+    cpu_irq_restore(flags);
+
+    if (!pipe->readers)
+        return -EPIPE;
+
+    frames = (uint32_t*) frame_alloc();
+    if (!frames)
+        return -ENOMEM;
+    error = vm_take_pages(space, address, size, frames);
+    if (error) {
+        frame_unref((uint32_t) frames);
+        return error;
+    }
+
+    grant = &pipe->grants[(pipe->first_grant + pipe->grant_count) % PIPE_GRANT_MAX];
+    grant->frames = frames;
+    grant->pages = pages;
+    pipe->grant_count++;
+    pipe_wake(&pipe->read_waiters);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Maps the oldest grant of a pipe into an address space.
+ * 
+ * Sleeps while no grant is queued and a write end is open. The pages show
+ * up as private read-write memory at the highest free range below limit,
+ * the caller unmaps them like any other.
+ * 
+ * @param pipe Pipe to read from.
+ * @param space Address space of the caller.
+ * @param limit End of the range to map in, see vm_find_free().
+ * @param size Receives the size of the mapping, 0 at the end.
+ * @return Address of the mapping, 0 once no grant is queued and all write
+ * ends are closed, -ENOMEM if there is no room, in which case the grant
+ * stays queued, -EINTR if the thread was killed while waiting.
+ * 
+ ******************************************************************************/
+int32_t pipe_accept(Pipe* pipe, AddressSpace* space, uint32_t limit, uint32_t* size) {
+    uint32_t flags = cpu_irq_save();
+    PipeGrant* grant;
+    uint32_t address;
+    int error;
+
+    *size = 0;
+    while (!pipe->grant_count && pipe->writers) {
+        if (pipe_sleep(&pipe->read_waiters)) {
+            cpu_irq_restore(flags);
+            return -EINTR;
+        }
+    }
+    cpu_irq_restore(flags);
+
+    if (!pipe->grant_count)
+        return 0;
+
+    grant = &pipe->grants[pipe->first_grant];
+    address = vm_find_free(space, grant->pages * PAGE_SIZE, limit);
+    if (!address)
+        return -ENOMEM;
+    error = vm_map_pages(space, address, grant->frames, grant->pages, VM_READ | VM_WRITE);
+    if (error)
+        return error;
+
+    *size = grant->pages * PAGE_SIZE;
+    pipe_grant_free(grant);
+    pipe->first_grant = (pipe->first_grant + 1) % PIPE_GRANT_MAX;
+    pipe->grant_count--;
+    pipe_wake(&pipe->write_waiters);
+    return (int32_t) address;
+}
+
+/**************************************************************************//**
+ * @brief Returns the shared memory of a pipe, creating it if need be.
+ * 
+ * The memory is a file without a name, PIPE_RING_SIZE bytes allocated in
+ * full, that lives as long as the pipe or a mapping of it.
+ * 
+ * @return File to map, the pipe keeps its reference. NULL if out of inodes
+ * or memory.
+ * 
+ ******************************************************************************/
+TmpfsInode* pipe_ring(Pipe* pipe) {
+    if (!pipe->ring)
+        pipe->ring = tmpfs_anonymous(PIPE_RING_SIZE);
+    return pipe->ring;
+}
@@ -0,0 +1,573 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/cpu.h>
+#include <kernel/elf.h>
+#include <kernel/futex.h>
+#include <kernel/init.h>
+#include <kernel/multiboot.h>
+#include <kernel/paging.h>
+#include <kernel/pipe.h>
+#include <kernel/process.h>
+#include <kernel/syscall.h>
+#include <kernel/thread.h>
+#include <kernel/tmpfs.h>
+#include <kernel/usermode.h>
+#include <kernel/vdso.h>
+#include <kernel/vm.h>
+
+#define PROCESS_EXIT_FAULT (-1)
+
+_Static_assert(VDSO_DATA_ADDRESS + PAGE_SIZE < PROCESS_STACK_TOP - PROCESS_STACK_SIZE,
+    "shared data page overlaps the stack");
+
+static Process process_pool[PROCESS_MAX];
+static uint32_t process_next_id = 1;
+
+/**************************************************************************//**
+ * @brief Local function. Takes a free process slot.
+ * 
+ * @return Process with a fresh id and no address space, NULL if none is left.
+ * 
+ ******************************************************************************/
+static Process* process_alloc(const char* name) {
+    uint32_t flags = cpu_irq_save();
+    Process* process = NULL;
+
+    for (size_t i = 0; i < PROCESS_MAX; i++) {
+        if (!process_pool[i].in_use) {
+            process = &process_pool[i];
+            process->in_use = true;
+            process->id = process_next_id++;
+            break;
+        }
+    }
+    cpu_irq_restore(flags);
+
+    if (process) {
+        size_t length = strlen(name);
+
+        if (length > PROCESS_NAME_MAX - 1)
+            length = PROCESS_NAME_MAX - 1;
+        memcpy(process->name, name, length);
+        process->name[length] = '\0';
+        process->space = NULL;
+        process->heap_start = 0;
+        process->brk = 0;
+        process->threads = 0;
+        process->exiting = false;
+        process->exit_status = 0;
+        memset(process->files, 0, sizeof(process->files));
+    }
+    return process;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Drops what a descriptor refers to and frees it.
+ * 
+ ******************************************************************************/
+static void process_file_release(ProcessFile* file) {
+    if (file->inode)
+        tmpfs_put(file->inode);
+    else if (file->pipe)
+        pipe_put(file->pipe, file->flags == SYSCALL_O_WRONLY);
+    file->inode = NULL;
+    file->pipe = NULL;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Finds the lowest free descriptor.
+ * 
+ * @return Free descriptor, NULL if all are in use or the thread has no
+ * process.
+ * 
+ ******************************************************************************/
+static ProcessFile* process_file_alloc(int32_t* fd) {
+    Process* process = process_current();
+
+    if (!process)
+        return NULL;
+
+    for (uint32_t i = SYSCALL_FD_STDERR + 1; i < PROCESS_FILE_MAX; i++) {
+        ProcessFile* file = &process->files[i];
+
+        if (!file->inode && !file->pipe) {
+            *fd = (int32_t) i;
+            return file;
+        }
+    }
+    return NULL;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Returns a process slot, its address space and files.
+ * 
+ ******************************************************************************/
+static void process_free(Process* process) {
+    for (uint32_t fd = 0; fd < PROCESS_FILE_MAX; fd++)
+        process_file_release(&process->files[fd]);
+    if (process->space)
+        vm_space_destroy(process->space);
+    process->space = NULL;
+    process->in_use = false;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Prints the page fault statistics of a process.
+ * 
+ ******************************************************************************/
+static void process_report(const Process* process, int32_t status) {
+    const VmStats* stats = &process->space->stats;
+
+    printf("\nprocess %u (%s) exited with %d: %u page faults (%u file, %u shared, %u zero, %u cow, %u copied), %u released",
+        process->id, process->name, status, stats->faults, stats->file_faults, stats->file_shared,
+        stats->zero_faults, stats->cow_faults, stats->cow_copies, stats->released);
+    if (stats->faults)
+        printf(", avg %llu cycles, max %llu cycles", stats->fault_cycles / stats->faults, stats->fault_cycles_max);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Finds the end of the executable's highest segment.
+ * 
+ ******************************************************************************/
+static uint32_t process_image_end(const AddressSpace* space) {
+    uint32_t end = USER_SPACE_START;
+
+    for (size_t i = 0; i < VM_REGION_MAX; i++) {
+        if (space->regions[i].in_use && space->regions[i].end > end)
+            end = space->regions[i].end;
+    }
+    return end;
+}
+
+/**************************************************************************//**
+ * @brief Local function. First function of a spawned process's main thread.
+ * 
+ ******************************************************************************/
+static void process_start(void* arg) {
+    Process* process = arg;
+
+    usermode_enter(process->entry, PROCESS_STACK_TOP);
+}
+
+/**************************************************************************//**
+ * @brief Local function. First function of a process_fork() child.
+ * 
+ * Returns to user mode with the parent's register state, copied onto this
+ * thread's kernel stack first.
+ * 
+ ******************************************************************************/
+static void process_fork_entry(void* arg) {
+    Process* process = arg;
+    InterruptFrame frame = process->fork_frame;
+
+    usermode_resume(&frame);
+}
+
+/**************************************************************************//**
+ * @brief Local function. First function of a thread from process_thread_create().
+ * 
+ ******************************************************************************/
+static void process_thread_start(void* arg) {
+    Thread* thread = thread_current();
+
+    (void) arg;
+    if (thread->killed)
+        process_thread_exit();
+    usermode_enter(thread->user_entry, thread->user_stack);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Starts the main thread of a process.
+ * 
+ * @return False if no thread is left.
+ * 
+ ******************************************************************************/
+static bool process_start_thread(Process* process, thread_entry_t entry) {
+    Thread* thread = thread_create(process->name, entry, process);
+
+    if (!thread)
+        return false;
+
+    thread->process = process;
+    process->threads = 1;
+    return true;
+}
+
+/**************************************************************************//**
+ * @brief Creates a process from an ELF executable in memory.
+ * 
+ * Only the mappings are set up, the program's pages are faulted in as it
+ * runs. Its stack is PROCESS_STACK_SIZE of demand-zero memory below
+ * PROCESS_STACK_TOP, its heap starts out empty right after the image, and
+ * the shared data page is mapped at VDSO_DATA_ADDRESS.
+ * 
+ * @param name Name for diagnostics, copied.
+ * @param image Executable. Must stay in memory for the life of the process
+ * and its children.
+ * @param size Size of the image in bytes.
+ * @return The new process, runnable, or NULL on failure.
+ * 
+ ******************************************************************************/
+Process* process_spawn(const char* name, const uint8_t* image, uint32_t size) {
+    Process* process = process_alloc(name);
+    int error;
+
+    if (!process)
+        return NULL;
+
+    process->space = vm_space_create();
+    if (!process->space) {
+        process_free(process);
+        return NULL;
+    }
+
+    error = elf_load(process->space, image, size, &process->entry);
+    process->heap_start = process_image_end(process->space);
+    process->brk = process->heap_start;
+    if (!error)
+        error = vm_map_anonymous(process->space, PROCESS_STACK_TOP - PROCESS_STACK_SIZE, PROCESS_STACK_SIZE,
+            VM_READ | VM_WRITE);
+    if (!error)
+        error = vdso_map(process->space);
+    if (error || !process_start_thread(process, process_start)) {
+        printf("\nprocess: cannot start %s (%d)", name, error);
+        process_free(process);
+        return NULL;
+    }
+    return process;
+}
+
+/**************************************************************************//**
+ * @brief Spawns a process for each multiboot module.
+ * 
+ * Modules are named after their command line up to the first space.
+ * 
+ * @param mbi Multiboot information from the bootloader, may be NULL.
+ * 
+ ******************************************************************************/
+__init void process_spawn_modules(const multiboot_info_t* mbi) {
+    if (!mbi || !(mbi->flags & MULTIBOOT_INFO_MODS))
+        return;
+
+    const multiboot_module_t* modules = (const multiboot_module_t*) mbi->mods_addr;
+    for (uint32_t i = 0; i < mbi->mods_count; i++) {
+        char name[PROCESS_NAME_MAX] = "module";
+        const char* cmdline = (const char*) modules[i].cmdline;
+
+        if (cmdline) {
+            size_t length = 0;
+
+            while (cmdline[length] && cmdline[length] != ' ' && length < PROCESS_NAME_MAX - 1) {
+                name[length] = cmdline[length];
+                length++;
+            }
+            name[length] = '\0';
+        }
+
+        if (modules[i].mod_end > KERNEL_SPACE_END) {
+            printf("\nprocess: module %s is not in identity mapped memory", name);
+            continue;
+        }
+        process_spawn(name, (const uint8_t*) modules[i].mod_start, modules[i].mod_end - modules[i].mod_start);
+    }
+}
+
+/**************************************************************************//**
+ * @brief Duplicates the calling process.
+ * 
+ * The child gets a copy-on-write clone of the address space and a single
+ * thread resuming from the same system call, with a result of 0. Open files
+ * and pipe ends are inherited, files each side with an offset of its own.
+ * 
+ * @param frame User register state of the calling thread.
+ * @return Child process id, -EINVAL from a thread without a process,
+ * -EAGAIN if no process or thread is left, -ENOMEM if out of memory.
+ * 
+ ******************************************************************************/
+int32_t process_fork(const InterruptFrame* frame) {
+    Process* parent = process_current();
+    Process* child;
+
+    if (!parent)
+        return -EINVAL;
+
+    child = process_alloc(parent->name);
+    if (!child)
+        return -EAGAIN;
+
+    child->space = vm_space_clone(parent->space);
+    if (!child->space) {
+        process_free(child);
+        return -ENOMEM;
+    }
+
+    child->entry = parent->entry;
+    child->heap_start = parent->heap_start;
+    child->brk = parent->brk;
+    child->fork_frame = *frame;
+    child->fork_frame.eax = 0;
+    for (size_t i = 0; i < PROCESS_FILE_MAX; i++) {
+        child->files[i] = parent->files[i];
+        if (child->files[i].inode)
+            tmpfs_get(child->files[i].inode);
+        else if (child->files[i].pipe)
+            pipe_get(child->files[i].pipe, child->files[i].flags == SYSCALL_O_WRONLY);
+    }
+    if (!process_start_thread(child, process_fork_entry)) {
+        process_free(child);
+        return -EAGAIN;
+    }
+    return child->id;
+}
+
+/**************************************************************************//**
+ * @brief Starts another thread in the calling process.
+ * 
+ * The thread shares everything with its creator and enters ring 3 at entry
+ * on the given stack, with no registers set up beyond that. When it exits
+ * while other threads remain, its exit word is set to 0 and the threads
+ * sleeping on it are woken, see futex_store_wake(), so a joining thread
+ * knows the stack is no longer in use.
+ * 
+ * @param entry User address to start at.
+ * @param stack Initial user stack pointer.
+ * @param exit_word User address of a 4-byte aligned word, 0 for none.
+ * @return Id of the new thread, -EINVAL from a thread without a process or
+ * for an address outside user space, -EAGAIN if no thread is left.
+ * 
+ ******************************************************************************/
+int32_t process_thread_create(uint32_t entry, uint32_t stack, uint32_t exit_word) {
+    Process* process = process_current();
+    Thread* thread;
+
+    if (!process || entry < USER_SPACE_START || entry >= USER_SPACE_END
+        || stack <= USER_SPACE_START || stack > USER_SPACE_END
+        || (exit_word && (exit_word < USER_SPACE_START || exit_word >= USER_SPACE_END)))
+        return -EINVAL;
+
+    thread = thread_create(process->name, process_thread_start, NULL);
+    if (!thread)
+        return -EAGAIN;
+
+    thread->process = process;
+    thread->user_entry = entry;
+    thread->user_stack = stack;
+    thread->exit_word = exit_word;
+    process->threads++;
+    return (int32_t) thread->id;
+}
+
+/**************************************************************************//**
+ * @brief Moves the end of the calling process's heap, see sbrk().
+ * 
+ * The heap is a single demand-zero region from heap_start up to the break,
+ * rounded up to whole pages. Shrinking it frees the pages cut off.
+ * 
+ * @param address New break, 0 to only query the current one.
+ * @return The break after the call, -EINVAL from a thread without a
+ * process, -ENOMEM if the heap cannot move there.
+ * 
+ ******************************************************************************/
+int32_t process_brk(uint32_t address) {
+    Process* process = process_current();
+    int error;
+
+    if (!process)
+        return -EINVAL;
+    if (!address)
+        return (int32_t) process->brk;
+    if (address < process->heap_start || address > PROCESS_MMAP_TOP)
+        return -ENOMEM;
+
+    error = vm_resize(process->space, process->heap_start, address);
+    if (error)
+        return -ENOMEM;
+    process->brk = address;
+    return (int32_t) address;
+}
+
+/**************************************************************************//**
+ * @brief Gives an open file a descriptor in the calling process.
+ * 
+ * @param inode File, whose reference the descriptor takes over.
+ * @param flags SYSCALL_O_* access mode and SYSCALL_O_APPEND.
+ * @return Lowest free descriptor, -EMFILE if all are in use.
+ * 
+ ******************************************************************************/
+int32_t process_file_open(TmpfsInode* inode, uint32_t flags) {
+    int32_t fd;
+    ProcessFile* file = process_file_alloc(&fd);
+
+    if (!file)
+        return -EMFILE;
+    file->inode = inode;
+    file->offset = 0;
+    file->flags = flags;
+    return fd;
+}
+
+/**************************************************************************//**
+ * @brief Gives a pipe end a descriptor in the calling process.
+ * 
+ * @param pipe Pipe, whose end the descriptor takes over.
+ * @param writer The write end, otherwise the read end.
+ * @return Lowest free descriptor, -EMFILE if all are in use.
+ * 
+ ******************************************************************************/
+int32_t process_pipe_open(Pipe* pipe, bool writer) {
+    int32_t fd;
+    ProcessFile* file = process_file_alloc(&fd);
+
+    if (!file)
+        return -EMFILE;
+    file->pipe = pipe;
+    file->offset = 0;
+    file->flags = writer ? SYSCALL_O_WRONLY : SYSCALL_O_RDONLY;
+    return fd;
+}
+
+/**************************************************************************//**
+ * @brief Looks up an open file of the calling process.
+ * 
+ * @param fd Descriptor.
+ * @return Open file, NULL for a descriptor that is not.
+ * 
+ ******************************************************************************/
+ProcessFile* process_file(uint32_t fd) {
+    Process* process = process_current();
+
+    if (!process || fd >= PROCESS_FILE_MAX || (!process->files[fd].inode && !process->files[fd].pipe))
+        return NULL;
+    return &process->files[fd];
+}
+
+/**************************************************************************//**
+ * @brief Closes a descriptor of the calling process.
+ * 
+ * @param fd Descriptor.
+ * @return 0 on success, -EBADF for a descriptor that is not open.
+ * 
+ ******************************************************************************/
+int process_file_close(uint32_t fd) {
+    ProcessFile* file = process_file(fd);
+
+    if (!file)
+        return -EBADF;
+    process_file_release(file);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the process of the running thread.
+ * 
+ * @return Running process, NULL in kernel threads.
+ * 
+ ******************************************************************************/
+Process* process_current() {
+    Thread* thread = thread_current();
+
+    return thread ? thread->process : NULL;
+}
+
+/**************************************************************************//**
+ * @brief Yields until every process has exited.
+ * 
+ ******************************************************************************/
+void process_wait_all() {
+    for (;;) {
+        bool alive = false;
+
+        for (size_t i = 0; i < PROCESS_MAX; i++)
+            alive |= process_pool[i].in_use;
+        if (!alive)
+            return;
+        thread_yield();
+    }
+}
+
+/**************************************************************************//**
+ * @brief Local function. Ends the running thread and, with its last thread,
+ * its process.
+ * 
+ * The page fault statistics are reported when the process ends, with the
+ * status from process_exit(). A thread that leaves others behind in a
+ * process that is not exiting clears and wakes its exit word first, see
+ * process_thread_create(). From a kernel thread this is thread_exit().
+ * 
+ ******************************************************************************/
+__attribute__((__noreturn__)) static void process_end_thread() {
+    Thread* thread = thread_current();
+    Process* process = thread->process;
+
+    if (process && !process->exiting && process->threads > 1 && thread->exit_word)
+        futex_store_wake(process->space, thread->exit_word, 0, UINT32_MAX);
+
+    cpu_irq_save();
+
+    if (process) {
+        thread->process = NULL;
+        if (--process->threads == 0) {
+            process_report(process, process->exit_status);
+            process_free(process);
+        }
+    }
+    thread_exit();
+}
+
+/**************************************************************************//**
+ * @brief Terminates the calling process, all of its threads.
+ * 
+ * Only the first call records its status, a thread that exits later, or
+ * faults, on the way out cannot replace it. The other threads are killed,
+ * see thread_kill(), and end themselves once they get to run, the last
+ * one frees the process. From a kernel thread this is thread_exit().
+ * 
+ * @param status Exit status.
+ * 
+ ******************************************************************************/
+void process_exit(int32_t status) {
+    Process* process = process_current();
+
+    if (process) {
+        if (!process->exiting) {
+            process->exiting = true;
+            process->exit_status = status;
+        }
+        thread_kill(process);
+    }
+    process_end_thread();
+}
+
+/**************************************************************************//**
+ * @brief Terminates only the running thread.
+ * 
+ * The process goes on with its other threads. When the last one leaves
+ * this way, the process ends with status 0, unless it is already exiting.
+ * 
+ ******************************************************************************/
+void process_thread_exit() {
+    process_end_thread();
+}
+
+/**************************************************************************//**
+ * @brief Kills the running thread's process, all of its threads, after an
+ * exception it caused.
+ * 
+ * @param frame Register state at the exception.
+ * @param description Name of the exception.
+ * 
+ ******************************************************************************/
+void process_fault(const InterruptFrame* frame, const char* description) {
+    Process* process = process_current();
+
+    if (process)
+        printf("\n%s in process %u (%s) at eip %x", description, process->id, process->name, frame->eip);
+    else
+        printf("\n%s in thread %s at eip %x", description, thread_current()->name, frame->eip);
+    process_exit(PROCESS_EXIT_FAULT);
+}
@@ -0,0 +1,153 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <kernel/pio.h>
+#include <kernel/profile.h>
+
+/*
+ * Function call profile for the link order, see layout.sh. Builds with
+ * KERNEL_PROFILE=1 compile the kernel with -finstrument-functions, so every
+ * function entry calls __cyg_profile_func_enter(). Call counts go into an
+ * open addressing hash table keyed by function address. Nothing in here may
+ * be instrumented itself, including inline functions from headers.
+ */
+#define PROFILE_NO_HOOK __attribute__((no_instrument_function))
+
+#ifdef KERNEL_PROFILE
+
+#define PROFILE_BITS 10
+#define PROFILE_SLOTS (1 << PROFILE_BITS)
+
+typedef struct ProfileSlot {
+    uint32_t function;
+    uint32_t calls;
+} ProfileSlot;
+
+static ProfileSlot profile_slots[PROFILE_SLOTS];
+static volatile bool profile_active;
+static uint32_t profile_dropped; // calls lost to a full table
+
+/**************************************************************************//**
+ * @brief Counts a function entry. Called by compiler generated code.
+ * 
+ * Interrupts are disabled around the update with plain instructions, since
+ * the helpers in cpu.h would be instrumented themselves.
+ * 
+ ******************************************************************************/
+PROFILE_NO_HOOK void __cyg_profile_func_enter(void* function, void* call_site) {
+    uint32_t key = (uint32_t) function;
+    uint32_t index = ((key >> 2) * 2654435761U) >> (32 - PROFILE_BITS);
+    uint32_t flags;
+
+    (void) call_site;
+    if (!profile_active)
+        return;
+
+    asm volatile("PUSHF\n\t"
+        "POP %0\n\t"
+        "CLI\n\t"
+        : "=r" (flags) : : "memory");
+
+    uint32_t probe;
+    for (probe = 0; probe < PROFILE_SLOTS; probe++) {
+        ProfileSlot* slot = &profile_slots[(index + probe) & (PROFILE_SLOTS - 1)];
+
+        if (slot->function == key || !slot->function) {
+            slot->function = key;
+            slot->calls++;
+            break;
+        }
+    }
+    if (probe == PROFILE_SLOTS)
+        profile_dropped++;
+
+    asm volatile("PUSH %0\n\t"
+        "POPF\n\t"
+        : : "r" (flags) : "memory", "cc");
+}
+
+/**************************************************************************//**
+ * @brief Function exit hook, unused.
+ * 
+ ******************************************************************************/
+PROFILE_NO_HOOK void __cyg_profile_func_exit(void* function, void* call_site) {
+    (void) function;
+    (void) call_site;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Writes a string to the debug console.
+ * 
+ ******************************************************************************/
+static PROFILE_NO_HOOK void profile_write(const char* string) {
+    while (*string)
+        outb(*string++, PROFILE_PORT);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Writes a number to the debug console.
+ * 
+ ******************************************************************************/
+static PROFILE_NO_HOOK void profile_write_number(uint32_t value, uint32_t base) {
+    char digits[11];
+    size_t length = 0;
+
+    do {
+        digits[length++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value);
+    while (length)
+        outb(digits[--length], PROFILE_PORT);
+}
+
+#endif // KERNEL_PROFILE
+
+/**************************************************************************//**
+ * @brief Starts counting function calls.
+ * 
+ * Called once booting is done, so the profile reflects steady state rather
+ * than __init code. Does nothing unless built with KERNEL_PROFILE=1.
+ * 
+ ******************************************************************************/
+PROFILE_NO_HOOK void profile_start() {
+#ifdef KERNEL_PROFILE
+    profile_active = true;
+#endif
+}
+
+/**************************************************************************//**
+ * @brief Stops counting and dumps the profile to the debug console.
+ * 
+ * Each line holds a function address and its call count in hex and decimal,
+ * between "profile begin" and "profile end" lines. layout.sh turns the
+ * addresses into names. Does nothing unless built with KERNEL_PROFILE=1.
+ * 
+ ******************************************************************************/
+PROFILE_NO_HOOK void profile_report() {
+#ifdef KERNEL_PROFILE
+    uint32_t functions = 0;
+    uint32_t calls = 0;
+
+    profile_active = false;
+
+    profile_write("profile begin\n");
+    for (size_t i = 0; i < PROFILE_SLOTS; i++) {
+        ProfileSlot* slot = &profile_slots[i];
+
+        if (!slot->function)
+            continue;
+        functions++;
+        calls += slot->calls;
+        profile_write_number(slot->function, 16);
+        profile_write(" ");
+        profile_write_number(slot->calls, 10);
+        profile_write("\n");
+    }
+    profile_write("profile end\n");
+
+    printf("\nprofile: %u functions, %u calls, %u dropped, written to port %x",
+        functions, calls, profile_dropped, PROFILE_PORT);
+#endif
+}
@@ -0,0 +1,339 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <kernel/cpu.h>
+#include <kernel/init.h>
+#include <kernel/softirq.h>
+#include <kernel/thread.h>
+#include <kernel/tsc.h>
+#include <kernel/tty.h>
+
+#define SOFTIRQ_MAX_RESTART 10   // passes over the pending bitmap per run
+#define SOFTIRQ_BUDGET_US 2000   // time per run before handing over to ksoftirqd
+#define SOFTIRQ_TASKLET_BUDGET 64 // tasklets per queue and pass
+
+typedef struct SoftirqStats {
+    uint32_t raised;
+    uint32_t runs;
+    uint64_t cycles;
+    uint64_t max_cycles;
+} SoftirqStats;
+
+typedef struct TaskletQueue {
+    Tasklet* head;
+    Tasklet** tail;
+} TaskletQueue;
+
+typedef struct SoftirqCpu {
+    volatile uint32_t pending; // bit per softirq class
+    uint32_t irq_depth;        // hardware interrupts being handled
+    bool active;               // softirqs running, on this stack or another
+    TaskletQueue hi_tasklets;
+    TaskletQueue tasklets;
+    Thread* ksoftirqd;
+    uint32_t deferred;         // runs that ran out of budget
+    SoftirqStats stats[SOFTIRQ_COUNT];
+} SoftirqCpu;
+
+static const char* const softirq_names[SOFTIRQ_COUNT] = {
+    [SOFTIRQ_HI_TASKLET] = "hi-tasklet",
+    [SOFTIRQ_TIMER] = "timer",
+    [SOFTIRQ_BLOCK] = "block",
+    [SOFTIRQ_TASKLET] = "tasklet",
+};
+
+static softirq_handler_t softirq_handlers[SOFTIRQ_COUNT];
+static SoftirqCpu softirq_cpus[CPU_MAX];
+static uint64_t softirq_budget_cycles;
+
+/**************************************************************************//**
+ * @brief Local function. Runs pending softirqs of the running CPU.
+ * 
+ * Each pass takes a snapshot of the pending bitmap and runs every class in
+ * it once, in class order, with interrupts enabled. Work raised meanwhile,
+ * even by a handler for its own class, waits for the next pass, so a busy
+ * class cannot starve the others. After SOFTIRQ_MAX_RESTART passes or
+ * SOFTIRQ_BUDGET_US, whatever is left goes to ksoftirqd, which competes
+ * with the other threads. Must be called with interrupts disabled.
+ * 
+ ******************************************************************************/
+static void softirq_run(SoftirqCpu* cpu) {
+    uint64_t deadline = tsc_read() + softirq_budget_cycles;
+    uint32_t restart = SOFTIRQ_MAX_RESTART;
+    uint32_t pending;
+
+    cpu->active = true;
+    while ((pending = cpu->pending)) {
+        cpu->pending = 0;
+        cpu_irq_enable();
+
+        while (pending) {
+            uint32_t nr = __builtin_ctz(pending);
+            SoftirqStats* stats = &cpu->stats[nr];
+            uint64_t start = tsc_read();
+
+            pending &= pending - 1;
+            softirq_handlers[nr]();
+
+            uint64_t cycles = tsc_read() - start;
+            stats->runs++;
+            stats->cycles += cycles;
+            if (cycles > stats->max_cycles)
+                stats->max_cycles = cycles;
+        }
+
+        cpu_irq_disable();
+        if (--restart == 0 || tsc_read() >= deadline)
+            break;
+    }
+    cpu->active = false;
+
+    if (cpu->pending && cpu->ksoftirqd) {
+        cpu->deferred++;
+        thread_wake(cpu->ksoftirqd);
+    }
+}
+
+/**************************************************************************//**
+ * @brief Local function. Body of the per-CPU ksoftirqd thread.
+ * 
+ * Sleeps until softirqs are raised outside of interrupts or a run from
+ * softirq_irq_exit() runs out of budget.
+ * 
+ ******************************************************************************/
+static void softirq_thread(void* arg) {
+    SoftirqCpu* cpu = arg;
+
+    for (;;) {
+        uint32_t flags = cpu_irq_save();
+
+        if (!cpu->pending)
+            thread_block();
+        if (cpu->pending && !cpu->active)
+            softirq_run(cpu);
+
+        cpu_irq_restore(flags);
+        thread_yield();
+    }
+}
+
+/**************************************************************************//**
+ * @brief Local function. Runs the tasklets queued for one softirq class.
+ * 
+ * The queue is detached first, so tasklets scheduled while running wait for
+ * the next pass. Past SOFTIRQ_TASKLET_BUDGET the rest is requeued.
+ * 
+ ******************************************************************************/
+static void tasklet_action(TaskletQueue* queue, uint32_t nr) {
+    uint32_t flags = cpu_irq_save();
+    Tasklet* list = queue->head;
+    uint32_t budget = SOFTIRQ_TASKLET_BUDGET;
+
+    queue->head = NULL;
+    queue->tail = &queue->head;
+    cpu_irq_restore(flags);
+
+    while (list) {
+        Tasklet* tasklet = list;
+
+        if (!budget--) {
+            Tasklet* last = list;
+
+            while (last->next)
+                last = last->next;
+            flags = cpu_irq_save();
+            *queue->tail = list;
+            queue->tail = &last->next;
+            softirq_raise(nr);
+            cpu_irq_restore(flags);
+            return;
+        }
+
+        list = tasklet->next;
+        flags = cpu_irq_save();
+        tasklet->state = (tasklet->state & ~TASKLET_SCHEDULED) | TASKLET_RUNNING;
+        cpu_irq_restore(flags);
+
+        tasklet->func(tasklet->data);
+
+        flags = cpu_irq_save();
+        tasklet->state &= ~TASKLET_RUNNING;
+        cpu_irq_restore(flags);
+    }
+}
+
+/**************************************************************************//**
+ * @brief Local function. SOFTIRQ_HI_TASKLET handler.
+ * 
+ ******************************************************************************/
+static void tasklet_hi_softirq() {
+    tasklet_action(&softirq_cpus[cpu_id()].hi_tasklets, SOFTIRQ_HI_TASKLET);
+}
+
+/**************************************************************************//**
+ * @brief Local function. SOFTIRQ_TASKLET handler.
+ * 
+ ******************************************************************************/
+static void tasklet_softirq() {
+    tasklet_action(&softirq_cpus[cpu_id()].tasklets, SOFTIRQ_TASKLET);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Queues a tasklet and raises its softirq class.
+ * 
+ ******************************************************************************/
+static void tasklet_enqueue(Tasklet* tasklet, TaskletQueue* queue, uint32_t nr) {
+    uint32_t flags = cpu_irq_save();
+
+    if (!(tasklet->state & TASKLET_SCHEDULED)) {
+        tasklet->state |= TASKLET_SCHEDULED;
+        tasklet->next = NULL;
+        *queue->tail = tasklet;
+        queue->tail = &tasklet->next;
+        softirq_raise(nr);
+    }
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Initializes softirqs, tasklets and the ksoftirqd threads.
+ * 
+ * Must run after thread_init() and before any softirq class is registered.
+ * 
+ ******************************************************************************/
+__init void softirq_init() {
+    softirq_budget_cycles = (uint64_t) tsc_khz() * SOFTIRQ_BUDGET_US / 1000;
+
+    for (size_t i = 0; i < CPU_MAX; i++) {
+        SoftirqCpu* cpu = &softirq_cpus[i];
+
+        cpu->pending = 0;
+        cpu->irq_depth = 0;
+        cpu->active = false;
+        cpu->hi_tasklets.head = NULL;
+        cpu->hi_tasklets.tail = &cpu->hi_tasklets.head;
+        cpu->tasklets.head = NULL;
+        cpu->tasklets.tail = &cpu->tasklets.head;
+        cpu->ksoftirqd = thread_create("ksoftirqd", softirq_thread, cpu);
+    }
+
+    softirq_register(SOFTIRQ_HI_TASKLET, tasklet_hi_softirq);
+    softirq_register(SOFTIRQ_TASKLET, tasklet_softirq);
+
+    term_writestring("\nSoftirqs initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Sets the handler of a softirq class.
+ * 
+ * @param nr Softirq class, SOFTIRQ_*.
+ * @param handler Called with interrupts enabled, outside of any thread. Must
+ * not block or yield.
+ * 
+ ******************************************************************************/
+void softirq_register(uint32_t nr, softirq_handler_t handler) {
+    softirq_handlers[nr] = handler;
+}
+
+/**************************************************************************//**
+ * @brief Marks a softirq class pending on the running CPU.
+ * 
+ * From an interrupt handler, it runs once the interrupt is acknowledged.
+ * Otherwise ksoftirqd is woken, unless the next interrupt gets there first.
+ * 
+ * @param nr Softirq class, SOFTIRQ_*.
+ * 
+ ******************************************************************************/
+void softirq_raise(uint32_t nr) {
+    uint32_t flags = cpu_irq_save();
+    SoftirqCpu* cpu = &softirq_cpus[cpu_id()];
+
+    cpu->pending |= 1U << nr;
+    cpu->stats[nr].raised++;
+    if (!cpu->irq_depth && !cpu->active && cpu->ksoftirqd)
+        thread_wake(cpu->ksoftirqd);
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Notes the start of a hardware interrupt, see idt_dispatch().
+ * 
+ ******************************************************************************/
+void softirq_irq_enter() {
+    softirq_cpus[cpu_id()].irq_depth++;
+}
+
+/**************************************************************************//**
+ * @brief Runs pending softirqs at the end of a hardware interrupt.
+ * 
+ * Called by idt_dispatch() after the EOI, with interrupts disabled. Skipped
+ * if softirqs are already running underneath this interrupt.
+ * 
+ ******************************************************************************/
+void softirq_irq_exit() {
+    SoftirqCpu* cpu = &softirq_cpus[cpu_id()];
+
+    cpu->irq_depth--;
+    if (!cpu->irq_depth && cpu->pending && !cpu->active)
+        softirq_run(cpu);
+}
+
+/**************************************************************************//**
+ * @brief Prints the deferred work statistics of each CPU.
+ * 
+ ******************************************************************************/
+void softirq_report() {
+    for (size_t i = 0; i < CPU_MAX; i++) {
+        SoftirqCpu* cpu = &softirq_cpus[i];
+
+        for (size_t nr = 0; nr < SOFTIRQ_COUNT; nr++) {
+            SoftirqStats* stats = &cpu->stats[nr];
+
+            if (!stats->raised)
+                continue;
+            printf("\nsoftirq: cpu %u %s: raised %u, ran %u, %llu us total, max %llu cycles",
+                i, softirq_names[nr], stats->raised, stats->runs, tsc_cycles_to_us(stats->cycles),
+                stats->max_cycles);
+        }
+        printf("\nsoftirq: cpu %u: %u runs deferred to ksoftirqd", i, cpu->deferred);
+    }
+}
+
+/**************************************************************************//**
+ * @brief Prepares a tasklet for tasklet_schedule().
+ * 
+ * @param tasklet Tasklet to initialize.
+ * @param func Function to run.
+ * @param data Argument handed to func.
+ * 
+ ******************************************************************************/
+void tasklet_init(Tasklet* tasklet, tasklet_func_t func, void* data) {
+    tasklet->next = NULL;
+    tasklet->func = func;
+    tasklet->data = data;
+    tasklet->state = 0;
+}
+
+/**************************************************************************//**
+ * @brief Queues a tasklet on the running CPU, if it is not queued already.
+ * 
+ * @param tasklet Tasklet from tasklet_init().
+ * 
+ ******************************************************************************/
+void tasklet_schedule(Tasklet* tasklet) {
+    tasklet_enqueue(tasklet, &softirq_cpus[cpu_id()].tasklets, SOFTIRQ_TASKLET);
+}
+
+/**************************************************************************//**
+ * @brief Queues a tasklet that runs ahead of timers and block completions.
+ * 
+ * @param tasklet Tasklet from tasklet_init().
+ * 
+ ******************************************************************************/
+void tasklet_hi_schedule(Tasklet* tasklet) {
+    tasklet_enqueue(tasklet, &softirq_cpus[cpu_id()].hi_tasklets, SOFTIRQ_HI_TASKLET);
+}
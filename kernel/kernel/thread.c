@@ -0,0 +1,280 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <kernel/cpu.h>
+#include <kernel/fpu.h>
+#include <kernel/gdt.h>
+#include <kernel/idle.h>
+#include <kernel/init.h>
+#include <kernel/process.h>
+#include <kernel/thread.h>
+#include <kernel/tty.h>
+
+// Slot 0 is the boot thread, which keeps running on the stack from boot.S
+#define THREAD_BOOT 0
+
+extern void thread_switch_context(uint32_t* save_esp, uint32_t load_esp);
+extern void thread_trampoline();
+
+static Thread thread_pool[THREAD_MAX] __attribute__((aligned(16)));
+static uint8_t thread_stacks[THREAD_MAX][THREAD_STACK_SIZE] __attribute__((aligned(16)));
+static Thread* thread_running;
+static Thread* thread_run_head;
+static Thread* thread_run_tail;
+static uint32_t thread_next_id;
+
+/**************************************************************************//**
+ * @brief Local function. Appends a thread to the run queue.
+ * 
+ ******************************************************************************/
+static void thread_enqueue(Thread* thread) {
+    thread->state = THREAD_RUNNABLE;
+    thread->next = NULL;
+    if (thread_run_tail)
+        thread_run_tail->next = thread;
+    else
+        thread_run_head = thread;
+    thread_run_tail = thread;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Removes the first thread from the run queue.
+ * 
+ * @return Next thread to run, or NULL if none is runnable.
+ * 
+ ******************************************************************************/
+static Thread* thread_dequeue() {
+    Thread* thread = thread_run_head;
+
+    if (thread) {
+        thread_run_head = thread->next;
+        if (!thread_run_head)
+            thread_run_tail = NULL;
+        thread->next = NULL;
+    }
+    return thread;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Switches from the running thread to another one.
+ * 
+ * Must be called with interrupts disabled. The FPU is not switched here,
+ * fpu_switch() only arms the lazy restore in the #NM handler. Threads of a
+ * process get its address space loaded, kernel threads run on whichever is
+ * active since the kernel mappings are the same in all of them. The TSS is
+ * pointed at the new thread's kernel stack for entries from ring 3.
+ * 
+ * @param next Thread to run.
+ * 
+ ******************************************************************************/
+static void thread_switch_to(Thread* next) {
+    Thread* prev = thread_running;
+
+    if (next == prev) {
+        next->state = THREAD_RUNNING;
+        return;
+    }
+
+    thread_running = next;
+    next->state = THREAD_RUNNING;
+    fpu_switch(prev, next);
+    if (next->process)
+        vm_space_activate(next->process->space);
+    if (next->stack)
+        gdt_set_kernel_stack((uint32_t) (next->stack + THREAD_STACK_SIZE));
+    thread_switch_context(&prev->esp, next->esp);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Switches to the next runnable thread.
+ * 
+ * Must be called with interrupts disabled, after the running thread was
+ * requeued or left its runnable state. If nothing is runnable, the CPU
+ * idles until an interrupt wakes a thread, see idle_enter().
+ * 
+ ******************************************************************************/
+static void thread_schedule() {
+    Thread* next;
+
+    while (!(next = thread_dequeue()))
+        idle_enter();
+    thread_switch_to(next);
+}
+
+/**************************************************************************//**
+ * @brief Initializes threading, adopting the caller as the boot thread.
+ *              
+ ******************************************************************************/
+__init void thread_init() {
+    memset(thread_pool, 0, sizeof(thread_pool));
+
+    thread_run_head = NULL;
+    thread_run_tail = NULL;
+    thread_next_id = 0;
+
+    thread_running = &thread_pool[THREAD_BOOT];
+    thread_running->id = thread_next_id++;
+    thread_running->name = "boot";
+    thread_running->state = THREAD_RUNNING;
+
+    term_writestring("\nThreads initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Creates a kernel thread and makes it runnable.
+ * 
+ * @param name Name for diagnostics. Not copied.
+ * @param entry Function the thread starts in. Returning from it exits the thread.
+ * @param arg Argument handed to entry.
+ * @return New thread, or NULL if THREAD_MAX threads already exist.
+ *              
+ ******************************************************************************/
+Thread* thread_create(const char* name, thread_entry_t entry, void* arg) {
+    uint32_t flags = cpu_irq_save();
+    Thread* thread = NULL;
+
+    for (size_t i = 0; i < THREAD_MAX; i++) {
+        if (i == THREAD_BOOT)
+            continue;
+        if (thread_pool[i].state == THREAD_UNUSED || thread_pool[i].state == THREAD_DEAD) {
+            thread = &thread_pool[i];
+            thread->stack = thread_stacks[i];
+            break;
+        }
+    }
+
+    if (!thread) {
+        cpu_irq_restore(flags);
+        return NULL;
+    }
+
+    thread->id = thread_next_id++;
+    thread->name = name;
+    thread->fpu_used = false;
+    thread->process = NULL;
+    thread->syscall_frame = NULL;
+    thread->user_entry = 0;
+    thread->user_stack = 0;
+    thread->exit_word = 0;
+    thread->killed = false;
+
+    // Initial frame popped by thread_switch_context(), see switch.S
+    uint32_t* sp = (uint32_t*) (thread->stack + THREAD_STACK_SIZE);
+    *--sp = (uint32_t) thread_trampoline;
+    *--sp = 0;                  // ebp
+    *--sp = (uint32_t) entry;   // ebx
+    *--sp = (uint32_t) arg;     // esi
+    *--sp = 0;                  // edi
+    thread->esp = (uint32_t) sp;
+
+    thread_enqueue(thread);
+    idle_kick();
+
+    cpu_irq_restore(flags);
+    return thread;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the running thread.
+ * 
+ * @return Running thread, NULL before thread_init().
+ * 
+ ******************************************************************************/
+Thread* thread_current() {
+    return thread_running;
+}
+
+/**************************************************************************//**
+ * @brief Gives up the CPU to the next runnable thread, if any.
+ *              
+ ******************************************************************************/
+void thread_yield() {
+    uint32_t flags = cpu_irq_save();
+    Thread* next = thread_dequeue();
+
+    if (next) {
+        thread_enqueue(thread_running);
+        thread_switch_to(next);
+    }
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Puts the running thread to sleep until thread_wake().
+ * 
+ * To avoid lost wake-ups, callers disable interrupts, check their wait
+ * condition and only then block.
+ *              
+ ******************************************************************************/
+void thread_block() {
+    uint32_t flags = cpu_irq_save();
+
+    thread_running->state = THREAD_BLOCKED;
+    thread_schedule();
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Makes a blocked thread runnable again.
+ * 
+ * Safe from interrupt handlers. Threads that are not blocked are left alone.
+ * 
+ * @param thread Thread to wake.
+ *              
+ ******************************************************************************/
+void thread_wake(Thread* thread) {
+    uint32_t flags = cpu_irq_save();
+
+    if (thread->state == THREAD_BLOCKED) {
+        thread_enqueue(thread);
+        idle_kick();
+    }
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Marks every other thread of a process killed and wakes it.
+ * 
+ * Sleeps that a killed thread can be in give up, see futex_wait(), and the
+ * thread ends itself on its way back to user mode, see syscall_dispatch().
+ * The running thread is left alone.
+ * 
+ * @param process Process whose threads to kill.
+ * 
+ ******************************************************************************/
+void thread_kill(struct Process* process) {
+    uint32_t flags = cpu_irq_save();
+
+    for (size_t i = 0; i < THREAD_MAX; i++) {
+        Thread* thread = &thread_pool[i];
+
+        if (thread == thread_running || thread->process != process || thread->state == THREAD_UNUSED
+            || thread->state == THREAD_DEAD)
+            continue;
+        thread->killed = true;
+        thread_wake(thread);
+    }
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Terminates the running thread.
+ * 
+ * Its slot is reused by a later thread_create(). The boot thread must not
+ * exit.
+ *              
+ ******************************************************************************/
+void thread_exit() {
+    cpu_irq_save();
+
+    thread_running->state = THREAD_DEAD;
+    fpu_thread_exit(thread_running);
+
+    thread_schedule();
+    __builtin_unreachable();
+}
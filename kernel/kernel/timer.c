@@ -0,0 +1,463 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <kernel/cpu.h>
+#include <kernel/init.h>
+#include <kernel/pit.h>
+#include <kernel/softirq.h>
+#include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <kernel/tsc.h>
+#include <kernel/tty.h>
+
+/*
+ * Hierarchical timing wheel. The root level has one bucket per jiffy for
+ * the next 256 jiffies, each further level covers 64 times the span of the
+ * one below with buckets as wide as that whole level. Insert and cancel
+ * are O(1). Whenever the root wraps, the next bucket of level 1 is spread
+ * over the root, and so on upwards (cascading). 8 + 4 * 6 bits cover 2^32
+ * jiffies, later timers are parked in the last level.
+ */
+#define TIMER_ROOT_BITS 8
+#define TIMER_ROOT_SIZE (1 << TIMER_ROOT_BITS)
+#define TIMER_ROOT_MASK (TIMER_ROOT_SIZE - 1)
+#define TIMER_LEVEL_BITS 6
+#define TIMER_LEVEL_SIZE (1 << TIMER_LEVEL_BITS)
+#define TIMER_LEVEL_MASK (TIMER_LEVEL_SIZE - 1)
+#define TIMER_LEVELS 4
+#define TIMER_BUCKETS (TIMER_ROOT_SIZE + TIMER_LEVELS * TIMER_LEVEL_SIZE)
+
+#define TIMER_BENCH_COUNT 4096
+#define TIMER_BENCH_IDLE_MS 100
+#define TIMER_BENCH_SLEEPERS 4
+
+typedef struct TimerStats {
+    uint32_t interrupts;
+    uint32_t runs;      // bottom half passes
+    uint32_t expired;
+    uint32_t cascaded;  // timers moved down a level
+    uint32_t max_batch; // most timers expired in one pass
+} TimerStats;
+
+static Timer* timer_buckets[TIMER_BUCKETS];
+static uint32_t timer_bitmap[TIMER_BUCKETS / 32]; // non-empty buckets
+static uint64_t timer_clk;      // next jiffy to expire
+static uint64_t timer_deadline; // jiffy the clock interrupt is programmed for
+static uint64_t timer_deadline_tsc; // TSC of a one-shot clock interrupt, 0 while periodic
+static uint64_t timer_fired_tsc;    // TSC on entry to the last clock interrupt
+static uint64_t timer_tsc_base;
+static uint32_t timer_cycles_per_jiffy;
+static bool timer_in_expiry;
+static TimerStats timer_stats;
+
+static Timer timer_bench_timers[TIMER_BENCH_COUNT];
+static volatile uint32_t timer_bench_fired;
+static Thread* timer_bench_waiter; // boot thread, woken by the last sleeper
+
+/**************************************************************************//**
+ * @brief Local function. Links a timer into the bucket for its expiry.
+ * 
+ * Must be called with interrupts disabled.
+ * 
+ ******************************************************************************/
+static void timer_enqueue(Timer* timer) {
+    uint64_t expires = timer->expires < timer_clk ? timer_clk : timer->expires;
+    uint64_t delta = expires - timer_clk;
+    uint32_t bucket;
+
+    if (delta < TIMER_ROOT_SIZE) {
+        bucket = expires & TIMER_ROOT_MASK;
+    } else {
+        uint32_t shift = TIMER_ROOT_BITS;
+        uint32_t level = 0;
+
+        while (level < TIMER_LEVELS - 1 && delta >= (1ULL << (shift + TIMER_LEVEL_BITS))) {
+            shift += TIMER_LEVEL_BITS;
+            level++;
+        }
+        if (delta >= (1ULL << (shift + TIMER_LEVEL_BITS)))
+            expires = timer_clk + (1ULL << (shift + TIMER_LEVEL_BITS)) - 1;
+        bucket = TIMER_ROOT_SIZE + level * TIMER_LEVEL_SIZE + ((expires >> shift) & TIMER_LEVEL_MASK);
+    }
+
+    timer->bucket = bucket;
+    timer->next = timer_buckets[bucket];
+    if (timer->next)
+        timer->next->pprev = &timer->next;
+    timer->pprev = &timer_buckets[bucket];
+    timer_buckets[bucket] = timer;
+    timer_bitmap[bucket / 32] |= 1U << (bucket % 32);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Unlinks a pending timer.
+ * 
+ * Must be called with interrupts disabled.
+ * 
+ ******************************************************************************/
+static void timer_unlink(Timer* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next)
+        timer->next->pprev = timer->pprev;
+    if (!timer_buckets[timer->bucket])
+        timer_bitmap[timer->bucket / 32] &= ~(1U << (timer->bucket % 32));
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Empties a bucket.
+ * 
+ * @return The bucket's timers, still linked to each other.
+ * 
+ ******************************************************************************/
+static Timer* timer_take_bucket(uint32_t bucket) {
+    Timer* list = timer_buckets[bucket];
+
+    timer_buckets[bucket] = NULL;
+    timer_bitmap[bucket / 32] &= ~(1U << (bucket % 32));
+    return list;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Moves the timers due in the next root span down.
+ * 
+ * Called whenever timer_clk crosses a multiple of TIMER_ROOT_SIZE. A level
+ * only cascades into the one below when that one has wrapped as well.
+ * 
+ ******************************************************************************/
+static void timer_cascade() {
+    uint32_t shift = TIMER_ROOT_BITS;
+
+    for (uint32_t level = 0; level < TIMER_LEVELS; level++, shift += TIMER_LEVEL_BITS) {
+        uint32_t index = (timer_clk >> shift) & TIMER_LEVEL_MASK;
+        Timer* list = timer_take_bucket(TIMER_ROOT_SIZE + level * TIMER_LEVEL_SIZE + index);
+
+        while (list) {
+            Timer* next = list->next;
+
+            timer_enqueue(list);
+            timer_stats.cascaded++;
+            list = next;
+        }
+        if (index)
+            break;
+    }
+}
+
+/**************************************************************************//**
+ * @brief Local function. Finds the next jiffy that needs the clock interrupt.
+ * 
+ * Scans the root level's bitmap. With an empty root, the next cascade is
+ * the earliest point anything can become due.
+ * 
+ * @return Absolute jiffy, timer_clk if timers are overdue.
+ * 
+ ******************************************************************************/
+static uint64_t timer_next_expiry() {
+    uint32_t start = timer_clk & TIMER_ROOT_MASK;
+
+    for (uint32_t i = 0; i < TIMER_ROOT_SIZE; ) {
+        uint32_t index = (start + i) & TIMER_ROOT_MASK;
+        uint32_t word = timer_bitmap[index / 32] >> (index % 32);
+
+        if (word)
+            return timer_clk + i + __builtin_ctz(word);
+        i += 32 - (index % 32);
+    }
+    return (timer_clk | TIMER_ROOT_MASK) + 1;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Programs the clock interrupt for the next expiry.
+ * 
+ * A busy wheel gets a periodic tick. A sparse one gets a single interrupt
+ * at its next expiry (tickless), or at the longest PIT delay, so an idle
+ * CPU is not woken every jiffy. Must be called with interrupts disabled.
+ * 
+ ******************************************************************************/
+static void timer_program() {
+    uint64_t now = timer_jiffies();
+    uint64_t next = timer_next_expiry();
+
+    if (next <= now + 1) {
+        pit_set_periodic(TIMER_HZ);
+        timer_deadline = now + 1;
+        timer_deadline_tsc = 0;
+    } else {
+        uint64_t us = ((next - now) * 1000000) / TIMER_HZ;
+        uint32_t programmed = pit_set_oneshot(us > UINT32_MAX ? UINT32_MAX : (uint32_t) us);
+
+        timer_deadline = now + ((uint64_t) programmed * TIMER_HZ) / 1000000;
+        timer_deadline_tsc = tsc_read() + (uint64_t) programmed * tsc_khz() / 1000;
+    }
+}
+
+/**************************************************************************//**
+ * @brief Local function. Clock interrupt handler, in hard interrupt context.
+ * 
+ * Only raises SOFTIRQ_TIMER, expiry runs after the EOI.
+ * 
+ ******************************************************************************/
+static void timer_interrupt() {
+    timer_fired_tsc = tsc_read();
+    timer_stats.interrupts++;
+    softirq_raise(SOFTIRQ_TIMER);
+}
+
+/**************************************************************************//**
+ * @brief Local function. SOFTIRQ_TIMER handler, runs all timers that are due.
+ * 
+ * Each due root bucket is detached as a whole and its callbacks run with
+ * interrupts enabled. Callbacks may add and cancel timers, including the
+ * ones still waiting in the same batch. The clock interrupt is programmed
+ * once at the end.
+ * 
+ ******************************************************************************/
+static void timer_run() {
+    uint64_t now = timer_jiffies();
+    uint32_t flags = cpu_irq_save();
+    uint32_t batch = 0;
+
+    timer_in_expiry = true;
+
+    while (timer_clk <= now) {
+        uint32_t index = timer_clk & TIMER_ROOT_MASK;
+        Timer* expired;
+
+        if (!index)
+            timer_cascade();
+
+        expired = timer_take_bucket(index);
+        if (expired)
+            expired->pprev = &expired;
+        timer_clk++;
+
+        while (expired) {
+            Timer* timer = expired;
+
+            timer_unlink(timer);
+            cpu_irq_restore(flags);
+            timer->callback(timer->arg);
+            flags = cpu_irq_save();
+            batch++;
+        }
+    }
+
+    timer_stats.runs++;
+    timer_stats.expired += batch;
+    if (batch > timer_stats.max_batch)
+        timer_stats.max_batch = batch;
+    timer_program();
+    timer_in_expiry = false;
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Initializes the timer wheel and starts the clock interrupt.
+ * 
+ * Time is kept with the TSC, the PIT only raises interrupts when timers
+ * are due. Must run after tsc_init(), softirq_init() and pic_init().
+ * 
+ ******************************************************************************/
+__init void timer_init() {
+    for (size_t i = 0; i < TIMER_BUCKETS; i++)
+        timer_buckets[i] = NULL;
+    for (size_t i = 0; i < TIMER_BUCKETS / 32; i++)
+        timer_bitmap[i] = 0;
+
+    timer_cycles_per_jiffy = (tsc_khz() * 1000) / TIMER_HZ;
+    if (timer_cycles_per_jiffy == 0)
+        timer_cycles_per_jiffy = 1;
+    timer_tsc_base = tsc_read();
+    timer_clk = 0;
+    timer_in_expiry = false;
+
+    softirq_register(SOFTIRQ_TIMER, timer_run);
+    pit_init(timer_interrupt);
+
+    uint32_t flags = cpu_irq_save();
+    timer_program();
+    cpu_irq_restore(flags);
+
+    term_writestring("\nTimers initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Prepares a timer for timer_add().
+ * 
+ * @param timer Timer to initialize.
+ * @param callback Function called on expiry.
+ * @param arg Argument handed to callback.
+ * 
+ ******************************************************************************/
+void timer_setup(Timer* timer, timer_callback_t callback, void* arg) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->bucket = 0;
+}
+
+/**************************************************************************//**
+ * @brief Arms a timer, or moves it if it is already pending.
+ * 
+ * @param timer Timer from timer_setup().
+ * @param expires Absolute expiry in jiffies, see timer_jiffies(). Past
+ * values expire on the next clock interrupt.
+ * 
+ ******************************************************************************/
+void timer_add(Timer* timer, uint64_t expires) {
+    uint32_t flags = cpu_irq_save();
+
+    if (timer->pprev)
+        timer_unlink(timer);
+    timer->expires = expires;
+    timer_enqueue(timer);
+
+    if (expires < timer_deadline && !timer_in_expiry)
+        timer_program();
+
+    cpu_irq_restore(flags);
+}
+
+/**************************************************************************//**
+ * @brief Disarms a timer.
+ * 
+ * The clock interrupt is not reprogrammed, at worst it fires once for
+ * nothing.
+ * 
+ * @param timer Timer from timer_setup().
+ * @return True if the timer was pending.
+ * 
+ ******************************************************************************/
+bool timer_cancel(Timer* timer) {
+    uint32_t flags = cpu_irq_save();
+    bool pending = timer->pprev != NULL;
+
+    if (pending)
+        timer_unlink(timer);
+
+    cpu_irq_restore(flags);
+    return pending;
+}
+
+/**************************************************************************//**
+ * @brief Checks whether a timer is armed.
+ * 
+ ******************************************************************************/
+bool timer_pending(const Timer* timer) {
+    return timer->pprev != NULL;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the current time.
+ * 
+ * @return Jiffies since timer_init().
+ * 
+ ******************************************************************************/
+uint64_t timer_jiffies() {
+    return (tsc_read() - timer_tsc_base) / timer_cycles_per_jiffy;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves when the clock interrupt is due next.
+ * 
+ * Used by the idle governor as an upper bound on how long the CPU sleeps.
+ * 
+ * @return Absolute jiffy the clock interrupt is programmed for.
+ * 
+ ******************************************************************************/
+uint64_t timer_next_event() {
+    return timer_deadline;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the TSC at which a one-shot clock interrupt is due.
+ * 
+ * Only known to within a microsecond, the PIT delay is rounded to that.
+ * The phase of the periodic tick is not tracked.
+ * 
+ * @return TSC value, 0 while the clock interrupt is periodic.
+ * 
+ ******************************************************************************/
+uint64_t timer_next_event_tsc() {
+    return timer_deadline_tsc;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the TSC read first thing in the last clock interrupt.
+ * 
+ * Compared with timer_next_event_tsc() from before the interrupt, this is
+ * how late the interrupt was taken, used by the idle governor to measure
+ * how long an idle state takes to wake up.
+ * 
+ ******************************************************************************/
+uint64_t timer_last_interrupt_tsc() {
+    return timer_fired_tsc;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Expiry callback of timer_benchmark().
+ * 
+ ******************************************************************************/
+static void timer_bench_expired(void* arg) {
+    (void) arg;
+    if (++timer_bench_fired == TIMER_BENCH_SLEEPERS && timer_bench_waiter)
+        thread_wake(timer_bench_waiter);
+}
+
+/**************************************************************************//**
+ * @brief Measures timer_add()/timer_cancel() and idle clock interrupts.
+ * 
+ * Arms TIMER_BENCH_COUNT timers spread over all levels of the wheel and
+ * cancels them again, then idles TIMER_BENCH_IDLE_MS with a few sleepers
+ * pending and counts the clock interrupts taken, versus one per jiffy for
+ * a periodic tick.
+ * 
+ ******************************************************************************/
+void timer_benchmark() {
+    uint64_t now = timer_jiffies();
+    uint32_t seed = 1;
+    uint64_t start, add_cycles, cancel_cycles;
+
+    for (size_t i = 0; i < TIMER_BENCH_COUNT; i++)
+        timer_setup(&timer_bench_timers[i], timer_bench_expired, NULL);
+
+    start = tsc_read();
+    for (size_t i = 0; i < TIMER_BENCH_COUNT; i++) {
+        seed = seed * 1103515245 + 12345;
+        timer_add(&timer_bench_timers[i], now + 1000 + ((seed >> 8) & 0xFFFFF));
+    }
+    add_cycles = tsc_read() - start;
+
+    start = tsc_read();
+    for (size_t i = 0; i < TIMER_BENCH_COUNT; i++)
+        timer_cancel(&timer_bench_timers[i]);
+    cancel_cycles = tsc_read() - start;
+
+    uint32_t interrupts = timer_stats.interrupts;
+    uint32_t expired = timer_stats.expired;
+    timer_bench_fired = 0;
+    now = timer_jiffies();
+    for (size_t i = 0; i < TIMER_BENCH_SLEEPERS; i++)
+        timer_add(&timer_bench_timers[i], now + (i + 1) * (TIMER_BENCH_IDLE_MS / TIMER_BENCH_SLEEPERS));
+    timer_bench_waiter = thread_current();
+    uint32_t flags = cpu_irq_save();
+    while (timer_bench_fired < TIMER_BENCH_SLEEPERS)
+        thread_block();
+    cpu_irq_restore(flags);
+    timer_bench_waiter = NULL;
+    interrupts = timer_stats.interrupts - interrupts;
+    expired = timer_stats.expired - expired;
+
+    printf("\ntimer: add %llu cycles, cancel %llu cycles (%u timers)",
+        add_cycles / TIMER_BENCH_COUNT, cancel_cycles / TIMER_BENCH_COUNT, TIMER_BENCH_COUNT);
+    printf("\ntimer: %u ms idle with %u sleepers: %u clock interrupts (periodic %u), %u expired",
+        TIMER_BENCH_IDLE_MS, TIMER_BENCH_SLEEPERS, interrupts, TIMER_BENCH_IDLE_MS * TIMER_HZ / 1000, expired);
+    printf("\ntimer: %u cascaded, max batch %u, %u PIT reprograms",
+        timer_stats.cascaded, timer_stats.max_batch, pit_reprogram_count());
+}
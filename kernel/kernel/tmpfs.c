@@ -0,0 +1,747 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <kernel/frame.h>
+#include <kernel/init.h>
+#include <kernel/paging.h>
+#include <kernel/tmpfs.h>
+#include <kernel/tty.h>
+#include <kernel/vm.h>
+
+#define TMPFS_BUCKETS (1 << TMPFS_HASH_BITS)
+
+/*
+ * A name in a directory. The directory tree is nothing but these entries,
+ * hashed by parent and name, so resolving a path costs one hash lookup per
+ * component and directories need no storage of their own.
+ *
+ * Only system calls touch the file system and threads are not preempted,
+ * so there is no locking yet.
+ */
+typedef struct TmpfsDentry {
+    struct TmpfsDentry* next; // hash chain, or free list
+    TmpfsInode* parent;
+    TmpfsInode* inode;
+    uint32_t hash;
+    uint32_t length;
+    char name[TMPFS_NAME_MAX + 1];
+} TmpfsDentry;
+
+static TmpfsInode tmpfs_inodes[TMPFS_INODE_MAX];
+static TmpfsDentry tmpfs_dentries[TMPFS_DENTRY_MAX];
+static TmpfsInode* tmpfs_free_inodes;
+static TmpfsDentry* tmpfs_free_dentries;
+static TmpfsDentry* tmpfs_hash[TMPFS_BUCKETS];
+static TmpfsInode* tmpfs_root;
+static uint32_t tmpfs_next_id = 1;
+
+/**************************************************************************//**
+ * @brief Local function. Hashes a name within a directory (FNV-1a).
+ * 
+ ******************************************************************************/
+static uint32_t tmpfs_name_hash(const TmpfsInode* parent, const char* name, uint32_t length) {
+    uint32_t hash = 2166136261u ^ (parent->id * 0x9E3779B1u);
+
+    for (uint32_t i = 0; i < length; i++)
+        hash = (hash ^ (uint8_t) name[i]) * 16777619u;
+    return hash;
+}
+
+static inline TmpfsDentry** tmpfs_bucket(uint32_t hash) {
+    return &tmpfs_hash[hash >> (32 - TMPFS_HASH_BITS)];
+}
+
+/**************************************************************************//**
+ * @brief Local function. Number of pages a radix tree of a height reaches.
+ * 
+ ******************************************************************************/
+static inline uint32_t tmpfs_radix_reach(uint32_t height) {
+    return 1u << (TMPFS_RADIX_BITS * height);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Finds the slot for a page in an inode's radix tree.
+ * 
+ * With create set, the tree grows in height until it reaches the index, and
+ * missing nodes on the way down are allocated. The page itself is not.
+ * 
+ * @return Slot holding the page's frame or NULL, NULL if the path does not
+ * exist and create is not set, or if out of memory.
+ * 
+ ******************************************************************************/
+static void** tmpfs_radix_slot(TmpfsInode* inode, uint32_t index, bool create) {
+    void** slot;
+
+    while (inode->height < TMPFS_RADIX_HEIGHT_MAX && index >= tmpfs_radix_reach(inode->height)) {
+        if (!create)
+            return NULL;
+        if (inode->root) {
+            void** node = (void**) frame_alloc_zeroed();
+
+            if (!node)
+                return NULL;
+            node[0] = inode->root;
+            inode->root = node;
+        }
+        inode->height++;
+    }
+
+    slot = &inode->root;
+    for (uint32_t level = inode->height; level > 0; level--) {
+        if (!*slot) {
+            if (!create || !(*slot = (void*) frame_alloc_zeroed()))
+                return NULL;
+        }
+        slot = &((void**) *slot)[(index >> (TMPFS_RADIX_BITS * (level - 1))) & (TMPFS_RADIX_SLOTS - 1)];
+    }
+    return slot;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Frees the nodes on the path to a page that hold
+ * nothing, after tmpfs_radix_slot() ran out of memory part way.
+ * 
+ ******************************************************************************/
+static void tmpfs_radix_prune(TmpfsInode* inode, uint32_t index) {
+    void** path[TMPFS_RADIX_HEIGHT_MAX];
+    void** slot = &inode->root;
+    uint32_t depth = 0;
+
+    for (uint32_t level = inode->height; level > 0 && *slot; level--) {
+        path[depth++] = slot;
+        slot = &((void**) *slot)[(index >> (TMPFS_RADIX_BITS * (level - 1))) & (TMPFS_RADIX_SLOTS - 1)];
+    }
+
+    while (depth--) {
+        void** node = *path[depth];
+
+        for (uint32_t i = 0; i < TMPFS_RADIX_SLOTS; i++) {
+            if (node[i])
+                return;
+        }
+        frame_unref((uint32_t) node);
+        *path[depth] = NULL;
+    }
+    if (!inode->root)
+        inode->height = 0;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Looks up a cached page without allocating.
+ * 
+ * @return Frame of the page, 0 for a hole.
+ * 
+ ******************************************************************************/
+static uint32_t tmpfs_find_page(TmpfsInode* inode, uint32_t index) {
+    void** slot = tmpfs_radix_slot(inode, index, false);
+
+    return slot ? (uint32_t) *slot : 0;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Looks up a cached page, filling a hole with zeros.
+ * 
+ * @return Frame of the page, 0 if out of memory, in which case no empty
+ * node is left behind.
+ * 
+ ******************************************************************************/
+static uint32_t tmpfs_get_page(TmpfsInode* inode, uint32_t index) {
+    void** slot = tmpfs_radix_slot(inode, index, true);
+
+    if (slot && !*slot) {
+        *slot = (void*) frame_alloc_zeroed();
+        if (*slot)
+            inode->pages++;
+    }
+    if (!slot || !*slot) {
+        tmpfs_radix_prune(inode, index);
+        return 0;
+    }
+    return (uint32_t) *slot;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Drops the pages from index first on in a subtree.
+ * 
+ * Nodes left empty are freed as well. Pages still mapped somewhere stay
+ * with their mappings, the cache only drops its reference.
+ * 
+ * @param slot Subtree, reaching tmpfs_radix_reach(level) pages from base.
+ * @return True if the subtree is empty now.
+ * 
+ ******************************************************************************/
+static bool tmpfs_radix_trim(TmpfsInode* inode, void** slot, uint32_t level, uint32_t base, uint32_t first) {
+    void** node = *slot;
+    uint32_t reach;
+    bool empty = true;
+
+    if (!node)
+        return true;
+    if (!level) {
+        if (base < first)
+            return false;
+        frame_unref((uint32_t) node);
+        inode->pages--;
+        *slot = NULL;
+        return true;
+    }
+
+    reach = tmpfs_radix_reach(level - 1);
+    for (uint32_t i = 0; i < TMPFS_RADIX_SLOTS; i++) {
+        uint32_t child = base + i * reach;
+
+        if (child + reach <= first)
+            empty &= !node[i];
+        else
+            empty &= tmpfs_radix_trim(inode, &node[i], level - 1, child, first);
+    }
+    if (empty) {
+        frame_unref((uint32_t) node);
+        *slot = NULL;
+    }
+    return empty;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Zeros a cached page from an offset to its end.
+ * 
+ * Keeps the invariant that cache pages hold zeros past the end of the file,
+ * which a shared mapping can break by writing there.
+ * 
+ ******************************************************************************/
+static void tmpfs_zero_tail(TmpfsInode* inode, uint32_t offset) {
+    uint32_t frame;
+
+    if (!(offset & ~PAGE_MASK))
+        return;
+    frame = tmpfs_find_page(inode, offset / PAGE_SIZE);
+    if (frame)
+        memset((void*) (frame + (offset & ~PAGE_MASK)), 0, PAGE_SIZE - (offset & ~PAGE_MASK));
+}
+
+/**************************************************************************//**
+ * @brief Local function. Takes an inode from the free list.
+ * 
+ * @return Inode with one link and no references, NULL if none is left.
+ * 
+ ******************************************************************************/
+static TmpfsInode* tmpfs_inode_alloc(uint32_t type, TmpfsInode* parent) {
+    TmpfsInode* inode = tmpfs_free_inodes;
+
+    if (!inode)
+        return NULL;
+    tmpfs_free_inodes = inode->next_free;
+
+    memset(inode, 0, sizeof(*inode));
+    inode->id = tmpfs_next_id++;
+    inode->type = type;
+    inode->links = 1;
+    inode->parent = parent;
+    inode->in_use = true;
+    return inode;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Frees an inode nothing refers to anymore.
+ * 
+ ******************************************************************************/
+static void tmpfs_inode_release(TmpfsInode* inode) {
+    if (inode->links || inode->refs)
+        return;
+
+    tmpfs_radix_trim(inode, &inode->root, inode->height, 0, 0);
+    inode->in_use = false;
+    inode->next_free = tmpfs_free_inodes;
+    tmpfs_free_inodes = inode;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Finds the entry for a name in a directory.
+ * 
+ ******************************************************************************/
+static TmpfsDentry** tmpfs_lookup(TmpfsInode* dir, const char* name, uint32_t length) {
+    uint32_t hash = tmpfs_name_hash(dir, name, length);
+    TmpfsDentry** link = tmpfs_bucket(hash);
+
+    for (; *link; link = &(*link)->next) {
+        TmpfsDentry* dentry = *link;
+
+        if (dentry->hash == hash && dentry->parent == dir && dentry->length == length
+            && !memcmp(dentry->name, name, length))
+            return link;
+    }
+    return NULL;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Resolves one path component in a directory.
+ * 
+ * @return Inode named, NULL if there is none.
+ * 
+ ******************************************************************************/
+static TmpfsInode* tmpfs_step(TmpfsInode* dir, const char* name, uint32_t length) {
+    TmpfsDentry** link;
+
+    if (length == 1 && name[0] == '.')
+        return dir;
+    if (length == 2 && name[0] == '.' && name[1] == '.')
+        return dir->parent;
+
+    link = tmpfs_lookup(dir, name, length);
+    return link ? (*link)->inode : NULL;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Resolves a path up to its last component.
+ * 
+ * Paths are absolute, repeated and trailing slashes are ignored.
+ * 
+ * @param path Path to resolve.
+ * @param dir Receives the directory holding the last component.
+ * @param name Receives the last component, empty for the root itself.
+ * @param length Receives its length.
+ * @return 0 on success, -EINVAL for a relative path, -ENOENT or -ENOTDIR if
+ * a directory on the way is missing, -ENAMETOOLONG for a component longer
+ * than TMPFS_NAME_MAX.
+ * 
+ ******************************************************************************/
+static int tmpfs_resolve(const char* path, TmpfsInode** dir, const char** name, uint32_t* length) {
+    TmpfsInode* current = tmpfs_root;
+
+    if (*path != '/')
+        return -EINVAL;
+
+    for (;;) {
+        const char* component;
+        uint32_t size = 0;
+
+        while (*path == '/')
+            path++;
+        component = path;
+        while (path[size] && path[size] != '/')
+            size++;
+        if (size > TMPFS_NAME_MAX)
+            return -ENAMETOOLONG;
+        path += size;
+        while (*path == '/')
+            path++;
+
+        if (!*path) {
+            *dir = current;
+            *name = component;
+            *length = size;
+            return 0;
+        }
+
+        current = tmpfs_step(current, component, size);
+        if (!current)
+            return -ENOENT;
+        if (current->type != TMPFS_DIR)
+            return -ENOTDIR;
+    }
+}
+
+/**************************************************************************//**
+ * @brief Local function. Resolves a path to its inode.
+ * 
+ * @return 0 on success, negated errno value from tmpfs_resolve() or -ENOENT.
+ * 
+ ******************************************************************************/
+static int tmpfs_resolve_inode(const char* path, TmpfsInode** inode) {
+    TmpfsInode* dir;
+    const char* name;
+    uint32_t length;
+    int error = tmpfs_resolve(path, &dir, &name, &length);
+
+    if (error)
+        return error;
+    *inode = length ? tmpfs_step(dir, name, length) : dir;
+    return *inode ? 0 : -ENOENT;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Adds a new inode under a name in a directory.
+ * 
+ * @return 0 on success, -EEXIST for "." and "..", -ENOSPC if out of inodes
+ * or entries.
+ * 
+ ******************************************************************************/
+static int tmpfs_create(TmpfsInode* dir, const char* name, uint32_t length, uint32_t type, TmpfsInode** created) {
+    TmpfsDentry* dentry = tmpfs_free_dentries;
+    TmpfsInode* inode;
+    TmpfsDentry** bucket;
+
+    if (!length || (name[0] == '.' && (length == 1 || (length == 2 && name[1] == '.'))))
+        return -EEXIST;
+    if (!dentry)
+        return -ENOSPC;
+    inode = tmpfs_inode_alloc(type, dir);
+    if (!inode)
+        return -ENOSPC;
+    tmpfs_free_dentries = dentry->next;
+
+    dentry->parent = dir;
+    dentry->inode = inode;
+    dentry->hash = tmpfs_name_hash(dir, name, length);
+    dentry->length = length;
+    memcpy(dentry->name, name, length);
+    dentry->name[length] = '\0';
+
+    bucket = tmpfs_bucket(dentry->hash);
+    dentry->next = *bucket;
+    *bucket = dentry;
+    dir->entries++;
+
+    if (created)
+        *created = inode;
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Removes a name and drops the link it held.
+ * 
+ ******************************************************************************/
+static void tmpfs_remove(TmpfsDentry** link) {
+    TmpfsDentry* dentry = *link;
+    TmpfsInode* inode = dentry->inode;
+
+    *link = dentry->next;
+    dentry->parent->entries--;
+    dentry->next = tmpfs_free_dentries;
+    tmpfs_free_dentries = dentry;
+
+    inode->links--;
+    tmpfs_inode_release(inode);
+}
+
+/**************************************************************************//**
+ * @brief Sets up an empty file system with just the root directory.
+ * 
+ ******************************************************************************/
+__init void tmpfs_init() {
+    for (size_t i = TMPFS_INODE_MAX; i > 0; i--) {
+        tmpfs_inodes[i - 1].next_free = tmpfs_free_inodes;
+        tmpfs_free_inodes = &tmpfs_inodes[i - 1];
+    }
+    for (size_t i = TMPFS_DENTRY_MAX; i > 0; i--) {
+        tmpfs_dentries[i - 1].next = tmpfs_free_dentries;
+        tmpfs_free_dentries = &tmpfs_dentries[i - 1];
+    }
+
+    tmpfs_root = tmpfs_inode_alloc(TMPFS_DIR, NULL);
+    tmpfs_root->parent = tmpfs_root;
+
+    term_writestring("\nRAM file system initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Opens a file or directory, creating or truncating files on request.
+ * 
+ * @param path Absolute path.
+ * @param flags TMPFS_OPEN_* flags.
+ * @param inode Receives the inode, with a reference the caller drops with
+ * tmpfs_put().
+ * @return 0 on success, -EEXIST if TMPFS_OPEN_EXCLUSIVE and the file
+ * exists, -EISDIR to truncate a directory, or an error from resolving the
+ * path or creating the file.
+ * 
+ ******************************************************************************/
+int tmpfs_open(const char* path, uint32_t flags, TmpfsInode** inode) {
+    TmpfsInode* dir;
+    TmpfsInode* found;
+    const char* name;
+    uint32_t length;
+    int error = tmpfs_resolve(path, &dir, &name, &length);
+
+    if (error)
+        return error;
+
+    found = length ? tmpfs_step(dir, name, length) : dir;
+    if (found) {
+        if ((flags & TMPFS_OPEN_CREATE) && (flags & TMPFS_OPEN_EXCLUSIVE))
+            return -EEXIST;
+        if (found->type == TMPFS_DIR && (flags & TMPFS_OPEN_TRUNCATE))
+            return -EISDIR;
+    } else {
+        if (!(flags & TMPFS_OPEN_CREATE))
+            return -ENOENT;
+        error = tmpfs_create(dir, name, length, TMPFS_FILE, &found);
+        if (error)
+            return error;
+    }
+
+    if (flags & TMPFS_OPEN_TRUNCATE)
+        tmpfs_truncate(found, 0);
+    found->refs++;
+    *inode = found;
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Creates a file without a name, e.g. memory shared through a pipe.
+ * 
+ * All its pages are allocated up front. It goes away with its last
+ * reference.
+ * 
+ * @param size Size of the file in bytes.
+ * @return File with one reference, NULL if out of inodes or memory.
+ * 
+ ******************************************************************************/
+TmpfsInode* tmpfs_anonymous(uint32_t size) {
+    TmpfsInode* inode = tmpfs_inode_alloc(TMPFS_FILE, NULL);
+
+    if (!inode)
+        return NULL;
+    inode->links = 0;
+    inode->refs = 1;
+    inode->size = size;
+
+    for (uint32_t i = 0; i < (size + PAGE_SIZE - 1) / PAGE_SIZE; i++) {
+        if (!tmpfs_get_page(inode, i)) {
+            tmpfs_put(inode);
+            return NULL;
+        }
+    }
+    return inode;
+}
+
+/**************************************************************************//**
+ * @brief Adds a reference to an inode, e.g. for a mapping of the file.
+ * 
+ ******************************************************************************/
+void tmpfs_get(TmpfsInode* inode) {
+    inode->refs++;
+}
+
+/**************************************************************************//**
+ * @brief Drops a reference, freeing an inode that lost all its names.
+ * 
+ ******************************************************************************/
+void tmpfs_put(TmpfsInode* inode) {
+    inode->refs--;
+    tmpfs_inode_release(inode);
+}
+
+/**************************************************************************//**
+ * @brief Creates a directory.
+ * 
+ * @return 0 on success, -EEXIST if the name is taken, or an error from
+ * resolving the path or creating the directory.
+ * 
+ ******************************************************************************/
+int tmpfs_mkdir(const char* path) {
+    TmpfsInode* dir;
+    const char* name;
+    uint32_t length;
+    int error = tmpfs_resolve(path, &dir, &name, &length);
+
+    if (error)
+        return error;
+    if (!length || tmpfs_step(dir, name, length))
+        return -EEXIST;
+    return tmpfs_create(dir, name, length, TMPFS_DIR, NULL);
+}
+
+/**************************************************************************//**
+ * @brief Removes the name of a file.
+ * 
+ * The data stays until the file is no longer open or mapped.
+ * 
+ * @return 0 on success, -ENOENT if there is no such name, -EISDIR for a
+ * directory, or an error from resolving the path.
+ * 
+ ******************************************************************************/
+int tmpfs_unlink(const char* path) {
+    TmpfsInode* dir;
+    TmpfsDentry** link;
+    const char* name;
+    uint32_t length;
+    int error = tmpfs_resolve(path, &dir, &name, &length);
+
+    if (error)
+        return error;
+    if (!length)
+        return -EISDIR;
+    link = tmpfs_lookup(dir, name, length);
+    if (!link)
+        return tmpfs_step(dir, name, length) ? -EISDIR : -ENOENT;
+    if ((*link)->inode->type == TMPFS_DIR)
+        return -EISDIR;
+
+    tmpfs_remove(link);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Removes an empty directory.
+ * 
+ * @return 0 on success, -ENOENT if there is no such name, -ENOTDIR for a
+ * file, -ENOTEMPTY if it has entries, -EBUSY for the root, -EINVAL for "."
+ * and "..", or an error from resolving the path.
+ * 
+ ******************************************************************************/
+int tmpfs_rmdir(const char* path) {
+    TmpfsInode* dir;
+    TmpfsDentry** link;
+    const char* name;
+    uint32_t length;
+    int error = tmpfs_resolve(path, &dir, &name, &length);
+
+    if (error)
+        return error;
+    if (!length)
+        return -EBUSY;
+    link = tmpfs_lookup(dir, name, length);
+    if (!link)
+        return tmpfs_step(dir, name, length) ? -EINVAL : -ENOENT;
+    if ((*link)->inode->type != TMPFS_DIR)
+        return -ENOTDIR;
+    if ((*link)->inode->entries)
+        return -ENOTEMPTY;
+
+    tmpfs_remove(link);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the attributes of a file or directory.
+ * 
+ * @return 0 on success, or an error from resolving the path.
+ * 
+ ******************************************************************************/
+int tmpfs_stat(const char* path, TmpfsStat* stat) {
+    TmpfsInode* inode;
+    int error = tmpfs_resolve_inode(path, &inode);
+
+    if (error)
+        return error;
+    stat->id = inode->id;
+    stat->type = inode->type;
+    stat->links = inode->links;
+    stat->size = inode->size;
+    stat->pages = inode->pages;
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Copies file data out of the page cache.
+ * 
+ * Holes read as zeros without allocating pages. The buffer may be user
+ * memory, which is faulted in as the copy reaches it.
+ * 
+ * @return Bytes read, 0 at or past the end of the file, -EISDIR for a
+ * directory.
+ * 
+ ******************************************************************************/
+int32_t tmpfs_read(TmpfsInode* inode, uint32_t offset, uint8_t* buffer, uint32_t count) {
+    uint32_t done = 0;
+
+    if (inode->type != TMPFS_FILE)
+        return -EISDIR;
+    if (offset >= inode->size)
+        return 0;
+    if (count > inode->size - offset)
+        count = inode->size - offset;
+    if (count > INT32_MAX)
+        count = INT32_MAX;
+
+    while (done < count) {
+        uint32_t in_page = (offset + done) & ~PAGE_MASK;
+        uint32_t chunk = PAGE_SIZE - in_page < count - done ? PAGE_SIZE - in_page : count - done;
+        uint32_t frame = tmpfs_find_page(inode, (offset + done) / PAGE_SIZE);
+
+        if (frame)
+            memcpy(buffer + done, (const void*) (frame + in_page), chunk);
+        else
+            memset(buffer + done, 0, chunk);
+        done += chunk;
+    }
+    return (int32_t) done;
+}
+
+/**************************************************************************//**
+ * @brief Copies data into the page cache, growing the file as needed.
+ * 
+ * Pages are allocated as the copy reaches them, writing past the end of
+ * the file leaves a hole. The buffer may be user memory.
+ * 
+ * @return Bytes written, which falls short only if memory ran out part way,
+ * -ENOSPC if it ran out before the first byte, -EFBIG past 4 GiB, -EISDIR
+ * for a directory.
+ * 
+ ******************************************************************************/
+int32_t tmpfs_write(TmpfsInode* inode, uint32_t offset, const uint8_t* buffer, uint32_t count) {
+    uint32_t done = 0;
+
+    if (inode->type != TMPFS_FILE)
+        return -EISDIR;
+    if (count > INT32_MAX)
+        count = INT32_MAX;
+    if (count > UINT32_MAX - offset)
+        return -EFBIG;
+    if (offset > inode->size)
+        tmpfs_zero_tail(inode, inode->size);
+
+    while (done < count) {
+        uint32_t in_page = (offset + done) & ~PAGE_MASK;
+        uint32_t chunk = PAGE_SIZE - in_page < count - done ? PAGE_SIZE - in_page : count - done;
+        uint32_t frame = tmpfs_get_page(inode, (offset + done) / PAGE_SIZE);
+
+        if (!frame)
+            break;
+        memcpy((void*) (frame + in_page), buffer + done, chunk);
+        done += chunk;
+    }
+
+    if (offset + done > inode->size)
+        inode->size = offset + done;
+    return done || !count ? (int32_t) done : -ENOSPC;
+}
+
+/**************************************************************************//**
+ * @brief Sets the size of a file.
+ * 
+ * Shrinking drops the cache pages past the new end, and unmaps them from
+ * every mapping of the file first, see vm_unmap_inode(). Growing leaves a
+ * hole.
+ * 
+ * @return 0 on success, -EISDIR for a directory.
+ * 
+ ******************************************************************************/
+int tmpfs_truncate(TmpfsInode* inode, uint32_t size) {
+    if (inode->type != TMPFS_FILE)
+        return -EISDIR;
+
+    if (size < inode->size) {
+        uint32_t first = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+        vm_unmap_inode(inode, first);
+        tmpfs_radix_trim(inode, &inode->root, inode->height, 0, first);
+        if (!inode->root)
+            inode->height = 0;
+        tmpfs_zero_tail(inode, size);
+    } else {
+        tmpfs_zero_tail(inode, inode->size);
+    }
+    inode->size = size;
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Looks up a page of a file for mapping it, filling holes.
+ * 
+ * The cache keeps its own reference, mappings add theirs.
+ * 
+ * @param inode File to look in.
+ * @param index Page number within the file.
+ * @return Frame of the page, 0 past the end of the file or if out of memory.
+ * 
+ ******************************************************************************/
+uint32_t tmpfs_page(TmpfsInode* inode, uint32_t index) {
+    if (inode->type != TMPFS_FILE || index >= (inode->size + PAGE_SIZE - 1) / PAGE_SIZE)
+        return 0;
+    return tmpfs_get_page(inode, index);
+}
@@ -0,0 +1,104 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <kernel/cpu.h>
+#include <kernel/frame.h>
+#include <kernel/init.h>
+#include <kernel/paging.h>
+#include <kernel/timer.h>
+#include <kernel/tsc.h>
+#include <kernel/tty.h>
+#include <kernel/vdso.h>
+#include <kernel/vm.h>
+
+#define VDSO_CLOCK_SHIFT 24
+#define VDSO_UPDATE_JIFFIES TIMER_HZ // cycles * multiplier stays in 64 bits for ~1000 s
+
+/*
+ * The page is mapped into user space as a whole, so nothing else may share
+ * its frame.
+ */
+typedef union VdsoPage {
+    VdsoData data;
+    uint8_t bytes[PAGE_SIZE];
+} VdsoPage;
+
+static VdsoPage vdso_page __attribute__((aligned(PAGE_SIZE)));
+static Timer vdso_timer;
+
+/**************************************************************************//**
+ * @brief Local function. Moves the clock snapshot up to the current time.
+ * 
+ * Runs once a second from a timer, and re-arms it. Interrupts stay off
+ * while the sequence count is odd, so no reader on this CPU can spin on it.
+ * 
+ ******************************************************************************/
+static void vdso_update(void* arg) {
+    (void) arg;
+    VdsoData* data = &vdso_page.data;
+    uint32_t flags = cpu_irq_save();
+    uint64_t now = tsc_read();
+    uint64_t ns = data->monotonic_base + (((now - data->tsc_base) * data->multiplier) >> data->shift);
+
+    data->sequence++;
+    asm volatile("" : : : "memory");
+    data->tsc_base = now;
+    data->monotonic_base = ns;
+    asm volatile("" : : : "memory");
+    data->sequence++;
+    cpu_irq_restore(flags);
+
+    timer_add(&vdso_timer, timer_jiffies() + VDSO_UPDATE_JIFFIES);
+}
+
+/**************************************************************************//**
+ * @brief Fills in the shared data page and starts its clock.
+ * 
+ * The clock scale comes from the calibrated TSC frequency, which gives
+ * nanoseconds as (cycles * multiplier) >> VDSO_CLOCK_SHIFT. Must run after
+ * cpu_init() and timer_init().
+ * 
+ ******************************************************************************/
+__init void vdso_init() {
+    VdsoData* data = &vdso_page.data;
+    uint64_t multiplier = (1000000ULL << VDSO_CLOCK_SHIFT) / tsc_khz();
+
+    frame_pin((uint32_t) &vdso_page, (uint32_t) &vdso_page + PAGE_SIZE);
+
+    data->shift = VDSO_CLOCK_SHIFT;
+    data->multiplier = multiplier > UINT32_MAX ? UINT32_MAX : (uint32_t) multiplier;
+    data->tsc_khz = tsc_khz();
+    data->tsc_base = tsc_read();
+    data->monotonic_base = 0;
+    data->cpu_count = CPU_MAX;
+    data->cpu_features = cpu_features();
+    memcpy(data->cpu_vendor, cpu_vendor(), strlen(cpu_vendor()) + 1);
+
+    timer_setup(&vdso_timer, vdso_update, NULL);
+    timer_add(&vdso_timer, timer_jiffies() + VDSO_UPDATE_JIFFIES);
+
+    term_writestring("\nShared data page initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Maps the shared data page read-only at VDSO_DATA_ADDRESS.
+ * 
+ * The page is pinned, so every address space maps the same frame.
+ * 
+ * @param space Address space to map into.
+ * @return 0 on success, negated errno value otherwise.
+ * 
+ ******************************************************************************/
+int vdso_map(AddressSpace* space) {
+    return vm_map_file(space, VDSO_DATA_ADDRESS, PAGE_SIZE, vdso_page.bytes, PAGE_SIZE, VM_READ);
+}
+
+/**************************************************************************//**
+ * @brief Reads the clock user space sees through the shared data page.
+ * 
+ * @return Nanoseconds since boot.
+ * 
+ ******************************************************************************/
+uint64_t vdso_monotonic_ns() {
+    return vdso_clock_ns(&vdso_page.data);
+}
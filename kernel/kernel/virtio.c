@@ -0,0 +1,587 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <kernel/cpu.h>
+#include <kernel/paging.h>
+#include <kernel/pci.h>
+#include <kernel/pio.h>
+#include <kernel/virtio.h>
+
+/*
+ * Virtio over PCI, legacy (virtio 0.9.5) and modern (virtio 1.0) transports,
+ * and the split virtqueue. Transitional devices offer both, the modern one
+ * is used whenever its capabilities point at a reachable BAR.
+ */
+
+// Legacy registers, offsets from I/O BAR 0
+#define VIRTIO_LEGACY_HOST_FEATURES 0x00
+#define VIRTIO_LEGACY_GUEST_FEATURES 0x04
+#define VIRTIO_LEGACY_QUEUE_PFN 0x08
+#define VIRTIO_LEGACY_QUEUE_SIZE 0x0C
+#define VIRTIO_LEGACY_QUEUE_SELECT 0x0E
+#define VIRTIO_LEGACY_QUEUE_NOTIFY 0x10
+#define VIRTIO_LEGACY_STATUS 0x12
+#define VIRTIO_LEGACY_ISR 0x13
+#define VIRTIO_LEGACY_CONFIG_VECTOR 0x14 // MSI-X only
+#define VIRTIO_LEGACY_QUEUE_VECTOR 0x16  // MSI-X only
+#define VIRTIO_LEGACY_CONFIG 0x14
+#define VIRTIO_LEGACY_CONFIG_MSIX 0x18
+
+// Modern vendor capability, offsets from the capability
+#define VIRTIO_CAP_TYPE 0x03
+#define VIRTIO_CAP_BAR 0x04
+#define VIRTIO_CAP_OFFSET 0x08
+#define VIRTIO_CAP_NOTIFY_MULTIPLIER 0x10
+
+#define VIRTIO_CAP_COMMON 1
+#define VIRTIO_CAP_NOTIFY 2
+#define VIRTIO_CAP_ISR 3
+#define VIRTIO_CAP_DEVICE 4
+
+// Modern common configuration
+#define VIRTIO_COMMON_DEVICE_FEATURE_SELECT 0x00
+#define VIRTIO_COMMON_DEVICE_FEATURE 0x04
+#define VIRTIO_COMMON_DRIVER_FEATURE_SELECT 0x08
+#define VIRTIO_COMMON_DRIVER_FEATURE 0x0C
+#define VIRTIO_COMMON_CONFIG_VECTOR 0x10
+#define VIRTIO_COMMON_STATUS 0x14
+#define VIRTIO_COMMON_CONFIG_GENERATION 0x15
+#define VIRTIO_COMMON_QUEUE_SELECT 0x16
+#define VIRTIO_COMMON_QUEUE_SIZE 0x18
+#define VIRTIO_COMMON_QUEUE_VECTOR 0x1A
+#define VIRTIO_COMMON_QUEUE_ENABLE 0x1C
+#define VIRTIO_COMMON_QUEUE_NOTIFY_OFF 0x1E
+#define VIRTIO_COMMON_QUEUE_DESC 0x20
+#define VIRTIO_COMMON_QUEUE_DRIVER 0x28
+#define VIRTIO_COMMON_QUEUE_DEVICE 0x30
+
+#define VIRTIO_COMMON8(device, offset) (*(volatile uint8_t*) ((device)->common + (offset)))
+#define VIRTIO_COMMON16(device, offset) (*(volatile uint16_t*) ((device)->common + (offset)))
+#define VIRTIO_COMMON32(device, offset) (*(volatile uint32_t*) ((device)->common + (offset)))
+
+// Fits the legacy layout of the largest queue: descriptors, avail ring, used ring
+#define VIRTIO_RING_BYTES (3 * VIRTIO_QUEUE_ALIGN)
+
+// The device needs to see index updates after the ring contents they cover
+#define virtio_barrier() asm volatile("" : : : "memory")
+// Store to one ring followed by a load from the other
+#define virtio_fence() __sync_synchronize()
+
+static uint8_t virtio_rings[VIRTIO_QUEUE_MAX][VIRTIO_RING_BYTES] __attribute__((aligned(VIRTIO_QUEUE_ALIGN)));
+static uint32_t virtio_ring_count;
+
+/**************************************************************************//**
+ * @brief Local function. Reads the device status.
+ * 
+ ******************************************************************************/
+static uint8_t virtio_get_status(VirtioDevice* device) {
+    if (device->modern)
+        return VIRTIO_COMMON8(device, VIRTIO_COMMON_STATUS);
+    return inb(device->io_base + VIRTIO_LEGACY_STATUS);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Writes the device status, 0 resets the device.
+ * 
+ ******************************************************************************/
+static void virtio_set_status(VirtioDevice* device, uint8_t status) {
+    if (device->modern)
+        VIRTIO_COMMON8(device, VIRTIO_COMMON_STATUS) = status;
+    else
+        outb(status, device->io_base + VIRTIO_LEGACY_STATUS);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Picks up the modern transport's capabilities.
+ * 
+ * @return True if all the structures the driver needs are reachable.
+ * 
+ ******************************************************************************/
+static bool virtio_find_modern(VirtioDevice* device) {
+    PciDevice* pci = device->pci;
+
+    for (uint8_t cap = pci_find_capability(pci, PCI_CAP_VENDOR, 0); cap;
+        cap = pci_find_capability(pci, PCI_CAP_VENDOR, cap)) {
+        uint8_t type = pci_read8(pci, cap + VIRTIO_CAP_TYPE);
+        volatile uint8_t* base = pci_map_bar(pci, pci_read8(pci, cap + VIRTIO_CAP_BAR));
+
+        if (!base)
+            continue;
+        base += pci_read32(pci, cap + VIRTIO_CAP_OFFSET);
+
+        // The first structure of a type is the preferred one
+        if (type == VIRTIO_CAP_COMMON && !device->common) {
+            device->common = base;
+        } else if (type == VIRTIO_CAP_NOTIFY && !device->notify) {
+            device->notify = base;
+            device->notify_multiplier = pci_read32(pci, cap + VIRTIO_CAP_NOTIFY_MULTIPLIER);
+        } else if (type == VIRTIO_CAP_ISR && !device->isr) {
+            device->isr = base;
+        } else if (type == VIRTIO_CAP_DEVICE && !device->config) {
+            device->config = base;
+        }
+    }
+    return device->common && device->notify && device->isr && device->config;
+}
+
+/**************************************************************************//**
+ * @brief Resets a virtio device and announces a driver for it.
+ * 
+ * Drivers continue with virtio_enable_msix() if they want it, then
+ * virtio_negotiate(), virtq_setup() for each queue, reading their device
+ * configuration and finally virtio_driver_ok().
+ * 
+ * @param device Transport state, filled in here.
+ * @param pci Function with the virtio vendor ID.
+ * @return 0 on success, -ENODEV if neither transport is usable.
+ * 
+ ******************************************************************************/
+int virtio_pci_init(VirtioDevice* device, PciDevice* pci) {
+    memset(device, 0, sizeof(*device));
+    device->pci = pci;
+
+    if (virtio_find_modern(device))
+        device->modern = true;
+    else if ((pci->bars[0].flags & PCI_BAR_IO) && pci->bars[0].size)
+        device->io_base = pci->bars[0].base;
+    else
+        return -ENODEV;
+
+    pci_enable(pci);
+    virtio_set_status(device, 0);
+    while (device->modern && virtio_get_status(device))
+        cpu_pause();
+    virtio_set_status(device, VIRTIO_STATUS_ACKNOWLEDGE);
+    virtio_set_status(device, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Routes the device's queue interrupts to an MSI-X vector.
+ * 
+ * All queues share MSI-X table entry 0, configuration changes raise no
+ * interrupt. Must be called before anything else touches the legacy
+ * registers, since MSI-X moves the legacy device configuration.
+ * 
+ * @param device Device after virtio_pci_init().
+ * @param handler Called in hard interrupt context.
+ * @return Interrupt vector, or a negated errno value from pci_enable_msix()
+ * in which case the device keeps using its INTx line.
+ * 
+ ******************************************************************************/
+int virtio_enable_msix(VirtioDevice* device, idt_handler_t handler) {
+    int vector = pci_enable_msix(device->pci, 0, handler);
+
+    if (vector < 0)
+        return vector;
+
+    device->msix = true;
+    if (device->modern)
+        VIRTIO_COMMON16(device, VIRTIO_COMMON_CONFIG_VECTOR) = VIRTIO_NO_VECTOR;
+    else
+        outw(VIRTIO_NO_VECTOR, device->io_base + VIRTIO_LEGACY_CONFIG_VECTOR);
+    return vector;
+}
+
+/**************************************************************************//**
+ * @brief Agrees on the features both the driver and the device support.
+ * 
+ * The modern transport always adds VIRTIO_F_VERSION_1, which the legacy one
+ * cannot express along with anything else above bit 31.
+ * 
+ * @param device Device after virtio_pci_init().
+ * @param wanted Feature bits the driver supports.
+ * @return 0 on success, -ENODEV if the device rejects the feature set.
+ * 
+ ******************************************************************************/
+int virtio_negotiate(VirtioDevice* device, uint64_t wanted) {
+    uint8_t status = VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER;
+
+    if (!device->modern) {
+        uint32_t offered = inl(device->io_base + VIRTIO_LEGACY_HOST_FEATURES);
+
+        device->features = offered & (uint32_t) wanted;
+        outl((uint32_t) device->features, device->io_base + VIRTIO_LEGACY_GUEST_FEATURES);
+        return 0;
+    }
+
+    uint64_t offered;
+    VIRTIO_COMMON32(device, VIRTIO_COMMON_DEVICE_FEATURE_SELECT) = 0;
+    offered = VIRTIO_COMMON32(device, VIRTIO_COMMON_DEVICE_FEATURE);
+    VIRTIO_COMMON32(device, VIRTIO_COMMON_DEVICE_FEATURE_SELECT) = 1;
+    offered |= (uint64_t) VIRTIO_COMMON32(device, VIRTIO_COMMON_DEVICE_FEATURE) << 32;
+
+    wanted |= 1ULL << VIRTIO_F_VERSION_1;
+    device->features = offered & wanted;
+    if (!virtio_has_feature(device, VIRTIO_F_VERSION_1))
+        return -ENODEV;
+
+    VIRTIO_COMMON32(device, VIRTIO_COMMON_DRIVER_FEATURE_SELECT) = 0;
+    VIRTIO_COMMON32(device, VIRTIO_COMMON_DRIVER_FEATURE) = (uint32_t) device->features;
+    VIRTIO_COMMON32(device, VIRTIO_COMMON_DRIVER_FEATURE_SELECT) = 1;
+    VIRTIO_COMMON32(device, VIRTIO_COMMON_DRIVER_FEATURE) = (uint32_t) (device->features >> 32);
+
+    virtio_set_status(device, status | VIRTIO_STATUS_FEATURES_OK);
+    if (!(virtio_get_status(device) & VIRTIO_STATUS_FEATURES_OK))
+        return -ENODEV;
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Checks whether a feature was negotiated.
+ * 
+ ******************************************************************************/
+bool virtio_has_feature(const VirtioDevice* device, uint32_t bit) {
+    return (device->features >> bit) & 1;
+}
+
+/**************************************************************************//**
+ * @brief Reads a dword of the device specific configuration.
+ * 
+ ******************************************************************************/
+uint32_t virtio_config_read32(VirtioDevice* device, uint32_t offset) {
+    if (device->modern)
+        return *(volatile uint32_t*) (device->config + offset);
+    return inl(device->io_base + (device->msix ? VIRTIO_LEGACY_CONFIG_MSIX : VIRTIO_LEGACY_CONFIG) + offset);
+}
+
+/**************************************************************************//**
+ * @brief Reads a qword of the device specific configuration.
+ * 
+ * The modern transport's generation counter catches the device changing
+ * the value between the two halves.
+ * 
+ ******************************************************************************/
+uint64_t virtio_config_read64(VirtioDevice* device, uint32_t offset) {
+    uint64_t value;
+    uint8_t generation;
+
+    do {
+        generation = device->modern ? VIRTIO_COMMON8(device, VIRTIO_COMMON_CONFIG_GENERATION) : 0;
+        value = virtio_config_read32(device, offset);
+        value |= (uint64_t) virtio_config_read32(device, offset + 4) << 32;
+    } while (device->modern && generation != VIRTIO_COMMON8(device, VIRTIO_COMMON_CONFIG_GENERATION));
+    return value;
+}
+
+/**************************************************************************//**
+ * @brief Reads and thereby acknowledges the interrupt status, VIRTIO_ISR_*.
+ * 
+ * Only meaningful for INTx, MSI-X interrupts do not set it.
+ * 
+ ******************************************************************************/
+uint8_t virtio_isr_read(VirtioDevice* device) {
+    if (device->modern)
+        return *device->isr;
+    return inb(device->io_base + VIRTIO_LEGACY_ISR);
+}
+
+/**************************************************************************//**
+ * @brief Tells the device that the driver is ready, queues go live.
+ * 
+ ******************************************************************************/
+void virtio_driver_ok(VirtioDevice* device) {
+    virtio_set_status(device, virtio_get_status(device) | VIRTIO_STATUS_DRIVER_OK);
+}
+
+/**************************************************************************//**
+ * @brief Tells the device that the driver gave up on it.
+ * 
+ ******************************************************************************/
+void virtio_fail(VirtioDevice* device) {
+    virtio_set_status(device, virtio_get_status(device) | VIRTIO_STATUS_FAILED);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Checks whether an index update crossed an event
+ * index, the virtio vring_need_event().
+ * 
+ ******************************************************************************/
+static inline bool virtq_need_event(uint16_t event, uint16_t new_idx, uint16_t old_idx) {
+    return (uint16_t) (new_idx - event - 1) < (uint16_t) (new_idx - old_idx);
+}
+
+/**************************************************************************//**
+ * @brief Sets up a split virtqueue and hands it to the device.
+ * 
+ * The rings come from a static pool in kernel memory, laid out as the legacy
+ * transport requires, which satisfies the modern alignment rules as well.
+ * Modern devices get at most VIRTIO_QUEUE_MAX_SIZE entries, legacy ones
+ * cannot be resized and are refused if larger.
+ * 
+ * @param queue Queue state, filled in here.
+ * @param device Device after virtio_negotiate().
+ * @param index Queue number.
+ * @return 0 on success, -ENOENT if the queue does not exist, -ENOMEM if it
+ * is too large or the pool is used up, -EBUSY if the device refused the
+ * MSI-X vector.
+ * 
+ ******************************************************************************/
+int virtq_setup(Virtqueue* queue, VirtioDevice* device, uint16_t index) {
+    uint16_t size;
+
+    if (device->modern) {
+        VIRTIO_COMMON16(device, VIRTIO_COMMON_QUEUE_SELECT) = index;
+        size = VIRTIO_COMMON16(device, VIRTIO_COMMON_QUEUE_SIZE);
+        if (size > VIRTIO_QUEUE_MAX_SIZE)
+            size = VIRTIO_QUEUE_MAX_SIZE;
+    } else {
+        outw(index, device->io_base + VIRTIO_LEGACY_QUEUE_SELECT);
+        size = inw(device->io_base + VIRTIO_LEGACY_QUEUE_SIZE);
+    }
+    if (!size)
+        return -ENOENT;
+    if (size > VIRTIO_QUEUE_MAX_SIZE || (size & (size - 1)) || virtio_ring_count == VIRTIO_QUEUE_MAX)
+        return -ENOMEM;
+
+    uint8_t* ring = virtio_rings[virtio_ring_count++];
+    uint32_t used_offset = sizeof(VirtqDesc) * size + sizeof(VirtqAvail) + sizeof(uint16_t) * (size + 1);
+    used_offset = (used_offset + VIRTIO_QUEUE_ALIGN - 1) & ~(VIRTIO_QUEUE_ALIGN - 1);
+
+    memset(queue, 0, sizeof(*queue));
+    memset(ring, 0, VIRTIO_RING_BYTES);
+    queue->device = device;
+    queue->index = index;
+    queue->size = size;
+    queue->desc = (volatile VirtqDesc*) ring;
+    queue->avail = (volatile VirtqAvail*) (ring + sizeof(VirtqDesc) * size);
+    queue->used = (volatile VirtqUsed*) (ring + used_offset);
+    queue->used_event = &queue->avail->ring[size];
+    queue->avail_event = (volatile uint16_t*) &queue->used->ring[size];
+    queue->event_idx = virtio_has_feature(device, VIRTIO_F_RING_EVENT_IDX);
+    queue->free_count = size;
+    for (uint16_t i = 0; i < size; i++)
+        queue->desc[i].next = i + 1;
+
+    if (device->modern) {
+        VIRTIO_COMMON16(device, VIRTIO_COMMON_QUEUE_SIZE) = size;
+        if (device->msix) {
+            VIRTIO_COMMON16(device, VIRTIO_COMMON_QUEUE_VECTOR) = 0;
+            if (VIRTIO_COMMON16(device, VIRTIO_COMMON_QUEUE_VECTOR) == VIRTIO_NO_VECTOR)
+                return -EBUSY;
+        }
+        // Kernel memory is identity mapped, so these are physical addresses
+        VIRTIO_COMMON32(device, VIRTIO_COMMON_QUEUE_DESC) = (uint32_t) queue->desc;
+        VIRTIO_COMMON32(device, VIRTIO_COMMON_QUEUE_DESC + 4) = 0;
+        VIRTIO_COMMON32(device, VIRTIO_COMMON_QUEUE_DRIVER) = (uint32_t) queue->avail;
+        VIRTIO_COMMON32(device, VIRTIO_COMMON_QUEUE_DRIVER + 4) = 0;
+        VIRTIO_COMMON32(device, VIRTIO_COMMON_QUEUE_DEVICE) = (uint32_t) queue->used;
+        VIRTIO_COMMON32(device, VIRTIO_COMMON_QUEUE_DEVICE + 4) = 0;
+        queue->doorbell = (volatile uint16_t*) (device->notify
+            + VIRTIO_COMMON16(device, VIRTIO_COMMON_QUEUE_NOTIFY_OFF) * device->notify_multiplier);
+        VIRTIO_COMMON16(device, VIRTIO_COMMON_QUEUE_ENABLE) = 1;
+    } else {
+        if (device->msix) {
+            outw(0, device->io_base + VIRTIO_LEGACY_QUEUE_VECTOR);
+            if (inw(device->io_base + VIRTIO_LEGACY_QUEUE_VECTOR) == VIRTIO_NO_VECTOR)
+                return -EBUSY;
+        }
+        outl((uint32_t) ring / VIRTIO_QUEUE_ALIGN, device->io_base + VIRTIO_LEGACY_QUEUE_PFN);
+    }
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Queues a descriptor chain, without telling the device yet.
+ * 
+ * The buffers are used in place, one descriptor each, so the data is never
+ * copied. Device readable buffers come first. The chain becomes visible to
+ * the device with the next virtq_kick(), so any number of chains can be
+ * added per doorbell.
+ * 
+ * @param queue Queue after virtq_setup().
+ * @param buffers Scatter-gather list of kernel memory.
+ * @param out Number of leading buffers the device reads.
+ * @param in Number of trailing buffers the device writes.
+ * @param token Returned by virtq_get() on completion, not NULL.
+ * @return 0 on success, -EINVAL for an empty list, -EFAULT for a buffer
+ * outside kernel memory, -ENOSPC if not enough descriptors are free.
+ * 
+ ******************************************************************************/
+int virtq_add(Virtqueue* queue, const VirtqBuffer* buffers, uint32_t out, uint32_t in, void* token) {
+    uint32_t count = out + in;
+
+    if (!count || !token)
+        return -EINVAL;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t start = (uint32_t) buffers[i].data;
+
+        if (start + buffers[i].length > KERNEL_SPACE_END || start + buffers[i].length < start)
+            return -EFAULT;
+    }
+
+    uint32_t flags = cpu_irq_save();
+    if (count > queue->free_count) {
+        cpu_irq_restore(flags);
+        return -ENOSPC;
+    }
+
+    // Free descriptors are linked through next, the chain reuses those links
+    uint16_t head = queue->free_head;
+    uint16_t index = head;
+    for (uint32_t i = 0; i < count; i++) {
+        volatile VirtqDesc* desc = &queue->desc[index];
+
+        desc->addr = (uint32_t) buffers[i].data;
+        desc->len = buffers[i].length;
+        desc->flags = (i >= out ? VIRTQ_DESC_F_WRITE : 0) | (i + 1 < count ? VIRTQ_DESC_F_NEXT : 0);
+        index = desc->next;
+    }
+    queue->free_head = index;
+    queue->free_count -= count;
+    queue->tokens[head] = token;
+
+    queue->avail->ring[queue->avail_idx & (queue->size - 1)] = head;
+    queue->avail_idx++;
+    queue->stats.added++;
+
+    cpu_irq_restore(flags);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Publishes the chains added since the last kick.
+ * 
+ * The doorbell is only written if the device asked for it: with
+ * VIRTIO_F_RING_EVENT_IDX when the batch crossed its avail_event, otherwise
+ * unless it set VIRTQ_USED_F_NO_NOTIFY. A device that is still working
+ * through the ring picks the new chains up without a VM exit.
+ * 
+ * @return True if the doorbell was written.
+ * 
+ ******************************************************************************/
+bool virtq_kick(Virtqueue* queue) {
+    uint32_t flags = cpu_irq_save();
+    uint16_t new_idx = queue->avail_idx;
+    uint16_t old_idx = queue->kicked_idx;
+    bool notify;
+
+    if (new_idx == old_idx) {
+        cpu_irq_restore(flags);
+        return false;
+    }
+
+    virtio_barrier();
+    queue->avail->idx = new_idx;
+    queue->kicked_idx = new_idx;
+    virtio_fence();
+
+    if (queue->event_idx)
+        notify = virtq_need_event(*queue->avail_event, new_idx, old_idx);
+    else
+        notify = !(queue->used->flags & VIRTQ_USED_F_NO_NOTIFY);
+
+    if (notify) {
+        if (queue->device->modern)
+            *queue->doorbell = queue->index;
+        else
+            outw(queue->index, queue->device->io_base + VIRTIO_LEGACY_QUEUE_NOTIFY);
+        queue->stats.kicks++;
+    } else {
+        queue->stats.kicks_suppressed++;
+    }
+
+    cpu_irq_restore(flags);
+    return notify;
+}
+
+/**************************************************************************//**
+ * @brief Takes the next completed chain off the used ring.
+ * 
+ * @param queue Queue after virtq_setup().
+ * @param length Set to the number of bytes the device wrote, may be NULL.
+ * @return Token passed to virtq_add(), NULL if nothing has completed.
+ * 
+ ******************************************************************************/
+void* virtq_get(Virtqueue* queue, uint32_t* length) {
+    uint32_t flags = cpu_irq_save();
+
+    if (queue->last_used == queue->used->idx) {
+        cpu_irq_restore(flags);
+        return NULL;
+    }
+    virtio_barrier();
+
+    volatile VirtqUsedElem* elem = &queue->used->ring[queue->last_used & (queue->size - 1)];
+    uint16_t head = elem->id;
+    void* token = queue->tokens[head];
+
+    if (length)
+        *length = elem->len;
+    queue->last_used++;
+    queue->tokens[head] = NULL;
+
+    uint16_t index = head;
+    uint16_t count = 1;
+    while (queue->desc[index].flags & VIRTQ_DESC_F_NEXT) {
+        index = queue->desc[index].next;
+        count++;
+    }
+    queue->desc[index].next = queue->free_head;
+    queue->free_head = head;
+    queue->free_count += count;
+    queue->stats.completed++;
+
+    cpu_irq_restore(flags);
+    return token;
+}
+
+/**************************************************************************//**
+ * @brief Asks the device not to interrupt, while completions are polled.
+ * 
+ * With VIRTIO_F_RING_EVENT_IDX nothing needs to be written: the device only
+ * interrupts when it passes used_event, which stays behind until
+ * virtq_enable_cb() moves it.
+ * 
+ ******************************************************************************/
+void virtq_disable_cb(Virtqueue* queue) {
+    if (!queue->event_idx)
+        queue->avail->flags |= VIRTQ_AVAIL_F_NO_INTERRUPT;
+}
+
+/**************************************************************************//**
+ * @brief Re-arms the completion interrupt after polling.
+ * 
+ * With VIRTIO_F_RING_EVENT_IDX the interrupt is held back until batch more
+ * chains have completed, so one interrupt covers several completions. The
+ * batch is capped at the chains in flight, so the interrupt always comes.
+ * 
+ * @param queue Queue after virtq_setup().
+ * @param batch Completions to collect per interrupt, 0 or 1 for each one.
+ * @return True if it is safe to wait for the interrupt, false if enough
+ * completions raced in that the caller has to poll again.
+ * 
+ ******************************************************************************/
+bool virtq_enable_cb(Virtqueue* queue, uint16_t batch) {
+    uint32_t flags = cpu_irq_save();
+    uint16_t in_flight = queue->kicked_idx - queue->last_used;
+    bool armed;
+
+    if (batch > in_flight)
+        batch = in_flight;
+    if (!batch)
+        batch = 1;
+
+    if (queue->event_idx)
+        *queue->used_event = queue->last_used + batch - 1;
+    else
+        queue->avail->flags &= ~VIRTQ_AVAIL_F_NO_INTERRUPT;
+    virtio_fence();
+
+    uint16_t completed = queue->used->idx - queue->last_used;
+    armed = queue->event_idx ? completed < batch : !completed;
+
+    cpu_irq_restore(flags);
+    return armed;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the number of free descriptors.
+ * 
+ ******************************************************************************/
+uint32_t virtq_free_count(const Virtqueue* queue) {
+    return queue->free_count;
+}
@@ -0,0 +1,570 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <kernel/cpu.h>
+#include <kernel/frame.h>
+#include <kernel/idt.h>
+#include <kernel/init.h>
+#include <kernel/pci.h>
+#include <kernel/pic.h>
+#include <kernel/softirq.h>
+#include <kernel/thread.h>
+#include <kernel/tsc.h>
+#include <kernel/tty.h>
+#include <kernel/virtio.h>
+#include <kernel/virtio_blk.h>
+
+#define VIRTIO_BLK_FEATURES ((1ULL << VIRTIO_BLK_F_SIZE_MAX) | (1ULL << VIRTIO_BLK_F_SEG_MAX) \
+    | (1ULL << VIRTIO_BLK_F_RO) | (1ULL << VIRTIO_BLK_F_BLK_SIZE) | (1ULL << VIRTIO_BLK_F_FLUSH) \
+    | (1ULL << VIRTIO_F_RING_EVENT_IDX))
+#define VIRTIO_BLK_STATUS_PENDING 0xFF
+
+#define VIRTIO_BLK_BENCH_MS 200
+#define VIRTIO_BLK_BENCH_DEPTH_MAX 64
+#define VIRTIO_BLK_BENCH_BLOCK 4096
+#define VIRTIO_BLK_BENCH_SPAN (1024 * 1024 * 1024 / VIRTIO_BLK_SECTOR_SIZE) // sectors
+
+typedef struct VirtioBlkStats {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t errors;
+    uint32_t interrupts;
+    uint32_t polls;      // softirq passes over the used ring
+    uint32_t max_batch;  // most completions taken in one pass
+} VirtioBlkStats;
+
+struct VirtioBlk {
+    VirtioDevice device;
+    Virtqueue queue;
+    uint64_t capacity;    // sectors
+    uint32_t segment_max; // data segments per request
+    uint32_t size_max;    // bytes per segment, 0 if unlimited
+    uint32_t block_size;
+    bool read_only;
+    uint32_t in_flight;
+    VirtioBlkStats stats;
+};
+
+typedef struct VirtioBlkBench {
+    VirtioBlk* disk;
+    uint64_t deadline;   // TSC
+    uint64_t blocks;     // VIRTIO_BLK_BENCH_BLOCK sized blocks in range
+    uint32_t seed;
+    uint32_t in_flight;
+    uint32_t completed;
+    Thread* waiter;
+} VirtioBlkBench;
+
+static const PciId virtio_blk_ids[] = {
+    PCI_ID_DEVICE(VIRTIO_PCI_VENDOR, VIRTIO_PCI_LEGACY_BASE + VIRTIO_BLK_ID - 1),
+    PCI_ID_DEVICE(VIRTIO_PCI_VENDOR, VIRTIO_PCI_MODERN_BASE + VIRTIO_BLK_ID),
+    { 0 },
+};
+
+static int virtio_blk_probe(PciDevice* pci);
+
+static const PciDriver virtio_blk_driver = {
+    .name = "virtio-blk",
+    .ids = virtio_blk_ids,
+    .probe = virtio_blk_probe,
+};
+
+static VirtioBlk virtio_blk_disks[VIRTIO_BLK_MAX];
+static uint32_t virtio_blk_count;
+static uint8_t virtio_blk_irq_lines; // bit per INTx line with the handler installed
+
+static VirtioBlkRequest virtio_blk_bench_requests[VIRTIO_BLK_BENCH_DEPTH_MAX];
+static VirtioBlkBench virtio_blk_bench;
+
+/**************************************************************************//**
+ * @brief Local function. Interrupt handler for all disks.
+ * 
+ * Only acknowledges the interrupt, completions are taken off the used rings
+ * by the block softirq. Disks on INTx may share a line, so every one of
+ * them is asked. MSI-X vectors are not shared, so the vector tells which
+ * disk it was.
+ * 
+ ******************************************************************************/
+static void virtio_blk_interrupt(InterruptFrame* frame) {
+    bool pending = false;
+
+    for (uint32_t i = 0; i < virtio_blk_count; i++) {
+        VirtioBlk* disk = &virtio_blk_disks[i];
+
+        if (disk->device.msix) {
+            if (frame->vector != disk->device.pci->msi_vector)
+                continue;
+        } else if (!(virtio_isr_read(&disk->device) & VIRTIO_ISR_QUEUE)) {
+            continue;
+        }
+        disk->stats.interrupts++;
+        pending = true;
+    }
+    if (pending)
+        softirq_raise(SOFTIRQ_BLOCK);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Completes everything on a disk's used ring.
+ * 
+ * Polls until the device is idle or the interrupt has been re-armed without
+ * a race. The interrupt is held back until half of the requests still in
+ * flight have completed, so a deep queue costs one interrupt per batch
+ * rather than per request, while the other half keeps the device busy.
+ * Requests the callbacks resubmit go out with one kick per pass.
+ * 
+ ******************************************************************************/
+static void virtio_blk_poll(VirtioBlk* disk) {
+    Virtqueue* queue = &disk->queue;
+    VirtioBlkRequest* request;
+
+    do {
+        uint32_t batch = 0;
+
+        virtq_disable_cb(queue);
+        for (;;) {
+            uint32_t flags = cpu_irq_save();
+
+            request = virtq_get(queue, NULL);
+            if (request)
+                disk->in_flight--;
+            cpu_irq_restore(flags);
+            if (!request)
+                break;
+
+            batch++;
+            disk->stats.completed++;
+            if (request->status == VIRTIO_BLK_S_OK) {
+                request->result = 0;
+            } else {
+                request->result = request->status == VIRTIO_BLK_S_UNSUPP ? -ENOSYS : -EIO;
+                disk->stats.errors++;
+            }
+            if (request->callback)
+                request->callback(request);
+        }
+
+        disk->stats.polls++;
+        if (batch > disk->stats.max_batch)
+            disk->stats.max_batch = batch;
+        virtq_kick(queue);
+    } while (!virtq_enable_cb(queue, disk->in_flight / 2));
+}
+
+/**************************************************************************//**
+ * @brief Local function. Block softirq, completes requests on all disks.
+ * 
+ ******************************************************************************/
+static void virtio_blk_softirq() {
+    for (uint32_t i = 0; i < virtio_blk_count; i++)
+        virtio_blk_poll(&virtio_blk_disks[i]);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Sets up the disk's interrupt, MSI-X if possible.
+ * 
+ * @return 0 on success, -ENODEV if the disk has no usable interrupt.
+ * 
+ ******************************************************************************/
+static int virtio_blk_setup_irq(VirtioBlk* disk) {
+    PciDevice* pci = disk->device.pci;
+
+    if (virtio_enable_msix(&disk->device, virtio_blk_interrupt) >= 0)
+        return 0;
+    if (!pci->irq_pin || pci->irq_line >= 16)
+        return -ENODEV;
+
+    if (!(virtio_blk_irq_lines & (1U << pci->irq_line))) {
+        virtio_blk_irq_lines |= 1U << pci->irq_line;
+        idt_register_irq_handler(pci->irq_line, virtio_blk_interrupt);
+        pic_clearInterruptMask(pci->irq_line);
+    }
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Undoes virtio_blk_setup_irq() for a disk that is
+ * not bound after all.
+ * 
+ * A legacy line is only given up if no bound disk shares it.
+ * 
+ ******************************************************************************/
+static void virtio_blk_release_irq(VirtioBlk* disk) {
+    PciDevice* pci = disk->device.pci;
+
+    if (disk->device.msix) {
+        pci_disable_msi(pci);
+        disk->device.msix = false;
+        return;
+    }
+    if (!pci->irq_pin || pci->irq_line >= 16 || !(virtio_blk_irq_lines & (1U << pci->irq_line)))
+        return;
+    for (uint32_t i = 0; i < virtio_blk_count; i++) {
+        if (!virtio_blk_disks[i].device.msix && virtio_blk_disks[i].device.pci->irq_line == pci->irq_line)
+            return;
+    }
+    pic_setInterruptMask(pci->irq_line);
+    idt_register_irq_handler(pci->irq_line, NULL);
+    virtio_blk_irq_lines &= ~(1U << pci->irq_line);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Binds a virtio block device.
+ * 
+ ******************************************************************************/
+static int virtio_blk_probe(PciDevice* pci) {
+    if (virtio_blk_count == VIRTIO_BLK_MAX)
+        return -ENOMEM;
+
+    VirtioBlk* disk = &virtio_blk_disks[virtio_blk_count];
+    VirtioDevice* device = &disk->device;
+    int error = virtio_pci_init(device, pci);
+
+    if (error)
+        return error;
+    if ((error = virtio_blk_setup_irq(disk))) {
+        virtio_fail(device);
+        return error;
+    }
+    if ((error = virtio_negotiate(device, VIRTIO_BLK_FEATURES)) || (error = virtq_setup(&disk->queue, device, 0))) {
+        virtio_fail(device);
+        virtio_blk_release_irq(disk);
+        return error;
+    }
+
+    disk->capacity = virtio_config_read64(device, VIRTIO_BLK_CONFIG_CAPACITY);
+    disk->segment_max = VIRTIO_BLK_SEGMENT_MAX;
+    if (virtio_has_feature(device, VIRTIO_BLK_F_SEG_MAX)) {
+        uint32_t segment_max = virtio_config_read32(device, VIRTIO_BLK_CONFIG_SEG_MAX);
+        if (segment_max && segment_max < disk->segment_max)
+            disk->segment_max = segment_max;
+    }
+    if (virtio_has_feature(device, VIRTIO_BLK_F_SIZE_MAX))
+        disk->size_max = virtio_config_read32(device, VIRTIO_BLK_CONFIG_SIZE_MAX);
+    disk->block_size = VIRTIO_BLK_SECTOR_SIZE;
+    if (virtio_has_feature(device, VIRTIO_BLK_F_BLK_SIZE))
+        disk->block_size = virtio_config_read32(device, VIRTIO_BLK_CONFIG_BLK_SIZE);
+    disk->read_only = virtio_has_feature(device, VIRTIO_BLK_F_RO);
+
+    pci->driver_data = disk;
+    virtio_blk_count++;
+    virtio_driver_ok(device);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Registers the virtio block driver and its softirq.
+ * 
+ ******************************************************************************/
+__init void virtio_blk_init() {
+    softirq_register(SOFTIRQ_BLOCK, virtio_blk_softirq);
+    pci_register_driver(&virtio_blk_driver);
+
+    term_writestring("\nvirtio-blk initialized.");
+}
+
+/**************************************************************************//**
+ * @brief Retrieves a disk by probe order.
+ * 
+ * @return Disk, NULL if there are not that many.
+ * 
+ ******************************************************************************/
+VirtioBlk* virtio_blk_get(uint32_t index) {
+    return index < virtio_blk_count ? &virtio_blk_disks[index] : NULL;
+}
+
+/**************************************************************************//**
+ * @brief Retrieves the size of a disk in VIRTIO_BLK_SECTOR_SIZE sectors.
+ * 
+ ******************************************************************************/
+uint64_t virtio_blk_capacity(const VirtioBlk* disk) {
+    return disk->capacity;
+}
+
+/**************************************************************************//**
+ * @brief Queues a request, without telling the device yet.
+ * 
+ * Requests are passed to the device by virtio_blk_kick(), so submitting a
+ * batch first costs one doorbell write at most. Requests submitted from a
+ * completion callback need no kick.
+ * 
+ * @param disk Disk from virtio_blk_get().
+ * @param request Request with header, segments and callback filled in.
+ * @return 0 on success, -EINVAL for a malformed request, -EROFS for a write
+ * to a read-only disk, -ENOSPC if the queue is full, -EFAULT for a segment
+ * outside kernel memory.
+ * 
+ ******************************************************************************/
+int virtio_blk_submit(VirtioBlk* disk, VirtioBlkRequest* request) {
+    VirtqBuffer buffers[VIRTIO_BLK_SEGMENT_MAX + 2];
+    uint32_t type = request->header.type;
+    uint32_t count = request->segment_count;
+
+    if (type == VIRTIO_BLK_T_FLUSH ? count != 0 : (count == 0 || count > disk->segment_max))
+        return -EINVAL;
+    if (type != VIRTIO_BLK_T_IN && type != VIRTIO_BLK_T_OUT && type != VIRTIO_BLK_T_FLUSH)
+        return -EINVAL;
+    if (type == VIRTIO_BLK_T_OUT && disk->read_only)
+        return -EROFS;
+
+    uint32_t bytes = 0;
+    buffers[0].data = &request->header;
+    buffers[0].length = sizeof(request->header);
+    for (uint32_t i = 0; i < count; i++) {
+        if (disk->size_max && request->segments[i].length > disk->size_max)
+            return -EINVAL;
+        buffers[i + 1] = request->segments[i];
+        bytes += request->segments[i].length;
+    }
+    if (bytes % VIRTIO_BLK_SECTOR_SIZE
+        || request->header.sector + bytes / VIRTIO_BLK_SECTOR_SIZE > disk->capacity)
+        return -EINVAL;
+    buffers[count + 1].data = (void*) &request->status;
+    buffers[count + 1].length = sizeof(request->status);
+
+    request->header.reserved = 0;
+    request->status = VIRTIO_BLK_STATUS_PENDING;
+
+    uint32_t out = type == VIRTIO_BLK_T_OUT ? count + 1 : 1;
+    uint32_t flags = cpu_irq_save();
+    int error = virtq_add(&disk->queue, buffers, out, count + 2 - out, request);
+
+    if (!error) {
+        disk->in_flight++;
+        disk->stats.submitted++;
+    }
+    cpu_irq_restore(flags);
+    return error;
+}
+
+/**************************************************************************//**
+ * @brief Passes the requests submitted since the last kick to the device.
+ * 
+ ******************************************************************************/
+void virtio_blk_kick(VirtioBlk* disk) {
+    virtq_kick(&disk->queue);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Completion callback of virtio_blk_transfer().
+ * 
+ ******************************************************************************/
+static void virtio_blk_wake(VirtioBlkRequest* request) {
+    Thread* waiter = request->arg;
+
+    request->arg = NULL;
+    thread_wake(waiter);
+}
+
+/**************************************************************************//**
+ * @brief Local function. Transfers a buffer and blocks until it is done.
+ * 
+ * The buffer is split into segments no larger than the device allows, each
+ * pointing into the buffer itself.
+ * 
+ ******************************************************************************/
+static int virtio_blk_transfer(VirtioBlk* disk, uint32_t type, uint64_t sector, void* buffer, uint32_t bytes) {
+    VirtioBlkRequest request;
+    uint32_t segment = disk->size_max ? disk->size_max & ~(VIRTIO_BLK_SECTOR_SIZE - 1) : bytes;
+    uint8_t* data = buffer;
+
+    if (!bytes || !segment)
+        return -EINVAL;
+
+    request.header.type = type;
+    request.header.sector = sector;
+    request.segment_count = 0;
+    while (bytes) {
+        uint32_t length = bytes < segment ? bytes : segment;
+
+        if (request.segment_count == VIRTIO_BLK_SEGMENT_MAX)
+            return -EINVAL;
+        request.segments[request.segment_count].data = data;
+        request.segments[request.segment_count].length = length;
+        request.segment_count++;
+        data += length;
+        bytes -= length;
+    }
+    request.callback = virtio_blk_wake;
+    request.arg = thread_current();
+
+    uint32_t flags = cpu_irq_save();
+    int error = virtio_blk_submit(disk, &request);
+
+    if (!error) {
+        virtio_blk_kick(disk);
+        while (request.arg)
+            thread_block();
+        error = request.result;
+    }
+    cpu_irq_restore(flags);
+    return error;
+}
+
+/**************************************************************************//**
+ * @brief Reads sectors into a buffer, blocking the calling thread.
+ * 
+ * @param disk Disk from virtio_blk_get().
+ * @param sector First sector.
+ * @param buffer Kernel memory, filled by the device directly.
+ * @param bytes Multiple of VIRTIO_BLK_SECTOR_SIZE.
+ * @return 0 on success, a negated errno value otherwise.
+ * 
+ ******************************************************************************/
+int virtio_blk_read(VirtioBlk* disk, uint64_t sector, void* buffer, uint32_t bytes) {
+    return virtio_blk_transfer(disk, VIRTIO_BLK_T_IN, sector, buffer, bytes);
+}
+
+/**************************************************************************//**
+ * @brief Writes sectors from a buffer, blocking the calling thread.
+ * 
+ * @param disk Disk from virtio_blk_get().
+ * @param sector First sector.
+ * @param buffer Kernel memory, read by the device directly.
+ * @param bytes Multiple of VIRTIO_BLK_SECTOR_SIZE.
+ * @return 0 on success, a negated errno value otherwise.
+ * 
+ ******************************************************************************/
+int virtio_blk_write(VirtioBlk* disk, uint64_t sector, const void* buffer, uint32_t bytes) {
+    return virtio_blk_transfer(disk, VIRTIO_BLK_T_OUT, sector, (void*) buffer, bytes);
+}
+
+/**************************************************************************//**
+ * @brief Prints the disks found and their request statistics.
+ * 
+ ******************************************************************************/
+void virtio_blk_report() {
+    for (uint32_t i = 0; i < virtio_blk_count; i++) {
+        VirtioBlk* disk = &virtio_blk_disks[i];
+        VirtioDevice* device = &disk->device;
+
+        printf("\nvirtio-blk%u: %02x:%02x.%u %s, %llu MiB, %u byte blocks, %u segments, queue %u%s%s%s",
+            i, device->pci->bus, device->pci->slot, device->pci->function,
+            device->modern ? "modern" : "legacy", disk->capacity * VIRTIO_BLK_SECTOR_SIZE >> 20,
+            disk->block_size, disk->segment_max, disk->queue.size,
+            disk->queue.event_idx ? ", event idx" : "", device->msix ? ", msi-x" : ", intx",
+            disk->read_only ? ", read-only" : "");
+        printf("\nvirtio-blk%u: %u requests, %u errors, %u kicks (%u suppressed), %u interrupts, %u polls, max batch %u",
+            i, disk->stats.submitted, disk->stats.errors, disk->queue.stats.kicks,
+            disk->queue.stats.kicks_suppressed, disk->stats.interrupts, disk->stats.polls,
+            disk->stats.max_batch);
+    }
+}
+
+/**************************************************************************//**
+ * @brief Local function. Submits a benchmark read of a random block.
+ * 
+ ******************************************************************************/
+static void virtio_blk_bench_issue(VirtioBlkRequest* request) {
+    VirtioBlkBench* bench = &virtio_blk_bench;
+
+    bench->seed = bench->seed * 1103515245 + 12345;
+    request->header.sector = (bench->seed >> 4) % bench->blocks * (VIRTIO_BLK_BENCH_BLOCK / VIRTIO_BLK_SECTOR_SIZE);
+    if (virtio_blk_submit(bench->disk, request))
+        bench->in_flight--;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Completion callback of virtio_blk_benchmark().
+ * 
+ * Keeps the queue depth up by resubmitting until the run is over.
+ * 
+ ******************************************************************************/
+static void virtio_blk_bench_done(VirtioBlkRequest* request) {
+    VirtioBlkBench* bench = &virtio_blk_bench;
+
+    bench->completed++;
+    if (tsc_read() < bench->deadline)
+        virtio_blk_bench_issue(request);
+    else
+        bench->in_flight--;
+
+    if (!bench->in_flight)
+        thread_wake(bench->waiter);
+}
+
+/**************************************************************************//**
+ * @brief Measures random 4 KiB reads on the first disk per queue depth.
+ * 
+ * Runs VIRTIO_BLK_BENCH_MS per depth from 1 to 64, keeping that many reads
+ * in flight, over the first GiB of the disk. Prints IOPS, throughput and
+ * how many requests each doorbell write and each interrupt covered. Only
+ * reads, so any disk image can be used.
+ * 
+ ******************************************************************************/
+void virtio_blk_benchmark() {
+    VirtioBlkBench* bench = &virtio_blk_bench;
+    VirtioBlk* disk = virtio_blk_get(0);
+    uint32_t buffers[VIRTIO_BLK_BENCH_DEPTH_MAX];
+
+    if (!disk) {
+        printf("\nvirtio-blk: no disk to benchmark");
+        return;
+    }
+
+    // Header, data and status descriptor per request
+    uint32_t depth_max = disk->queue.size / 3;
+    if (depth_max > VIRTIO_BLK_BENCH_DEPTH_MAX)
+        depth_max = VIRTIO_BLK_BENCH_DEPTH_MAX;
+
+    uint64_t span = disk->capacity < VIRTIO_BLK_BENCH_SPAN ? disk->capacity : VIRTIO_BLK_BENCH_SPAN;
+    bench->disk = disk;
+    bench->blocks = span / (VIRTIO_BLK_BENCH_BLOCK / VIRTIO_BLK_SECTOR_SIZE);
+    bench->seed = 1;
+    bench->waiter = thread_current();
+    if (!bench->blocks) {
+        printf("\nvirtio-blk: disk too small to benchmark");
+        return;
+    }
+
+    uint32_t allocated;
+    for (allocated = 0; allocated < depth_max; allocated++) {
+        VirtioBlkRequest* request = &virtio_blk_bench_requests[allocated];
+
+        if (!(buffers[allocated] = frame_alloc()))
+            break;
+        request->header.type = VIRTIO_BLK_T_IN;
+        request->segments[0].data = (void*) buffers[allocated];
+        request->segments[0].length = VIRTIO_BLK_BENCH_BLOCK;
+        request->segment_count = 1;
+        request->callback = virtio_blk_bench_done;
+    }
+
+    for (uint32_t depth = 1; depth <= allocated; depth *= 2) {
+        uint32_t kicks = disk->queue.stats.kicks;
+        uint32_t interrupts = disk->stats.interrupts;
+        uint32_t errors = disk->stats.errors;
+        uint64_t start = tsc_read();
+
+        bench->completed = 0;
+        bench->deadline = start + (uint64_t) VIRTIO_BLK_BENCH_MS * tsc_khz();
+
+        uint32_t flags = cpu_irq_save();
+        bench->in_flight = depth;
+        for (uint32_t i = 0; i < depth; i++)
+            virtio_blk_bench_issue(&virtio_blk_bench_requests[i]);
+        virtio_blk_kick(disk);
+        while (bench->in_flight)
+            thread_block();
+        cpu_irq_restore(flags);
+
+        uint64_t elapsed_us = tsc_cycles_to_us(tsc_read() - start);
+        uint64_t iops = elapsed_us ? (uint64_t) bench->completed * 1000000 / elapsed_us : 0;
+        uint64_t kib_per_s = iops * (VIRTIO_BLK_BENCH_BLOCK / 1024);
+        kicks = disk->queue.stats.kicks - kicks;
+        interrupts = disk->stats.interrupts - interrupts;
+
+        printf("\nvirtio-blk: qd %u: %llu IOPS, %llu.%llu MiB/s, %u reads per kick, %u per interrupt, %u errors",
+            depth, iops, kib_per_s / 1024, kib_per_s % 1024 * 10 / 1024,
+            kicks ? bench->completed / kicks : bench->completed,
+            interrupts ? bench->completed / interrupts : bench->completed, disk->stats.errors - errors);
+    }
+    if (allocated < VIRTIO_BLK_BENCH_DEPTH_MAX)
+        printf("\nvirtio-blk: queue depth capped at %u", allocated);
+
+    for (uint32_t i = 0; i < allocated; i++)
+        frame_unref(buffers[i]);
+}
@@ -0,0 +1,720 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <kernel/cpu.h>
+#include <kernel/frame.h>
+#include <kernel/paging.h>
+#include <kernel/tmpfs.h>
+#include <kernel/tsc.h>
+#include <kernel/vm.h>
+
+#define VM_TABLE_SPAN (1024 * PAGE_SIZE) // user space covered by one page table
+
+static AddressSpace vm_spaces[VM_SPACE_MAX];
+
+/**************************************************************************//**
+ * @brief Local function. Takes a free address space from the pool.
+ * 
+ * @return Address space with an empty user space, NULL if none is left.
+ * 
+ ******************************************************************************/
+static AddressSpace* vm_space_alloc() {
+    uint32_t flags = cpu_irq_save();
+    AddressSpace* space = NULL;
+
+    for (size_t i = 0; i < VM_SPACE_MAX; i++) {
+        if (!vm_spaces[i].in_use) {
+            space = &vm_spaces[i];
+            space->in_use = true;
+            break;
+        }
+    }
+    cpu_irq_restore(flags);
+
+    if (!space)
+        return NULL;
+
+    memset(space->regions, 0, sizeof(space->regions));
+    memset(&space->stats, 0, sizeof(space->stats));
+    space->directory = paging_create_directory();
+    if (!space->directory) {
+        space->in_use = false;
+        return NULL;
+    }
+    return space;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Finds the region containing an address.
+ * 
+ ******************************************************************************/
+static VmRegion* vm_find_region(AddressSpace* space, uint32_t address) {
+    for (size_t i = 0; i < VM_REGION_MAX; i++) {
+        VmRegion* region = &space->regions[i];
+
+        if (region->in_use && address >= region->start && address < region->end)
+            return region;
+    }
+    return NULL;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Adds a region to an address space.
+ * 
+ * @return 0 on success, -EINVAL for a range outside user space or overlapping
+ * another region, -ENOMEM if the region table is full. The new region is
+ * stored in added, unless that is NULL.
+ * 
+ ******************************************************************************/
+static int vm_add_region(AddressSpace* space, uint32_t start, uint32_t size, uint32_t flags,
+    const uint8_t* file, uint32_t file_start, uint32_t file_size, VmRegion** added) {
+    uint32_t region_start = start & PAGE_MASK;
+    uint32_t region_end = (start + size + PAGE_SIZE - 1) & PAGE_MASK;
+    VmRegion* free_region = NULL;
+
+    if (!size || region_start < USER_SPACE_START || region_end > USER_SPACE_END || region_end <= region_start)
+        return -EINVAL;
+
+    for (size_t i = 0; i < VM_REGION_MAX; i++) {
+        VmRegion* region = &space->regions[i];
+
+        if (!region->in_use) {
+            if (!free_region)
+                free_region = region;
+        } else if (region_start < region->end && region_end > region->start) {
+            return -EINVAL;
+        }
+    }
+    if (!free_region)
+        return -ENOMEM;
+
+    free_region->start = region_start;
+    free_region->end = region_end;
+    free_region->flags = flags;
+    free_region->file = file;
+    free_region->file_start = file_start;
+    free_region->file_size = file_size;
+    free_region->inode = NULL;
+    free_region->inode_offset = 0;
+    free_region->in_use = true;
+    if (added)
+        *added = free_region;
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Maps the first page for a not-present fault.
+ * 
+ * Pages fully covered by read-only file data that is page aligned in memory
+ * are mapped straight onto the file's (pinned) frames. Other file pages are
+ * copied into a new frame, with zeros around partial data, and pages past
+ * the file data are demand-zero. Inode regions map the page cache page
+ * itself, private writable ones copy-on-write so the first write copies it.
+ * 
+ * @return False if out of memory, or past the end of an inode's file.
+ * 
+ ******************************************************************************/
+static bool vm_fill_page(AddressSpace* space, VmRegion* region, uint32_t page, uint32_t* pte) {
+    uint32_t flags = PAGE_PRESENT | PAGE_USER | ((region->flags & VM_WRITE) ? PAGE_WRITE : 0);
+    uint32_t file_end = region->file_start + region->file_size;
+    uint32_t frame;
+
+    if (region->inode) {
+        frame = tmpfs_page(region->inode, (region->inode_offset + (page - region->start)) / PAGE_SIZE);
+        if (!frame)
+            return false;
+
+        space->stats.file_faults++;
+        space->stats.file_shared++;
+        if ((flags & PAGE_WRITE) && !(region->flags & VM_SHARED))
+            flags = (flags & ~PAGE_WRITE) | PAGE_COW;
+        frame_ref(frame);
+        *pte = frame | flags;
+        return true;
+    }
+
+    if (region->file && page < file_end && page + PAGE_SIZE > region->file_start) {
+        uint32_t from = page > region->file_start ? page : region->file_start;
+        uint32_t to = page + PAGE_SIZE < file_end ? page + PAGE_SIZE : file_end;
+        const uint8_t* data = region->file + (from - region->file_start);
+
+        space->stats.file_faults++;
+        if (!(region->flags & VM_WRITE) && from == page && to == page + PAGE_SIZE
+            && !((uint32_t) data & ~PAGE_MASK) && (uint32_t) data < KERNEL_SPACE_END) {
+            space->stats.file_shared++;
+            frame_ref((uint32_t) data);
+            *pte = (uint32_t) data | flags;
+            return true;
+        }
+
+        frame = frame_alloc();
+        if (!frame)
+            return false;
+        memset((void*) frame, 0, from - page);
+        memcpy((void*) (frame + (from - page)), data, to - from);
+        memset((void*) (frame + (to - page)), 0, page + PAGE_SIZE - to);
+    } else {
+        space->stats.zero_faults++;
+        frame = frame_alloc_zeroed();
+        if (!frame)
+            return false;
+    }
+
+    *pte = frame | flags;
+    return true;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Gives a copy-on-write page a private, writable frame.
+ * 
+ * The last sharer takes the frame over without copying.
+ * 
+ * @return False if out of memory.
+ * 
+ ******************************************************************************/
+static bool vm_break_cow(AddressSpace* space, uint32_t* pte) {
+    uint32_t old_frame = *pte & PAGE_MASK;
+    uint32_t flags = ((*pte & ~PAGE_MASK) & ~PAGE_COW) | PAGE_WRITE;
+
+    space->stats.cow_faults++;
+    if (frame_refcount(old_frame) == 1) {
+        *pte = old_frame | flags;
+        return true;
+    }
+
+    uint32_t frame = frame_alloc();
+    if (!frame)
+        return false;
+    memcpy((void*) frame, (const void*) old_frame, PAGE_SIZE);
+    *pte = frame | flags;
+    frame_unref(old_frame);
+    space->stats.cow_copies++;
+    return true;
+}
+
+/**************************************************************************//**
+ * @brief Local function. Unmaps the pages of a range and drops their frames.
+ * 
+ * Ranges without a page table are skipped a table at a time, so releasing
+ * a large, mostly untouched range is cheap.
+ * 
+ ******************************************************************************/
+static void vm_release_pages(AddressSpace* space, uint32_t start, uint32_t end) {
+    bool active = cpu_read_cr3() == space->directory;
+    uint32_t page = start;
+
+    while (page < end) {
+        uint32_t* pte = paging_get_entry(space->directory, page, false);
+
+        if (!pte) {
+            page = (page + VM_TABLE_SPAN) & ~(VM_TABLE_SPAN - 1);
+            continue;
+        }
+        if (*pte & PAGE_PRESENT) {
+            frame_unref(*pte & PAGE_MASK);
+            *pte = 0;
+            if (active)
+                paging_invalidate(page);
+            space->stats.released++;
+        }
+        page += PAGE_SIZE;
+    }
+}
+
+/**************************************************************************//**
+ * @brief Creates an address space with an empty user space.
+ * 
+ * @return New address space, NULL if out of memory or address spaces.
+ * 
+ ******************************************************************************/
+AddressSpace* vm_space_create() {
+    return vm_space_alloc();
+}
+
+/**************************************************************************//**
+ * @brief Duplicates an address space, sharing all pages copy-on-write.
+ * 
+ * @param parent Address space to duplicate.
+ * @return New address space, NULL if out of memory or address spaces.
+ * 
+ ******************************************************************************/
+AddressSpace* vm_space_clone(AddressSpace* parent) {
+    AddressSpace* space = vm_space_alloc();
+
+    if (!space)
+        return NULL;
+
+    memcpy(space->regions, parent->regions, sizeof(space->regions));
+    for (size_t i = 0; i < VM_REGION_MAX; i++) {
+        if (space->regions[i].in_use && space->regions[i].inode)
+            tmpfs_get(space->regions[i].inode);
+    }
+    if (!paging_clone_directory(parent->directory, space->directory)) {
+        vm_space_destroy(space);
+        return NULL;
+    }
+    return space;
+}
+
+/**************************************************************************//**
+ * @brief Frees an address space and drops its references to mapped frames.
+ * 
+ * If the address space is active, the kernel page directory is loaded first.
+ * 
+ * @param space Address space to free.
+ * 
+ ******************************************************************************/
+void vm_space_destroy(AddressSpace* space) {
+    if (cpu_read_cr3() == space->directory)
+        paging_activate(paging_kernel_directory());
+
+    for (size_t i = 0; i < VM_REGION_MAX; i++) {
+        if (space->regions[i].in_use && space->regions[i].inode)
+            tmpfs_put(space->regions[i].inode);
+        space->regions[i].in_use = false;
+    }
+
+    paging_destroy_directory(space->directory);
+    space->directory = 0;
+    space->in_use = false;
+}
+
+/**************************************************************************//**
+ * @brief Switches to an address space.
+ * 
+ * @param space Address space to load.
+ * 
+ ******************************************************************************/
+void vm_space_activate(AddressSpace* space) {
+    paging_activate(space->directory);
+}
+
+/**************************************************************************//**
+ * @brief Reserves demand-zero memory in an address space.
+ * 
+ * @param space Address space to map into.
+ * @param start Virtual address, rounded down to a page boundary.
+ * @param size Size in bytes, rounded up to whole pages.
+ * @param flags VM_READ, VM_WRITE and VM_EXEC.
+ * @return 0 on success, negated errno value otherwise.
+ * 
+ ******************************************************************************/
+int vm_map_anonymous(AddressSpace* space, uint32_t start, uint32_t size, uint32_t flags) {
+    return vm_add_region(space, start, size, flags, NULL, 0, 0, NULL);
+}
+
+/**************************************************************************//**
+ * @brief Maps file data into an address space, e.g. an ELF segment.
+ * 
+ * Nothing is copied here. The file must stay in memory for the lifetime of
+ * the address space and its clones.
+ * 
+ * @param space Address space to map into.
+ * @param start Virtual address of the first byte of file data.
+ * @param size Size of the mapping in bytes, at least file_size. Bytes past
+ * the file data read as zero.
+ * @param file Data to map.
+ * @param file_size Bytes of data at file.
+ * @param flags VM_READ, VM_WRITE and VM_EXEC.
+ * @return 0 on success, negated errno value otherwise.
+ * 
+ ******************************************************************************/
+int vm_map_file(AddressSpace* space, uint32_t start, uint32_t size, const uint8_t* file, uint32_t file_size, uint32_t flags) {
+    if (file_size > size)
+        return -EINVAL;
+    return vm_add_region(space, start, size, flags, file, start, file_size, NULL);
+}
+
+/**************************************************************************//**
+ * @brief Maps part of a file's page cache into an address space.
+ * 
+ * Faults map the cache pages themselves, so the mapping and read() or
+ * write() on the file see the same data. Without VM_SHARED, writes go to
+ * private copies instead. The region keeps the inode alive until it is
+ * unmapped. Touching a page past the end of the file is an invalid access.
+ * 
+ * @param space Address space to map into.
+ * @param start Virtual address, page aligned.
+ * @param size Size of the mapping in bytes.
+ * @param inode File to map.
+ * @param offset File offset mapped at start, page aligned.
+ * @param flags VM_READ, VM_WRITE, VM_EXEC and VM_SHARED.
+ * @return 0 on success, negated errno value otherwise.
+ * 
+ ******************************************************************************/
+int vm_map_inode(AddressSpace* space, uint32_t start, uint32_t size, TmpfsInode* inode, uint32_t offset, uint32_t flags) {
+    VmRegion* region;
+    int error;
+
+    if ((start & ~PAGE_MASK) || (offset & ~PAGE_MASK))
+        return -EINVAL;
+    error = vm_add_region(space, start, size, flags, NULL, 0, 0, &region);
+    if (error)
+        return error;
+
+    region->inode = inode;
+    region->inode_offset = offset;
+    tmpfs_get(inode);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Maps frames as private memory, e.g. pages from vm_take_pages().
+ * 
+ * Each frame gets a reference of the mapping's own, on top of the one the
+ * caller holds. Frames shared with anyone else are mapped copy-on-write,
+ * so only the first write to them copies. Entries of 0 are demand-zero.
+ * 
+ * @param space Address space to map into.
+ * @param start Virtual address, page aligned.
+ * @param frames One frame per page.
+ * @param count Number of pages.
+ * @param flags VM_READ, VM_WRITE and VM_EXEC.
+ * @return 0 on success, -EINVAL for a bad range, -ENOMEM if out of memory
+ * or regions.
+ * 
+ ******************************************************************************/
+int vm_map_pages(AddressSpace* space, uint32_t start, const uint32_t* frames, uint32_t count, uint32_t flags) {
+    uint32_t page_flags = PAGE_PRESENT | PAGE_USER;
+    int error;
+
+    if ((start & ~PAGE_MASK) || !count || count > (USER_SPACE_END - USER_SPACE_START) / PAGE_SIZE)
+        return -EINVAL;
+    error = vm_add_region(space, start, count * PAGE_SIZE, flags, NULL, 0, 0, NULL);
+    if (error)
+        return error;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t* pte;
+
+        if (!frames[i])
+            continue;
+        pte = paging_get_entry(space->directory, start + i * PAGE_SIZE, true);
+        if (!pte) {
+            vm_unmap(space, start, count * PAGE_SIZE);
+            return -ENOMEM;
+        }
+
+        frame_ref(frames[i]);
+        if (!(flags & VM_WRITE))
+            *pte = frames[i] | page_flags;
+        else if (frame_refcount(frames[i]) > 2) // the caller's and ours
+            *pte = frames[i] | page_flags | PAGE_COW;
+        else
+            *pte = frames[i] | page_flags | PAGE_WRITE;
+    }
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Unmaps a range but keeps its frames, e.g. to map them elsewhere.
+ * 
+ * The range must lie in private anonymous read-write memory, such as
+ * mmap() hands out. It is removed like with vm_unmap(), except that every
+ * present page leaves a reference to its frame in frames. Pages never
+ * touched come out as 0.
+ * 
+ * @param space Address space to take from.
+ * @param start Virtual address, page aligned.
+ * @param size Size in bytes, whole pages.
+ * @param frames Receives one frame per page.
+ * @return 0 on success, -EINVAL for a misaligned range or one that is not
+ * all private anonymous memory, -ENOMEM if unmapping needs a region and the
+ * table is full.
+ * 
+ ******************************************************************************/
+int vm_take_pages(AddressSpace* space, uint32_t start, uint32_t size, uint32_t* frames) {
+    uint32_t end = start + size;
+    uint32_t page;
+    int error;
+
+    if (!size || ((start | size) & ~PAGE_MASK) || end <= start)
+        return -EINVAL;
+
+    for (page = start; page < end;) {
+        const VmRegion* region = vm_find_region(space, page);
+
+        if (!region || region->file || region->inode
+            || (region->flags & (VM_READ | VM_WRITE | VM_SHARED)) != (VM_READ | VM_WRITE))
+            return -EINVAL;
+        page = region->end;
+    }
+
+    for (page = start; page < end; page += PAGE_SIZE) {
+        uint32_t* pte = paging_get_entry(space->directory, page, false);
+        uint32_t frame = pte && (*pte & PAGE_PRESENT) ? *pte & PAGE_MASK : 0;
+
+        if (frame)
+            frame_ref(frame);
+        frames[(page - start) / PAGE_SIZE] = frame;
+    }
+
+    error = vm_unmap(space, start, size);
+    if (error) {
+        for (uint32_t i = 0; i < size / PAGE_SIZE; i++) {
+            if (frames[i])
+                frame_unref(frames[i]);
+        }
+    }
+    return error;
+}
+
+/**************************************************************************//**
+ * @brief Removes a range from an address space and frees its pages.
+ * 
+ * Regions overlapping the range are trimmed, removed or, for a range in
+ * the middle of a region, split in two. Parts of the range that are not
+ * mapped are ignored.
+ * 
+ * @param space Address space to unmap from.
+ * @param start Virtual address, page aligned.
+ * @param size Size in bytes, rounded up to whole pages.
+ * @return 0 on success, -EINVAL for a range outside user space, -ENOMEM if
+ * a split needs a region and the table is full.
+ * 
+ ******************************************************************************/
+int vm_unmap(AddressSpace* space, uint32_t start, uint32_t size) {
+    uint32_t end = start + ((size + PAGE_SIZE - 1) & PAGE_MASK);
+    VmRegion* split = NULL;
+    VmRegion* spare = NULL;
+
+    if (!size || (start & ~PAGE_MASK) || start < USER_SPACE_START || end > USER_SPACE_END || end <= start)
+        return -EINVAL;
+
+    for (size_t i = 0; i < VM_REGION_MAX; i++) {
+        VmRegion* region = &space->regions[i];
+
+        if (!region->in_use) {
+            if (!spare)
+                spare = region;
+        } else if (start > region->start && end < region->end) {
+            split = region;
+        }
+    }
+    if (split && !spare)
+        return -ENOMEM;
+
+    for (size_t i = 0; i < VM_REGION_MAX; i++) {
+        VmRegion* region = &space->regions[i];
+
+        if (!region->in_use || end <= region->start || start >= region->end)
+            continue;
+
+        if (region == split) {
+            *spare = *region;
+            spare->start = end;
+            spare->inode_offset += end - region->start;
+            region->end = start;
+            if (spare->inode)
+                tmpfs_get(spare->inode);
+        } else if (start > region->start) {
+            region->end = start;
+        } else if (end < region->end) {
+            region->inode_offset += end - region->start;
+            region->start = end;
+        } else {
+            region->in_use = false;
+            if (region->inode)
+                tmpfs_put(region->inode);
+        }
+    }
+
+    vm_release_pages(space, start, end);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Drops the pages of a mapped range but keeps the mapping.
+ * 
+ * The frames go back to the kernel right away. The next touch faults the
+ * page in again, with zeros for anonymous memory and from the file
+ * otherwise.
+ * 
+ * @param space Address space to discard from.
+ * @param start Virtual address, page aligned.
+ * @param size Size in bytes, rounded up to whole pages.
+ * @return 0 on success, -EINVAL for a misaligned range, -ENOMEM if the range
+ * is not inside a single region.
+ * 
+ ******************************************************************************/
+int vm_discard(AddressSpace* space, uint32_t start, uint32_t size) {
+    uint32_t end = start + ((size + PAGE_SIZE - 1) & PAGE_MASK);
+    VmRegion* region;
+
+    if (!size || (start & ~PAGE_MASK) || end <= start)
+        return -EINVAL;
+
+    region = vm_find_region(space, start);
+    if (!region || end > region->end)
+        return -ENOMEM;
+
+    vm_release_pages(space, start, end);
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Unmaps the pages of a file from its page on, in every address space.
+ * 
+ * Called when the file shrinks, before its page cache drops those pages,
+ * so no mapping is left on a frame the cache no longer has. The regions
+ * stay, their next access past the end of the file is invalid and one
+ * after the file grew again faults in the new cache page. Private copies
+ * of the dropped pages go as well.
+ * 
+ * @param inode File whose mappings to trim.
+ * @param first First page number to unmap.
+ * 
+ ******************************************************************************/
+void vm_unmap_inode(TmpfsInode* inode, uint32_t first) {
+    uint32_t offset = first * PAGE_SIZE;
+
+    for (size_t i = 0; i < VM_SPACE_MAX; i++) {
+        AddressSpace* space = &vm_spaces[i];
+
+        if (!space->in_use)
+            continue;
+        for (size_t j = 0; j < VM_REGION_MAX; j++) {
+            VmRegion* region = &space->regions[j];
+            uint32_t start = region->start;
+
+            if (!region->in_use || region->inode != inode)
+                continue;
+            if (offset > region->inode_offset) {
+                if (offset - region->inode_offset >= region->end - region->start)
+                    continue;
+                start += offset - region->inode_offset;
+            }
+            vm_release_pages(space, start, region->end);
+        }
+    }
+}
+
+/**************************************************************************//**
+ * @brief Moves the end of an anonymous read-write region, e.g. the heap.
+ * 
+ * The region is created if there is none at start yet and removed when it
+ * shrinks to nothing. Pages cut off are freed.
+ * 
+ * @param space Address space of the region.
+ * @param start Start of the region, page aligned.
+ * @param end New end, rounded up to a page boundary.
+ * @return 0 on success, -EINVAL for a range outside user space, -ENOMEM if
+ * the region would run into another one.
+ * 
+ ******************************************************************************/
+int vm_resize(AddressSpace* space, uint32_t start, uint32_t end) {
+    VmRegion* resized = NULL;
+
+    if ((start & ~PAGE_MASK) || start < USER_SPACE_START || end < start || end > USER_SPACE_END)
+        return -EINVAL;
+    end = (end + PAGE_SIZE - 1) & PAGE_MASK;
+
+    for (size_t i = 0; i < VM_REGION_MAX && !resized; i++) {
+        VmRegion* region = &space->regions[i];
+
+        if (region->in_use && region->start == start && !region->file && !region->inode)
+            resized = region;
+    }
+    if (!resized)
+        return end == start ? 0 : vm_map_anonymous(space, start, end - start, VM_READ | VM_WRITE);
+
+    if (end > resized->end) {
+        for (size_t i = 0; i < VM_REGION_MAX; i++) {
+            VmRegion* region = &space->regions[i];
+
+            if (region->in_use && region != resized && region->start < end && region->end > resized->end)
+                return -ENOMEM;
+        }
+        resized->end = end;
+    } else if (end < resized->end) {
+        vm_release_pages(space, end, resized->end);
+        if (end == start)
+            resized->in_use = false;
+        else
+            resized->end = end;
+    }
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Finds unmapped address space, searching down from a limit.
+ * 
+ * @param space Address space to search.
+ * @param size Size in bytes, rounded up to whole pages.
+ * @param limit End of the range to search, page aligned.
+ * @return Start of the highest free range of that size below limit, 0 if
+ * there is none.
+ * 
+ ******************************************************************************/
+uint32_t vm_find_free(AddressSpace* space, uint32_t size, uint32_t limit) {
+    uint32_t end = limit < USER_SPACE_END ? limit & PAGE_MASK : USER_SPACE_END;
+
+    size = (size + PAGE_SIZE - 1) & PAGE_MASK;
+    if (!size)
+        return 0;
+
+    while (end >= USER_SPACE_START + size) {
+        uint32_t start = end - size;
+        uint32_t lowest = end;
+
+        for (size_t i = 0; i < VM_REGION_MAX; i++) {
+            const VmRegion* region = &space->regions[i];
+
+            if (region->in_use && region->start < end && region->end > start && region->start < lowest)
+                lowest = region->start;
+        }
+        if (lowest == end)
+            return start;
+        end = lowest;
+    }
+    return 0;
+}
+
+/**************************************************************************//**
+ * @brief Resolves a page fault in user space.
+ * 
+ * Maps not-present pages of a region from its file or with zeros, and
+ * breaks copy-on-write sharing on writes, except in shared regions. The
+ * time taken is accounted in the address space's statistics.
+ * 
+ * @param space Address space the fault happened in, must be active.
+ * @param address Faulting address.
+ * @param write The access was a write.
+ * @return False if the access is invalid or memory ran out.
+ * 
+ ******************************************************************************/
+bool vm_handle_fault(AddressSpace* space, uint32_t address, bool write) {
+    uint64_t start = tsc_read();
+    uint32_t page = address & PAGE_MASK;
+    VmRegion* region = vm_find_region(space, address);
+    uint32_t* pte;
+
+    if (!region || (write && !(region->flags & VM_WRITE)))
+        return false;
+
+    pte = paging_get_entry(space->directory, page, true);
+    if (!pte)
+        return false;
+
+    if (*pte & PAGE_PRESENT) {
+        if (!write || !(*pte & PAGE_COW))
+            return false;
+        if (region->flags & VM_SHARED)
+            *pte = (*pte & ~PAGE_COW) | PAGE_WRITE; // made read-only by a fork, the page stays shared
+        else if (!vm_break_cow(space, pte))
+            return false;
+    } else if (!vm_fill_page(space, region, page, pte)) {
+        return false;
+    }
+    paging_invalidate(page);
+
+    uint64_t cycles = tsc_read() - start;
+    space->stats.faults++;
+    space->stats.fault_cycles += cycles;
+    if (cycles > space->stats.fault_cycles_max)
+        space->stats.fault_cycles_max = cycles;
+    return true;
+}
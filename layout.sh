@@ -0,0 +1,88 @@
+#!/bin/sh
+# Profile-guided link order for the kernel's .text, see linker.ld.
+#
+#   layout.sh resolve DUMP KERNEL   Turns the "profile begin/end" dump from a
+#                                   KERNEL_PROFILE=1 kernel (debug console,
+#                                   e.g. ./qemu.sh -debugcon file:DUMP) into a
+#                                   profile of "calls function" lines, using
+#                                   the symbols of that same kernel.
+#   layout.sh order [PROFILE]       Prints linker script lines placing the hot
+#                                   set first, hottest first. Prints only a
+#                                   comment without a profile.
+#   layout.sh footprint PROFILE KERNEL
+#                                   Prints how many cache lines and pages the
+#                                   hot set spans in a linked kernel, to
+#                                   compare builds with and without a layout.
+#
+# The hot set is the smallest set of functions that accounts for
+# LAYOUT_HOT_PERCENT percent of all calls in the profile.
+set -e
+
+NM=${NM:-${HOST:+$HOST-}nm}
+LAYOUT_HOT_PERCENT=${LAYOUT_HOT_PERCENT:-99}
+LAYOUT_LINE_SIZE=64
+LAYOUT_PAGE_SIZE=4096
+
+hot_set() {
+  sort -k1,1nr "$1" | awk -v percent="$LAYOUT_HOT_PERCENT" '
+    { calls[NR] = $1; name[NR] = $2; total += $1 }
+    END {
+      for (i = 1; i <= NR && sum * 100 < total * percent; i++) {
+        sum += calls[i]
+        print name[i]
+      }
+    }'
+}
+
+case "$1" in
+resolve)
+  "$NM" "$3" | awk '
+    NR == FNR { if ($2 ~ /^[tT]$/) symbol[$1] = $3; next }
+    /^profile end/ { active = 0 }
+    active {
+      address = sprintf("%08s", $1)
+      gsub(/ /, "0", address)
+      print $2, (address in symbol) ? symbol[address] : "0x" $1
+    }
+    /^profile begin/ { active = 1 }' - "$2" | sort -k1,1nr
+  ;;
+order)
+  echo "/* Generated by layout.sh from ${2:-no profile}, do not edit. */"
+  if [ -n "$2" ]; then
+    hot_set "$2" | awk '{ print "*(.text." $1 ")" }'
+  fi
+  ;;
+footprint)
+  hot_set "$2" > "$2.hot"
+  "$NM" -S "$3" | awk -v line="$LAYOUT_LINE_SIZE" -v page="$LAYOUT_PAGE_SIZE" '
+    function hex(s,    i, n) {
+      n = 0
+      for (i = 1; i <= length(s); i++)
+        n = n * 16 + index("0123456789abcdef", tolower(substr(s, i, 1))) - 1
+      return n
+    }
+    NR == FNR { hot[$1] = 1; next }
+    NF == 4 && $3 ~ /^[tT]$/ && ($4 in hot) && !($4 in seen) {
+      seen[$4] = 1
+      start = hex($1)
+      end = start + hex($2) - 1
+      functions++
+      bytes += hex($2)
+      for (l = int(start / line); l <= int(end / line); l++)
+        lines[l] = 1
+      for (p = int(start / page); p <= int(end / page); p++)
+        pages[p] = 1
+    }
+    END {
+      for (l in lines) line_count++
+      for (p in pages) page_count++
+      printf "hot set: %d functions, %d bytes, %d cache lines (%d bytes of i-cache), %d pages (iTLB entries)\n",
+        functions, bytes, line_count, line_count * line, page_count
+    }' "$2.hot" -
+  rm -f "$2.hot"
+  ;;
+*)
+  echo "usage: $0 resolve DUMP KERNEL | order [PROFILE] | footprint PROFILE KERNEL" >&2
+  exit 1
+  ;;
+esac
@@ -0,0 +1,148 @@
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/channel.h>
+#include <sys/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * The ring fills the pipe's shared memory: a page of indices, then the
+ * data. Each side only writes its own index, on a cache line of its own,
+ * and sleeps on the other side's index with a futex when it cannot go on.
+ * A side about to sleep says so first, and the other side only makes the
+ * futex_wake() system call when it sees that.
+ *
+ * Records are a 32-bit length followed by the message, padded to 4 bytes.
+ * A record never wraps: if it does not fit before the end of the data, a
+ * CHANNEL_WRAP length sends the receiver back to the start. Four bytes
+ * always stay free, so a full ring never looks empty.
+ */
+#define CHANNEL_HEADER_SIZE 4096
+#define CHANNEL_DATA_SIZE (SYSCALL_PIPE_RING_SIZE - CHANNEL_HEADER_SIZE)
+#define CHANNEL_WRAP 0xFFFFFFFFu
+
+struct channel_ring {
+	volatile int head; /* offset of the next record, written by the receiver */
+	volatile int receiver_sleeping;
+	char receiver_line[56];
+	volatile int tail; /* offset past the last record, written by the sender */
+	volatile int sender_sleeping;
+	char sender_line[CHANNEL_HEADER_SIZE - 72];
+	unsigned char data[CHANNEL_DATA_SIZE];
+};
+
+static inline uint32_t channel_record_size(uint32_t length) {
+	return (sizeof(uint32_t) + length + 3) & ~3u;
+}
+
+/* Sleeps while the other side's index still holds seen. */
+static void channel_sleep(volatile int* index, volatile int* sleeping, int seen) {
+	__atomic_store_n(sleeping, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(index, __ATOMIC_RELAXED) == seen)
+		futex_wait(index, seen);
+	__atomic_store_n(sleeping, 0, __ATOMIC_RELAXED);
+}
+
+/* Moves our index on, waking the other side if it sleeps on it. */
+static void channel_publish(volatile int* index, volatile int* sleeping, int value) {
+	__atomic_store_n(index, value, __ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(sleeping, __ATOMIC_RELAXED))
+		futex_wake(index, 1);
+}
+
+int channel_open(channel_t* receiver, channel_t* sender) {
+	int fds[2];
+	void* receiver_ring;
+	void* sender_ring;
+
+	if (pipe(fds) < 0)
+		return -1;
+
+	/* Each end maps the ring on its own, so either can be closed alone. */
+	receiver_ring = mmap(NULL, SYSCALL_PIPE_RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+	sender_ring = mmap(NULL, SYSCALL_PIPE_RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fds[1], 0);
+	if (receiver_ring == MAP_FAILED || sender_ring == MAP_FAILED) {
+		int error = errno;
+
+		if (receiver_ring != MAP_FAILED)
+			munmap(receiver_ring, SYSCALL_PIPE_RING_SIZE);
+		if (sender_ring != MAP_FAILED)
+			munmap(sender_ring, SYSCALL_PIPE_RING_SIZE);
+		close(fds[0]);
+		close(fds[1]);
+		errno = error;
+		return -1;
+	}
+
+	receiver->ring = receiver_ring;
+	receiver->fd = fds[0];
+	sender->ring = sender_ring;
+	sender->fd = fds[1];
+	return 0;
+}
+
+int channel_close(channel_t* channel) {
+	munmap(channel->ring, SYSCALL_PIPE_RING_SIZE);
+	return close(channel->fd);
+}
+
+int channel_send(channel_t* channel, const void* message, size_t length) {
+	struct channel_ring* ring = channel->ring;
+	uint32_t size = channel_record_size(length);
+	uint32_t tail = (uint32_t) ring->tail;
+	uint32_t skip = CHANNEL_DATA_SIZE - tail < size ? CHANNEL_DATA_SIZE - tail : 0;
+
+	if (length > CHANNEL_MESSAGE_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Wait for room for the record and the wrap before it, if any. */
+	for (;;) {
+		uint32_t head = (uint32_t) __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		uint32_t used = (tail - head + CHANNEL_DATA_SIZE) % CHANNEL_DATA_SIZE;
+
+		if (used + skip + size + sizeof(uint32_t) <= CHANNEL_DATA_SIZE)
+			break;
+		channel_sleep(&ring->head, &ring->sender_sleeping, (int) head);
+	}
+
+	if (skip) {
+		*(uint32_t*) &ring->data[tail] = CHANNEL_WRAP;
+		tail = 0;
+	}
+	*(uint32_t*) &ring->data[tail] = (uint32_t) length;
+	memcpy(&ring->data[tail + sizeof(uint32_t)], message, length);
+	tail = (tail + size) % CHANNEL_DATA_SIZE;
+	channel_publish(&ring->tail, &ring->receiver_sleeping, (int) tail);
+	return 0;
+}
+
+/* Bytes of a message past size are dropped. */
+ssize_t channel_receive(channel_t* channel, void* buffer, size_t size) {
+	struct channel_ring* ring = channel->ring;
+	uint32_t head = (uint32_t) ring->head;
+	uint32_t length;
+
+	for (;;) {
+		uint32_t tail = (uint32_t) __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+		if (tail == head) {
+			channel_sleep(&ring->tail, &ring->receiver_sleeping, (int) head);
+			continue;
+		}
+		length = *(const uint32_t*) &ring->data[head];
+		if (length != CHANNEL_WRAP)
+			break;
+		head = 0;
+	}
+
+	memcpy(buffer, &ring->data[head + sizeof(uint32_t)], length < size ? length : size);
+	head = (head + channel_record_size(length)) % CHANNEL_DATA_SIZE;
+	channel_publish(&ring->head, &ring->sender_sleeping, (int) head);
+	return (ssize_t) (length < size ? length : size);
+}
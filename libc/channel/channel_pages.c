@@ -0,0 +1,28 @@
+#include <errno.h>
+#include <stdint.h>
+#include <sys/channel.h>
+#include <sys/syscall.h>
+
+/* The pages are gone from this address space once this returns. */
+int channel_send_pages(channel_t* channel, void* buffer, size_t size) {
+	long result = syscall(SYSCALL_PIPE_GRANT, channel->fd, buffer, size);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return 0;
+}
+
+/* Returns NULL with size 0 once all sending ends are closed. */
+void* channel_receive_pages(channel_t* channel, size_t* size) {
+	uint32_t mapped;
+	unsigned long result = (unsigned long) syscall(SYSCALL_PIPE_ACCEPT, channel->fd, &mapped);
+
+	if (result >= (unsigned long) -SYSCALL_ERRNO_MAX) {
+		errno = (int) -result;
+		*size = 0;
+		return NULL;
+	}
+	*size = mapped;
+	return (void*) result;
+}
@@ -0,0 +1,12 @@
+#include <errno.h>
+#include <sys/futex.h>
+#include <sys/syscall.h>
+
+int futex_wait(volatile int* word, int expected) {
+	long result = syscall(SYSCALL_FUTEX_WAIT, word, expected);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return 0;
+}
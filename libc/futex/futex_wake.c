@@ -0,0 +1,12 @@
+#include <errno.h>
+#include <sys/futex.h>
+#include <sys/syscall.h>
+
+int futex_wake(volatile int* word, int count) {
+	long result = syscall(SYSCALL_FUTEX_WAKE, word, count);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return (int) result;
+}
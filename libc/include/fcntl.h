@@ -0,0 +1,29 @@
+#ifndef _FCNTL_H
+#define _FCNTL_H 1
+
+#include <sys/cdefs.h>
+
+#include <sys/types.h>
+
+#include <kernel/syscall.h>
+
+#define O_RDONLY SYSCALL_O_RDONLY
+#define O_WRONLY SYSCALL_O_WRONLY
+#define O_RDWR SYSCALL_O_RDWR
+#define O_ACCMODE SYSCALL_O_ACCMODE
+#define O_CREAT SYSCALL_O_CREAT
+#define O_EXCL SYSCALL_O_EXCL
+#define O_TRUNC SYSCALL_O_TRUNC
+#define O_APPEND SYSCALL_O_APPEND
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int open(const char*, int, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
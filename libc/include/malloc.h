@@ -0,0 +1,33 @@
+#ifndef _MALLOC_H
+#define _MALLOC_H 1
+
+#include <sys/cdefs.h>
+
+#include <stddef.h>
+
+/* Heap statistics, a subset of the traditional fields. */
+struct mallinfo {
+	size_t arena;    /* resident bytes of the sbrk() heap */
+	size_t hblks;    /* blocks mapped on their own */
+	size_t hblkhd;   /* bytes in those blocks */
+	size_t uordblks; /* heap bytes allocated, rounded up to size classes */
+	size_t fordblks; /* resident heap bytes not allocated */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* calloc(size_t, size_t);
+void free(void*);
+void* malloc(size_t);
+struct mallinfo mallinfo(void);
+int malloc_trim(size_t);
+size_t malloc_usable_size(void*);
+void* realloc(void*, size_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,6 +3,9 @@
 
 #include <sys/cdefs.h>
 
+#include <stdarg.h>
+#include <stddef.h>
+
 #define EOF (-1)
 
 #ifdef __cplusplus
@@ -13,6 +16,38 @@ int printf(const char* __restrict, ...);
 int putchar(int);
 int puts(const char*);
 
+#ifdef __jkos_hosted
+#define BUFSIZ 4096
+
+/* Buffering modes for setvbuf(). */
+#define _IOFBF 0
+#define _IOLBF 1
+#define _IONBF 2
+
+typedef struct FILE FILE;
+
+extern FILE* stdin;
+extern FILE* stdout;
+extern FILE* stderr;
+#define stdin stdin
+#define stdout stdout
+#define stderr stderr
+
+void clearerr(FILE*);
+int ferror(FILE*);
+int fflush(FILE*);
+int fileno(FILE*);
+int fprintf(FILE* __restrict, const char* __restrict, ...);
+int fputc(int, FILE*);
+int fputs(const char* __restrict, FILE* __restrict);
+size_t fwrite(const void* __restrict, size_t, size_t, FILE* __restrict);
+int putc(int, FILE*);
+void setbuf(FILE* __restrict, char* __restrict);
+int setvbuf(FILE* __restrict, char* __restrict, int, size_t);
+int vfprintf(FILE* __restrict, const char* __restrict, va_list);
+int vprintf(const char* __restrict, va_list);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
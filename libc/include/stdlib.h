@@ -3,6 +3,8 @@
 
 #include <sys/cdefs.h>
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -10,6 +12,18 @@ extern "C" {
 __attribute__((__noreturn__))
 void abort(void);
 
+#ifdef __jkos_hosted
+#define EXIT_SUCCESS 0
+#define EXIT_FAILURE 1
+
+void* calloc(size_t, size_t);
+__attribute__((__noreturn__))
+void exit(int);
+void free(void*);
+void* malloc(size_t);
+void* realloc(void*, size_t);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
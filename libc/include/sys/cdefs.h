@@ -3,4 +3,9 @@
 
 #define __jkos_libc 1
 
+/* Set for user programs and libc.a, which run on top of system calls. */
+#if !defined(__is_libk) && !defined(__is_kernel)
+#define __jkos_hosted 1
+#endif
+
 #endif
@@ -0,0 +1,49 @@
+#ifndef _SYS_CHANNEL_H
+#define _SYS_CHANNEL_H 1
+
+#include <sys/cdefs.h>
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* One-way message channel built on a pipe, for passing data between
+   processes without copying it through the kernel.
+
+   Messages of up to CHANNEL_MESSAGE_MAX bytes go through a ring in the
+   pipe's shared memory, which both sides map, for one sending and one
+   receiving thread. Sending and receiving make no system call unless one
+   side has to sleep on a full or empty ring and the other has to wake it
+   through a futex. A receive buffer too small drops the rest of a
+   message.
+
+   Buffers of whole pages are given away instead: the pages leave the
+   sender's address space and the receiver gets the same frames mapped.
+
+   Messages and page buffers are two separate streams. The ring does not
+   notice the other side closing, so protocols end with a message of their
+   own; page buffers end like a pipe, once all sending ends are closed. */
+#define CHANNEL_MESSAGE_MAX 4096
+
+struct channel_ring;
+
+typedef struct channel {
+	struct channel_ring* ring;
+	int fd; /* read end of the pipe for receiving, write end for sending */
+} channel_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int channel_open(channel_t*, channel_t*);
+int channel_close(channel_t*);
+int channel_send(channel_t*, const void*, size_t);
+ssize_t channel_receive(channel_t*, void*, size_t);
+int channel_send_pages(channel_t*, void*, size_t);
+void* channel_receive_pages(channel_t*, size_t*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
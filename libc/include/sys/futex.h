@@ -0,0 +1,20 @@
+#ifndef _SYS_FUTEX_H
+#define _SYS_FUTEX_H 1
+
+#include <sys/cdefs.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sleeps while *word equals expected, until futex_wake() on the same word.
+   Fails with EAGAIN if it no longer did. Wakes up to count sleepers and
+   returns how many there were. */
+int futex_wait(volatile int*, int);
+int futex_wake(volatile int*, int);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
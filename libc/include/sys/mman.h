@@ -0,0 +1,40 @@
+#ifndef _SYS_MMAN_H
+#define _SYS_MMAN_H 1
+
+#include <sys/cdefs.h>
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <kernel/syscall.h>
+
+#define PROT_NONE 0x00
+#define PROT_READ SYSCALL_PROT_READ
+#define PROT_WRITE SYSCALL_PROT_WRITE
+#define PROT_EXEC SYSCALL_PROT_EXEC
+
+/* Anonymous mappings are private, files can be mapped either way. The
+   kernel always picks the address. */
+#define MAP_SHARED 0x01
+#define MAP_PRIVATE 0x02
+#define MAP_FIXED 0x10
+#define MAP_ANONYMOUS 0x20
+#define MAP_ANON MAP_ANONYMOUS
+
+#define MAP_FAILED ((void*) -1)
+
+#define MADV_DONTNEED SYSCALL_MADV_DONTNEED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* mmap(void*, size_t, int, int, int, off_t);
+int munmap(void*, size_t);
+int madvise(void*, size_t, int);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef _SYS_STAT_H
+#define _SYS_STAT_H 1
+
+#include <sys/cdefs.h>
+
+#include <sys/types.h>
+
+/* File types. There are no permission bits. */
+#define S_IFMT 0170000
+#define S_IFDIR 0040000
+#define S_IFREG 0100000
+
+#define S_ISDIR(mode) (((mode) & S_IFMT) == S_IFDIR)
+#define S_ISREG(mode) (((mode) & S_IFMT) == S_IFREG)
+
+struct stat {
+	ino_t st_ino;
+	mode_t st_mode;
+	nlink_t st_nlink;
+	off_t st_size;
+	blksize_t st_blksize;
+	blkcnt_t st_blocks; /* 512 byte units actually in memory, holes take none */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int mkdir(const char*, mode_t);
+int stat(const char*, struct stat*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _SYS_SYSCALL_H
+#define _SYS_SYSCALL_H 1
+
+#include <sys/cdefs.h>
+
+#include <kernel/syscall.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Raw system call, SYSCALL_* number and up to four arguments. Returns the
+   kernel's result as is, errors as negated errno values. */
+long syscall(long, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
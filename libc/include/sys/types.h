@@ -0,0 +1,19 @@
+#ifndef _SYS_TYPES_H
+#define _SYS_TYPES_H 1
+
+#include <sys/cdefs.h>
+
+#include <stddef.h>
+
+typedef int ssize_t;
+typedef int pid_t;
+typedef long off_t;
+typedef long time_t;
+typedef int clockid_t;
+typedef unsigned int mode_t;
+typedef unsigned int ino_t;
+typedef unsigned int nlink_t;
+typedef long blksize_t;
+typedef long blkcnt_t;
+
+#endif
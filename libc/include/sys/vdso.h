@@ -0,0 +1,13 @@
+#ifndef _SYS_VDSO_H
+#define _SYS_VDSO_H 1
+
+#include <sys/cdefs.h>
+
+#include <kernel/vdso.h>
+
+/* The kernel's data page, mapped read-only into every process. */
+static inline const volatile VdsoData* vdso_data(void) {
+	return (const volatile VdsoData*) VDSO_DATA_ADDRESS;
+}
+
+#endif
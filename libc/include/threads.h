@@ -0,0 +1,63 @@
+#ifndef _THREADS_H
+#define _THREADS_H 1
+
+#include <sys/cdefs.h>
+
+/*
+ * The C11 threads subset the kernel supports: threads without timed waits,
+ * thread-specific storage or detaching, plain mutexes and condition
+ * variables. Threads are not preempted, so errno and the malloc() cache are
+ * shared by all threads of a process.
+ */
+enum {
+	thrd_success,
+	thrd_busy,
+	thrd_error,
+	thrd_nomem,
+	thrd_timedout,
+};
+
+enum {
+	mtx_plain = 0,
+	mtx_recursive = 1,
+	mtx_timed = 2,
+};
+
+typedef int (*thrd_start_t)(void*);
+typedef struct __thrd* thrd_t;
+
+/* Both stay in user space unless a thread has to sleep or wake another. */
+typedef struct {
+	volatile int state; /* 0 unlocked, 1 locked, 2 locked and maybe waited for */
+} mtx_t;
+
+typedef struct {
+	volatile int sequence; /* bumped by every signal, waiters sleep on it */
+	volatile int waiters;
+} cnd_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int thrd_create(thrd_t*, thrd_start_t, void*);
+int thrd_join(thrd_t, int*);
+void thrd_yield(void);
+
+int mtx_init(mtx_t*, int);
+void mtx_destroy(mtx_t*);
+int mtx_lock(mtx_t*);
+int mtx_trylock(mtx_t*);
+int mtx_unlock(mtx_t*);
+
+int cnd_init(cnd_t*);
+void cnd_destroy(cnd_t*);
+int cnd_signal(cnd_t*);
+int cnd_broadcast(cnd_t*);
+int cnd_wait(cnd_t*, mtx_t*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
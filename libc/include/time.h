@@ -0,0 +1,29 @@
+#ifndef _TIME_H
+#define _TIME_H 1
+
+#include <sys/cdefs.h>
+
+#include <sys/types.h>
+
+#include <kernel/syscall.h>
+
+/* There is no real-time clock yet, both clocks count from boot. */
+#define CLOCK_REALTIME SYSCALL_CLOCK_REALTIME
+#define CLOCK_MONOTONIC SYSCALL_CLOCK_MONOTONIC
+
+struct timespec {
+	time_t tv_sec;
+	long tv_nsec;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int clock_gettime(clockid_t, struct timespec*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
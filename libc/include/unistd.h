@@ -0,0 +1,50 @@
+#ifndef _UNISTD_H
+#define _UNISTD_H 1
+
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <kernel/syscall.h>
+
+#define STDIN_FILENO 0
+#define STDOUT_FILENO 1
+#define STDERR_FILENO 2
+
+/* Origins for lseek(). */
+#define SEEK_SET SYSCALL_SEEK_SET
+#define SEEK_CUR SYSCALL_SEEK_CUR
+#define SEEK_END SYSCALL_SEEK_END
+
+/* Names for sysconf(). */
+#define _SC_PAGESIZE 30
+#define _SC_PAGE_SIZE _SC_PAGESIZE
+#define _SC_NPROCESSORS_CONF 83
+#define _SC_NPROCESSORS_ONLN 84
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+__attribute__((__noreturn__))
+void _exit(int);
+int brk(void*);
+int close(int);
+pid_t fork(void);
+int ftruncate(int, off_t);
+pid_t getpid(void);
+off_t lseek(int, off_t, int);
+int pipe(int[2]);
+ssize_t read(int, void*, size_t);
+int rmdir(const char*);
+void* sbrk(intptr_t);
+long sysconf(int);
+int unlink(const char*);
+ssize_t write(int, const void*, size_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
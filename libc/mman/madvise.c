@@ -0,0 +1,12 @@
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+int madvise(void* address, size_t length, int advice) {
+	long result = syscall(SYSCALL_MADVISE, address, length, advice);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,32 @@
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+void* mmap(void* address, size_t length, int prot, int flags, int fd, off_t offset) {
+	int sharing = flags & (MAP_SHARED | MAP_PRIVATE);
+	(void) address;
+
+	/* The kernel always picks the address, and only files can be shared. */
+	if ((sharing != MAP_SHARED && sharing != MAP_PRIVATE) || (flags & MAP_FIXED)
+		|| (prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC))) {
+		errno = EINVAL;
+		return MAP_FAILED;
+	}
+	if (flags & MAP_ANONYMOUS) {
+		if (sharing == MAP_SHARED) {
+			errno = EINVAL;
+			return MAP_FAILED;
+		}
+		fd = -1;
+		offset = 0;
+	}
+	if (sharing == MAP_SHARED)
+		prot |= SYSCALL_MAP_SHARED;
+
+	unsigned long result = (unsigned long) syscall(SYSCALL_MMAP, length, prot, fd, offset);
+	if (result >= (unsigned long) -SYSCALL_ERRNO_MAX) {
+		errno = (int) -result;
+		return MAP_FAILED;
+	}
+	return (void*) result;
+}
@@ -0,0 +1,12 @@
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+int munmap(void* address, size_t length) {
+	long result = syscall(SYSCALL_MUNMAP, address, length);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return 0;
+}
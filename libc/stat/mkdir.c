@@ -0,0 +1,15 @@
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/* There are no permissions, so mode is ignored. */
+int mkdir(const char* path, mode_t mode) {
+	(void) mode;
+
+	long result = syscall(SYSCALL_MKDIR, path);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,20 @@
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+int stat(const char* path, struct stat* buffer) {
+	SyscallStat result;
+	long error = syscall(SYSCALL_STAT, path, &result);
+
+	if (error < 0) {
+		errno = (int) -error;
+		return -1;
+	}
+	buffer->st_ino = result.id;
+	buffer->st_mode = result.type == SYSCALL_STAT_DIR ? S_IFDIR : S_IFREG;
+	buffer->st_nlink = result.links;
+	buffer->st_size = (off_t) result.size;
+	buffer->st_blksize = 4096;
+	buffer->st_blocks = (blkcnt_t) result.pages * (4096 / 512);
+	return 0;
+}
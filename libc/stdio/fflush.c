@@ -0,0 +1,14 @@
+#include <stdio.h>
+
+#include "file.h"
+
+int fflush(FILE* stream) {
+	if (stream)
+		return __stdio_flush(stream);
+
+	int result = 0;
+	for (size_t i = 0; i < FILE_STREAM_MAX; i++)
+		if (__stdio_flush(&__stdio_streams[i]))
+			result = EOF;
+	return result;
+}
@@ -0,0 +1,66 @@
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "file.h"
+
+static unsigned char stdout_buffer[BUFSIZ];
+
+/*
+ * The console is interactive, so standard output is line buffered and
+ * standard error unbuffered, as C requires. Nothing reads standard input
+ * yet, it has no buffer.
+ */
+FILE __stdio_streams[FILE_STREAM_MAX] = {
+	{ STDIN_FILENO, _IONBF, 0, NULL, 0, 0 },
+	{ STDOUT_FILENO, _IOLBF, 0, stdout_buffer, sizeof(stdout_buffer), 0 },
+	{ STDERR_FILENO, _IONBF, 0, NULL, 0, 0 },
+};
+
+FILE* stdin = &__stdio_streams[STDIN_FILENO];
+FILE* stdout = &__stdio_streams[STDOUT_FILENO];
+FILE* stderr = &__stdio_streams[STDERR_FILENO];
+
+/*
+ * Writes data to the stream's file descriptor, bypassing the buffer.
+ * Retries short writes, so this is one write() unless the kernel takes
+ * less. Returns 0, or EOF with the error flag set.
+ */
+int __stdio_write(FILE* stream, const unsigned char* data, size_t length) {
+	while (length) {
+		ssize_t written = write(stream->fd, data, length);
+		if (written <= 0) {
+			stream->flags |= FILE_ERROR;
+			return EOF;
+		}
+		data += written;
+		length -= (size_t) written;
+	}
+	return 0;
+}
+
+/*
+ * Writes out and empties the stream's buffer. Returns 0, or EOF with the
+ * error flag set, in which case the buffered bytes are dropped.
+ */
+int __stdio_flush(FILE* stream) {
+	size_t length = stream->length;
+
+	stream->length = 0;
+	if (!length)
+		return 0;
+	return __stdio_write(stream, stream->buffer, length);
+}
+
+int ferror(FILE* stream) {
+	return stream->flags & FILE_ERROR;
+}
+
+void clearerr(FILE* stream) {
+	stream->flags &= ~FILE_ERROR;
+}
+
+int fileno(FILE* stream) {
+	return stream->fd;
+}
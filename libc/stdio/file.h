@@ -0,0 +1,32 @@
+#ifndef _LIBC_STDIO_FILE_H
+#define _LIBC_STDIO_FILE_H 1
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* Stream state bits. */
+#define FILE_ERROR 0x01
+
+#define FILE_STREAM_MAX 3
+
+/*
+ * Output stream. Bytes collect in buffer until it fills up, a newline is
+ * written in line buffered mode, or the stream is flushed, and then go out
+ * with a single write(). Unbuffered streams write every call straight
+ * through.
+ */
+struct FILE {
+	int fd;
+	int mode;
+	int flags;
+	unsigned char* buffer;
+	size_t size;
+	size_t length; /* bytes waiting in buffer */
+};
+
+extern FILE __stdio_streams[FILE_STREAM_MAX];
+
+int __stdio_flush(FILE* stream);
+int __stdio_write(FILE* stream, const unsigned char* data, size_t length);
+
+#endif
@@ -0,0 +1,19 @@
+#include <stdio.h>
+
+#include "file.h"
+
+int fputc(int ic, FILE* stream) {
+	unsigned char c = (unsigned char) ic;
+
+	if (stream->mode == _IONBF || stream->length == stream->size)
+		return fwrite(&c, 1, 1, stream) ? c : EOF;
+
+	stream->buffer[stream->length++] = c;
+	if (stream->mode == _IOLBF && c == '\n' && __stdio_flush(stream))
+		return EOF;
+	return c;
+}
+
+int putc(int ic, FILE* stream) {
+	return fputc(ic, stream);
+}
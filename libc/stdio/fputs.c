@@ -0,0 +1,10 @@
+#include <stdio.h>
+#include <string.h>
+
+int fputs(const char* restrict string, FILE* restrict stream) {
+	size_t length = strlen(string);
+
+	if (!length)
+		return 0;
+	return fwrite(string, 1, length, stream) ? 0 : EOF;
+}
@@ -0,0 +1,39 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "file.h"
+
+/*
+ * Data that fits is copied into the buffer. Data that does not is written
+ * directly after the buffer, unless it would fit an empty buffer, so large
+ * writes are never copied. In line buffered mode a newline anywhere in the
+ * data flushes everything written so far.
+ */
+size_t fwrite(const void* restrict ptr, size_t size, size_t count, FILE* restrict stream) {
+	const unsigned char* data = (const unsigned char*) ptr;
+	size_t length = size * count;
+
+	if (!length)
+		return 0;
+	if (size && length / size != count)
+		return 0;
+
+	if (stream->mode == _IONBF)
+		return __stdio_write(stream, data, length) ? 0 : count;
+
+	bool newline = stream->mode == _IOLBF && memchr(data, '\n', length);
+
+	if (length > stream->size - stream->length) {
+		if (__stdio_flush(stream))
+			return 0;
+		if (length >= stream->size)
+			return __stdio_write(stream, data, length) ? 0 : count;
+	}
+
+	memcpy(stream->buffer + stream->length, data, length);
+	stream->length += length;
+	if (newline && __stdio_flush(stream))
+		return 0;
+	return count;
+}
@@ -4,18 +4,127 @@
 #include <stdio.h>
 #include <string.h>
 
-static bool print(const char* data, size_t length) {
+#if defined(__is_libk)
+typedef void FILE;
+#define stdout NULL
+
+static bool print(FILE* stream, const char* data, size_t length) {
+	(void) stream;
 	const unsigned char* bytes = (const unsigned char*) data;
 	for (size_t i = 0; i < length; i++)
 		if (putchar(bytes[i]) == EOF)
 			return false;
 	return true;
 }
+#else
+#include "file.h"
 
-int printf(const char* restrict format, ...) {
-	va_list parameters;
-	va_start(parameters, format);
+/* Hosted output goes into the stream buffer a run of text at a time. */
+static bool print(FILE* stream, const char* data, size_t length) {
+	return fwrite(data, 1, length, stream) == length;
+}
+#endif
+
+// Longest conversion: the 20 digits of a 64-bit decimal, or a padded width,
+// plus sign. Wider fields are cut down to NUMBER_WIDTH_MAX.
+#define NUMBER_BUFFER_SIZE 32
+#define NUMBER_WIDTH_MAX (NUMBER_BUFFER_SIZE - 2)
+
+/*
+ * Parses a numeric conversion ([0][width][l|ll]d/i/u/x/X/p) starting right
+ * after the '%'. On success the digits are written to the end of buf and
+ * the number of characters and the position after the conversion returned.
+ * Returns NULL if the specifier is not numeric.
+ */
+static const char* format_number(const char* format, va_list* parameters,
+                                 char* buf, size_t* length) {
+	bool zero_pad = false;
+	size_t width = 0;
+	int longs = 0;
+
+	if (*format == '0') {
+		zero_pad = true;
+		format++;
+	}
+	while (*format >= '0' && *format <= '9') {
+		width = width * 10 + (size_t) (*format++ - '0');
+		if (width > NUMBER_WIDTH_MAX)
+			width = NUMBER_WIDTH_MAX;
+	}
+	while (*format == 'l' && longs < 2) {
+		longs++;
+		format++;
+	}
+
+	unsigned long long value;
+	bool negative = false;
+	unsigned int base = 10;
+	const char* digits = "0123456789abcdef";
 
+	switch (*format) {
+	case 'd':
+	case 'i': {
+		long long svalue;
+		if (longs == 2)
+			svalue = va_arg(*parameters, long long);
+		else if (longs == 1)
+			svalue = va_arg(*parameters, long);
+		else
+			svalue = va_arg(*parameters, int);
+		negative = svalue < 0;
+		value = negative ? -(unsigned long long) svalue : (unsigned long long) svalue;
+		break;
+	}
+	case 'X':
+		digits = "0123456789ABCDEF";
+		/* fall through */
+	case 'x':
+		base = 16;
+		/* fall through */
+	case 'u':
+		if (longs == 2)
+			value = va_arg(*parameters, unsigned long long);
+		else if (longs == 1)
+			value = va_arg(*parameters, unsigned long);
+		else
+			value = va_arg(*parameters, unsigned int);
+		break;
+	case 'p':
+		value = (unsigned long) va_arg(*parameters, void*);
+		base = 16;
+		zero_pad = true;
+		width = 2 * sizeof(void*);
+		break;
+	default:
+		return NULL;
+	}
+
+	char* end = buf + NUMBER_BUFFER_SIZE;
+	char* cur = end;
+	do {
+		*--cur = digits[value % base];
+		value /= base;
+	} while (value);
+
+	size_t pad = width > (size_t) (end - cur) + negative ? width - (size_t) (end - cur) - negative : 0;
+	if (zero_pad) {
+		while (pad--)
+			*--cur = '0';
+		if (negative)
+			*--cur = '-';
+	} else {
+		if (negative)
+			*--cur = '-';
+		while (pad--)
+			*--cur = ' ';
+	}
+
+	*length = (size_t) (end - cur);
+	memmove(buf, cur, *length);
+	return format + 1;
+}
+
+static int format_print(FILE* stream, const char* restrict format, va_list parameters) {
 	int written = 0;
 
 	while (*format != '\0') {
@@ -31,7 +140,7 @@ int printf(const char* restrict format, ...) {
 				// TODO: Set errno to EOVERFLOW.
 				return -1;
 			}
-			if (!print(format, amount))
+			if (!print(stream, format, amount))
 				return -1;
 			format += amount;
 			written += amount;
@@ -39,6 +148,9 @@ int printf(const char* restrict format, ...) {
 		}
 
 		const char* format_begun_at = format++;
+		char number[NUMBER_BUFFER_SIZE];
+		size_t number_len;
+		const char* number_end;
 
 		if (*format == 'c') {
 			format++;
@@ -47,7 +159,7 @@ int printf(const char* restrict format, ...) {
 				// TODO: Set errno to EOVERFLOW.
 				return -1;
 			}
-			if (!print(&c, sizeof(c)))
+			if (!print(stream, &c, sizeof(c)))
 				return -1;
 			written++;
 		} else if (*format == 's') {
@@ -58,9 +170,18 @@ int printf(const char* restrict format, ...) {
 				// TODO: Set errno to EOVERFLOW.
 				return -1;
 			}
-			if (!print(str, len))
+			if (!print(stream, str, len))
 				return -1;
 			written += len;
+		} else if ((number_end = format_number(format, &parameters, number, &number_len))) {
+			format = number_end;
+			if (maxrem < number_len) {
+				// TODO: Set errno to EOVERFLOW.
+				return -1;
+			}
+			if (!print(stream, number, number_len))
+				return -1;
+			written += number_len;
 		} else {
 			format = format_begun_at;
 			size_t len = strlen(format);
@@ -68,13 +189,67 @@ int printf(const char* restrict format, ...) {
 				// TODO: Set errno to EOVERFLOW.
 				return -1;
 			}
-			if (!print(format, len))
+			if (!print(stream, format, len))
 				return -1;
 			written += len;
 			format += len;
 		}
 	}
 
+	return written;
+}
+
+#if defined(__is_libk)
+int printf(const char* restrict format, ...) {
+	va_list parameters;
+	va_start(parameters, format);
+	int written = format_print(stdout, format, parameters);
+	va_end(parameters);
+	return written;
+}
+#else
+/*
+ * An unbuffered stream would otherwise see a write() per run of text and
+ * per conversion, so it borrows a buffer on the stack for the duration of
+ * the call and the whole line goes out at once.
+ */
+int vfprintf(FILE* restrict stream, const char* restrict format, va_list parameters) {
+	if (stream->mode != _IONBF)
+		return format_print(stream, format, parameters);
+
+	unsigned char buffer[256];
+	unsigned char* saved_buffer = stream->buffer;
+	size_t saved_size = stream->size;
+	stream->mode = _IOFBF;
+	stream->buffer = buffer;
+	stream->size = sizeof(buffer);
+	stream->length = 0;
+	int written = format_print(stream, format, parameters);
+	if (__stdio_flush(stream))
+		written = -1;
+	stream->mode = _IONBF;
+	stream->buffer = saved_buffer;
+	stream->size = saved_size;
+	return written;
+}
+
+int vprintf(const char* restrict format, va_list parameters) {
+	return vfprintf(stdout, format, parameters);
+}
+
+int fprintf(FILE* restrict stream, const char* restrict format, ...) {
+	va_list parameters;
+	va_start(parameters, format);
+	int written = vfprintf(stream, format, parameters);
+	va_end(parameters);
+	return written;
+}
+
+int printf(const char* restrict format, ...) {
+	va_list parameters;
+	va_start(parameters, format);
+	int written = vfprintf(stdout, format, parameters);
 	va_end(parameters);
 	return written;
 }
+#endif
@@ -8,8 +8,8 @@ int putchar(int ic) {
 #if defined(__is_libk)
 	char c = (char) ic;
 	term_write(&c, sizeof(c));
+	return ic;
 #else
-	// TODO: Implement stdio and the write system call.
+	return fputc(ic, stdout);
 #endif
-	return ic;
 }
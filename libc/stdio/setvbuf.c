@@ -0,0 +1,28 @@
+#include <stdio.h>
+
+#include "file.h"
+
+/*
+ * Switches the buffering mode, flushing what the old mode still held. A
+ * NULL buffer keeps the stream's current one. Buffered modes need a buffer
+ * from somewhere, so setvbuf() fails for a stream that never had one.
+ */
+int setvbuf(FILE* restrict stream, char* restrict buffer, int mode, size_t size) {
+	if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF)
+		return EOF;
+	if (__stdio_flush(stream))
+		return EOF;
+
+	if (buffer && size) {
+		stream->buffer = (unsigned char*) buffer;
+		stream->size = size;
+	}
+	if (mode != _IONBF && !stream->size)
+		return EOF;
+	stream->mode = mode;
+	return 0;
+}
+
+void setbuf(FILE* restrict stream, char* restrict buffer) {
+	setvbuf(stream, buffer, buffer ? _IOFBF : _IONBF, BUFSIZ);
+}
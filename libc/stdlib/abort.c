@@ -1,6 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#if !defined(__is_libk)
+#include <unistd.h>
+#endif
+
 __attribute__((__noreturn__))
 void abort(void) {
 #if defined(__is_libk)
@@ -9,6 +13,8 @@ void abort(void) {
 #else
 	// TODO: Abnormally terminate the process as if by SIGABRT.
 	printf("abort()\n");
+	fflush(stdout);
+	_exit(EXIT_FAILURE);
 #endif
 	while (1) { }
 	__builtin_unreachable();
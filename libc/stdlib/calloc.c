@@ -0,0 +1,16 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+void* calloc(size_t count, size_t size) {
+	void* object;
+
+	if (size && count > (size_t) -1 / size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	object = malloc(count * size);
+	if (object)
+		memset(object, 0, count * size);
+	return object;
+}
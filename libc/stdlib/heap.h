@@ -0,0 +1,58 @@
+#ifndef _LIBC_STDLIB_HEAP_H
+#define _LIBC_STDLIB_HEAP_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HEAP_PAGE_SIZE 4096
+#define HEAP_ALIGN 16
+
+/*
+ * Objects up to HEAP_SMALL_MAX are rounded up to one of HEAP_CLASS_COUNT
+ * size classes, 16 bytes apart up to 128 and four per power of two above.
+ * Each class carves its objects out of spans, HEAP_SPAN_SIZE blocks of the
+ * sbrk() heap aligned to their size, so free() finds an object's span by
+ * masking its address. Larger blocks get a mapping of their own.
+ */
+#define HEAP_SMALL_MAX 8192
+#define HEAP_CLASS_COUNT 32
+#define HEAP_SPAN_SIZE 0x10000
+#define HEAP_SPAN_HEADER 64     /* objects start here, keeps them aligned */
+#define HEAP_SPAN_KEEP 4        /* empty spans kept resident, the rest is released */
+#define HEAP_LARGE_HEADER HEAP_ALIGN
+
+/*
+ * The process cache holds up to HEAP_CACHE_MAX objects, or HEAP_CACHE_BYTES
+ * worth, per class and trades them with the spans in batches of half that.
+ */
+#define HEAP_CACHE_MAX 64
+#define HEAP_CACHE_BYTES 0x8000
+
+/*
+ * Span header. Never allocated objects lie between bump and end, so a new
+ * span costs no more than the pages its objects touch. An empty span has
+ * size 0 and sits in one of the heap's empty lists.
+ */
+typedef struct HeapSpan {
+	struct HeapSpan* next;
+	struct HeapSpan* prev;
+	void* free;    /* freed objects, linked through their first word */
+	char* bump;
+	char* end;
+	uint32_t size; /* object size */
+	uint16_t used; /* objects out of the span, cached ones included */
+	uint8_t class;
+	uint8_t released; /* pages past the header handed back, empty spans only */
+} HeapSpan;
+
+/*
+ * Stacks of free objects, one per size class, shared by all threads of the
+ * process. malloc() and free() only touch the cache, the heap and its lock
+ * are reached once per batch.
+ */
+typedef struct HeapCache {
+	void* objects[HEAP_CLASS_COUNT][HEAP_CACHE_MAX];
+	uint32_t count[HEAP_CLASS_COUNT];
+} HeapCache;
+
+#endif
@@ -0,0 +1,393 @@
+#include <errno.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "heap.h"
+
+_Static_assert(sizeof(HeapSpan) <= HEAP_SPAN_HEADER, "span header too large");
+
+static const uint32_t class_sizes[HEAP_CLASS_COUNT] = {
+	16, 32, 48, 64, 80, 96, 112, 128,
+	160, 192, 224, 256, 320, 384, 448, 512,
+	640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+	2560, 3072, 3584, 4096, 5120, 6144, 7168, 8192,
+};
+
+/*
+ * State shared by all threads, under lock. Spans fill the range from base
+ * to end, which is also the break unless somebody else calls sbrk().
+ */
+static struct {
+	char* base;
+	char* end;
+	HeapSpan* partial[HEAP_CLASS_COUNT]; /* spans with objects left */
+	HeapSpan* empty;                      /* empty spans, still resident */
+	HeapSpan* released;                   /* empty spans, pages handed back */
+	uint32_t empty_count;
+	size_t allocated;                     /* bytes out of spans, cached ones included */
+	size_t released_bytes;
+	size_t large_count;
+	size_t large_bytes;
+	volatile char lock;
+} heap;
+
+/* One cache for the whole process, not one per thread. Sharing it is safe
+   as long as threads only switch in blocking system calls, which malloc()
+   makes none of, and with a single CPU a cache per thread would only cost
+   a lookup. */
+static HeapCache process_cache;
+
+static inline void heap_lock(void) {
+	while (__atomic_test_and_set(&heap.lock, __ATOMIC_ACQUIRE))
+		;
+}
+
+static inline void heap_unlock(void) {
+	__atomic_clear(&heap.lock, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t size_class(size_t size) {
+	if (size <= 128)
+		return size ? (uint32_t) (size - 1) >> 4 : 0;
+
+	uint32_t last = (uint32_t) size - 1;
+	uint32_t bit = 31 - (uint32_t) __builtin_clz(last);
+	return 8 + (bit - 7) * 4 + ((last >> (bit - 2)) & 3);
+}
+
+static inline uint32_t cache_limit(uint32_t class) {
+	uint32_t limit = HEAP_CACHE_BYTES / class_sizes[class];
+	return limit < HEAP_CACHE_MAX ? limit : HEAP_CACHE_MAX;
+}
+
+static inline bool in_heap(const void* object) {
+	return (const char*) object >= heap.base && (const char*) object < heap.end;
+}
+
+static inline HeapSpan* object_span(const void* object) {
+	return (HeapSpan*) ((uintptr_t) object & ~(uintptr_t) (HEAP_SPAN_SIZE - 1));
+}
+
+static void list_push(HeapSpan** list, HeapSpan* span) {
+	span->prev = NULL;
+	span->next = *list;
+	if (*list)
+		(*list)->prev = span;
+	*list = span;
+}
+
+static void list_remove(HeapSpan** list, HeapSpan* span) {
+	if (span->prev)
+		span->prev->next = span->next;
+	else
+		*list = span->next;
+	if (span->next)
+		span->next->prev = span->prev;
+}
+
+/*
+ * Adds a span to the top of the heap. The first one also moves the break
+ * up to a span boundary.
+ */
+static HeapSpan* heap_grow(void) {
+	char* top = sbrk(0);
+	uintptr_t pad;
+
+	if (top == (char*) -1)
+		return NULL;
+	if (heap.end && top != heap.end) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	pad = -(uintptr_t) top & (HEAP_SPAN_SIZE - 1);
+	if (sbrk((intptr_t) (pad + HEAP_SPAN_SIZE)) == (void*) -1)
+		return NULL;
+	if (!heap.base)
+		heap.base = top + pad;
+	heap.end = top + pad + HEAP_SPAN_SIZE;
+	return (HeapSpan*) (top + pad);
+}
+
+/* Moves an empty span on or off the list matching its pages. */
+static void empty_link(HeapSpan* span) {
+	if (span->released) {
+		list_push(&heap.released, span);
+		heap.released_bytes += HEAP_SPAN_SIZE - HEAP_PAGE_SIZE;
+	} else {
+		list_push(&heap.empty, span);
+		heap.empty_count++;
+	}
+}
+
+static void empty_unlink(HeapSpan* span) {
+	if (span->released) {
+		list_remove(&heap.released, span);
+		heap.released_bytes -= HEAP_SPAN_SIZE - HEAP_PAGE_SIZE;
+	} else {
+		list_remove(&heap.empty, span);
+		heap.empty_count--;
+	}
+}
+
+/*
+ * Gives empty spans at the top of the heap back with sbrk(), as many as
+ * there are in a row. Their headers go with them, so they leave the lists
+ * first.
+ */
+static void heap_trim(void) {
+	char* end = heap.end;
+
+	if (sbrk(0) != heap.end)
+		return;
+	while (end > heap.base && !((HeapSpan*) (end - HEAP_SPAN_SIZE))->size) {
+		end -= HEAP_SPAN_SIZE;
+		empty_unlink((HeapSpan*) end);
+	}
+	if (end == heap.end)
+		return;
+
+	if (sbrk(end - heap.end) != (void*) -1) {
+		heap.end = end;
+		return;
+	}
+	for (char* top = end; top < heap.end; top += HEAP_SPAN_SIZE)
+		empty_link((HeapSpan*) top);
+}
+
+/*
+ * Sets up an empty span for a class, preferring one whose pages are still
+ * resident, and makes it the class's first partial span.
+ */
+static HeapSpan* span_take(uint32_t class) {
+	HeapSpan* span = heap.empty ? heap.empty : heap.released;
+
+	if (span)
+		empty_unlink(span);
+	else if (!(span = heap_grow()))
+		return NULL;
+
+	span->free = NULL;
+	span->bump = (char*) span + HEAP_SPAN_HEADER;
+	span->end = span->bump + (HEAP_SPAN_SIZE - HEAP_SPAN_HEADER) / class_sizes[class] * class_sizes[class];
+	span->size = class_sizes[class];
+	span->used = 0;
+	span->class = (uint8_t) class;
+	span->released = 0;
+	list_push(&heap.partial[class], span);
+	return span;
+}
+
+/*
+ * Retires a span whose last object came back. Up to HEAP_SPAN_KEEP empty
+ * spans stay resident for quick reuse, the pages of any others except the
+ * header go back to the kernel.
+ */
+static void span_retire(HeapSpan* span) {
+	list_remove(&heap.partial[span->class], span);
+	span->size = 0;
+	span->released = heap.empty_count >= HEAP_SPAN_KEEP
+		&& !madvise((char*) span + HEAP_PAGE_SIZE, HEAP_SPAN_SIZE - HEAP_PAGE_SIZE, MADV_DONTNEED);
+	empty_link(span);
+}
+
+/*
+ * Fills an empty cache slot with half its limit of objects, from freed
+ * ones first and then from the untouched end of the span.
+ */
+static uint32_t cache_refill(HeapCache* cache, uint32_t class) {
+	uint32_t wanted = cache_limit(class) / 2;
+	void** objects = cache->objects[class];
+	uint32_t count = 0;
+
+	heap_lock();
+	while (count < wanted) {
+		HeapSpan* span = heap.partial[class];
+
+		if (!span && !(span = span_take(class)))
+			break;
+		while (count < wanted && span->free) {
+			objects[count++] = span->free;
+			span->free = *(void**) span->free;
+			span->used++;
+		}
+		while (count < wanted && span->bump < span->end) {
+			objects[count++] = span->bump;
+			span->bump += span->size;
+			span->used++;
+		}
+		if (!span->free && span->bump == span->end)
+			list_remove(&heap.partial[class], span);
+	}
+	heap.allocated += count * class_sizes[class];
+	heap_unlock();
+
+	cache->count[class] = count;
+	return count;
+}
+
+/*
+ * Returns the oldest count objects of a cache slot to their spans and
+ * trims the heap if any span ran empty.
+ */
+static void cache_flush(HeapCache* cache, uint32_t class, uint32_t count) {
+	void** objects = cache->objects[class];
+	bool retired = false;
+
+	heap_lock();
+	for (uint32_t i = 0; i < count; i++) {
+		HeapSpan* span = object_span(objects[i]);
+
+		if (!span->free && span->bump == span->end)
+			list_push(&heap.partial[class], span);
+		*(void**) objects[i] = span->free;
+		span->free = objects[i];
+		if (!--span->used) {
+			span_retire(span);
+			retired = true;
+		}
+	}
+	heap.allocated -= count * class_sizes[class];
+	if (retired)
+		heap_trim();
+	heap_unlock();
+
+	cache->count[class] -= count;
+	for (uint32_t i = 0; i < cache->count[class]; i++)
+		objects[i] = objects[i + count];
+}
+
+/*
+ * Maps a block of its own, with its length in a header in front of the
+ * object. free() unmaps it right away.
+ */
+static void* large_alloc(size_t size) {
+	size_t length = (size + HEAP_LARGE_HEADER + HEAP_PAGE_SIZE - 1) & ~(size_t) (HEAP_PAGE_SIZE - 1);
+	char* block;
+
+	if (length < size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	block = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (block == MAP_FAILED)
+		return NULL;
+	*(size_t*) block = length;
+
+	heap_lock();
+	heap.large_count++;
+	heap.large_bytes += length;
+	heap_unlock();
+	return block + HEAP_LARGE_HEADER;
+}
+
+static void large_free(void* object) {
+	char* block = (char*) object - HEAP_LARGE_HEADER;
+	size_t length = *(size_t*) block;
+
+	heap_lock();
+	heap.large_count--;
+	heap.large_bytes -= length;
+	heap_unlock();
+	munmap(block, length);
+}
+
+void* malloc(size_t size) {
+	HeapCache* cache = &process_cache;
+	uint32_t class;
+
+	if (size > HEAP_SMALL_MAX)
+		return large_alloc(size);
+
+	class = size_class(size);
+	if (!cache->count[class] && !cache_refill(cache, class)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	return cache->objects[class][--cache->count[class]];
+}
+
+void free(void* object) {
+	HeapCache* cache = &process_cache;
+	uint32_t class;
+
+	if (!object)
+		return;
+	if (!in_heap(object)) {
+		large_free(object);
+		return;
+	}
+
+	class = object_span(object)->class;
+	if (cache->count[class] == cache_limit(class))
+		cache_flush(cache, class, cache_limit(class) / 2);
+	cache->objects[class][cache->count[class]++] = object;
+}
+
+size_t malloc_usable_size(void* object) {
+	if (!object)
+		return 0;
+	if (!in_heap(object))
+		return *(size_t*) ((char*) object - HEAP_LARGE_HEADER) - HEAP_LARGE_HEADER;
+	return object_span(object)->size;
+}
+
+/*
+ * Returns the cached objects to their spans and hands the
+ * pages of every empty span back, the top of the heap with sbrk() and the
+ * rest with madvise(). There is no top pad to keep, so pad is ignored.
+ */
+int malloc_trim(size_t pad) {
+	HeapCache* cache = &process_cache;
+	size_t before, after;
+
+	(void) pad;
+	heap_lock();
+	before = (size_t) (heap.end - heap.base) - heap.released_bytes;
+	heap_unlock();
+
+	for (uint32_t class = 0; class < HEAP_CLASS_COUNT; class++) {
+		if (cache->count[class])
+			cache_flush(cache, class, cache->count[class]);
+	}
+
+	heap_lock();
+	heap_trim();
+	while (heap.empty) {
+		HeapSpan* span = heap.empty;
+
+		if (madvise((char*) span + HEAP_PAGE_SIZE, HEAP_SPAN_SIZE - HEAP_PAGE_SIZE, MADV_DONTNEED))
+			break;
+		empty_unlink(span);
+		span->released = 1;
+		empty_link(span);
+	}
+	after = (size_t) (heap.end - heap.base) - heap.released_bytes;
+	heap_unlock();
+	return after < before;
+}
+
+/* Objects in the process cache count as free. */
+struct mallinfo mallinfo(void) {
+	HeapCache* cache = &process_cache;
+	struct mallinfo info;
+	size_t cached = 0;
+
+	for (uint32_t class = 0; class < HEAP_CLASS_COUNT; class++)
+		cached += cache->count[class] * class_sizes[class];
+
+	heap_lock();
+	info.arena = (size_t) (heap.end - heap.base) - heap.released_bytes;
+	info.hblks = heap.large_count;
+	info.hblkhd = heap.large_bytes;
+	info.uordblks = heap.allocated - cached;
+	heap_unlock();
+
+	info.fordblks = info.arena - info.uordblks;
+	return info;
+}
@@ -0,0 +1,28 @@
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Blocks stay in place while the new size fits and uses at least half of
+   them, otherwise they move to a block of the right class. */
+void* realloc(void* object, size_t size) {
+	size_t usable;
+	void* moved;
+
+	if (!object)
+		return malloc(size);
+	if (!size) {
+		free(object);
+		return NULL;
+	}
+
+	usable = malloc_usable_size(object);
+	if (size <= usable && size >= usable / 2)
+		return object;
+
+	moved = malloc(size);
+	if (!moved)
+		return NULL;
+	memcpy(moved, object, size < usable ? size : usable);
+	free(object);
+	return moved;
+}
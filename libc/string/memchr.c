@@ -0,0 +1,9 @@
+#include <string.h>
+
+void* memchr(const void* ptr, int value, size_t size) {
+	const unsigned char* p = (const unsigned char*) ptr;
+	for (size_t i = 0; i < size; i++)
+		if (p[i] == (unsigned char) value)
+			return (void*) (p + i);
+	return NULL;
+}
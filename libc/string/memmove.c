@@ -1,12 +1,42 @@
+#include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
+// Large moves (e.g. scrolling a framebuffer) are done a word at a time when
+// both pointers share the same alignment.
+#define WORD_SIZE sizeof(uint32_t)
+#define WORD_MASK (WORD_SIZE - 1)
+
 void* memmove(void* dstptr, const void* srcptr, size_t size) {
 	unsigned char* dst = (unsigned char*) dstptr;
 	const unsigned char* src = (const unsigned char*) srcptr;
+	bool aligned = (((uintptr_t) dst ^ (uintptr_t) src) & WORD_MASK) == 0;
 	if (dst < src) {
+		if (aligned) {
+			while (size && ((uintptr_t) dst & WORD_MASK)) {
+				*dst++ = *src++;
+				size--;
+			}
+			uint32_t* wdst = (uint32_t*) dst;
+			const uint32_t* wsrc = (const uint32_t*) src;
+			for (; size >= WORD_SIZE; size -= WORD_SIZE)
+				*wdst++ = *wsrc++;
+			dst = (unsigned char*) wdst;
+			src = (const unsigned char*) wsrc;
+		}
 		for (size_t i = 0; i < size; i++)
 			dst[i] = src[i];
 	} else {
+		if (aligned) {
+			while (size && ((uintptr_t) (dst + size) & WORD_MASK)) {
+				dst[size-1] = src[size-1];
+				size--;
+			}
+			uint32_t* wdst = (uint32_t*) (dst + size);
+			const uint32_t* wsrc = (const uint32_t*) (src + size);
+			for (; size >= WORD_SIZE; size -= WORD_SIZE)
+				*--wdst = *--wsrc;
+		}
 		for (size_t i = size; i != 0; i--)
 			dst[i-1] = src[i-1];
 	}
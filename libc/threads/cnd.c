@@ -0,0 +1,45 @@
+#include <limits.h>
+#include <sys/futex.h>
+#include <threads.h>
+
+/*
+ * Waiters sleep on the sequence count they saw before dropping the mutex,
+ * so a signal between the unlock and the sleep bumps it and the sleep
+ * returns at once. Signals only enter the kernel while somebody waits.
+ */
+int cnd_init(cnd_t* condition) {
+	condition->sequence = 0;
+	condition->waiters = 0;
+	return thrd_success;
+}
+
+void cnd_destroy(cnd_t* condition) {
+	(void) condition;
+}
+
+static int cnd_wake(cnd_t* condition, int count) {
+	if (__atomic_load_n(&condition->waiters, __ATOMIC_SEQ_CST)) {
+		__atomic_add_fetch(&condition->sequence, 1, __ATOMIC_SEQ_CST);
+		futex_wake(&condition->sequence, count);
+	}
+	return thrd_success;
+}
+
+int cnd_signal(cnd_t* condition) {
+	return cnd_wake(condition, 1);
+}
+
+int cnd_broadcast(cnd_t* condition) {
+	return cnd_wake(condition, INT_MAX);
+}
+
+int cnd_wait(cnd_t* condition, mtx_t* mutex) {
+	int sequence;
+
+	__atomic_add_fetch(&condition->waiters, 1, __ATOMIC_SEQ_CST);
+	sequence = __atomic_load_n(&condition->sequence, __ATOMIC_SEQ_CST);
+	mtx_unlock(mutex);
+	futex_wait(&condition->sequence, sequence);
+	__atomic_sub_fetch(&condition->waiters, 1, __ATOMIC_SEQ_CST);
+	return mtx_lock(mutex);
+}
@@ -0,0 +1,51 @@
+#include <stdbool.h>
+#include <sys/futex.h>
+#include <threads.h>
+
+/*
+ * Locking and unlocking an uncontended mutex is a single atomic operation
+ * each. Only a thread that finds the mutex taken marks it 2 and sleeps, and
+ * only unlocking a mutex marked 2 makes a system call to wake one sleeper.
+ */
+int mtx_init(mtx_t* mutex, int type) {
+	if (type != mtx_plain)
+		return thrd_error;
+	mutex->state = 0;
+	return thrd_success;
+}
+
+void mtx_destroy(mtx_t* mutex) {
+	(void) mutex;
+}
+
+int mtx_trylock(mtx_t* mutex) {
+	int state = 0;
+
+	if (__atomic_compare_exchange_n(&mutex->state, &state, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return thrd_success;
+	return thrd_busy;
+}
+
+int mtx_lock(mtx_t* mutex) {
+	int state = 0;
+
+	if (__atomic_compare_exchange_n(&mutex->state, &state, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return thrd_success;
+
+	/* Taken: claim it as contended, so whoever holds it wakes us. */
+	if (state != 2)
+		state = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+	while (state) {
+		futex_wait(&mutex->state, 2);
+		state = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+	}
+	return thrd_success;
+}
+
+int mtx_unlock(mtx_t* mutex) {
+	if (__atomic_fetch_sub(&mutex->state, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n(&mutex->state, 0, __ATOMIC_RELEASE);
+		futex_wake(&mutex->state, 1);
+	}
+	return thrd_success;
+}
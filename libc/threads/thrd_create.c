@@ -0,0 +1,44 @@
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <threads.h>
+
+#include "thread.h"
+
+/* First function of a new thread, entered from the kernel as if called. */
+__attribute__((__noreturn__))
+static void thread_start(struct __thrd* thread) {
+	thread->result = thread->start(thread->arg);
+	syscall(SYSCALL_THREAD_EXIT);
+	__builtin_unreachable();
+}
+
+int thrd_create(thrd_t* thread, thrd_start_t start, void* arg) {
+	char* stack = mmap(NULL, THREAD_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	struct __thrd* block;
+	uint32_t* sp;
+	long result;
+
+	if (stack == MAP_FAILED)
+		return thrd_nomem;
+
+	block = (struct __thrd*) ((uintptr_t) (stack + THREAD_STACK_SIZE - sizeof(*block)) & ~(uintptr_t) 15);
+	block->start = start;
+	block->arg = arg;
+	block->result = 0;
+	block->exit_word = 1;
+	block->stack = stack;
+
+	/* The argument sits 16-byte aligned, under it a null return address. */
+	sp = (uint32_t*) block - 4;
+	sp[0] = (uint32_t) block;
+	*--sp = 0;
+
+	result = syscall(SYSCALL_THREAD_CREATE, thread_start, sp, &block->exit_word);
+	if (result < 0) {
+		munmap(stack, THREAD_STACK_SIZE);
+		return thrd_error;
+	}
+	*thread = block;
+	return thrd_success;
+}
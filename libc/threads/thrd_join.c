@@ -0,0 +1,15 @@
+#include <sys/futex.h>
+#include <sys/mman.h>
+#include <threads.h>
+
+#include "thread.h"
+
+int thrd_join(thrd_t thread, int* result) {
+	while (thread->exit_word)
+		futex_wait(&thread->exit_word, 1);
+
+	if (result)
+		*result = thread->result;
+	munmap(thread->stack, THREAD_STACK_SIZE);
+	return thrd_success;
+}
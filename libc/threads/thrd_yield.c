@@ -0,0 +1,6 @@
+#include <sys/syscall.h>
+#include <threads.h>
+
+void thrd_yield(void) {
+	syscall(SYSCALL_YIELD);
+}
@@ -0,0 +1,22 @@
+#ifndef _LIBC_THREADS_THREAD_H
+#define _LIBC_THREADS_THREAD_H 1
+
+#include <threads.h>
+
+#define THREAD_STACK_SIZE 0x10000
+
+/*
+ * Control block of a thread from thrd_create(), at the top of the mapping
+ * that is also its stack. The kernel clears exit_word and wakes its
+ * sleepers once the thread is off the stack, which is when thrd_join()
+ * may unmap it.
+ */
+struct __thrd {
+	thrd_start_t start;
+	void* arg;
+	int result;
+	volatile int exit_word; /* 1 while running */
+	char* stack;
+};
+
+#endif
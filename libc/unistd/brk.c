@@ -0,0 +1,40 @@
+#include <errno.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Current break, 0 until the first call asks the kernel. */
+static uintptr_t current_brk;
+
+/* Moves the break, returns it or 0 with errno set. Breaks above 2 GiB
+   look negative, so only the errno range counts as an error. */
+static uintptr_t set_brk(uintptr_t address) {
+	unsigned long result = (unsigned long) syscall(SYSCALL_BRK, address);
+	if (result >= (unsigned long) -SYSCALL_ERRNO_MAX) {
+		errno = (int) -result;
+		return 0;
+	}
+	current_brk = result;
+	return result;
+}
+
+int brk(void* address) {
+	return set_brk((uintptr_t) address) ? 0 : -1;
+}
+
+void* sbrk(intptr_t increment) {
+	uintptr_t old = current_brk;
+
+	if (!old && !(old = set_brk(0)))
+		return (void*) -1;
+	if (!increment)
+		return (void*) old;
+	if ((increment > 0 && old + (uintptr_t) increment < old)
+		|| (increment < 0 && (uintptr_t) -increment > old)) {
+		errno = ENOMEM;
+		return (void*) -1;
+	}
+	if (!set_brk(old + (uintptr_t) increment))
+		return (void*) -1;
+	return (void*) old;
+}
@@ -0,0 +1,12 @@
+#include <errno.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+int close(int fd) {
+	long result = syscall(SYSCALL_CLOSE, fd);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return 0;
+}
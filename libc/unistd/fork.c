@@ -0,0 +1,12 @@
+#include <errno.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+pid_t fork(void) {
+	long result = syscall(SYSCALL_FORK);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return (pid_t) result;
+}
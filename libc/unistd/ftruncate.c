@@ -0,0 +1,12 @@
+#include <errno.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+int ftruncate(int fd, off_t size) {
+	long result = syscall(SYSCALL_FTRUNCATE, fd, size);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,6 @@
+#include <sys/syscall.h>
+#include <unistd.h>
+
+pid_t getpid(void) {
+	return (pid_t) syscall(SYSCALL_GETPID);
+}
@@ -0,0 +1,12 @@
+#include <errno.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+off_t lseek(int fd, off_t offset, int whence) {
+	long result = syscall(SYSCALL_LSEEK, fd, offset, whence);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return (off_t) result;
+}
@@ -0,0 +1,12 @@
+#include <errno.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+int pipe(int fds[2]) {
+	long result = syscall(SYSCALL_PIPE, fds);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,16 @@
+#include <errno.h>
+#include <sys/vdso.h>
+#include <unistd.h>
+
+long sysconf(int name) {
+	switch (name) {
+	case _SC_PAGESIZE:
+		return 4096;
+	case _SC_NPROCESSORS_CONF:
+	case _SC_NPROCESSORS_ONLN:
+		return (long) vdso_data()->cpu_count;
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+}
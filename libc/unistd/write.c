@@ -0,0 +1,12 @@
+#include <errno.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+ssize_t write(int fd, const void* buffer, size_t count) {
+	long result = syscall(SYSCALL_WRITE, fd, buffer, count);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return (ssize_t) result;
+}
@@ -2,4 +2,11 @@
 set -e
 . ./iso.sh
 
-qemu-system-$(./target-triplet-to-arch.sh $HOST) -cdrom jkos.iso
+# Attaches a raw disk image for virtio-blk if there is one. Add
+# -global virtio-blk-pci.disable-legacy=on to test the modern transport.
+DISK=${DISK:-disk.img}
+if [ -f "$DISK" ]; then
+  set -- -drive file="$DISK",if=virtio,format=raw "$@"
+fi
+
+qemu-system-$(./target-triplet-to-arch.sh $HOST) -cdrom jkos.iso "$@"
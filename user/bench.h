@@ -0,0 +1,24 @@
+#ifndef _USER_BENCH_H
+#define _USER_BENCH_H 1
+
+#include <stdint.h>
+
+/*
+ * Shared by the benchmark programs.
+ *
+ * Some of them count the system calls libc makes by defining a libc
+ * function themselves, such as write() or futex_wait(), that bumps a
+ * counter and then makes the same system call. libc.a holds one function
+ * per object file, and the linker only takes an object file from it to
+ * resolve a symbol the program left undefined. The program's definition
+ * therefore replaces libc's for every caller, libc's own included.
+ */
+
+/* Reads the time stamp counter, in cycles. */
+static inline uint64_t rdtsc(void) {
+	uint32_t low, high;
+	asm volatile("RDTSC" : "=a" (low), "=d" (high));
+	return ((uint64_t) high << 32) | low;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <sys/vdso.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/*
+ * Compares reading the clock through the shared data page, which is what
+ * clock_gettime() does, with asking the kernel through SYSCALL_CLOCK_GETTIME.
+ * Both read the same clock, so a syscall read taken between two page reads
+ * must fall between them, and consecutive page reads must never go back.
+ */
+#define BENCH_READS 100000
+#define BENCH_CHECKS 1000
+
+static inline uint64_t timespec_ns(const struct timespec* time) {
+	return (uint64_t) time->tv_sec * 1000000000 + (uint64_t) time->tv_nsec;
+}
+
+int main(void) {
+	const volatile VdsoData* data = vdso_data();
+	struct timespec time;
+	uint64_t previous = 0;
+	uint32_t backwards = 0;
+	uint32_t outside = 0;
+	uint64_t start, page_cycles, syscall_cycles;
+
+	printf("\nclock-bench: %s, %ld CPUs, features %x, TSC %u kHz",
+		(const char*) data->cpu_vendor, sysconf(_SC_NPROCESSORS_ONLN), data->cpu_features, data->tsc_khz);
+
+	start = rdtsc();
+	for (uint32_t i = 0; i < BENCH_READS; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		uint64_t now = timespec_ns(&time);
+
+		backwards += now < previous;
+		previous = now;
+	}
+	page_cycles = rdtsc() - start;
+
+	start = rdtsc();
+	for (uint32_t i = 0; i < BENCH_READS; i++)
+		syscall(SYSCALL_CLOCK_GETTIME, CLOCK_MONOTONIC, &time);
+	syscall_cycles = rdtsc() - start;
+
+	for (uint32_t i = 0; i < BENCH_CHECKS; i++) {
+		uint64_t before, kernel, after;
+
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		before = timespec_ns(&time);
+		syscall(SYSCALL_CLOCK_GETTIME, CLOCK_MONOTONIC, &time);
+		kernel = timespec_ns(&time);
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		after = timespec_ns(&time);
+		outside += kernel < before || kernel > after;
+	}
+
+	printf("\nclock-bench: shared page %llu cycles per read, system call %llu cycles per read (%u reads)",
+		page_cycles / BENCH_READS, syscall_cycles / BENCH_READS, BENCH_READS);
+	printf("\nclock-bench: %u backward steps, %u of %u system call reads out of order, uptime %u.%09u s\n",
+		backwards, outside, BENCH_CHECKS, (uint32_t) time.tv_sec, (uint32_t) time.tv_nsec);
+	return 0;
+}
@@ -0,0 +1,217 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/futex.h>
+#include <sys/syscall.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/*
+ * Cost of mutexes and condition variables, and how often they enter the
+ * kernel.
+ *
+ * The uncontended phase locks and unlocks a mutex, and signals a condition
+ * nobody waits on, from a single thread: neither may make a system call.
+ *
+ * The contended phases run 1 to BENCH_THREADS_MAX threads that increment a
+ * shared counter under one lock, the futex mutex against a spinlock that
+ * yields whenever it finds the lock taken. Threads are not preempted, so
+ * each thread yields while holding the lock every BENCH_HOLD iterations,
+ * which makes the others find it taken, and again after unlocking, which
+ * lets them in. The counter must come out exact either way.
+ *
+ * The ping-pong phase hands a token back and forth between the main thread
+ * and another one through a condition variable, each hand-off a sleep and
+ * a wake-up.
+ */
+#define BENCH_UNCONTENDED 1000000
+#define BENCH_ITERATIONS 20000
+#define BENCH_HOLD 16
+#define BENCH_THREADS_MAX 8
+#define BENCH_ROUNDS 10000
+
+typedef struct BenchLock {
+	const char* name;
+	void (*lock)(void);
+	void (*unlock)(void);
+} BenchLock;
+
+static mtx_t bench_mutex;
+static volatile char bench_spin;
+static uint32_t bench_counter;
+static const BenchLock* bench_lock;
+
+static cnd_t bench_turn;
+static uint32_t bench_token;
+
+static uint32_t bench_waits;
+static uint32_t bench_wakes;
+
+/* Replace libc's futex calls to count the system calls made, see bench.h. */
+int futex_wait(volatile int* word, int expected) {
+	long result;
+
+	__atomic_add_fetch(&bench_waits, 1, __ATOMIC_RELAXED);
+	result = syscall(SYSCALL_FUTEX_WAIT, word, expected);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return 0;
+}
+
+int futex_wake(volatile int* word, int count) {
+	long result;
+
+	__atomic_add_fetch(&bench_wakes, 1, __ATOMIC_RELAXED);
+	result = syscall(SYSCALL_FUTEX_WAKE, word, count);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return (int) result;
+}
+
+static void mutex_lock(void) {
+	mtx_lock(&bench_mutex);
+}
+
+static void mutex_unlock(void) {
+	mtx_unlock(&bench_mutex);
+}
+
+static void spin_lock(void) {
+	while (__atomic_test_and_set(&bench_spin, __ATOMIC_ACQUIRE))
+		thrd_yield();
+}
+
+static void spin_unlock(void) {
+	__atomic_clear(&bench_spin, __ATOMIC_RELEASE);
+}
+
+static const BenchLock bench_locks[] = {
+	{ "futex mutex", mutex_lock, mutex_unlock },
+	{ "yielding spinlock", spin_lock, spin_unlock },
+};
+
+static void bench_reset(void) {
+	bench_waits = 0;
+	bench_wakes = 0;
+}
+
+static void bench_uncontended(void) {
+	uint64_t start, lock_cycles, signal_cycles;
+
+	bench_reset();
+	start = rdtsc();
+	for (uint32_t i = 0; i < BENCH_UNCONTENDED; i++) {
+		mtx_lock(&bench_mutex);
+		mtx_unlock(&bench_mutex);
+	}
+	lock_cycles = rdtsc() - start;
+
+	start = rdtsc();
+	for (uint32_t i = 0; i < BENCH_UNCONTENDED; i++)
+		cnd_signal(&bench_turn);
+	signal_cycles = rdtsc() - start;
+
+	printf("\nfutex-bench: uncontended lock+unlock %llu cycles, signal %llu cycles, %u system calls",
+		lock_cycles / BENCH_UNCONTENDED, signal_cycles / BENCH_UNCONTENDED, bench_waits + bench_wakes);
+}
+
+static int bench_worker(void* arg) {
+	(void) arg;
+
+	for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+		bench_lock->lock();
+		bench_counter++;
+		if (i % BENCH_HOLD == 0)
+			thrd_yield();
+		bench_lock->unlock();
+		if (i % BENCH_HOLD == BENCH_HOLD / 2)
+			thrd_yield();
+	}
+	return 0;
+}
+
+static void bench_contended(const BenchLock* lock, uint32_t threads) {
+	thrd_t workers[BENCH_THREADS_MAX];
+	uint32_t started = 0;
+	uint64_t start, cycles;
+
+	bench_lock = lock;
+	bench_counter = 0;
+	bench_reset();
+
+	start = rdtsc();
+	while (started < threads && thrd_create(&workers[started], bench_worker, NULL) == thrd_success)
+		started++;
+	for (uint32_t i = 0; i < started; i++)
+		thrd_join(workers[i], NULL);
+	cycles = rdtsc() - start;
+
+	if (!started) {
+		printf("\nfutex-bench: %s: no thread could be started", lock->name);
+		return;
+	}
+	printf("\nfutex-bench: %s, %u threads: %llu cycles per increment, %u waits, %u wakes, counter %s",
+		lock->name, started, cycles / (started * BENCH_ITERATIONS), bench_waits, bench_wakes,
+		bench_counter == started * BENCH_ITERATIONS ? "exact" : "WRONG");
+}
+
+static int bench_ponger(void* arg) {
+	uint32_t side = (uint32_t) (uintptr_t) arg;
+
+	mtx_lock(&bench_mutex);
+	for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+		while (bench_token % 2 != side)
+			cnd_wait(&bench_turn, &bench_mutex);
+		bench_token++;
+		cnd_signal(&bench_turn);
+	}
+	mtx_unlock(&bench_mutex);
+	return 0;
+}
+
+static void bench_ping_pong(void) {
+	thrd_t partner;
+	uint64_t start, cycles;
+
+	bench_token = 0;
+	bench_reset();
+
+	start = rdtsc();
+	if (thrd_create(&partner, bench_ponger, (void*) 1) != thrd_success) {
+		printf("\nfutex-bench: condition ping-pong: no thread could be started");
+		return;
+	}
+	bench_ponger((void*) 0);
+	thrd_join(partner, NULL);
+	cycles = rdtsc() - start;
+
+	printf("\nfutex-bench: condition ping-pong: %u hand-offs, %llu cycles each, %u waits, %u wakes",
+		bench_token, cycles / bench_token, bench_waits, bench_wakes);
+}
+
+int main(void) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	mtx_init(&bench_mutex, mtx_plain);
+	cnd_init(&bench_turn);
+
+	printf("\nfutex-bench: %ld CPU%s%s", cpus, cpus == 1 ? "" : "s",
+		cpus == 1 ? ", threads take turns on one CPU" : "");
+	bench_uncontended();
+	for (size_t i = 0; i < sizeof(bench_locks) / sizeof(bench_locks[0]); i++) {
+		for (uint32_t threads = 1; threads <= BENCH_THREADS_MAX; threads *= 2)
+			bench_contended(&bench_locks[i], threads);
+	}
+	bench_ping_pong();
+	putchar('\n');
+
+	mtx_destroy(&bench_mutex);
+	cnd_destroy(&bench_turn);
+	return 0;
+}
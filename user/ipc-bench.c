@@ -0,0 +1,269 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/channel.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/vdso.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/*
+ * Message passing between two processes, a channel against a plain pipe.
+ * Each phase forks a sender and times the receiving parent from the fork
+ * to the last message.
+ *
+ * The small message phases send BENCH_MESSAGES messages of BENCH_MESSAGE
+ * bytes, each carrying its sequence number: through write() and read() on
+ * a pipe, which copies every message into the kernel and out again, and
+ * through the channel's shared ring.
+ *
+ * The large buffer phases send BENCH_BUFFERS buffers of BENCH_BUFFER_SIZE
+ * bytes. Over the pipe the sender fills and writes the same buffer every
+ * time. Over the channel it fills fresh pages and gives them away, and the
+ * receiver unmaps them when done, so each buffer pays for its page faults
+ * instead of two copies.
+ */
+#define BENCH_MESSAGES 100000
+#define BENCH_MESSAGE 64
+#define BENCH_BUFFERS 64
+#define BENCH_BUFFER_SIZE (1024 * 1024)
+
+static uint8_t bench_buffer[BENCH_BUFFER_SIZE];
+static uint32_t bench_waits;
+
+/* Replaces libc's futex_wait() to count how often the receiver sleeps, see
+   bench.h. */
+int futex_wait(volatile int* word, int expected) {
+	long result;
+
+	bench_waits++;
+	result = syscall(SYSCALL_FUTEX_WAIT, word, expected);
+	if (result < 0) {
+		errno = (int) -result;
+		return -1;
+	}
+	return 0;
+}
+
+/* Events per second for count events in cycles, from the TSC frequency. */
+static uint32_t bench_per_second(uint64_t count, uint64_t cycles) {
+	uint32_t khz = vdso_data()->tsc_khz;
+
+	if (!khz || !cycles)
+		return 0;
+	return (uint32_t) (count * khz * 1000 / cycles);
+}
+
+static void bench_report_rate(const char* name, uint64_t cycles, uint32_t errors) {
+	uint32_t khz = vdso_data()->tsc_khz;
+	uint32_t mb = khz && cycles ? (uint32_t) ((uint64_t) BENCH_BUFFERS * BENCH_BUFFER_SIZE * khz / cycles / 1000) : 0;
+
+	printf("\nipc-bench: %s, %u x %u KiB: %u.%03u GB/s, %u bad buffers",
+		name, BENCH_BUFFERS, BENCH_BUFFER_SIZE / 1024, mb / 1000, mb % 1000, errors);
+}
+
+static void bench_fill(uint8_t* buffer, uint32_t i) {
+	memset(buffer, (int) (i & 0xFF), BENCH_BUFFER_SIZE);
+}
+
+static uint32_t bench_check(const uint8_t* buffer, uint32_t i) {
+	return buffer[0] != (uint8_t) i || buffer[BENCH_BUFFER_SIZE - 1] != (uint8_t) i;
+}
+
+/* Reads exactly count bytes, the pipe may hand them out in pieces. */
+static int bench_read_all(int fd, void* buffer, size_t count) {
+	size_t done = 0;
+
+	while (done < count) {
+		ssize_t result = read(fd, (uint8_t*) buffer + done, count - done);
+
+		if (result <= 0)
+			return -1;
+		done += (size_t) result;
+	}
+	return 0;
+}
+
+static void bench_pipe_messages(void) {
+	uint32_t message[BENCH_MESSAGE / sizeof(uint32_t)] = { 0 };
+	uint32_t errors = 0;
+	uint64_t start, cycles;
+	int fds[2];
+	pid_t child;
+
+	if (pipe(fds) < 0) {
+		printf("\nipc-bench: pipe failed");
+		return;
+	}
+	start = rdtsc();
+	child = fork();
+	if (child == 0) {
+		close(fds[0]);
+		for (uint32_t i = 0; i < BENCH_MESSAGES; i++) {
+			message[0] = i;
+			write(fds[1], message, sizeof(message));
+		}
+		_exit(0);
+	}
+	close(fds[1]);
+	if (child < 0) {
+		printf("\nipc-bench: fork failed");
+		close(fds[0]);
+		return;
+	}
+
+	for (uint32_t i = 0; i < BENCH_MESSAGES; i++) {
+		if (bench_read_all(fds[0], message, sizeof(message)) < 0) {
+			errors += BENCH_MESSAGES - i;
+			break;
+		}
+		errors += message[0] != i;
+	}
+	cycles = rdtsc() - start;
+	close(fds[0]);
+
+	printf("\nipc-bench: pipe, %u x %u bytes: %u messages/s, %llu cycles each, %u bad messages",
+		BENCH_MESSAGES, BENCH_MESSAGE, bench_per_second(BENCH_MESSAGES, cycles), cycles / BENCH_MESSAGES, errors);
+}
+
+static void bench_channel_messages(void) {
+	uint32_t message[BENCH_MESSAGE / sizeof(uint32_t)] = { 0 };
+	uint32_t errors = 0;
+	uint64_t start, cycles;
+	channel_t receiver, sender;
+	pid_t child;
+
+	if (channel_open(&receiver, &sender) < 0) {
+		printf("\nipc-bench: channel_open failed");
+		return;
+	}
+	bench_waits = 0;
+	start = rdtsc();
+	child = fork();
+	if (child == 0) {
+		channel_close(&receiver);
+		for (uint32_t i = 0; i < BENCH_MESSAGES; i++) {
+			message[0] = i;
+			channel_send(&sender, message, sizeof(message));
+		}
+		_exit(0);
+	}
+	channel_close(&sender);
+	if (child < 0) {
+		printf("\nipc-bench: fork failed");
+		channel_close(&receiver);
+		return;
+	}
+
+	for (uint32_t i = 0; i < BENCH_MESSAGES; i++)
+		errors += channel_receive(&receiver, message, sizeof(message)) != sizeof(message) || message[0] != i;
+	cycles = rdtsc() - start;
+	channel_close(&receiver);
+
+	printf("\nipc-bench: channel ring, %u x %u bytes: %u messages/s, %llu cycles each, %u bad messages, receiver slept %u times",
+		BENCH_MESSAGES, BENCH_MESSAGE, bench_per_second(BENCH_MESSAGES, cycles), cycles / BENCH_MESSAGES, errors,
+		bench_waits);
+}
+
+static void bench_pipe_buffers(void) {
+	uint32_t errors = 0;
+	uint64_t start, cycles;
+	int fds[2];
+	pid_t child;
+
+	if (pipe(fds) < 0) {
+		printf("\nipc-bench: pipe failed");
+		return;
+	}
+	start = rdtsc();
+	child = fork();
+	if (child == 0) {
+		close(fds[0]);
+		for (uint32_t i = 0; i < BENCH_BUFFERS; i++) {
+			bench_fill(bench_buffer, i);
+			write(fds[1], bench_buffer, BENCH_BUFFER_SIZE);
+		}
+		_exit(0);
+	}
+	close(fds[1]);
+	if (child < 0) {
+		printf("\nipc-bench: fork failed");
+		close(fds[0]);
+		return;
+	}
+
+	for (uint32_t i = 0; i < BENCH_BUFFERS; i++) {
+		if (bench_read_all(fds[0], bench_buffer, BENCH_BUFFER_SIZE) < 0) {
+			errors += BENCH_BUFFERS - i;
+			break;
+		}
+		errors += bench_check(bench_buffer, i);
+	}
+	cycles = rdtsc() - start;
+	close(fds[0]);
+	bench_report_rate("pipe", cycles, errors);
+}
+
+static void bench_channel_buffers(void) {
+	uint32_t errors = 0;
+	uint64_t start, cycles;
+	channel_t receiver, sender;
+	pid_t child;
+
+	if (channel_open(&receiver, &sender) < 0) {
+		printf("\nipc-bench: channel_open failed");
+		return;
+	}
+	start = rdtsc();
+	child = fork();
+	if (child == 0) {
+		channel_close(&receiver);
+		for (uint32_t i = 0; i < BENCH_BUFFERS; i++) {
+			uint8_t* buffer = mmap(NULL, BENCH_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			if (buffer == MAP_FAILED)
+				break;
+			bench_fill(buffer, i);
+			if (channel_send_pages(&sender, buffer, BENCH_BUFFER_SIZE) < 0)
+				break;
+		}
+		_exit(0);
+	}
+	channel_close(&sender);
+	if (child < 0) {
+		printf("\nipc-bench: fork failed");
+		channel_close(&receiver);
+		return;
+	}
+
+	for (uint32_t i = 0; i < BENCH_BUFFERS; i++) {
+		size_t size;
+		uint8_t* buffer = channel_receive_pages(&receiver, &size);
+
+		if (!buffer) {
+			errors += BENCH_BUFFERS - i;
+			break;
+		}
+		errors += size != BENCH_BUFFER_SIZE || bench_check(buffer, i);
+		munmap(buffer, size);
+	}
+	cycles = rdtsc() - start;
+	channel_close(&receiver);
+	bench_report_rate("channel pages", cycles, errors);
+}
+
+int main(void) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	printf("\nipc-bench: %ld CPU%s%s", cpus, cpus == 1 ? "" : "s",
+		cpus == 1 ? ", sender and receiver take turns" : "");
+	bench_pipe_messages();
+	bench_channel_messages();
+	bench_pipe_buffers();
+	bench_channel_buffers();
+	putchar('\n');
+	return 0;
+}
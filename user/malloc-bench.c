@@ -0,0 +1,155 @@
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/*
+ * Allocation throughput and fragmentation of malloc().
+ *
+ * Each throughput phase keeps a working set of up to slots live blocks of
+ * random sizes: every operation picks a random slot and frees its block,
+ * or allocates one if the slot is empty. Block sizes cover the small size
+ * classes, the large end of them, and blocks mapped on their own.
+ *
+ * The fragmentation phase fills the heap with small blocks, frees three in
+ * four at random and then allocates blocks of larger classes, which cannot
+ * reuse the holes. Heap usage is reported after each step, once all
+ * blocks are gone, and after malloc_trim() has emptied the process cache,
+ * when the heap should have shrunk back to nothing.
+ */
+#define BENCH_FRAG_SMALL 8192
+#define BENCH_FRAG_LARGE 2048
+#define BENCH_KIB 1024
+
+typedef struct BenchPhase {
+	const char* name;
+	uint32_t min_size;
+	uint32_t max_size;
+	uint32_t slots;
+	uint32_t operations;
+} BenchPhase;
+
+static const BenchPhase bench_phases[] = {
+	{ "small", 16, 512, 4096, 200000 },
+	{ "medium", 512, 8192, 1024, 50000 },
+	{ "large", 16384, 262144, 16, 2000 },
+};
+
+static void* bench_slots[BENCH_FRAG_SMALL + BENCH_FRAG_LARGE];
+static uint32_t bench_seed = 0x2545F491;
+
+static inline uint32_t bench_random(void) {
+	bench_seed ^= bench_seed << 13;
+	bench_seed ^= bench_seed >> 17;
+	bench_seed ^= bench_seed << 5;
+	return bench_seed;
+}
+
+static inline uint32_t bench_size(uint32_t min, uint32_t max) {
+	return min + bench_random() % (max - min + 1);
+}
+
+static void bench_free_all(uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		free(bench_slots[i]);
+		bench_slots[i] = NULL;
+	}
+}
+
+static void bench_report(const char* step) {
+	struct mallinfo info = mallinfo();
+	uint32_t used = info.arena ? (uint32_t) ((uint64_t) info.uordblks * 100 / info.arena) : 100;
+
+	printf("\nmalloc-bench: %s: heap %u KiB, %u KiB allocated (%u%%), %u mapped blocks %u KiB",
+		step, info.arena / BENCH_KIB, info.uordblks / BENCH_KIB, used, info.hblks, info.hblkhd / BENCH_KIB);
+}
+
+static void bench_throughput(const BenchPhase* phase) {
+	uint32_t allocations = 0;
+	uint64_t start = rdtsc();
+
+	for (uint32_t i = 0; i < phase->operations; i++) {
+		void** slot = &bench_slots[bench_random() % phase->slots];
+
+		if (*slot) {
+			free(*slot);
+			*slot = NULL;
+		} else {
+			*slot = malloc(bench_size(phase->min_size, phase->max_size));
+			if (!*slot) {
+				printf("\nmalloc-bench: %s: out of memory", phase->name);
+				break;
+			}
+			*(char*) *slot = 1;
+			allocations++;
+		}
+	}
+	uint64_t cycles = rdtsc() - start;
+
+	printf("\nmalloc-bench: %s (%u-%u bytes): %u operations, %u allocations, %llu cycles per operation",
+		phase->name, phase->min_size, phase->max_size, phase->operations, allocations,
+		cycles / phase->operations);
+	bench_report(phase->name);
+	bench_free_all(phase->slots);
+}
+
+static void bench_fragmentation(void) {
+	uint64_t start;
+
+	for (uint32_t i = 0; i < BENCH_FRAG_SMALL; i++)
+		bench_slots[i] = malloc(bench_size(16, 1024));
+	bench_report("filled");
+
+	for (uint32_t i = 0; i < BENCH_FRAG_SMALL; i++) {
+		if (bench_random() % 4) {
+			free(bench_slots[i]);
+			bench_slots[i] = NULL;
+		}
+	}
+	bench_report("3/4 freed");
+
+	for (uint32_t i = BENCH_FRAG_SMALL; i < BENCH_FRAG_SMALL + BENCH_FRAG_LARGE; i++)
+		bench_slots[i] = malloc(bench_size(1025, 4096));
+	bench_report("refilled");
+
+	start = rdtsc();
+	bench_free_all(BENCH_FRAG_SMALL + BENCH_FRAG_LARGE);
+	printf("\nmalloc-bench: freed everything in %llu cycles", rdtsc() - start);
+	bench_report("empty");
+	malloc_trim(0);
+	bench_report("trimmed");
+}
+
+static void bench_realloc(void) {
+	uint32_t moves = 0;
+	uint32_t calls = 0;
+	char* buffer = NULL;
+	uint64_t start = rdtsc();
+
+	for (uint32_t size = 64; size <= 256 * BENCH_KIB; size += 64) {
+		char* grown = realloc(buffer, size);
+
+		if (!grown)
+			break;
+		moves += grown != buffer;
+		grown[size - 1] = 1;
+		buffer = grown;
+		calls++;
+	}
+	uint64_t cycles = rdtsc() - start;
+	free(buffer);
+
+	printf("\nmalloc-bench: realloc to 256 KiB in 64 byte steps: %u calls, %u moves, %llu cycles per call",
+		calls, moves, cycles / calls);
+}
+
+int main(void) {
+	for (size_t i = 0; i < sizeof(bench_phases) / sizeof(bench_phases[0]); i++)
+		bench_throughput(&bench_phases[i]);
+	bench_fragmentation();
+	bench_realloc();
+	putchar('\n');
+	return 0;
+}
@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/*
+ * Counts the write() calls stdio makes for the same output in each
+ * buffering mode. The output is BENCH_LINES lines, each written as a
+ * printf() conversion, an fputs() and a putchar(), and goes to the console
+ * like any other output.
+ */
+#define BENCH_LINES 1024
+#define BENCH_MIB (1024 * 1024)
+
+typedef struct BenchMode {
+	const char* name;
+	int mode;
+	uint32_t writes;
+	uint64_t cycles;
+} BenchMode;
+
+static BenchMode bench_modes[] = {
+	{ "unbuffered", _IONBF, 0, 0 },
+	{ "line buffered", _IOLBF, 0, 0 },
+	{ "fully buffered", _IOFBF, 0, 0 },
+};
+
+static uint32_t bench_writes;
+
+/* Replaces libc's write() to count the calls stdio makes, see bench.h. */
+ssize_t write(int fd, const void* buffer, size_t count) {
+	bench_writes++;
+	return (ssize_t) syscall(SYSCALL_WRITE, fd, buffer, count);
+}
+
+int main(void) {
+	static const char text[] = "stdio-bench: the quick brown fox jumps over the lazy dog";
+	const size_t modes = sizeof(bench_modes) / sizeof(bench_modes[0]);
+	const uint32_t bytes = BENCH_LINES * (6 + strlen(text) + 1);
+
+	for (size_t i = 0; i < modes; i++) {
+		BenchMode* mode = &bench_modes[i];
+
+		setvbuf(stdout, NULL, mode->mode, 0);
+		bench_writes = 0;
+		uint64_t start = rdtsc();
+		for (uint32_t line = 0; line < BENCH_LINES; line++) {
+			printf("%05u ", line);
+			fputs(text, stdout);
+			putchar('\n');
+		}
+		fflush(stdout);
+		mode->cycles = rdtsc() - start;
+		mode->writes = bench_writes;
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	for (size_t i = 0; i < modes; i++) {
+		BenchMode* mode = &bench_modes[i];
+
+		printf("\nstdio-bench: %s: %u write calls for %u bytes, %u per MiB, %llu cycles per KiB",
+			mode->name, mode->writes, bytes, (uint32_t) ((uint64_t) mode->writes * BENCH_MIB / bytes),
+			mode->cycles * 1024 / bytes);
+	}
+	putchar('\n');
+	return 0;
+}
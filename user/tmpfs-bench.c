@@ -0,0 +1,181 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vdso.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/*
+ * Cost of the RAM file system.
+ *
+ * The metadata phase creates, looks up and removes BENCH_FILES empty files
+ * in a fresh directory, every step a dentry cache lookup, then does the
+ * same with directories.
+ *
+ * The sequential phase writes a BENCH_FILE_SIZE file BENCH_CHUNK bytes at a
+ * time, which fills the page cache, reads it back the same way and then
+ * reads it once more through a shared mapping of the same pages. A write
+ * through the mapping must show up in read() right away.
+ */
+#define BENCH_FILES 256
+#define BENCH_FILE_SIZE (4 * 1024 * 1024)
+#define BENCH_CHUNK (64 * 1024)
+#define BENCH_PASSES 4
+
+static uint8_t bench_buffer[BENCH_CHUNK];
+
+static void bench_name(char* name, const char* directory, uint32_t i) {
+	static const char digits[] = "0123456789abcdef";
+	size_t length = strlen(directory);
+
+	memcpy(name, directory, length);
+	name[length++] = '/';
+	name[length++] = 'f';
+	for (int shift = 12; shift >= 0; shift -= 4)
+		name[length++] = digits[(i >> shift) & 0xF];
+	name[length] = '\0';
+}
+
+/* MB/s for bytes moved in cycles, from the TSC frequency. */
+static uint32_t bench_rate(uint64_t bytes, uint64_t cycles) {
+	uint32_t khz = vdso_data()->tsc_khz;
+
+	if (!khz || !cycles)
+		return 0;
+	return (uint32_t) (bytes * khz / cycles / 1000);
+}
+
+static void bench_metadata(void) {
+	char name[32];
+	struct stat info;
+	uint64_t start, create_cycles, stat_cycles, unlink_cycles, mkdir_cycles, rmdir_cycles;
+	uint32_t failed = 0;
+
+	if (mkdir("/bench", 0755) < 0) {
+		printf("\ntmpfs-bench: mkdir /bench failed");
+		return;
+	}
+
+	start = rdtsc();
+	for (uint32_t i = 0; i < BENCH_FILES; i++) {
+		bench_name(name, "/bench", i);
+		int fd = open(name, O_CREAT | O_EXCL | O_WRONLY, 0644);
+		if (fd < 0)
+			failed++;
+		else
+			close(fd);
+	}
+	create_cycles = rdtsc() - start;
+
+	start = rdtsc();
+	for (uint32_t i = 0; i < BENCH_FILES; i++) {
+		bench_name(name, "/bench", i);
+		failed += stat(name, &info) < 0 || !S_ISREG(info.st_mode);
+	}
+	stat_cycles = rdtsc() - start;
+
+	start = rdtsc();
+	for (uint32_t i = 0; i < BENCH_FILES; i++) {
+		bench_name(name, "/bench", i);
+		failed += unlink(name) < 0;
+	}
+	unlink_cycles = rdtsc() - start;
+
+	start = rdtsc();
+	for (uint32_t i = 0; i < BENCH_FILES; i++) {
+		bench_name(name, "/bench", i);
+		failed += mkdir(name, 0755) < 0;
+	}
+	mkdir_cycles = rdtsc() - start;
+
+	start = rdtsc();
+	for (uint32_t i = 0; i < BENCH_FILES; i++) {
+		bench_name(name, "/bench", i);
+		failed += rmdir(name) < 0;
+	}
+	rmdir_cycles = rdtsc() - start;
+
+	failed += rmdir("/bench") < 0;
+	printf("\ntmpfs-bench: %u files, cycles per create+close %llu, stat %llu, unlink %llu, mkdir %llu, rmdir %llu, %u failures",
+		BENCH_FILES, create_cycles / BENCH_FILES, stat_cycles / BENCH_FILES, unlink_cycles / BENCH_FILES,
+		mkdir_cycles / BENCH_FILES, rmdir_cycles / BENCH_FILES, failed);
+}
+
+static void bench_sequential(void) {
+	uint64_t start, write_cycles, read_cycles, map_cycles;
+	uint32_t sum = 0, map_sum = 0;
+	uint8_t* mapping;
+	struct stat info;
+	int fd = open("/big", O_CREAT | O_TRUNC | O_RDWR, 0644);
+
+	if (fd < 0) {
+		printf("\ntmpfs-bench: open /big failed");
+		return;
+	}
+	for (uint32_t i = 0; i < BENCH_CHUNK; i++)
+		bench_buffer[i] = (uint8_t) (i * 7);
+
+	start = rdtsc();
+	for (uint32_t done = 0; done < BENCH_FILE_SIZE; done += BENCH_CHUNK) {
+		if (write(fd, bench_buffer, BENCH_CHUNK) != BENCH_CHUNK) {
+			printf("\ntmpfs-bench: write failed at %u", done);
+			close(fd);
+			unlink("/big");
+			return;
+		}
+	}
+	write_cycles = rdtsc() - start;
+
+	start = rdtsc();
+	for (uint32_t pass = 0; pass < BENCH_PASSES; pass++) {
+		lseek(fd, 0, SEEK_SET);
+		for (uint32_t done = 0; done < BENCH_FILE_SIZE; done += BENCH_CHUNK) {
+			read(fd, bench_buffer, BENCH_CHUNK);
+			sum += bench_buffer[done / BENCH_CHUNK];
+		}
+	}
+	read_cycles = rdtsc() - start;
+
+	mapping = mmap(NULL, BENCH_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mapping == MAP_FAILED) {
+		printf("\ntmpfs-bench: mmap failed");
+		close(fd);
+		unlink("/big");
+		return;
+	}
+	start = rdtsc();
+	for (uint32_t pass = 0; pass < BENCH_PASSES; pass++) {
+		for (uint32_t done = 0; done < BENCH_FILE_SIZE; done += BENCH_CHUNK) {
+			memcpy(bench_buffer, mapping + done, BENCH_CHUNK);
+			map_sum += bench_buffer[done / BENCH_CHUNK];
+		}
+	}
+	map_cycles = rdtsc() - start;
+
+	mapping[BENCH_FILE_SIZE / 2] = 0xA5;
+	lseek(fd, BENCH_FILE_SIZE / 2, SEEK_SET);
+	read(fd, bench_buffer, 1);
+	stat("/big", &info);
+
+	printf("\ntmpfs-bench: %u KiB file, write %u MB/s, read %u MB/s, shared mapping %u MB/s",
+		BENCH_FILE_SIZE / 1024, bench_rate(BENCH_FILE_SIZE, write_cycles),
+		bench_rate((uint64_t) BENCH_FILE_SIZE * BENCH_PASSES, read_cycles),
+		bench_rate((uint64_t) BENCH_FILE_SIZE * BENCH_PASSES, map_cycles));
+	printf("\ntmpfs-bench: %ld blocks cached, read and mapping %s, mapped store %s",
+		info.st_blocks, sum == map_sum ? "agree" : "DIFFER", bench_buffer[0] == 0xA5 ? "seen" : "LOST");
+
+	munmap(mapping, BENCH_FILE_SIZE);
+	close(fd);
+	unlink("/big");
+}
+
+int main(void) {
+	bench_metadata();
+	bench_sequential();
+	putchar('\n');
+	return 0;
+}